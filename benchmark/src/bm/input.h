@@ -0,0 +1,100 @@
+#ifndef BM_INPUT_H
+#define BM_INPUT_H
+
+#include <vector>
+#include <map>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#include "benchmark/benchmark.h"
+
+#include "corpus/generate.h"
+
+
+namespace bm {
+
+/// The size of every benchmark input in bytes.
+/// All stages report bytes/sec relative to the input, so the cost of the
+/// stages of a pipeline adds up.
+const size_t input_byte_count = 1U << 20U;
+
+
+/// Return the input for benchmark arguments (corpus::shape, alphabet size),
+/// generated once and cached.
+template<typename entity_type>
+const std::vector<uint8_t>& get_input(const benchmark::State& state)
+{
+  static std::map<std::pair<int, size_t>, std::vector<uint8_t>> inputs;
+
+  const auto key = std::make_pair(
+    static_cast<int>(state.range(0)),
+    static_cast<size_t>(state.range(1))
+  );
+
+  auto it = inputs.find(key);
+  if( it == inputs.end() )
+  {
+    it = inputs.emplace(
+      key,
+      corpus::generate(
+        static_cast<corpus::shape>(key.first),
+        bm::input_byte_count,
+        sizeof(entity_type),
+        key.second
+      )
+    ).first;
+  }
+
+  return it->second;
+}
+
+
+/// Register the benchmark arguments (corpus::shape, alphabet size) that fit
+/// entity_type.
+template<typename entity_type>
+void input_args(benchmark::internal::Benchmark * b)
+{
+  b->ArgNames({"shape", "alphabet"});
+
+  const int64_t alphabet_sizes[] = {256, 65536};
+  for(auto s : corpus::shapes)
+  {
+    for(auto alphabet_size : alphabet_sizes)
+    {
+      // 1 byte entities have at most 256 distinct values, text has a fixed
+      // alphabet
+      if( alphabet_size > 256
+          && (sizeof(entity_type) == 1 || s == corpus::text) )
+        continue;
+
+      b->Args({s, alphabet_size});
+    }
+  }
+}
+
+
+/// Report the throughput of a benchmark that processed input per iteration.
+inline void set_bytes_processed(
+  benchmark::State& state,
+  const std::vector<uint8_t>& input
+)
+{
+  state.SetBytesProcessed(
+    static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(input.size())
+  );
+}
+
+
+}
+
+
+/// Register a benchmark template for entity sizes 1, 2, 4 and 8, each with
+/// the arguments of bm::input_args.
+#define BM_FOR_ENTITY_SIZES(func) \
+  BENCHMARK_TEMPLATE(func, uint8_t)->Apply(bm::input_args<uint8_t>); \
+  BENCHMARK_TEMPLATE(func, uint16_t)->Apply(bm::input_args<uint16_t>); \
+  BENCHMARK_TEMPLATE(func, uint32_t)->Apply(bm::input_args<uint32_t>); \
+  BENCHMARK_TEMPLATE(func, uint64_t)->Apply(bm::input_args<uint64_t>)
+
+#endif // BM_INPUT_H
@@ -0,0 +1,208 @@
+#ifndef BM_PERF_COUNTERS_H
+#define BM_PERF_COUNTERS_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+
+#include "benchmark/benchmark.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+
+namespace bm {
+
+/// Whether hardware counters are read around each benchmark
+/// (--perf_counters on the command line).
+inline bool& perf_counters_enabled()
+{
+  static bool enabled = false;
+  return enabled;
+}
+
+
+/// Hardware performance counters of the calling thread, read with
+/// perf_event_open(2).
+///
+/// Counters that cannot be opened (e.g. no PMU in a virtual machine, or
+/// kernel.perf_event_paranoid too strict) are skipped with a warning; on
+/// other platforms there are no counters at all.
+class perf_counters
+{
+public:
+  /// The name and value of a counter.
+  typedef std::pair<std::string, double> value_type;
+
+  perf_counters()
+  : counters()
+  {
+#ifdef __linux__
+    const auto cache = [](uint64_t cache_id) {
+      return cache_id
+        | (static_cast<uint64_t>(PERF_COUNT_HW_CACHE_OP_READ) << 8U)
+        | (static_cast<uint64_t>(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16U);
+    };
+
+    this->open("cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    this->open("instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    this->open("branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    this->open("l1d_misses", PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_L1D));
+    this->open("llc_misses", PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_LL));
+#else
+    std::cerr << "Warning: hardware counters are only available on linux\n";
+#endif
+  }
+
+  ~perf_counters()
+  {
+#ifdef __linux__
+    for(const auto& c : this->counters)
+      ::close(c.fd);
+#endif
+  }
+
+  perf_counters(const perf_counters&) = delete;
+  perf_counters& operator=(const perf_counters&) = delete;
+
+  /// Reset and start all counters.
+  void start()
+  {
+#ifdef __linux__
+    for(const auto& c : this->counters)
+    {
+      ::ioctl(c.fd, PERF_EVENT_IOC_RESET, 0);
+      ::ioctl(c.fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  /// Stop all counters and return their values since start.
+  /// Values are scaled up if the kernel multiplexed the counters.
+  std::vector<value_type> stop()
+  {
+    std::vector<value_type> values;
+
+#ifdef __linux__
+    for(const auto& c : this->counters)
+      ::ioctl(c.fd, PERF_EVENT_IOC_DISABLE, 0);
+
+    for(const auto& c : this->counters)
+    {
+      // value, time enabled, time running
+      uint64_t buffer[3] = {0};
+      if( ::read(c.fd, buffer, sizeof(buffer)) != static_cast<ssize_t>(sizeof(buffer))
+          || buffer[2] == 0 )
+        continue;
+
+      const double scale = static_cast<double>(buffer[1]) / static_cast<double>(buffer[2]);
+      values.push_back(value_type(c.name, static_cast<double>(buffer[0]) * scale));
+    }
+#endif
+
+    return values;
+  }
+
+private:
+#ifdef __linux__
+  struct counter
+  {
+    std::string name;
+    int fd;
+  };
+
+  void open(const char * name, uint32_t type, uint64_t config)
+  {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // this thread, any cpu
+    const long fd = ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if( fd < 0 )
+    {
+      std::cerr << "Warning: hardware counter " << name << " is unavailable: "
+                << std::strerror(errno) << "\n";
+      return;
+    }
+
+    this->counters.push_back(counter{name, static_cast<int>(fd)});
+  }
+#else
+  struct counter {};
+#endif
+
+  std::vector<counter> counters;
+};
+
+
+/// Reads the hardware counters from construction to destruction and reports
+/// them per iteration as counters of the benchmark. Construct it right
+/// before the benchmark loop. Does nothing unless perf_counters_enabled().
+///
+/// Benchmarks run single threaded, the counters are opened once and shared.
+class perf_scope
+{
+public:
+  explicit perf_scope(benchmark::State& s)
+  : state(s),
+    counters(bm::perf_counters_enabled() ? &perf_scope::shared_counters() : nullptr)
+  {
+    if( this->counters )
+      this->counters->start();
+  }
+
+  ~perf_scope()
+  {
+    if( !this->counters )
+      return;
+
+    double cycles = 0;
+    double instructions = 0;
+    for(const auto& value : this->counters->stop())
+    {
+      this->state.counters[value.first] =
+        benchmark::Counter(value.second, benchmark::Counter::kAvgIterations);
+
+      if( value.first == "cycles" )
+        cycles = value.second;
+      else if( value.first == "instructions" )
+        instructions = value.second;
+    }
+
+    if( cycles > 0 && instructions > 0 )
+      this->state.counters["ipc"] = instructions / cycles;
+  }
+
+  perf_scope(const perf_scope&) = delete;
+  perf_scope& operator=(const perf_scope&) = delete;
+
+private:
+  static bm::perf_counters& shared_counters()
+  {
+    static bm::perf_counters counters;
+    return counters;
+  }
+
+  benchmark::State& state;
+  bm::perf_counters * counters;
+};
+
+
+}
+
+#endif // BM_PERF_COUNTERS_H
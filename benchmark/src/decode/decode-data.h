@@ -0,0 +1,47 @@
+#include "benchmark/benchmark.h"
+
+#include <vector>
+#include <cstdint>
+#include <iterator>
+
+#include "hm/encode.h"
+#include "hm/decode.h"
+
+#include "bm/input.h"
+#include "bm/perf-counters.h"
+
+namespace {
+
+template<typename entity_type>
+static void BM_DecodeData(benchmark::State& state)
+{
+  typedef hm::byte_entity<sizeof(entity_type)> decode_type;
+
+  const auto& input = bm::get_input<entity_type>(state);
+  auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+
+  std::vector<uint8_t> encoded;
+  const auto md = hm::encode(input.begin(), input.end(), tree.get(), std::back_inserter(encoded));
+
+  const auto entities = hm::decode_entities<decode_type>(encoded.begin(), encoded.end(), md);
+  auto entities_end = encoded.begin() + hm::entity_section_byte_count(md);
+  const auto dec_tree = hm::decode_tree(entities_end, encoded.end(), entities, md);
+  const auto data_begin = entities_end + md.tree_byte_count;
+
+  std::vector<uint8_t> out;
+  out.reserve(input.size());
+
+  bm::perf_scope perf(state);
+  while( state.KeepRunning() )
+  {
+    out.clear();
+    hm::decode_data(data_begin, encoded.end(), dec_tree.get(), md, std::back_inserter(out));
+    benchmark::DoNotOptimize(out.data());
+  }
+
+  bm::set_bytes_processed(state, input);
+}
+BM_FOR_ENTITY_SIZES(BM_DecodeData);
+
+
+}
@@ -0,0 +1,48 @@
+#include "benchmark/benchmark.h"
+
+#include <vector>
+#include <cstdint>
+#include <iterator>
+
+#include "hm/encode.h"
+#include "hm/decode.h"
+
+#include "bm/input.h"
+#include "bm/perf-counters.h"
+
+namespace {
+
+/// Decode the entity and the tree section.
+template<typename entity_type>
+static void BM_DecodeTree(benchmark::State& state)
+{
+  typedef hm::byte_entity<sizeof(entity_type)> decode_type;
+
+  const auto& input = bm::get_input<entity_type>(state);
+  auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+
+  std::vector<uint8_t> sections;
+  hm::meta md;
+  md.entity_size = sizeof(entity_type);
+  hm::encode_entities(tree.get(), std::back_inserter(sections), md);
+  hm::encode_tree(tree.get(), std::back_inserter(sections), md);
+
+  const auto tree_begin = sections.begin() + hm::entity_section_byte_count(md);
+
+  bm::perf_scope perf(state);
+  while( state.KeepRunning() )
+  {
+    auto entities = hm::decode_entities<decode_type>(sections.begin(), tree_begin, md);
+    auto dec_tree = hm::decode_tree(tree_begin, sections.end(), entities, md);
+    benchmark::DoNotOptimize(dec_tree);
+  }
+
+  bm::set_bytes_processed(state, input);
+  state.SetItemsProcessed(
+    static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(md.entity_count)
+  );
+}
+BM_FOR_ENTITY_SIZES(BM_DecodeTree);
+
+
+}
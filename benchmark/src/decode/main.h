@@ -0,0 +1,2 @@
+#include "decode/decode-tree.h"
+#include "decode/decode-data.h"
@@ -0,0 +1,30 @@
+#include "benchmark/benchmark.h"
+
+#include <vector>
+#include <cstdint>
+
+#include "hm/encode.h"
+
+#include "bm/input.h"
+#include "bm/perf-counters.h"
+
+namespace {
+
+template<typename entity_type>
+static void BM_BuildFrequencyTable(benchmark::State& state)
+{
+  const auto& input = bm::get_input<entity_type>(state);
+
+  bm::perf_scope perf(state);
+  while( state.KeepRunning() )
+  {
+    auto table = hm::build_frequency_table<entity_type>(input.begin(), input.end());
+    benchmark::DoNotOptimize(table);
+  }
+
+  bm::set_bytes_processed(state, input);
+}
+BM_FOR_ENTITY_SIZES(BM_BuildFrequencyTable);
+
+
+}
@@ -9,6 +9,10 @@
 #include "hm/common.h"
 #include "hm/encode.h"
 
+#include "corpus/generate.h"
+#include "bm/input.h"
+#include "bm/perf-counters.h"
+
 namespace old {
 
 template<
@@ -43,18 +47,17 @@ orig_build_huffman_table(
 
 namespace {
 
-/// create a huffman tree with unique leaves
+/// create a huffman tree from a zipf distributed corpus with num_leaves
+/// distinct entities
 std::unique_ptr<hm::enc_node<uint64_t>> build_tree(size_t num_leaves)
 {
-  std::vector<uint64_t> vec(num_leaves);
-  for(uint64_t i = 0; i < vec.size(); ++i)
-  {
-    vec[i] = i;
-  }
-  uint8_t * begin = reinterpret_cast<uint8_t *>(vec.data());
-  uint8_t * end = reinterpret_cast<uint8_t *>(vec.data() + vec.size());
-  auto tree = hm::build_huffman_tree<uint64_t>(begin, end);
-  return std::move(tree);
+  const auto input = corpus::generate(
+    corpus::zipf,
+    bm::input_byte_count,
+    sizeof(uint64_t),
+    num_leaves
+  );
+  return hm::build_huffman_tree<uint64_t>(input.begin(), input.end());
 }
 
 hm::enc_node<uint64_t> * get_tree()
@@ -65,9 +68,9 @@ hm::enc_node<uint64_t> * get_tree()
 
 static void BM_BuildHuffmanTable(benchmark::State& state)
 {
-  state.PauseTiming();
+  // only the loop is timed
   auto tree = get_tree();
-  state.ResumeTiming();
+  bm::perf_scope perf(state);
   while( state.KeepRunning() )
   {
     std::unordered_map<uint64_t, hm::code_type> table;
@@ -80,9 +83,9 @@ BENCHMARK(BM_BuildHuffmanTable);
 
 static void BM_BuildHuffmanTableOriginal(benchmark::State& state)
 {
-  state.PauseTiming();
+  // only the loop is timed
   auto tree = get_tree();
-  state.ResumeTiming();
+  bm::perf_scope perf(state);
   while( state.KeepRunning() )
   {
     std::unordered_map<uint64_t, hm::code_type> table;
@@ -0,0 +1,34 @@
+#include "benchmark/benchmark.h"
+
+#include <vector>
+#include <cstdint>
+
+#include "hm/encode.h"
+
+#include "bm/input.h"
+#include "bm/perf-counters.h"
+
+namespace {
+
+template<typename entity_type>
+static void BM_BuildHuffmanTree(benchmark::State& state)
+{
+  const auto& input = bm::get_input<entity_type>(state);
+  const auto table = hm::build_frequency_table<entity_type>(input.begin(), input.end());
+
+  bm::perf_scope perf(state);
+  while( state.KeepRunning() )
+  {
+    auto tree = hm::build_huffman_tree(table);
+    benchmark::DoNotOptimize(tree);
+  }
+
+  bm::set_bytes_processed(state, input);
+  state.SetItemsProcessed(
+    static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(table.size())
+  );
+}
+BM_FOR_ENTITY_SIZES(BM_BuildHuffmanTree);
+
+
+}
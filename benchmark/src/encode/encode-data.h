@@ -0,0 +1,37 @@
+#include "benchmark/benchmark.h"
+
+#include <vector>
+#include <cstdint>
+#include <iterator>
+
+#include "hm/encode.h"
+
+#include "bm/input.h"
+#include "bm/perf-counters.h"
+
+namespace {
+
+template<typename entity_type>
+static void BM_EncodeData(benchmark::State& state)
+{
+  const auto& input = bm::get_input<entity_type>(state);
+  auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+
+  std::vector<uint8_t> out;
+  out.reserve(input.size());
+
+  bm::perf_scope perf(state);
+  while( state.KeepRunning() )
+  {
+    out.clear();
+    hm::meta md;
+    hm::encode_data(input.begin(), input.end(), tree.get(), std::back_inserter(out), md);
+    benchmark::DoNotOptimize(out.data());
+  }
+
+  bm::set_bytes_processed(state, input);
+}
+BM_FOR_ENTITY_SIZES(BM_EncodeData);
+
+
+}
@@ -0,0 +1,43 @@
+#include "benchmark/benchmark.h"
+
+#include <vector>
+#include <cstdint>
+#include <iterator>
+
+#include "hm/encode.h"
+
+#include "bm/input.h"
+#include "bm/perf-counters.h"
+
+namespace {
+
+/// Encode the entity and the tree section.
+template<typename entity_type>
+static void BM_EncodeTree(benchmark::State& state)
+{
+  const auto& input = bm::get_input<entity_type>(state);
+  auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+
+  std::vector<uint8_t> out;
+  hm::meta md;
+
+  bm::perf_scope perf(state);
+  while( state.KeepRunning() )
+  {
+    out.clear();
+    md = hm::meta();
+    md.entity_size = sizeof(entity_type);
+    hm::encode_entities(tree.get(), std::back_inserter(out), md);
+    hm::encode_tree(tree.get(), std::back_inserter(out), md);
+    benchmark::DoNotOptimize(out.data());
+  }
+
+  bm::set_bytes_processed(state, input);
+  state.SetItemsProcessed(
+    static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(md.entity_count)
+  );
+}
+BM_FOR_ENTITY_SIZES(BM_EncodeTree);
+
+
+}
@@ -0,0 +1,166 @@
+#include "benchmark/benchmark.h"
+
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include <thread>
+#include <algorithm>
+
+#include "hm/common.h"
+#include "hm/encode.h"
+#include "hm/flat-map.h"
+#include "hm/radix-count.h"
+
+#include "corpus/generate.h"
+#include "bm/input.h"
+#include "bm/perf-counters.h"
+
+namespace {
+
+/// The tables of the encoder for 4 and 8 byte entities before and after
+/// hm::flat_map.
+typedef std::unordered_map<uint32_t, size_t> node_frequencies_32;
+typedef std::unordered_map<uint64_t, size_t> node_frequencies_64;
+typedef hm::flat_map<uint32_t, size_t> flat_frequencies_32;
+typedef hm::flat_map<uint64_t, size_t> flat_frequencies_64;
+
+typedef std::unordered_map<uint32_t, hm::code_type> node_codes_32;
+typedef std::unordered_map<uint64_t, hm::code_type> node_codes_64;
+typedef hm::flat_map<uint32_t, hm::code_type> flat_codes_32;
+typedef hm::flat_map<uint64_t, hm::code_type> flat_codes_64;
+
+
+/// Return a uniform input with 4 entities per symbol of the alphabet
+/// (argument 0), so that all symbols occur. Unlike bm::get_input the size
+/// grows with the alphabet, up to 32 MiB for 1M 8 byte entities.
+template<typename entity_type>
+const std::vector<uint8_t>& get_alphabet_input(const benchmark::State& state)
+{
+  static std::map<size_t, std::vector<uint8_t>> inputs;
+
+  const auto alphabet_size = static_cast<size_t>(state.range(0));
+  auto it = inputs.find(alphabet_size);
+  if( it == inputs.end() )
+  {
+    it = inputs.emplace(
+      alphabet_size,
+      corpus::generate(
+        corpus::uniform,
+        4 * alphabet_size * sizeof(entity_type),
+        sizeof(entity_type),
+        alphabet_size
+      )
+    ).first;
+  }
+
+  return it->second;
+}
+
+
+/// Register alphabets of 1k to 1M distinct entities.
+void alphabet_args(benchmark::internal::Benchmark * b)
+{
+  b->ArgNames({"alphabet"});
+  b->RangeMultiplier(4)->Range(1 << 10, 1 << 20);
+}
+
+
+template<typename table_type>
+static void BM_CountEntities(benchmark::State& state)
+{
+  typedef typename table_type::key_type entity_type;
+  const auto& input = get_alphabet_input<entity_type>(state);
+
+  bm::perf_scope perf(state);
+  while( state.KeepRunning() )
+  {
+    table_type table;
+    hm::count_entities<entity_type>(
+      input.begin(),
+      input.end(),
+      table,
+      std::false_type()
+    );
+    benchmark::DoNotOptimize(table);
+  }
+
+  bm::set_bytes_processed(state, input);
+}
+BENCHMARK_TEMPLATE(BM_CountEntities, node_frequencies_32)->Apply(alphabet_args);
+BENCHMARK_TEMPLATE(BM_CountEntities, flat_frequencies_32)->Apply(alphabet_args);
+BENCHMARK_TEMPLATE(BM_CountEntities, node_frequencies_64)->Apply(alphabet_args);
+BENCHMARK_TEMPLATE(BM_CountEntities, flat_frequencies_64)->Apply(alphabet_args);
+
+
+template<typename table_type>
+static void BM_LookupCodes(benchmark::State& state)
+{
+  typedef typename table_type::key_type entity_type;
+  const auto& input = get_alphabet_input<entity_type>(state);
+
+  auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+  table_type table;
+  hm::code_type prefix;
+  hm::build_huffman_table(tree.get(), table, prefix);
+
+  std::vector<uint8_t> out;
+  out.reserve(input.size());
+
+  // the data section is the lookup per entity and appending the code
+  bm::perf_scope perf(state);
+  while( state.KeepRunning() )
+  {
+    out.clear();
+    hm::meta md;
+    hm::encode_data(input.begin(), input.end(), table, std::back_inserter(out), md);
+    benchmark::DoNotOptimize(out.data());
+  }
+
+  bm::set_bytes_processed(state, input);
+}
+BENCHMARK_TEMPLATE(BM_LookupCodes, node_codes_32)->Apply(alphabet_args);
+BENCHMARK_TEMPLATE(BM_LookupCodes, flat_codes_32)->Apply(alphabet_args);
+BENCHMARK_TEMPLATE(BM_LookupCodes, node_codes_64)->Apply(alphabet_args);
+BENCHMARK_TEMPLATE(BM_LookupCodes, flat_codes_64)->Apply(alphabet_args);
+
+
+/// Counting by sorting instead of hashing, on one thread (argument 1) or
+/// all hardware threads, for comparison with BM_CountEntities.
+template<typename entity_type>
+static void BM_RadixCount(benchmark::State& state)
+{
+  const auto& input = get_alphabet_input<entity_type>(state);
+  const auto thread_count = static_cast<size_t>(state.range(1));
+
+  bm::perf_scope perf(state);
+  while( state.KeepRunning() )
+  {
+    hm::radix_counter<entity_type> counter(thread_count);
+    counter.add(input.data(), input.size());
+    benchmark::DoNotOptimize(counter.histogram().counts.data());
+  }
+
+  bm::set_bytes_processed(state, input);
+}
+
+/// Register alphabets of 1k to 1M distinct entities on 1 and all threads.
+void radix_args(benchmark::internal::Benchmark * b)
+{
+  const auto hardware_threads =
+    std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+  b->ArgNames({"alphabet", "threads"});
+  for(int alphabet = 1 << 10; alphabet <= (1 << 20); alphabet *= 4)
+  {
+    b->Args({alphabet, 1});
+    if( hardware_threads > 1 )
+      b->Args({alphabet, hardware_threads});
+  }
+}
+BENCHMARK_TEMPLATE(BM_RadixCount, uint32_t)->Apply(radix_args)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_RadixCount, uint64_t)->Apply(radix_args)->UseRealTime();
+
+
+}
@@ -1,2 +1,6 @@
 #include "encode/build-huffman-table.h"
-
+#include "encode/build-frequency-table.h"
+#include "encode/build-huffman-tree.h"
+#include "encode/encode-tree.h"
+#include "encode/encode-data.h"
+#include "encode/entity-map.h"
@@ -0,0 +1,148 @@
+#include "benchmark/benchmark.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+
+#include <unistd.h>
+
+#include "corpus/generate.h"
+#include "sp/uring-streambuf.h"
+
+#include "bm/perf-counters.h"
+
+namespace {
+
+namespace bm_io {
+
+  /// The size of the file read and written by the I/O benchmarks.
+  const size_t file_byte_count = 64U << 20U;
+
+  /// The size of a single sgetn or sputn, like the blocks of copy_stream.
+  const size_t chunk_byte_count = 64U * 1024U;
+
+  /// A file of file_byte_count bytes in $TMPDIR (default /tmp), removed at
+  /// exit. Point TMPDIR at the device to measure.
+  class temp_file
+  {
+  public:
+    temp_file()
+    : name()
+    {
+      const char * dir = std::getenv("TMPDIR");
+      std::string pattern = std::string(dir ? dir : "/tmp") + "/huffman-benchmark-XXXXXX";
+
+      std::vector<char> buffer(pattern.begin(), pattern.end());
+      buffer.push_back('\0');
+      const int fd = ::mkstemp(buffer.data());
+      if( fd >= 0 )
+        ::close(fd);
+      this->name = buffer.data();
+
+      const auto data = corpus::generate(corpus::zipf, file_byte_count, 1, 256);
+      std::ofstream out(this->name, std::ios::binary);
+      out.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+    }
+
+    ~temp_file()
+    {
+      std::remove(this->name.c_str());
+    }
+
+    temp_file(const temp_file&) = delete;
+    temp_file& operator=(const temp_file&) = delete;
+
+    std::string name;
+  };
+
+  inline const temp_file& input_file()
+  {
+    static temp_file file;
+    return file;
+  }
+
+  inline void set_bytes_processed(benchmark::State& state)
+  {
+    state.SetBytesProcessed(
+      static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(file_byte_count)
+    );
+  }
+
+}
+
+/// Read the whole file like the command line tool does, through
+/// std::ifstream (uring = false) or sp::uring_istreambuf (--io uring).
+template<bool uring>
+static void BM_ReadFile(benchmark::State& state)
+{
+  const std::string& name = bm_io::input_file().name;
+  std::vector<char> chunk(bm_io::chunk_byte_count);
+
+  bm::perf_scope perf(state);
+  while( state.KeepRunning() )
+  {
+    std::ifstream file;
+    std::unique_ptr<sp::uring_istreambuf> uring_buf;
+    std::streambuf * buf = nullptr;
+    if( uring )
+    {
+      uring_buf.reset(new sp::uring_istreambuf(name));
+      buf = uring_buf.get();
+    }
+    else
+    {
+      file.open(name, std::ios::binary);
+      buf = file.rdbuf();
+    }
+
+    uint64_t total = 0;
+    std::streamsize n = 0;
+    while( (n = buf->sgetn(chunk.data(), static_cast<std::streamsize>(chunk.size()))) > 0 )
+      total += static_cast<uint64_t>(n);
+
+    benchmark::DoNotOptimize(total);
+  }
+
+  bm_io::set_bytes_processed(state);
+}
+BENCHMARK_TEMPLATE(BM_ReadFile, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_ReadFile, true)->Unit(benchmark::kMillisecond);
+
+
+/// Write a file like the command line tool does, through std::ofstream
+/// (uring = false) or sp::uring_ostreambuf (--io uring), including the final
+/// flush.
+template<bool uring>
+static void BM_WriteFile(benchmark::State& state)
+{
+  const std::string name = bm_io::input_file().name + ".out";
+  const std::vector<char> chunk(bm_io::chunk_byte_count, 'x');
+
+  bm::perf_scope perf(state);
+  while( state.KeepRunning() )
+  {
+    std::ofstream file(name, std::ios::binary | std::ios::trunc);
+    std::unique_ptr<sp::uring_ostreambuf> uring_buf(
+      uring ? new sp::uring_ostreambuf(name) : nullptr
+    );
+    std::streambuf * buf = uring
+      ? static_cast<std::streambuf *>(uring_buf.get())
+      : file.rdbuf();
+
+    for(size_t written = 0; written < bm_io::file_byte_count; written += chunk.size())
+      buf->sputn(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    buf->pubsync();
+  }
+
+  std::remove(name.c_str());
+  bm_io::set_bytes_processed(state);
+}
+BENCHMARK_TEMPLATE(BM_WriteFile, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_WriteFile, true)->Unit(benchmark::kMillisecond);
+
+
+}
@@ -1,12 +1,29 @@
 #include <cstdlib>
+#include <cstring>
 #include "benchmark/benchmark.h"
 
+#include "bm/perf-counters.h"
+
 #include "encode/main.h"
+#include "decode/main.h"
+#include "round-trip/main.h"
+#include "io/main.h"
 
-int main(int argc, const char** argv)
+int main(int argc, char** argv)
 {
+  // --perf_counters: report hardware counters of each benchmark
+  // (removed before googlebenchmark parses the remaining flags)
+  int kept = 1;
+  for(int i = 1; i < argc; ++i)
+  {
+    if( std::strcmp(argv[i], "--perf_counters") == 0 )
+      bm::perf_counters_enabled() = true;
+    else
+      argv[kept++] = argv[i];
+  }
+  argc = kept;
+
   benchmark::Initialize(&argc, argv);
   benchmark::RunSpecifiedBenchmarks();
   return EXIT_SUCCESS;
 }
-
@@ -0,0 +1,99 @@
+#include "benchmark/benchmark.h"
+
+#include <vector>
+#include <cstdint>
+#include <iterator>
+
+#include "hm/encode.h"
+#include "hm/decode.h"
+
+#include "bm/input.h"
+#include "bm/perf-counters.h"
+
+namespace {
+
+/// Encode the whole input, including building the tree, like the command
+/// line tool does for a file.
+template<typename entity_type>
+static void BM_Encode(benchmark::State& state)
+{
+  const auto& input = bm::get_input<entity_type>(state);
+
+  std::vector<uint8_t> encoded;
+  encoded.reserve(input.size());
+
+  bm::perf_scope perf(state);
+  while( state.KeepRunning() )
+  {
+    encoded.clear();
+    auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+    auto md = hm::encode(input.begin(), input.end(), tree.get(), std::back_inserter(encoded));
+    benchmark::DoNotOptimize(md);
+  }
+
+  bm::set_bytes_processed(state, input);
+}
+BM_FOR_ENTITY_SIZES(BM_Encode);
+
+
+/// Decode the whole binary layout, including the tree.
+template<typename entity_type>
+static void BM_Decode(benchmark::State& state)
+{
+  typedef hm::byte_entity<sizeof(entity_type)> decode_type;
+
+  const auto& input = bm::get_input<entity_type>(state);
+  auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+
+  std::vector<uint8_t> encoded;
+  const auto md = hm::encode(input.begin(), input.end(), tree.get(), std::back_inserter(encoded));
+
+  std::vector<uint8_t> out;
+  out.reserve(input.size());
+
+  bm::perf_scope perf(state);
+  while( state.KeepRunning() )
+  {
+    out.clear();
+    hm::decode<decode_type>(md, encoded.begin(), encoded.end(), std::back_inserter(out));
+    benchmark::DoNotOptimize(out.data());
+  }
+
+  bm::set_bytes_processed(state, input);
+}
+BM_FOR_ENTITY_SIZES(BM_Decode);
+
+
+/// Encode and decode the whole input.
+template<typename entity_type>
+static void BM_RoundTrip(benchmark::State& state)
+{
+  typedef hm::byte_entity<sizeof(entity_type)> decode_type;
+
+  const auto& input = bm::get_input<entity_type>(state);
+
+  std::vector<uint8_t> encoded;
+  std::vector<uint8_t> out;
+  encoded.reserve(input.size());
+  out.reserve(input.size());
+
+  bm::perf_scope perf(state);
+  while( state.KeepRunning() )
+  {
+    encoded.clear();
+    out.clear();
+    auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+    auto md = hm::encode(input.begin(), input.end(), tree.get(), std::back_inserter(encoded));
+    hm::decode<decode_type>(md, encoded.begin(), encoded.end(), std::back_inserter(out));
+    benchmark::DoNotOptimize(out.data());
+  }
+
+  if( out != input )
+    state.SkipWithError("round trip mismatch");
+
+  bm::set_bytes_processed(state, input);
+}
+BM_FOR_ENTITY_SIZES(BM_RoundTrip);
+
+
+}
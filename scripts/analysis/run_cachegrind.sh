@@ -0,0 +1,222 @@
+#!/usr/bin/env bash
+
+# Instruction count regression check with cachegrind
+# see http://valgrind.org/docs/manual/cg-manual.html
+#
+# Runs fixed encode and decode workloads under cachegrind, sums instructions
+# (Ir), L1 data read misses (D1mr) and last level data read misses (DLmr) per
+# function of namespace hm and compares them to the baseline
+# cachegrind-baseline.tsv next to this script. Unlike wall clock benchmarks
+# the counts are deterministic: the same binary on the same input always
+# executes the same instructions, so a small tolerance suffices.
+#
+# The simulated caches are fixed (see cache_options) so the cache misses do
+# not depend on the machine. The counts still depend on the compiler and its
+# flags: cachegrind-baseline.tsv is recorded from a Release build (g++,
+# cmake -DCMAKE_BUILD_TYPE=Release), re-record it with --update when the
+# reference build changes. A missing baseline fails the check.
+
+# debug
+# set -x
+
+valgrind="${VALGRIND:-valgrind}"
+
+# allowed growth of a count in percent
+tolerance="${CACHEGRIND_TOLERANCE:-2}"
+
+# growth below this many events is ignored for the cache misses, which are
+# small numbers on small functions
+miss_slack=1000
+
+# functions below this share of the instructions of a workload in hm are
+# not tracked (in per mille)
+min_share=1
+
+# simulated caches: size in bytes, associativity, line size
+cache_options=(--I1=32768,8,64 --D1=32768,8,64 --LL=8388608,16,64)
+
+script_dir="$(cd "$(dirname "$0")" && pwd)"
+baseline="$script_dir/cachegrind-baseline.tsv"
+
+# red
+color_highlight=$(echo -n -e "\033[0;31m")
+# reset color
+color_end=$(echo -n -e "\033[0m")
+
+assert_dependencies()
+{
+  # Try to execute valgrind
+  "$valgrind" --tool=cachegrind --help > /dev/null 2>&1 \
+    || { echo >&2 "Cannot execute valgrind"; exit 1; }
+
+  # check if the executable exists
+  [ -x "$1" ] \
+    || { echo >&2 "huffman executable not found"; exit 1; }
+}
+
+print_usage()
+{
+  echo "Usage:" "$0" "[--update] [path to huffman executable]"
+  echo "       Compare instruction counts and cache misses per function to"
+  echo "       the baseline, or record a new baseline with --update"
+  echo "       Environment: CACHEGRIND_TOLERANCE (percent, default 2)"
+}
+
+update=0
+if [ "$1" == "--update" ]; then
+  update=1
+  shift
+fi
+
+[ $# -eq 1 ] || { print_usage ; exit 0; }
+
+assert_dependencies "$1"
+
+if [ $update -eq 0 ] && ! grep -q -v '^#' "$baseline" 2>/dev/null; then
+  echo >&2 "No baseline in $baseline, record one with --update"
+  exit 1
+fi
+
+huffman="$1"
+work_dir="$(mktemp -d)"
+trap 'rm -rf "$work_dir"' EXIT
+
+# The input: 512 KiB of decimal numbers, one per line. Deterministic, a
+# multiple of every entity size, and a mix of frequent and rare entities.
+seq 1 200000 | head -c 524288 > "$work_dir/input"
+
+# name and arguments of each workload, run in this order (decode workloads
+# read the output of the encode workloads)
+workloads=(
+  "encode-1|-e $work_dir/input -o $work_dir/input.1.hm -s 1"
+  "decode-1|-d $work_dir/input.1.hm -o $work_dir/output.1"
+  "encode-2|-e $work_dir/input -o $work_dir/input.2.hm -s 2"
+  "decode-2|-d $work_dir/input.2.hm -o $work_dir/output.2"
+  "encode-8|-e $work_dir/input -o $work_dir/input.8.hm -s 8"
+  "decode-8|-d $work_dir/input.8.hm -o $work_dir/output.8"
+  "encode-4-delta|-e $work_dir/input -o $work_dir/input.4d.hm -s 4 -f delta"
+  "decode-4-delta|-d $work_dir/input.4d.hm -o $work_dir/output.4d"
+)
+
+# Sum Ir, D1mr and DLmr per function of namespace hm in a cachegrind output
+# file. Instantiations of a template are summed, the parameter lists are
+# dropped. Prints "workload<tab>function<tab>Ir<tab>D1mr<tab>DLmr" lines,
+# the first one with the totals of all functions in hm.
+summarize()
+{
+  awk -v workload="$1" -v min_share="$min_share" '
+    BEGIN { OFS = "\t" }
+    /^events:/ {
+      for(i = 2; i <= NF; ++i)
+        column[$i] = i
+    }
+    /^fn=/ {
+      name = substr($0, 4)
+      keep = (name ~ /hm::/)
+      sub(/\(.*$/, "", name)
+      next
+    }
+    /^[0-9]/ && keep {
+      ir[name] += $(column["Ir"])
+      d1mr[name] += $(column["D1mr"])
+      dlmr[name] += $(column["DLmr"])
+    }
+    END {
+      total_ir = total_d1mr = total_dlmr = 0
+      for(name in ir)
+      {
+        total_ir += ir[name]
+        total_d1mr += d1mr[name]
+        total_dlmr += dlmr[name]
+      }
+      print workload, "(all of hm)", total_ir, total_d1mr, total_dlmr
+      for(name in ir)
+        if( ir[name] * 1000 >= total_ir * min_share )
+          print workload, name, ir[name], d1mr[name], dlmr[name]
+    }
+  ' "$2"
+}
+
+current="$work_dir/current.tsv"
+: > "$current"
+
+for workload in "${workloads[@]}"; do
+  name="${workload%%|*}"
+  arguments="${workload#*|}"
+  out_file="$work_dir/cachegrind.out.$name"
+
+  echo "Running $name"
+  # shellcheck disable=SC2086
+  "$valgrind" --tool=cachegrind --cache-sim=yes "${cache_options[@]}" \
+    --cachegrind-out-file="$out_file" "$huffman" $arguments \
+    > "$work_dir/log.$name" 2>&1 \
+    || { cat >&2 "$work_dir/log.$name"; echo >&2 "$name failed"; exit 1; }
+
+  summarize "$name" "$out_file" | sort -t$'\t' -k2,2 >> "$current"
+done
+
+cmp -s "$work_dir/input" "$work_dir/output.1" \
+  && cmp -s "$work_dir/input" "$work_dir/output.2" \
+  && cmp -s "$work_dir/input" "$work_dir/output.8" \
+  && cmp -s "$work_dir/input" "$work_dir/output.4d" \
+  || { echo >&2 "Round trip failed"; exit 1; }
+
+if [ $update -eq 1 ]; then
+  {
+    echo "# cachegrind baseline, recorded with $(basename "$0") --update"
+    echo "# workload	function	Ir	D1mr	DLmr"
+    cat "$current"
+  } > "$baseline"
+  echo "Baseline written to $baseline"
+  exit 0
+fi
+
+# Compare each tracked function to the baseline. Functions that appear or
+# disappear (e.g. after a change in inlining) are reported, but only growth
+# beyond the tolerance fails the check.
+awk -F'\t' -v tolerance="$tolerance" -v miss_slack="$miss_slack" \
+    -v hl="$color_highlight" -v end="$color_end" '
+  function check(metric, base, cur, slack)
+  {
+    if( cur > base * (1 + tolerance / 100) && cur - base > slack )
+    {
+      printf "%sREGRESSION%s %s %s %s: %.0f -> %.0f (%+.2f%%)\n", hl, end,
+        $1, $2, metric, base, cur, base ? (cur - base) * 100 / base : 100
+      failed = 1
+    }
+  }
+  /^#/ { next }
+  FNR == NR {
+    key = $1 FS $2
+    base_ir[key] = $3
+    base_d1mr[key] = $4
+    base_dlmr[key] = $5
+    next
+  }
+  {
+    key = $1 FS $2
+    if( !(key in base_ir) )
+    {
+      printf "new: %s %s (Ir %.0f)\n", $1, $2, $3
+      next
+    }
+    seen[key] = 1
+    check("Ir", base_ir[key], $3, 0)
+    check("D1mr", base_d1mr[key], $4, miss_slack)
+    check("DLmr", base_dlmr[key], $5, miss_slack)
+  }
+  END {
+    for(key in base_ir)
+      if( !(key in seen) )
+      {
+        split(key, parts, FS)
+        printf "gone: %s %s\n", parts[1], parts[2]
+      }
+    exit failed
+  }
+' "$baseline" "$current"
+status=$?
+
+[ $status -eq 0 ] && echo "No regressions (tolerance $tolerance%)"
+exit $status
+
@@ -0,0 +1,305 @@
+#ifndef CORPUS_GENERATE_H
+#define CORPUS_GENERATE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace corpus {
+
+/// The seed used unless another one is given. Changing it changes every
+/// benchmark input.
+const uint64_t default_seed = 0x5eed;
+
+
+/// The shape of a generated corpus.
+enum shape
+{
+  // every symbol is equally likely
+  uniform = 0,
+
+  // the k-th symbol has a probability proportional to 1/(k+1), like words
+  // in natural language
+  zipf = 1,
+
+  // probabilities decay by a constant factor, most of the mass is on the
+  // first 16 symbols
+  geometric = 2,
+
+  // zipf distributed symbols, each repeated a geometric number of times
+  // (1 to 64, mean 16)
+  runs = 3,
+
+  // lower case english-like text with words, punctuation and line breaks,
+  // as bytes regardless of the entity size
+  text = 4,
+
+  // a random walk: each entity differs from its predecessor by a small,
+  // geometric distributed step, like timestamps or sensor readings
+  series = 5
+};
+
+
+/// All shapes, e.g. to iterate over.
+const corpus::shape shapes[] = {
+  corpus::uniform,
+  corpus::zipf,
+  corpus::geometric,
+  corpus::runs,
+  corpus::text,
+  corpus::series
+};
+
+
+/// Returns the name of a shape.
+inline const char * shape_name(corpus::shape s)
+{
+  switch( s )
+  {
+    case corpus::uniform:   return "uniform";
+    case corpus::zipf:      return "zipf";
+    case corpus::geometric: return "geometric";
+    case corpus::runs:      return "runs";
+    case corpus::text:      return "text";
+    case corpus::series:    return "series";
+    default:                return "unknown";
+  }
+}
+
+
+/// A random number in [0, 1) with 53 bits of precision.
+inline double unit_interval(std::mt19937_64& engine)
+{
+  return static_cast<double>(engine() >> 11U) * (1.0 / 9007199254740992.0);
+}
+
+
+/// Draws indices with fixed probabilities by binary search in the
+/// cumulative weights.
+///
+/// The distributions of the standard library are implementation defined,
+/// this one is not: together with std::mt19937_64 a seed yields the same
+/// corpus on every platform.
+class table_sampler
+{
+public:
+  /// Parameters:
+  ///   weights:
+  ///     The relative probability of each index. Must not be empty.
+  explicit table_sampler(const std::vector<double>& weights)
+  : cumulative(weights.size())
+  {
+    if( weights.empty() )
+      throw std::invalid_argument("no weights");
+
+    double sum = 0;
+    for(size_t i = 0; i < weights.size(); ++i)
+    {
+      sum += weights[i];
+      this->cumulative[i] = sum;
+    }
+  }
+
+  size_t operator()(std::mt19937_64& engine) const
+  {
+    const double target = corpus::unit_interval(engine) * this->cumulative.back();
+    const auto it = std::upper_bound(
+      this->cumulative.begin(),
+      this->cumulative.end(),
+      target
+    );
+
+    return std::min<size_t>(
+      static_cast<size_t>(it - this->cumulative.begin()),
+      this->cumulative.size() - 1
+    );
+  }
+
+private:
+  std::vector<double> cumulative;
+};
+
+
+/// Weights of a zipf distribution with exponent 1 over count symbols.
+inline std::vector<double> zipf_weights(size_t count)
+{
+  std::vector<double> weights(count);
+  for(size_t i = 0; i < count; ++i)
+    weights[i] = 1.0 / static_cast<double>(i + 1);
+
+  return weights;
+}
+
+
+/// Weights of a geometric distribution over count symbols with the given
+/// mean (for large count).
+inline std::vector<double> geometric_weights(size_t count, double mean)
+{
+  const double ratio = mean / (mean + 1.0);
+
+  std::vector<double> weights(count);
+  double weight = 1.0;
+  for(size_t i = 0; i < count; ++i)
+  {
+    weights[i] = weight;
+    weight *= ratio;
+  }
+
+  return weights;
+}
+
+
+/// Weights of the bytes of english-like text, roughly the frequencies of
+/// letters in english prose.
+inline std::vector<double> text_weights()
+{
+  static const char letters[] = "etaoinshrdlcumwfgypbvkjxqz";
+  static const double letter_weights[] = {
+    12.7, 9.1, 8.2, 7.5, 7.0, 6.7, 6.3, 6.1, 6.0, 4.3, 4.0, 2.8, 2.8,
+    2.4, 2.4, 2.2, 2.0, 2.0, 1.9, 1.5, 1.0, 0.8, 0.15, 0.15, 0.1, 0.07
+  };
+
+  std::vector<double> weights(256, 0);
+  for(size_t i = 0; i < sizeof(letter_weights) / sizeof(letter_weights[0]); ++i)
+    weights[static_cast<uint8_t>(letters[i])] = letter_weights[i];
+
+  // one word in five letters
+  weights[' '] = 20.0;
+  weights[','] = 1.2;
+  weights['.'] = 1.0;
+  weights['\n'] = 0.5;
+
+  return weights;
+}
+
+
+/// Append the entity_size least significant bytes of value, little endian.
+inline void put_entity(std::vector<uint8_t>& out, uint64_t value, size_t entity_size)
+{
+  for(size_t i = 0; i < entity_size; ++i)
+  {
+    out.push_back(static_cast<uint8_t>(value & 0xffU));
+    value >>= 8U;
+  }
+}
+
+
+/// Map a symbol to an entity value. The odd multiplier spreads the symbols
+/// over the whole value range; distinct symbols stay distinct as long as the
+/// alphabet fits the entity size.
+inline uint64_t symbol_to_value(uint64_t symbol)
+{
+  return symbol * 0x9e3779b97f4a7c15ULL;
+}
+
+
+/// Generate a synthetic corpus.
+///
+/// The result depends on the parameters only, it is the same on every
+/// platform and in every run.
+///
+/// Parameters:
+///   s:
+///     The shape of the corpus.
+///   byte_count:
+///     The size of the corpus in bytes, rounded down to a multiple of
+///     entity_size.
+///   entity_size:
+///     The size of an entity in bytes, 1 to 8.
+///   alphabet_size:
+///     The number of distinct symbols for uniform, zipf, geometric and runs.
+///     The number of distinct steps for series. Ignored for text. Distinct
+///     symbols map to distinct entities if the alphabet fits entity_size.
+///   seed:
+///     Different seeds yield different corpora of the same shape.
+///
+/// Throws std::invalid_argument if entity_size or alphabet_size is out of
+/// range.
+inline std::vector<uint8_t> generate(
+  corpus::shape s,
+  size_t byte_count,
+  size_t entity_size,
+  size_t alphabet_size,
+  uint64_t seed = corpus::default_seed
+)
+{
+  if( entity_size < 1 || entity_size > 8 )
+    throw std::invalid_argument("entity size must be 1 to 8");
+
+  if( alphabet_size < 1 )
+    throw std::invalid_argument("empty alphabet");
+
+  std::mt19937_64 engine(seed);
+  const size_t entity_count = byte_count / entity_size;
+
+  std::vector<uint8_t> out;
+  out.reserve(entity_count * entity_size);
+
+  switch( s )
+  {
+    case corpus::uniform:
+    {
+      for(size_t i = 0; i < entity_count; ++i)
+        corpus::put_entity(out, corpus::symbol_to_value(engine() % alphabet_size), entity_size);
+      break;
+    }
+    case corpus::zipf:
+    case corpus::geometric:
+    {
+      const corpus::table_sampler sample(
+        s == corpus::zipf
+          ? corpus::zipf_weights(alphabet_size)
+          : corpus::geometric_weights(alphabet_size, 16.0)
+      );
+      for(size_t i = 0; i < entity_count; ++i)
+        corpus::put_entity(out, corpus::symbol_to_value(sample(engine)), entity_size);
+      break;
+    }
+    case corpus::runs:
+    {
+      const corpus::table_sampler sample(corpus::zipf_weights(alphabet_size));
+      const corpus::table_sampler run_length(corpus::geometric_weights(64, 16.0));
+      for(size_t i = 0; i < entity_count; )
+      {
+        const uint64_t value = corpus::symbol_to_value(sample(engine));
+        for(size_t n = run_length(engine) + 1; n > 0 && i < entity_count; --n, ++i)
+          corpus::put_entity(out, value, entity_size);
+      }
+      break;
+    }
+    case corpus::text:
+    {
+      const corpus::table_sampler sample(corpus::text_weights());
+      out.resize(entity_count * entity_size);
+      for(auto& byte : out)
+        byte = static_cast<uint8_t>(sample(engine));
+      break;
+    }
+    case corpus::series:
+    {
+      // steps alternate in sign: 0, -1, 1, -2, 2, ... (zigzag order)
+      const corpus::table_sampler step(corpus::geometric_weights(alphabet_size, 4.0));
+      uint64_t value = engine();
+      for(size_t i = 0; i < entity_count; ++i)
+      {
+        const uint64_t zigzag = step(engine);
+        value += (zigzag & 1U) ? ~(zigzag >> 1U) : (zigzag >> 1U);
+        corpus::put_entity(out, value, entity_size);
+      }
+      break;
+    }
+    default:
+      throw std::invalid_argument("unknown shape");
+  }
+
+  return out;
+}
+
+
+} // end namespace corpus
+
+#endif // CORPUS_GENERATE_H
@@ -0,0 +1,283 @@
+#ifndef HM_ARCHIVE_H
+#define HM_ARCHIVE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+
+#include "hm/common.h"
+#include "hm/crc32c.h"
+#include "hm/varint.h"
+#include "hm/exception.h"
+
+
+namespace hm
+{
+
+/// An archive packs many encoded files (members) into one:
+///
+///   member 0 | member 1 | ... | directory | trailer
+///
+/// Each member is a complete binary layout as written by the encoder,
+/// beginning with its hm::meta. The directory lists the members, the trailer
+/// of fixed size at the end locates the directory. A reader seeks to the
+/// trailer, reads the directory and can then seek to any member directly.
+
+
+/// A member as listed in the directory.
+struct archive_member
+{
+  archive_member()
+  : name(),
+    offset(0),
+    byte_count(0),
+    original_byte_count(0),
+    checksum(0)
+  {
+  }
+
+  /// The file name of the member, without directories.
+  std::string name;
+
+  /// The position of the member's layout in the archive.
+  uint64_t offset;
+
+  /// The number of bytes of the member's layout.
+  uint64_t byte_count;
+
+  /// The number of bytes of the member once decoded.
+  uint64_t original_byte_count;
+
+  /// The CRC32C of the member's layout (byte_count bytes at offset).
+  uint32_t checksum;
+};
+
+
+/// The end of an archive, locating the directory.
+struct archive_trailer
+{
+  archive_trailer()
+  : directory_offset(0),
+    directory_byte_count(0),
+    directory_checksum(0)
+  {
+  }
+
+  uint64_t directory_offset;
+  uint64_t directory_byte_count;
+
+  /// The CRC32C of the directory.
+  uint32_t directory_checksum;
+};
+
+
+/// The last four bytes of an archive, "HMAR".
+const uint32_t archive_magic = 0x52414d48;
+
+/// The number of bytes of the encoded trailer, including archive_magic.
+const size_t archive_trailer_byte_count =
+  sizeof(uint64_t) + sizeof(uint64_t) + sizeof(uint32_t) + sizeof(archive_magic);
+
+
+/// Check whether name may name a member: members are extracted into a
+/// single directory, therefore name must be a plain file name.
+inline bool is_valid_member_name(const std::string& name)
+{
+  return !name.empty()
+    && name != "."
+    && name != ".."
+    && name.find('/') == std::string::npos
+    && name.find('\0') == std::string::npos;
+}
+
+
+/// Encode the directory of an archive.
+///
+/// Layout: the member count, then for each member the length of its name,
+/// the name, the offset, the byte count and the original byte count as
+/// varints, followed by the checksum.
+///
+/// Returns the encoded directory, to be written after the members and
+/// followed by the trailer (see hm::encode_archive_trailer).
+inline std::vector<uint8_t> encode_archive_directory(
+  const std::vector<hm::archive_member>& members
+)
+{
+  std::vector<uint8_t> directory;
+  auto out = std::back_inserter(directory);
+
+  hm::encode_varint(members.size(), out);
+  for(const auto& member : members)
+  {
+    hm::encode_varint(member.name.size(), out);
+    directory.insert(directory.end(), member.name.begin(), member.name.end());
+    hm::encode_varint(member.offset, out);
+    hm::encode_varint(member.byte_count, out);
+    hm::encode_varint(member.original_byte_count, out);
+    hm::encode_type(member.checksum, out);
+  }
+
+  return directory;
+}
+
+
+/// Encode the trailer of an archive.
+///
+/// Parameters:
+///   out:
+///     An output iterator expecting bytes. Receives
+///     hm::archive_trailer_byte_count bytes.
+template<
+  typename out_iter
+>
+void encode_archive_trailer(const hm::archive_trailer& trailer, out_iter out)
+{
+  hm::encode_type(trailer.directory_offset, out);
+  hm::encode_type(trailer.directory_byte_count, out);
+  hm::encode_type(trailer.directory_checksum, out);
+  hm::encode_type(hm::archive_magic, out);
+}
+
+
+/// Decode the trailer of an archive, the last hm::archive_trailer_byte_count
+/// bytes.
+///
+/// in_begin is passed as a reference, see hm::decode_type.
+///
+/// Throws hm::invalid_layout if the input is too short or does not end in
+/// hm::archive_magic.
+template<
+  typename in_iter
+>
+hm::archive_trailer decode_archive_trailer(in_iter& in_begin, in_iter in_end)
+{
+  hm::archive_trailer trailer;
+  trailer.directory_offset = hm::decode_type<uint64_t>(in_begin, in_end);
+  trailer.directory_byte_count = hm::decode_type<uint64_t>(in_begin, in_end);
+  trailer.directory_checksum = hm::decode_type<uint32_t>(in_begin, in_end);
+
+  if( hm::decode_type<uint32_t>(in_begin, in_end) != hm::archive_magic )
+    throw hm::invalid_layout("not an archive");
+
+  return trailer;
+}
+
+
+/// Decode the directory of an archive, written by
+/// hm::encode_archive_directory.
+///
+/// in_begin is passed as a reference, see hm::decode_type.
+///
+/// Parameters:
+///   in_begin, in_end:
+///     A range of input iterators pointing to the directory.
+///   trailer:
+///     The trailer of the archive.
+///
+/// Throws hm::invalid_layout if the directory does not match its checksum,
+/// if a member's name is invalid (see hm::is_valid_member_name) or if a
+/// member does not lie before the directory.
+template<
+  typename in_iter
+>
+std::vector<hm::archive_member> decode_archive_directory(
+  in_iter& in_begin,
+  in_iter in_end,
+  const hm::archive_trailer& trailer
+)
+{
+  std::vector<uint8_t> directory;
+  // grows past 1 MiB only as far as the input goes
+  directory.reserve(std::min<uint64_t>(trailer.directory_byte_count, 1U << 20U));
+  for(uint64_t i = 0; i < trailer.directory_byte_count; ++i)
+  {
+    if( in_begin == in_end )
+      throw hm::invalid_layout("unexpected end");
+    directory.push_back(static_cast<uint8_t>(*in_begin++));
+  }
+
+  if( hm::crc32c(directory.data(), directory.size()) != trailer.directory_checksum )
+    throw hm::invalid_layout("directory checksum mismatch");
+
+  auto begin = directory.cbegin();
+  const auto end = directory.cend();
+  uint64_t byte_count = 0;
+
+  const uint64_t member_count = hm::decode_varint(begin, end, byte_count);
+  // every member takes at least 9 bytes, do not trust member_count blindly
+  if( member_count > directory.size() )
+    throw hm::invalid_layout("invalid member count");
+
+  std::vector<hm::archive_member> members(member_count);
+  for(auto& member : members)
+  {
+    const uint64_t name_length = hm::decode_varint(begin, end, byte_count);
+    if( name_length > static_cast<uint64_t>(end - begin) )
+      throw hm::invalid_layout("unexpected end");
+    member.name.assign(begin, begin + static_cast<std::ptrdiff_t>(name_length));
+    begin += static_cast<std::ptrdiff_t>(name_length);
+
+    member.offset = hm::decode_varint(begin, end, byte_count);
+    member.byte_count = hm::decode_varint(begin, end, byte_count);
+    member.original_byte_count = hm::decode_varint(begin, end, byte_count);
+    member.checksum = hm::decode_type<uint32_t>(begin, end);
+
+    if( !hm::is_valid_member_name(member.name) )
+      throw hm::invalid_layout("invalid member name");
+
+    if( member.offset > trailer.directory_offset
+        || member.byte_count > trailer.directory_offset - member.offset )
+      throw hm::invalid_layout("invalid member offset");
+  }
+
+  if( begin != end )
+    throw hm::invalid_layout("invalid directory");
+
+  return members;
+}
+
+
+/// Find the members of an archive by name in constant time.
+class archive_index
+{
+public:
+  /// Throws hm::invalid_layout if two members have the same name.
+  explicit archive_index(std::vector<hm::archive_member> members)
+  : entries(std::move(members)),
+    by_name()
+  {
+    this->by_name.reserve(this->entries.size());
+    for(size_t i = 0; i < this->entries.size(); ++i)
+    {
+      if( !this->by_name.emplace(this->entries[i].name, i).second )
+        throw hm::invalid_layout("duplicate member name");
+    }
+  }
+
+  /// Returns nullptr if there is no member called name.
+  const hm::archive_member * find(const std::string& name) const
+  {
+    const auto it = this->by_name.find(name);
+    return it == this->by_name.end() ? nullptr : &this->entries[it->second];
+  }
+
+  /// The members in archive order.
+  const std::vector<hm::archive_member>& members() const
+  {
+    return this->entries;
+  }
+
+private:
+  std::vector<hm::archive_member> entries;
+  std::unordered_map<std::string, size_t> by_name;
+};
+
+
+} // end namespace hm
+
+#endif // HM_ARCHIVE_H
@@ -13,6 +13,8 @@
 #include <type_traits>
 
 #include "hm/exception.h"
+#include "hm/entity.h"
+#include "hm/flat-map.h"
 
 namespace hm
 {
@@ -28,7 +30,15 @@ struct meta
     entity_size(0),
     entity_count(0),
     tree_byte_count(0),
-    data_byte_count(0)
+    data_byte_count(0),
+    flags(0),
+    filter(0),
+    checksum(0),
+    index_interval(0),
+    index_entry_count(0),
+    entity_byte_count(0),
+    original_byte_count(0),
+    escape_leaf(0)
   {
   }
 
@@ -38,6 +48,14 @@ struct meta
   typedef uint32_t entity_count_type;
   typedef uint32_t tree_count_type;
   typedef uint64_t data_count_type;
+  typedef uint16_t flags_type;
+  typedef uint8_t  filter_type;
+  typedef uint32_t checksum_type;
+  typedef uint32_t index_interval_type;
+  typedef uint64_t index_count_type;
+  typedef uint64_t entity_byte_count_type;
+  typedef uint64_t original_count_type;
+  typedef uint32_t escape_leaf_type;
 
   // The version number of the binary layout
   version_type version;
@@ -59,13 +77,270 @@ struct meta
 
   // The number of bytes in the data section
   data_count_type data_byte_count;
+
+  // How the input was transformed before it was encoded, see hm::flag_*.
+  // Not part of the binary layout before version 11.
+  flags_type flags;
+
+  // The numeric pre-filter applied to the input, see hm::filter_*.
+  // Only part of the binary layout if flags contains hm::flag_filter.
+  filter_type filter;
+
+  // The CRC32C of the original input, see hm/crc32c.h.
+  // Only part of the binary layout if flags contains hm::flag_checksum.
+  checksum_type checksum;
+
+  // The number of entities between two entries of the seek index.
+  // Only part of the binary layout if flags contains hm::flag_index.
+  index_interval_type index_interval;
+
+  // The number of entries in the seek index, which follows the data section.
+  // Only part of the binary layout if flags contains hm::flag_index.
+  index_count_type index_entry_count;
+
+  // The number of bytes in the compact entity section.
+  // Only part of the binary layout if flags contains
+  // hm::flag_compact_entities.
+  entity_byte_count_type entity_byte_count;
+
+  // The number of bytes of the original input.
+  // Only part of the binary layout if flags contains hm::flag_original_size.
+  original_count_type original_byte_count;
+
+  // The position of the escape leaf in the entity section.
+  // Only part of the binary layout if flags contains hm::flag_escape.
+  escape_leaf_type escape_leaf;
 };
 
 
+/// The version of the binary layout written by the encoder.
+const hm::meta::version_type current_version = 11;
+
+
+/// The data section holds run-length tokens instead of plain entities
+/// (see hm/rle.h).
+const hm::meta::flags_type flag_rle = 1U << 0;
+
+/// The input was transformed by a numeric pre-filter (see hm/filter.h).
+/// The binary layout contains hm::meta::filter.
+const hm::meta::flags_type flag_filter = 1U << 1;
+
+/// The data section holds entity_size byte lanes. Each lane is a complete
+/// binary layout of 1 byte entities (see hm/shuffle.h).
+const hm::meta::flags_type flag_shuffle = 1U << 2;
+
+/// The data section holds the input as is, without entities or tree. Used
+/// when huffman coding would expand the input. Excludes all other flags but
+/// hm::flag_checksum.
+const hm::meta::flags_type flag_stored = 1U << 3;
+
+/// The binary layout contains hm::meta::checksum, the CRC32C of the original
+/// input (see hm/crc32c.h).
+const hm::meta::flags_type flag_checksum = 1U << 4;
+
+/// The data section is followed by a seek index: for every index_interval-th
+/// entity, the bit offset of its code in the data section, as uint64_t.
+/// The binary layout contains hm::meta::index_interval and
+/// hm::meta::index_entry_count.
+const hm::meta::flags_type flag_index = 1U << 5;
+
+/// The entity section holds the leaves in canonical order (by code length,
+/// then by value), each as the zigzag encoded difference to its predecessor
+/// in varint format, instead of raw entities in tree order (see
+/// hm::encode_entities_compact). Requires an entity size of at most
+/// hm::max_compact_entity_size. The binary layout contains
+/// hm::meta::entity_byte_count.
+const hm::meta::flags_type flag_compact_entities = 1U << 6;
+
+/// The binary layout contains hm::meta::original_byte_count, which lets a
+/// decoder allocate its output up front. Stored layouts do not need it, their
+/// data section is the original input.
+const hm::meta::flags_type flag_original_size = 1U << 7;
+
+/// The tree has an escape leaf, whose entity in the entity section is a
+/// placeholder. Its code is followed by the entity as a literal of
+/// entity_size bytes, 8 bits each in the order of hm::set_bit. Lets the
+/// encoder build the tree from a sample of the input (see
+/// hm::encode_escaped). The binary layout contains hm::meta::escape_leaf.
+const hm::meta::flags_type flag_escape = 1U << 8;
+
+/// All flags known to this implementation.
+const hm::meta::flags_type known_flags =
+  hm::flag_rle | hm::flag_filter | hm::flag_shuffle | hm::flag_stored |
+  hm::flag_checksum | hm::flag_index | hm::flag_compact_entities |
+  hm::flag_original_size | hm::flag_escape;
+
+
+/// The largest entity size supported by hm::flag_compact_entities: entities
+/// are coded as numbers of up to 64 bits.
+const hm::meta::entity_size_type max_compact_entity_size = 8;
+
+
+/// Check whether the encoder should write a compact entity section for
+/// entities of entity_size bytes. Single byte alphabets are too small to
+/// benefit.
+inline bool is_compact_entity_size(size_t entity_size)
+{
+  return entity_size > 1 && entity_size <= hm::max_compact_entity_size;
+}
+
+
+/// The type of an entry in the seek index.
+typedef uint64_t index_entry_type;
+
+
+/// Numeric pre-filters (see hm/filter.h).
+const hm::meta::filter_type filter_none = 0;
+const hm::meta::filter_type filter_delta = 1;
+const hm::meta::filter_type filter_delta_delta = 2;
+const hm::meta::filter_type filter_xor = 3;
+
+
+/// The number of bytes of the encoded binary layout description.
+inline size_t meta_byte_count(const hm::meta& md)
+{
+  size_t count =
+    sizeof(hm::meta::version_type) +
+    sizeof(hm::meta::last_bits_type) +
+    sizeof(hm::meta::last_bits_type) +
+    sizeof(hm::meta::entity_size_type) +
+    sizeof(hm::meta::entity_count_type) +
+    sizeof(hm::meta::tree_count_type) +
+    sizeof(hm::meta::data_count_type);
+
+  if( md.version > 10 )
+  {
+    count += sizeof(hm::meta::flags_type);
+
+    if( md.flags & hm::flag_filter )
+      count += sizeof(hm::meta::filter_type);
+
+    if( md.flags & hm::flag_checksum )
+      count += sizeof(hm::meta::checksum_type);
+
+    if( md.flags & hm::flag_index )
+    {
+      count += sizeof(hm::meta::index_interval_type);
+      count += sizeof(hm::meta::index_count_type);
+    }
+
+    if( md.flags & hm::flag_compact_entities )
+      count += sizeof(hm::meta::entity_byte_count_type);
+
+    if( md.flags & hm::flag_original_size )
+      count += sizeof(hm::meta::original_count_type);
+
+    if( md.flags & hm::flag_escape )
+      count += sizeof(hm::meta::escape_leaf_type);
+  }
+
+  return count;
+}
+
+
+/// Get the number of bytes of the original input, if the binary layout
+/// records it: md.original_byte_count with hm::flag_original_size, or the
+/// data section of a stored layout.
+///
+/// Returns false if the size is only known once decoded.
+inline bool get_original_byte_count(const hm::meta& md, uint64_t& byte_count)
+{
+  if( md.flags & hm::flag_stored )
+  {
+    byte_count = md.data_byte_count;
+    return true;
+  }
+
+  if( md.flags & hm::flag_original_size )
+  {
+    byte_count = md.original_byte_count;
+    return true;
+  }
+
+  return false;
+}
+
+
+/// The number of bytes of the entity section.
+inline uint64_t entity_section_byte_count(const hm::meta& md)
+{
+  if( md.flags & hm::flag_compact_entities )
+    return md.entity_byte_count;
+
+  return static_cast<uint64_t>(md.entity_count) * md.entity_size;
+}
+
+
+/// The number of bytes of the whole binary layout: the encoded description,
+/// the entities, the tree, the data and the seek index.
+inline uint64_t layout_byte_count(const hm::meta& md)
+{
+  uint64_t count =
+    hm::meta_byte_count(md) +
+    hm::entity_section_byte_count(md) +
+    md.tree_byte_count +
+    md.data_byte_count
+  ;
+
+  if( md.flags & hm::flag_index )
+    count += md.index_entry_count * sizeof(hm::index_entry_type);
+
+  return count;
+}
+
+
 /// Each element represents a bit in a huffman code.
 typedef std::vector<bool> code_type;
 
 
+/// Whether the tables of entity_type are a hm::flat_map rather than a
+/// std::unordered_map: 4 and 8 byte integral entities have alphabets too
+/// large for a node per entry and too sparse for std::hash, the identity.
+template<typename entity_type>
+using uses_flat_map =
+  std::integral_constant<
+    bool,
+    std::is_integral<entity_type>::value
+      && (sizeof(entity_type) == 4 || sizeof(entity_type) == 8)
+  >
+;
+
+
+/// A map from entity_type to value, see hm::uses_flat_map.
+template<typename entity_type, typename value>
+using entity_map =
+  typename std::conditional<
+    hm::uses_flat_map<entity_type>::value,
+    hm::flat_map<entity_type, value>,
+    std::unordered_map<entity_type, value>
+  >::type
+;
+
+
+/// The number of occurrences of each entity, see build_frequency_table.
+template<typename entity_type>
+using frequency_table = hm::entity_map<entity_type, size_t>;
+
+
+/// The huffman code of each entity, see build_huffman_table.
+template<typename entity_type>
+using code_table = hm::entity_map<entity_type, hm::code_type>;
+
+
+/// Trait to check if table_type maps entities to huffman codes, e.g. a
+/// hm::code_table. Tells the overloads of encode and encode_data apart.
+template<typename table_type, typename = void>
+struct is_code_table : std::false_type {};
+
+template<typename table_type>
+struct is_code_table<
+  table_type,
+  typename std::enable_if<
+    std::is_same<typename table_type::mapped_type, hm::code_type>::value
+  >::type
+> : std::true_type {};
+
+
 /// The maximum number of shifts we can do in a byte without overflow.
 /// (Avoid the magic number 7 popping up everywhere in the code)
 const hm::meta::last_bits_type max_shifts_in_byte
@@ -119,7 +394,7 @@ inline uint8_t set_bit(uint8_t byte, uint8_t pos)
 ///
 /// Parameters:
 ///   target_type:
-///     The type of data to extract. Must be integral.
+///     The type of data to extract. Must be integral or a hm::byte_entity.
 ///   in_begin, in_end:
 ///     A range of input iterators pointing to bytes.
 ///
@@ -133,7 +408,7 @@ template<
   typename target_type,
   typename in_iter,
   typename = typename std::enable_if<
-    std::is_integral<target_type>::value
+    hm::is_entity<target_type>::value
   >::type
 >
 target_type decode_type(in_iter& in_begin, in_iter in_end)
@@ -155,14 +430,14 @@ target_type decode_type(in_iter& in_begin, in_iter in_end)
 ///
 /// Parameters:
 ///   source:
-///     Data to be encoded. Must be integral and unsigned.
+///     Data to be encoded. Must be integral or a hm::byte_entity.
 ///   out:
 ///     An output iterator expecting bytes.
 template<
   typename source_type,
   typename out_iter,
   typename = typename std::enable_if<
-    std::is_integral<source_type>::value
+    hm::is_entity<source_type>::value
   >::type
 >
 inline void encode_type(source_type source, out_iter out)
@@ -175,6 +450,32 @@ inline void encode_type(source_type source, out_iter out)
 }
 
 
+/// Interpret the bytes of an entity, as written by encode_type, as a little
+/// endian number. Used to order and delta code entities for
+/// hm::flag_compact_entities.
+///
+/// Parameters:
+///   entity:
+///     Must be integral or a hm::byte_entity of at most
+///     hm::max_compact_entity_size bytes.
+template<
+  typename entity_type
+>
+uint64_t entity_to_number(const entity_type& entity)
+{
+  assert(sizeof(entity_type) <= hm::max_compact_entity_size);
+
+  uint8_t bytes[sizeof(entity_type)];
+  hm::encode_type(entity, bytes);
+
+  uint64_t number = 0;
+  for(size_t i = std::min<size_t>(sizeof(bytes), hm::max_compact_entity_size); i-- > 0; )
+    number = (number << 8U) | bytes[i];
+
+  return number;
+}
+
+
 /// Convenience template alias to check if an iterator is a ForwardIterator
 template<typename iterator>
 using is_forward_iterator =
@@ -185,6 +486,18 @@ using is_forward_iterator =
 ;
 
 
+/// Convenience template alias to check if an iterator is a plain pointer to
+/// bytes, which can be copied with std::memcpy
+template<typename iterator>
+using is_byte_pointer =
+  std::integral_constant<
+    bool,
+    std::is_pointer<iterator>::value
+      && sizeof(typename std::remove_pointer<iterator>::type) == 1
+  >
+;
+
+
 /// Comparison class for nodes from a huffman tree.
 ///
 /// Comparison of nodes in a huffman tree is based on the frequency the
@@ -0,0 +1,152 @@
+#ifndef HM_CRC32C_H
+#define HM_CRC32C_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+
+namespace hm
+{
+
+/// The CRC32C (Castagnoli) polynomial, bit-reversed.
+const uint32_t crc32c_polynomial = 0x82f63b78U;
+
+
+/// Lookup tables for slicing-by-8: tables[k][b] is the CRC of byte b followed
+/// by k zero bytes.
+/// Not meant to be used directly, see crc32c.
+struct crc32c_tables
+{
+  crc32c_tables()
+  {
+    for(uint32_t b = 0; b < 256; ++b)
+    {
+      uint32_t crc = b;
+      for(int bit = 0; bit < 8; ++bit)
+        crc = (crc >> 1) ^ (crc & 1U ? hm::crc32c_polynomial : 0U);
+      this->tables[0][b] = crc;
+    }
+
+    for(uint32_t b = 0; b < 256; ++b)
+      for(size_t k = 1; k < 8; ++k)
+        this->tables[k][b] = (this->tables[k - 1][b] >> 8)
+          ^ this->tables[0][this->tables[k - 1][b] & 0xffU];
+  }
+
+  uint32_t tables[8][256];
+};
+
+
+/// Continue a CRC32C over data with lookup tables, eight bytes per step.
+/// Not meant to be called directly, see crc32c.
+///
+/// Parameters:
+///   crc:
+///     The inverted CRC so far.
+inline uint32_t crc32c_slicing8(uint32_t crc, const uint8_t * data, size_t size)
+{
+  // thread-safe initialization since C++11
+  static const hm::crc32c_tables lookup;
+  const auto& t = lookup.tables;
+
+  for(; size >= 8; size -= 8, data += 8)
+  {
+    // assemble little endian words byte-wise: no alignment requirements and
+    // independent of the byte order of the host
+    const uint32_t low = crc ^ (
+      static_cast<uint32_t>(data[0])         |
+      static_cast<uint32_t>(data[1]) << 8U   |
+      static_cast<uint32_t>(data[2]) << 16U  |
+      static_cast<uint32_t>(data[3]) << 24U
+    );
+
+    crc =
+      t[7][low & 0xffU]         ^
+      t[6][(low >> 8U) & 0xffU] ^
+      t[5][(low >> 16U) & 0xffU] ^
+      t[4][low >> 24U]          ^
+      t[3][data[4]]             ^
+      t[2][data[5]]             ^
+      t[1][data[6]]             ^
+      t[0][data[7]];
+  }
+
+  for(; size > 0; --size, ++data)
+    crc = (crc >> 8U) ^ t[0][(crc ^ *data) & 0xffU];
+
+  return crc;
+}
+
+
+#ifdef __SSE4_2__
+
+/// Continue a CRC32C over data with the SSE4.2 crc32 instruction.
+/// Not meant to be called directly, see crc32c.
+///
+/// Parameters:
+///   crc:
+///     The inverted CRC so far.
+inline uint32_t crc32c_sse42(uint32_t crc, const uint8_t * data, size_t size)
+{
+#ifdef __x86_64__
+  uint64_t crc64 = crc;
+  for(; size >= 8; size -= 8, data += 8)
+  {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = static_cast<uint32_t>(crc64);
+#endif
+
+  for(; size >= 4; size -= 4, data += 4)
+  {
+    uint32_t word;
+    std::memcpy(&word, data, sizeof(word));
+    crc = _mm_crc32_u32(crc, word);
+  }
+
+  for(; size > 0; --size, ++data)
+    crc = _mm_crc32_u8(crc, *data);
+
+  return crc;
+}
+
+#endif
+
+
+/// Compute the CRC32C (Castagnoli) checksum of data.
+///
+/// Uses the SSE4.2 crc32 instruction if available at compile time
+/// (e.g. -msse4.2), otherwise slicing-by-8.
+///
+/// Parameters:
+///   data, size:
+///     The bytes to checksum.
+///   crc:
+///     The checksum of the preceding bytes, to checksum a sequence in
+///     blocks. 0 for the first block.
+///
+/// Returns the checksum of the preceding bytes and data.
+inline uint32_t crc32c(const uint8_t * data, size_t size, uint32_t crc = 0)
+{
+  crc = ~crc;
+
+#ifdef __SSE4_2__
+  crc = hm::crc32c_sse42(crc, data, size);
+#else
+  crc = hm::crc32c_slicing8(crc, data, size);
+#endif
+
+  return ~crc;
+}
+
+
+} // end namespace hm
+
+#endif // HM_CRC32C_H
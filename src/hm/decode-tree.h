@@ -37,7 +37,8 @@ public:
   {
   }
 
-  entity_type get_entity() const
+  // by reference: entities may be byte-vectors, copying them allocates
+  const entity_type& get_entity() const
   {
     return this->ent;
   }
@@ -47,6 +48,19 @@ private:
 };
 
 
+/// The escape leaf (see hm::flag_escape): its code is followed by a literal
+/// entity instead of standing for one.
+template<typename entity_type>
+class dec_escape : public hm::dec_node<entity_type>
+{
+public:
+  dec_escape()
+  : dec_node<entity_type>()
+  {
+  }
+};
+
+
 /// A huffman tree has two children, either is another tree or a leaf.
 /// The tree is self-managing. Losing the handle to the top of a tree
 /// automatically propagates destruction to all children.
@@ -8,11 +8,15 @@
 #include <vector>
 #include <stack>
 #include <cstring>
+#include <algorithm>
+#include <iterator>
 
 #include "util/make-unique.h"
 #include "hm/common.h"
 #include "hm/decode-tree.h"
 #include "hm/exception.h"
+#include "hm/filter.h"
+#include "hm/varint.h"
 
 namespace hm
 {
@@ -26,28 +30,28 @@ namespace hm
 ///   entities:
 ///     the leaves of the tree, left-first and bottom-up
 ///   md:
-///     description of the binary layout
+///     description of the binary layout. With hm::flag_escape, the leaf at
+///     md.escape_leaf becomes a hm::dec_escape.
 ///
 /// Throws hm::invalid_layout.
-/// Returns a managed dec_tree containing byte-vectors.
+/// Returns a managed dec_tree containing entities.
 template<
+  typename entity_type,
   typename in_iter
 >
-std::unique_ptr<hm::dec_tree<std::vector<uint8_t>>>
+std::unique_ptr<hm::dec_tree<entity_type>>
 decode_tree(
   in_iter in_begin,
   in_iter in_end,
-  const std::vector<std::vector<uint8_t>>& entities,
+  const std::vector<entity_type>& entities,
   const hm::meta& md
 )
 {
-  typedef std::vector<uint8_t> entity_type;
-
   std::stack<std::unique_ptr<hm::dec_tree<entity_type>>> stk;
   hm::meta::tree_count_type bytes = 0;
   hm::meta::entity_count_type entities_applied = 0;
 
-  std::vector<entity_type>::const_iterator next_leaf = std::begin(entities);
+  typename std::vector<entity_type>::const_iterator next_leaf = std::begin(entities);
 
   while( bytes < md.tree_byte_count )
   {
@@ -79,7 +83,11 @@ decode_tree(
         if( next_leaf == std::end(entities) )
           throw hm::invalid_layout("missing leaf");
 
-        stk.top()->emplace_next_child<hm::dec_leaf<entity_type>>(*next_leaf++);
+        if( (md.flags & hm::flag_escape) && entities_applied == md.escape_leaf )
+          stk.top()->template emplace_next_child<hm::dec_escape<entity_type>>();
+        else
+          stk.top()->template emplace_next_child<hm::dec_leaf<entity_type>>(*next_leaf);
+        next_leaf++;
         entities_applied++;
 
         // append nodes from top of the stack to the next node on top of the stack
@@ -125,7 +133,8 @@ decode_tree(
 ///   in_begin, in_end:
 ///     A range of input iterators pointing to bytes containing an encoded hm::meta
 ///
-/// Throws hm::invalid_layout if in_end was reached before hm::meta was filled fully.
+/// Throws hm::invalid_layout if in_end was reached before hm::meta was filled fully
+/// or if md.flags or md.filter are unknown.
 /// Returns hm::meta, the binary layout description.
 template<
   typename in_iter
@@ -146,40 +155,186 @@ hm::meta decode_meta_data(in_iter in_begin, in_iter in_end)
   md.tree_byte_count = hm::decode_type<hm::meta::tree_count_type>(in_begin, in_end);
   md.data_byte_count = hm::decode_type<hm::meta::data_count_type>(in_begin, in_end);
 
+  // version 10 had no flags
+  if( md.version > 10 )
+  {
+    md.flags = hm::decode_type<hm::meta::flags_type>(in_begin, in_end);
+    if( md.flags & ~hm::known_flags )
+      throw hm::invalid_layout("unsupported flags");
+
+    if( (md.flags & hm::flag_stored)
+        && (md.flags & ~(hm::flag_stored | hm::flag_checksum)) )
+      throw hm::invalid_layout("unsupported flags");
+
+    if( md.flags & hm::flag_filter )
+    {
+      md.filter = hm::decode_type<hm::meta::filter_type>(in_begin, in_end);
+      if( md.filter > hm::filter_xor )
+        throw hm::invalid_layout("unsupported filter");
+    }
+
+    if( md.flags & hm::flag_checksum )
+      md.checksum = hm::decode_type<hm::meta::checksum_type>(in_begin, in_end);
+
+    if( md.flags & hm::flag_index )
+    {
+      md.index_interval =
+        hm::decode_type<hm::meta::index_interval_type>(in_begin, in_end);
+      md.index_entry_count =
+        hm::decode_type<hm::meta::index_count_type>(in_begin, in_end);
+
+      if( md.index_interval == 0 || (md.flags & hm::flag_stored) )
+        throw hm::invalid_layout("invalid index");
+    }
+
+    if( md.flags & hm::flag_compact_entities )
+    {
+      md.entity_byte_count =
+        hm::decode_type<hm::meta::entity_byte_count_type>(in_begin, in_end);
+
+      if( md.entity_size > hm::max_compact_entity_size
+          || (md.flags & (hm::flag_stored | hm::flag_shuffle)) )
+        throw hm::invalid_layout("unsupported flags");
+    }
+
+    if( md.flags & hm::flag_original_size )
+    {
+      md.original_byte_count =
+        hm::decode_type<hm::meta::original_count_type>(in_begin, in_end);
+    }
+
+    if( md.flags & hm::flag_escape )
+    {
+      md.escape_leaf =
+        hm::decode_type<hm::meta::escape_leaf_type>(in_begin, in_end);
+
+      if( md.escape_leaf >= md.entity_count
+          || (md.flags & (hm::flag_stored | hm::flag_shuffle)) )
+        throw hm::invalid_layout("invalid escape");
+    }
+  }
+
   return md;
 }
 
 
+/// Create an entity of md.entity_size bytes that can be filled by
+/// decode_entities.
+/// Not meant to be called directly, see decode_entities.
+///
+/// Throws hm::invalid_layout if md.entity_size doesn't match entity_type.
+template<
+  typename entity_type
+>
+entity_type make_entity(const hm::meta& md, std::true_type /* byte entity */)
+{
+  if( md.entity_size != sizeof(entity_type) )
+    throw hm::invalid_layout("unexpected entity size");
+
+  return entity_type();
+}
+
+
+/// Create a byte-vector of md.entity_size bytes that can be filled by
+/// decode_entities.
+/// Not meant to be called directly, see decode_entities.
+template<
+  typename entity_type
+>
+entity_type make_entity(const hm::meta& md, std::false_type /* byte entity */)
+{
+  return entity_type(md.entity_size, 0);
+}
+
+
+/// Decode a compact entity section (md.flags contains
+/// hm::flag_compact_entities) into entities.
+/// Not meant to be called directly, see decode_entities.
+///
+/// Throws hm::invalid_layout if the section does not hold md.entity_count
+/// entities in exactly md.entity_byte_count bytes, or if an entity does not
+/// fit md.entity_size.
+template<
+  typename entity_type,
+  typename in_iter
+>
+void decode_entities_compact(
+  in_iter in_begin,
+  in_iter in_end,
+  const hm::meta& md,
+  std::vector<entity_type>& entities
+)
+{
+  uint64_t byte_count = 0;
+  uint64_t number = 0;
+
+  for(auto& entity : entities)
+  {
+    if( byte_count >= md.entity_byte_count )
+      throw hm::invalid_layout("too few entities");
+
+    number += hm::zigzag_decode<uint64_t>(
+      hm::decode_varint(in_begin, in_end, byte_count)
+    );
+
+    // the little endian bytes of number, see hm::entity_to_number
+    uint64_t remaining = number;
+    for(auto& byte : entity)
+    {
+      byte = static_cast<uint8_t>(remaining & 0xffU);
+      remaining >>= 8U;
+    }
+
+    if( remaining != 0 )
+      throw hm::invalid_layout("entity too large");
+  }
+
+  if( byte_count != md.entity_byte_count )
+    throw hm::invalid_layout("invalid entity section");
+}
+
+
 /// Decode entities.
 ///
 /// Parameters:
+///   entity_type:
+///     The representation of a decoded entity. Either a byte-vector, which
+///     fits all entity sizes, or a hm::byte_entity, which must match
+///     md.entity_size.
 ///   in_begin, in_end:
 ///     A range of input iterators pointing to bytes containing encoded entities.
 ///   md:
 ///     The binary layout.
 ///
 /// Throws hm::invalid_layout if in_end is reached before all entities have been
-/// read (as described by the binary layout).
-/// Returns a vector containing entities (leaves of a huffman tree),
-/// which are represented by byte-vectors.
+/// read (as described by the binary layout) or if entity_type does not fit
+/// md.entity_size.
+/// Returns a vector containing entities (leaves of a huffman tree).
 template<
+  typename entity_type = std::vector<uint8_t>,
   typename in_iter
 >
-std::vector<std::vector<uint8_t>>
+std::vector<entity_type>
 decode_entities(in_iter in_begin, in_iter in_end, const hm::meta& md)
 {
-  std::vector<std::vector<uint8_t>> entities(
+  std::vector<entity_type> entities(
     md.entity_count,
-    std::vector<uint8_t>(md.entity_size, 0)
+    hm::make_entity<entity_type>(md, hm::is_byte_entity<entity_type>())
   );
 
-  for(hm::meta::entity_count_type i = 0; i < md.entity_count; ++i)
+  if( md.flags & hm::flag_compact_entities )
   {
-    for(hm::meta::entity_size_type c = 0; c < md.entity_size; ++c)
+    hm::decode_entities_compact(in_begin, in_end, md, entities);
+    return entities;
+  }
+
+  for(auto& entity : entities)
+  {
+    for(auto& byte : entity)
     {
       if( in_begin == in_end )
         throw hm::invalid_layout("too few entities");
-      entities.at(i).at(c) = static_cast<uint8_t>(*in_begin++);
+      byte = static_cast<uint8_t>(*in_begin++);
     }
   }
 
@@ -187,8 +342,151 @@ decode_entities(in_iter in_begin, in_iter in_end, const hm::meta& md)
 }
 
 
+/// Decode a range of entities from the corpus.
+///
+/// Also decodes layouts with an escape leaf (see hm::flag_escape), which
+/// hm::decode_data leaves to this function.
+///
+/// Parameters:
+///   in_begin, in_end:
+///     A range of input iterators pointing to bytes of the encoded corpus,
+///     starting at the byte that contains bit_offset.
+///   tree:
+///     A non-owning handle to the decoded huffman tree.
+///   md:
+///     The binary layout description.
+///   bit_offset:
+///     The offset of the first code to decode, in bits from the beginning of
+///     the data section, e.g. an entry of the seek index.
+///   skip:
+///     The number of entities to decode without writing them to out.
+///   count:
+///     The maximum number of entities to write to out.
+///   out:
+///     An output iterator accepting decoded bytes.
+///
+/// Throws hm::invalid_layout on unexpected or missing input.
+template<
+  typename entity_type,
+  typename in_iter,
+  typename out_iter
+>
+void decode_data_range(
+  in_iter in_begin,
+  in_iter in_end,
+  const hm::dec_tree<entity_type> * tree,
+  const hm::meta& md,
+  uint64_t bit_offset,
+  uint64_t skip,
+  uint64_t count,
+  out_iter out
+)
+{
+  hm::meta::data_count_type bytes = bit_offset / 8U;
+  auto first_pos = static_cast<hm::meta::last_bits_type>(bit_offset % 8U);
+
+  // the number of entities decoded so far, including skipped ones
+  uint64_t entities = 0;
+  const uint64_t last_entity =
+    count > std::numeric_limits<uint64_t>::max() - skip
+      ? std::numeric_limits<uint64_t>::max()
+      : skip + count;
+
+  auto walker = dynamic_cast<const hm::dec_node<entity_type> *>(tree);
+
+  // the bits of an escaped literal still to read (see hm::flag_escape)
+  const bool has_escape = md.flags & hm::flag_escape;
+  size_t literal_bits = 0;
+  uint8_t literal_byte = 0;
+
+  while( bytes < md.data_byte_count )
+  {
+    if( in_begin == in_end )
+      throw hm::invalid_layout("missing data in data section");
+
+    uint8_t byte = static_cast<uint8_t>(*in_begin++);
+
+    // Calculate the maximum bit-offset we're allowed to read in this byte
+    // (This is uneccessarily complex)
+    hm::meta::last_bits_type max_pos = hm::max_shifts_in_byte;
+    const bool is_last_byte = ( bytes == md.data_byte_count - 1 );
+    if( is_last_byte
+        && md.data_last_bits
+        && md.data_last_bits <= hm::max_shifts_in_byte )
+    {
+      max_pos = static_cast<uint8_t>(md.data_last_bits - 1);
+    }
+
+    hm::meta::last_bits_type pos = first_pos;
+    first_pos = 0;
+    while( pos <= max_pos )
+    {
+      if( literal_bits )
+      {
+        // the bits of each literal byte in the order of hm::set_bit
+        literal_bits--;
+        const auto literal_pos =
+          static_cast<uint8_t>(hm::max_shifts_in_byte - literal_bits % 8U);
+        if( hm::get_bit(byte, pos) )
+          literal_byte = hm::set_bit(literal_byte, literal_pos);
+
+        if( literal_bits % 8U == 0 )
+        {
+          if( entities >= skip )
+            *out++ = literal_byte;
+          literal_byte = 0;
+
+          if( literal_bits == 0 )
+          {
+            if( ++entities == last_entity )
+              return;
+
+            walker = dynamic_cast<const hm::dec_node<entity_type> *>(tree);
+          }
+        }
+
+        pos++;
+        continue;
+      }
+
+      if( auto branch = dynamic_cast<const hm::dec_tree<entity_type> *>(walker) )
+        // traverse the tree right on 1; left on 0
+        walker = hm::get_bit(byte, pos) ? branch->get_right() : branch->get_left();
+      else
+        throw hm::invalid_layout("invalid sequence");
+
+      if( auto leaf = dynamic_cast<const hm::dec_leaf<entity_type> *>(walker) )
+      {
+        // output all bytes from the entity
+        if( entities >= skip )
+          for( auto e : leaf->get_entity() )
+            *out++ = e;
+
+        if( ++entities == last_entity )
+          return;
+
+        // reset the walker by pointing it back to the root of the tree
+        walker = dynamic_cast<const hm::dec_node<entity_type> *>(tree);
+      }
+      else if( has_escape
+               && dynamic_cast<const hm::dec_escape<entity_type> *>(walker) )
+      {
+        literal_bits = md.entity_size * 8U;
+      }
+
+      pos++;
+    }
+
+    bytes++;
+  }
+}
+
+
 /// Decode the corpus.
 ///
+/// Layouts with an escape leaf (see hm::flag_escape) are decoded by
+/// decode_data_range, all others by a loop that only walks the tree.
+///
 /// Parameters:
 ///   in_begin, in_end:
 ///     A range of input iterators pointing to bytes containing the encoded corpus.
@@ -201,18 +499,33 @@ decode_entities(in_iter in_begin, in_iter in_end, const hm::meta& md)
 ///
 /// Throws hm::invalid_layout on unexpected or missing input.
 template<
+  typename entity_type,
   typename in_iter,
   typename out_iter
 >
 void decode_data(
   in_iter in_begin,
   in_iter in_end,
-  const hm::dec_tree<std::vector<uint8_t>> * tree,
+  const hm::dec_tree<entity_type> * tree,
   const hm::meta& md,
   out_iter out
 )
 {
-  typedef std::vector<uint8_t> entity_type;
+  if( md.flags & hm::flag_escape )
+  {
+    hm::decode_data_range(
+      in_begin,
+      in_end,
+      tree,
+      md,
+      0,
+      0,
+      std::numeric_limits<uint64_t>::max(),
+      out
+    );
+    return;
+  }
+
   hm::meta::data_count_type bytes = 0;
 
   auto walker = dynamic_cast<const hm::dec_node<entity_type> *>(tree);
@@ -259,16 +572,100 @@ void decode_data(
 
     bytes++;
   }
+}
+
+
+/// Copy the data section of a stored binary layout from and to pointers to
+/// bytes at once.
+/// Not meant to be called directly, see decode_stored.
+template<
+  typename in_iter,
+  typename out_iter
+>
+void copy_stored(
+  const hm::meta& md,
+  in_iter in_begin,
+  in_iter in_end,
+  out_iter out,
+  std::true_type /* byte pointers */
+)
+{
+  if( static_cast<uint64_t>(in_end - in_begin) < md.data_byte_count )
+    throw hm::invalid_layout("unexpected end");
+
+  if( md.data_byte_count )
+    std::memcpy(out, in_begin, static_cast<size_t>(md.data_byte_count));
+}
+
+
+/// Copy the data section of a stored binary layout byte by byte.
+/// Not meant to be called directly, see decode_stored.
+template<
+  typename in_iter,
+  typename out_iter
+>
+void copy_stored(
+  const hm::meta& md,
+  in_iter in_begin,
+  in_iter in_end,
+  out_iter out,
+  std::false_type /* byte pointers */
+)
+{
+  for(hm::meta::data_count_type i = 0; i < md.data_byte_count; ++i)
+  {
+    if( in_begin == in_end )
+      throw hm::invalid_layout("unexpected end");
+
+    *out++ = *in_begin++;
+  }
+}
+
 
-  if( bytes != md.data_byte_count )
-    throw hm::invalid_layout("missing bytes in data section");
+/// Decode a stored binary layout (md.flags contains hm::flag_stored) by
+/// copying the data section. If both in_iter and out_iter are pointers to
+/// bytes, the data section is copied with a single std::memcpy.
+///
+/// Parameters:
+///   md:
+///     The description of the binary layout.
+///   in_begin, in_end:
+///     A range of input iterators pointing to the data section.
+///   out:
+///     An output iterator accepting decoded bytes (=the original input)
+///
+/// Throws hm::invalid_layout if in_end is reached before md.data_byte_count
+/// bytes have been copied.
+template<
+  typename in_iter,
+  typename out_iter
+>
+void decode_stored(const hm::meta& md, in_iter in_begin, in_iter in_end, out_iter out)
+{
+  assert(md.flags & hm::flag_stored);
+
+  hm::copy_stored(
+    md,
+    in_begin,
+    in_end,
+    out,
+    std::integral_constant<
+      bool,
+      hm::is_byte_pointer<in_iter>::value && hm::is_byte_pointer<out_iter>::value
+    >()
+  );
 }
 
 
 /// Decode the binary layout.
-/// Calls decode_entities, decode_tree and finally decode_data.
+/// Calls decode_entities, decode_tree and finally decode_data, or
+/// decode_stored if the layout is stored.
 ///
 /// Parameters:
+///   entity_type:
+///     The representation of a decoded entity, see decode_entities.
+///     A hm::byte_entity of md.entity_size bytes is considerably faster
+///     than the default byte-vector.
 ///   md:
 ///     The description of the binary layout.
 ///   in_begin, in_end:
@@ -276,18 +673,29 @@ void decode_data(
 ///   out:
 ///     An output iterator accepting decoded bytes (=the original input)
 template<
+  typename entity_type = std::vector<uint8_t>,
   typename in_iter,
   typename out_iter
 >
 void decode(const hm::meta& md, in_iter in_begin, in_iter in_end, out_iter out)
 {
-  auto entities = hm::decode_entities(in_begin, in_end, md);
+  if( md.flags & hm::flag_stored )
+  {
+    hm::decode_stored(md, in_begin, in_end, out);
+    return;
+  }
+
+  // empty input
+  if( md.entity_count == 0 && md.data_byte_count == 0 )
+    return;
+
+  auto entities = hm::decode_entities<entity_type>(in_begin, in_end, md);
   if( hm::is_forward_iterator<in_iter>::value )
   {
     // decode_entities throws if we reached end prematurely,
     // meaning we can safely advance without accidentally
     // skipping end
-    std::advance(in_begin, md.entity_size * md.entity_count);
+    std::advance(in_begin, hm::entity_section_byte_count(md));
   }
 
   auto tree = hm::decode_tree(in_begin, in_end, entities, md);
@@ -301,6 +709,95 @@ void decode(const hm::meta& md, in_iter in_begin, in_iter in_end, out_iter out)
 }
 
 
+/// Decode a range of entities using the seek index, in time proportional to
+/// the size of the range rather than the position of the range.
+///
+/// Parameters:
+///   entity_type:
+///     The representation of a decoded entity, see decode_entities.
+///   md:
+///     The description of the binary layout. Must be stored or contain a
+///     seek index (hm::flag_index) without pre-transforms.
+///   in_begin, in_end:
+///     A range of forward iterators pointing to bytes. in_begin must point
+///     to the first byte after the meta data.
+///   start:
+///     The index of the first entity to decode.
+///   count:
+///     The maximum number of entities to decode. The range ends early at the
+///     end of the input.
+///   out:
+///     An output iterator accepting decoded bytes.
+///
+/// Throws hm::invalid_layout if the layout has no seek index, or on
+/// unexpected or missing input.
+template<
+  typename entity_type = std::vector<uint8_t>,
+  typename in_iter,
+  typename out_iter
+>
+void decode_range(
+  const hm::meta& md,
+  in_iter in_begin,
+  in_iter in_end,
+  uint64_t start,
+  uint64_t count,
+  out_iter out
+)
+{
+  static_assert(
+    hm::is_forward_iterator<in_iter>::value,
+    "decode_range needs forward iterators"
+  );
+
+  if( md.flags & hm::flag_stored )
+  {
+    const uint64_t entity_count = md.data_byte_count / md.entity_size;
+    start = std::min(start, entity_count);
+    count = std::min(count, entity_count - start);
+
+    std::advance(in_begin, start * md.entity_size);
+
+    hm::meta md_range = md;
+    md_range.data_byte_count = count * md.entity_size;
+    hm::decode_stored(md_range, in_begin, in_end, out);
+    return;
+  }
+
+  if( !(md.flags & hm::flag_index)
+      || (md.flags & (hm::flag_rle | hm::flag_filter | hm::flag_shuffle)) )
+    throw hm::invalid_layout("missing seek index");
+
+  const uint64_t entry = start / md.index_interval;
+  if( entry >= md.index_entry_count || count == 0 )
+    return;
+
+  auto entities = hm::decode_entities<entity_type>(in_begin, in_end, md);
+  std::advance(in_begin, hm::entity_section_byte_count(md));
+
+  auto tree = hm::decode_tree(in_begin, in_end, entities, md);
+  std::advance(in_begin, md.tree_byte_count);
+
+  auto index_iter = in_begin;
+  std::advance(index_iter, md.data_byte_count + entry * sizeof(hm::index_entry_type));
+  const auto bit_offset = hm::decode_type<hm::index_entry_type>(index_iter, in_end);
+  if( bit_offset >= md.data_byte_count * 8U )
+    throw hm::invalid_layout("invalid index");
+
+  std::advance(in_begin, bit_offset / 8U);
+  hm::decode_data_range(
+    in_begin,
+    in_end,
+    tree.get(),
+    md,
+    bit_offset,
+    start % md.index_interval,
+    count,
+    out
+  );
+}
+
+
 } // end namespace hm
 
 #endif // HM_DECODE_H
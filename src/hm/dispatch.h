@@ -0,0 +1,126 @@
+#ifndef HM_DISPATCH_H
+#define HM_DISPATCH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+#include "hm/entity.h"
+#include "hm/exception.h"
+
+
+namespace hm
+{
+
+/// The largest entity size in bytes that the dispatcher supports.
+const size_t max_entity_size = 16;
+
+
+/// The entity type used for entities of size bytes when encoding.
+/// Sizes with a matching unsigned integral type use that type, all others use
+/// a hm::byte_entity.
+template<size_t size>
+struct sized_entity
+{
+  typedef hm::byte_entity<size> type;
+};
+
+template<>
+struct sized_entity<1>
+{
+  typedef uint8_t type;
+};
+
+template<>
+struct sized_entity<2>
+{
+  typedef uint16_t type;
+};
+
+template<>
+struct sized_entity<4>
+{
+  typedef uint32_t type;
+};
+
+template<>
+struct sized_entity<8>
+{
+  typedef uint64_t type;
+};
+
+
+/// A compile time sequence of indices (std::index_sequence is C++14).
+template<size_t ...indices>
+struct index_sequence {};
+
+template<size_t count, size_t ...indices>
+struct make_index_sequence
+: hm::make_index_sequence<count - 1, count - 1, indices...>
+{
+};
+
+template<size_t ...indices>
+struct make_index_sequence<0, indices...>
+: hm::index_sequence<indices...>
+{
+};
+
+
+/// A table with an instantiation of action::run for every entity size.
+/// Not meant to be used directly, see dispatch_entity_size.
+template<typename action>
+struct dispatch_table
+{
+  typedef decltype(&action::template run<uint8_t>) function_type;
+
+  template<size_t ...indices>
+  static const function_type * get(hm::index_sequence<indices...>)
+  {
+    static const function_type functions[] = {
+      &action::template run<typename hm::sized_entity<indices + 1>::type>...
+    };
+    return functions;
+  }
+};
+
+
+/// Call action::run<entity_type>(args...) where entity_type is the
+/// hm::sized_entity of entity_size bytes.
+///
+/// Templates need the entity type at compile time. The table of
+/// instantiations for all sizes up to max_entity_size is generated at
+/// compile time, so each entity size gets its own specialised code while the
+/// size is picked at runtime.
+///
+/// Parameters:
+///   action:
+///     A type with a static member function template
+///     template<typename entity_type> run(...). All instantiations must have
+///     the same signature.
+///   entity_size:
+///     The size of an entity in bytes.
+///   args:
+///     Passed on to action::run.
+///
+/// Throws hm::invalid_layout if entity_size is 0 or exceeds max_entity_size.
+template<
+  typename action,
+  typename ...Args
+>
+void dispatch_entity_size(size_t entity_size, Args&& ...args)
+{
+  if( entity_size == 0 || entity_size > hm::max_entity_size )
+    throw hm::invalid_layout("unsupported entity size");
+
+  static const auto functions = hm::dispatch_table<action>::get(
+    hm::make_index_sequence<hm::max_entity_size>()
+  );
+
+  functions[entity_size - 1](std::forward<Args>(args)...);
+}
+
+
+} // end namespace hm
+
+#endif // HM_DISPATCH_H
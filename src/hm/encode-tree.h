@@ -46,7 +46,8 @@ public:
   {
   }
 
-  entity_type get_entity() const
+  // by reference: entities may be byte-vectors, copying them allocates
+  const entity_type& get_entity() const
   {
     return this->ent;
   }
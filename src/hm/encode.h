@@ -9,7 +9,11 @@
 #include <limits>
 #include <iterator>
 #include <memory>
-#include <unordered_map>
+#include <queue>
+#include <functional>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
 
 #include "util/make-unique.h"
 #include "ds/priority-queue.h"
@@ -17,6 +21,8 @@
 #include "hm/exception.h"
 #include "hm/encode-tree.h"
 #include "hm/common.h"
+#include "hm/filter.h"
+#include "hm/varint.h"
 
 
 namespace hm
@@ -24,6 +30,9 @@ namespace hm
 
 /// Encode the binary layout description.
 ///
+/// Fields that were added to the layout after md.version are omitted, as are
+/// optional fields whose flag is not set in md.flags.
+///
 /// Parameters:
 ///   md:
 ///     The description of the binary layout.
@@ -41,6 +50,90 @@ void encode_meta_data(const hm::meta& md, out_iter out)
   hm::encode_type(md.entity_count, out);
   hm::encode_type(md.tree_byte_count, out);
   hm::encode_type(md.data_byte_count, out);
+
+  if( md.version > 10 )
+  {
+    hm::encode_type(md.flags, out);
+
+    if( md.flags & hm::flag_filter )
+      hm::encode_type(md.filter, out);
+
+    if( md.flags & hm::flag_checksum )
+      hm::encode_type(md.checksum, out);
+
+    if( md.flags & hm::flag_index )
+    {
+      hm::encode_type(md.index_interval, out);
+      hm::encode_type(md.index_entry_count, out);
+    }
+
+    if( md.flags & hm::flag_compact_entities )
+      hm::encode_type(md.entity_byte_count, out);
+
+    if( md.flags & hm::flag_original_size )
+      hm::encode_type(md.original_byte_count, out);
+
+    if( md.flags & hm::flag_escape )
+      hm::encode_type(md.escape_leaf, out);
+  }
+}
+
+
+/// Count the entities of the input sequence in a hash map.
+/// Not meant to be called directly, see build_frequency_table.
+template<
+  typename entity_type,
+  typename in_iter,
+  typename table_type
+>
+void count_entities(
+  in_iter in_begin,
+  in_iter in_end,
+  table_type& table,
+  std::false_type /* single byte entity */
+)
+{
+  while(in_begin != in_end)
+  {
+    // passing in_begin by reference
+    auto entity = hm::decode_type<entity_type>(in_begin, in_end);
+    table[entity] += 1;
+  }
+}
+
+
+/// Count single byte entities in a plain array, which is considerably
+/// faster than hashing each entity.
+/// Not meant to be called directly, see build_frequency_table.
+template<
+  typename entity_type,
+  typename in_iter,
+  typename table_type
+>
+void count_entities(
+  in_iter in_begin,
+  in_iter in_end,
+  table_type& table,
+  std::true_type /* single byte entity */
+)
+{
+  size_t counts[std::numeric_limits<uint8_t>::max() + 1] = {0};
+
+  while(in_begin != in_end)
+  {
+    counts[static_cast<uint8_t>(*in_begin)]++;
+    ++in_begin;
+  }
+
+  for(size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i)
+  {
+    if( counts[i] )
+    {
+      const uint8_t byte = static_cast<uint8_t>(i);
+      const uint8_t * byte_ptr = &byte;
+      table[hm::decode_type<entity_type>(byte_ptr, byte_ptr + 1)] = counts[i];
+    }
+  }
 }
 
 
@@ -51,57 +144,52 @@ void encode_meta_data(const hm::meta& md, out_iter out)
 ///     A range of input iterators pointing to bytes.
 ///
 /// Return a table of mappings between entities and their number of occurrences in
-/// the input sequence.
+/// the input sequence, a hm::flat_map for 4 and 8 byte entities (see
+/// hm::frequency_table).
 /// We use size_t for the counter since in the worst case we may have a sequence
 /// that consists of only one unique byte.
 template<
   typename entity_type,
   typename in_iter
 >
-std::unordered_map<entity_type, size_t>
+hm::frequency_table<entity_type>
 build_frequency_table(in_iter in_begin, in_iter in_end)
 {
-  std::unordered_map<entity_type, size_t> table;
+  hm::frequency_table<entity_type> table;
 
-  while(in_begin != in_end)
-  {
-    // passing in_begin by reference
-    auto entity = hm::decode_type<entity_type>(in_begin, in_end);
-    table[entity] += 1;
-  }
+  hm::count_entities<entity_type>(
+    in_begin,
+    in_end,
+    table,
+    std::integral_constant<bool, sizeof(entity_type) == 1>()
+  );
 
   return table;
 }
 
 
-/// Build the huffman tree.
+/// Build the huffman tree from a frequency table.
 ///
 /// Entities with high frequency get placed higher than entities with low frequency.
 /// The higher the placement, the lesser the width of the resulting huffman code.
 ///
 /// Parameters:
-///   entity_type:
-///     The byte-wise input will be interpreted as this type.
-///     Example: If entity_type is uint64_t, 8 bytes will form a single entity.
-///   in_begin, in_end:
-///     A range of input iterators pointing to bytes. The amount of bytes
-///     must be a multiple of sizeof(entity_type).
+///   frequencies:
+///     A table as returned by build_frequency_table.
 ///
 /// Returns a managed pointer to the top of the tree.
-/// Returns nullptr on empty input.
+/// Returns nullptr if frequencies is empty.
 template<
-  typename entity_type,
-  typename in_iter
+  typename table_type,
+  typename entity_type = typename table_type::key_type
 >
 std::unique_ptr<hm::enc_node<entity_type>>
-build_huffman_tree(in_iter in_begin, in_iter in_end)
+build_huffman_tree(const table_type& frequencies)
 {
   typedef hm::enc_tree<entity_type> tree_type;
   typedef hm::enc_node<entity_type> node_type;
   typedef hm::enc_leaf<entity_type> leaf_type;
 
-  const auto frequencies = hm::build_frequency_table<entity_type>(in_begin, in_end);
-
   // empty input
   if( frequencies.size() == 0 )
     return std::unique_ptr<tree_type>(nullptr);
@@ -162,6 +250,313 @@ build_huffman_tree(in_iter in_begin, in_iter in_end)
 }
 
 
+/// Build the huffman tree.
+///
+/// Parameters:
+///   entity_type:
+///     The byte-wise input will be interpreted as this type.
+///     Example: If entity_type is uint64_t, 8 bytes will form a single entity.
+///   in_begin, in_end:
+///     A range of input iterators pointing to bytes. The amount of bytes
+///     must be a multiple of sizeof(entity_type).
+///
+/// Returns a managed pointer to the top of the tree.
+/// Returns nullptr on empty input.
+template<
+  typename entity_type,
+  typename in_iter
+>
+std::unique_ptr<hm::enc_node<entity_type>>
+build_huffman_tree(in_iter in_begin, in_iter in_end)
+{
+  return hm::build_huffman_tree(
+    hm::build_frequency_table<entity_type>(in_begin, in_end)
+  );
+}
+
+
+/// Compute the huffman code length of each entity from its frequency,
+/// without building the huffman tree.
+///
+/// Ties may be broken differently than in build_huffman_tree, therefore
+/// single code lengths may differ from the actual tree. The sum of
+/// frequency * code length is the same for all huffman trees of a frequency
+/// table though. build_canonical_huffman_tree uses exactly these lengths.
+///
+/// Parameters:
+///   frequencies:
+///     The number of occurrences of each entity.
+///
+/// Returns the code length in bits of each entity, in the order of
+/// frequencies.
+inline std::vector<size_t> code_lengths(const std::vector<uint64_t>& frequencies)
+{
+  const size_t leaf_count = frequencies.size();
+
+  // a tree node with a single leaf: the entity is coded with one bit
+  if( leaf_count < 2 )
+    return std::vector<size_t>(leaf_count, 1);
+
+  typedef std::pair<uint64_t, size_t> weighted_node;
+  std::priority_queue<
+    weighted_node,
+    std::vector<weighted_node>,
+    std::greater<weighted_node>
+  > nodes;
+
+  for(size_t i = 0; i < leaf_count; ++i)
+    nodes.push(weighted_node(frequencies[i], i));
+
+  // leaves first, then inner nodes in the order they were created. Parents
+  // are always created after their children.
+  std::vector<size_t> parents(2 * leaf_count - 1, 0);
+  size_t next_node = leaf_count;
+  while( nodes.size() > 1 )
+  {
+    const weighted_node left = nodes.top();
+    nodes.pop();
+    const weighted_node right = nodes.top();
+    nodes.pop();
+
+    parents[left.second] = next_node;
+    parents[right.second] = next_node;
+    nodes.push(weighted_node(left.first + right.first, next_node));
+    ++next_node;
+  }
+
+  // the root is the last node and has depth 0
+  std::vector<size_t> depths(parents.size(), 0);
+  for(size_t i = parents.size() - 1; i-- > 0; )
+    depths[i] = depths[parents[i]] + 1;
+
+  depths.resize(leaf_count);
+  return depths;
+}
+
+
+/// Build the subtree at depth of a canonical huffman tree recursively.
+/// Not meant to be called directly, see build_canonical_huffman_tree.
+///
+/// Parameters:
+///   leaves:
+///     Pairs of entity and frequency, ordered by code length, then by
+///     value.
+///   lengths:
+///     The code length of each leaf.
+///   next:
+///     The index of the next leaf to place.
+template<
+  typename entity_type
+>
+std::unique_ptr<hm::enc_node<entity_type>>
+build_canonical_subtree(
+  const std::vector<std::pair<entity_type, size_t>>& leaves,
+  const std::vector<size_t>& lengths,
+  size_t& next,
+  size_t depth
+)
+{
+  assert(next < leaves.size());
+
+  // canonical codes are assigned in ascending order: the next leaf is the
+  // leftmost free node at its depth
+  if( lengths[next] == depth )
+  {
+    const auto& leaf = leaves[next++];
+    return util::make_unique<hm::enc_leaf<entity_type>>(leaf.second, leaf.first);
+  }
+
+  auto left = hm::build_canonical_subtree(leaves, lengths, next, depth + 1);
+  auto right = hm::build_canonical_subtree(leaves, lengths, next, depth + 1);
+  const size_t frequency = left->get_frequency() + right->get_frequency();
+
+  return util::make_unique<hm::enc_tree<entity_type>>(
+    frequency,
+    std::move(left),
+    std::move(right)
+  );
+}
+
+
+/// Order the leaves of a canonical huffman tree: by code length, then by
+/// value.
+///
+/// Parameters:
+///   lengths:
+///     The code length of each entity, see code_lengths.
+///   numbers:
+///     The value of each entity (see hm::entity_to_number), or empty to break
+///     ties by position in lengths, e.g. if the entity section is not
+///     compact.
+///
+/// Returns the positions in lengths of the leaves, left to right.
+inline std::vector<size_t> canonical_order(
+  const std::vector<size_t>& lengths,
+  const std::vector<uint64_t>& numbers
+)
+{
+  assert(numbers.empty() || numbers.size() == lengths.size());
+
+  std::vector<size_t> order(lengths.size());
+  std::iota(order.begin(), order.end(), 0);
+
+  if( numbers.empty() )
+  {
+    std::stable_sort(order.begin(), order.end(), [&](size_t l, size_t r) {
+      return lengths[l] < lengths[r];
+    });
+  }
+  else
+  {
+    std::sort(order.begin(), order.end(), [&](size_t l, size_t r) {
+      return lengths[l] != lengths[r]
+        ? lengths[l] < lengths[r]
+        : numbers[l] < numbers[r];
+    });
+  }
+
+  return order;
+}
+
+
+/// Compute the codes of a canonical huffman tree from its code lengths,
+/// without building the tree: the codes are those build_huffman_table
+/// returns for the tree of build_canonical_huffman_tree.
+///
+/// Parameters:
+///   lengths:
+///     The code length of each entity, see code_lengths.
+///   order:
+///     The order of the leaves, see canonical_order.
+///
+/// Returns the code of each entity, in the order of lengths.
+inline std::vector<hm::code_type> canonical_codes(
+  const std::vector<size_t>& lengths,
+  const std::vector<size_t>& order
+)
+{
+  std::vector<hm::code_type> codes(lengths.size());
+
+  // each code is its predecessor plus one, padded with 0 to its length
+  hm::code_type code;
+  for(auto i : order)
+  {
+    for(size_t bit = code.size(); bit-- > 0; )
+    {
+      if( !code[bit] )
+      {
+        code[bit] = true;
+        break;
+      }
+      code[bit] = false;
+    }
+
+    code.resize(lengths[i], false);
+    codes[i] = code;
+  }
+
+  return codes;
+}
+
+
+/// Build a canonical huffman tree from arrays of its leaves.
+///
+/// Parameters:
+///   entities, counts, lengths:
+///     The value, frequency and code length (see code_lengths) of each
+///     leaf.
+///   order:
+///     The order of the leaves, see canonical_order.
+///
+/// Returns a managed pointer to the top of the tree.
+/// Returns nullptr if entities is empty.
+template<
+  typename entity_type
+>
+std::unique_ptr<hm::enc_node<entity_type>>
+build_canonical_huffman_tree(
+  const std::vector<entity_type>& entities,
+  const std::vector<uint64_t>& counts,
+  const std::vector<size_t>& lengths,
+  const std::vector<size_t>& order
+)
+{
+  assert(entities.size() == counts.size());
+  assert(entities.size() == lengths.size());
+  assert(entities.size() == order.size());
+
+  if( entities.empty() )
+    return std::unique_ptr<hm::enc_node<entity_type>>(nullptr);
+
+  // a single leaf still gets its own tree node, see build_huffman_tree
+  if( entities.size() == 1 )
+  {
+    return util::make_unique<hm::enc_tree<entity_type>>(
+      counts[0],
+      util::make_unique<hm::enc_leaf<entity_type>>(counts[0], entities[0])
+    );
+  }
+
+  std::vector<std::pair<entity_type, size_t>> sorted_leaves;
+  std::vector<size_t> sorted_lengths;
+  sorted_leaves.reserve(order.size());
+  sorted_lengths.reserve(order.size());
+  for(auto i : order)
+  {
+    sorted_leaves.emplace_back(entities[i], counts[i]);
+    sorted_lengths.push_back(lengths[i]);
+  }
+
+  size_t next = 0;
+  return hm::build_canonical_subtree(sorted_leaves, sorted_lengths, next, 0);
+}
+
+
+/// Build a canonical huffman tree from a frequency table.
+///
+/// The code lengths are those of code_lengths. Left to right, the leaves are
+/// ordered by code length, then by value (see hm::entity_to_number), which
+/// keeps the differences between neighbouring leaves small for
+/// encode_entities_compact.
+///
+/// Parameters:
+///   frequencies:
+///     A table as returned by build_frequency_table. Entities must not be
+///     larger than hm::max_compact_entity_size.
+///
+/// Returns a managed pointer to the top of the tree.
+/// Returns nullptr if frequencies is empty.
+template<
+  typename table_type,
+  typename entity_type = typename table_type::key_type
+>
+std::unique_ptr<hm::enc_node<entity_type>>
+build_canonical_huffman_tree(const table_type& frequencies)
+{
+  std::vector<entity_type> entities;
+  std::vector<uint64_t> counts;
+  std::vector<uint64_t> numbers;
+  entities.reserve(frequencies.size());
+  counts.reserve(frequencies.size());
+  numbers.reserve(frequencies.size());
+  for(const auto& f : frequencies)
+  {
+    entities.push_back(f.first);
+    counts.push_back(f.second);
+    numbers.push_back(hm::entity_to_number(f.first));
+  }
+
+  const auto lengths = hm::code_lengths(counts);
+
+  return hm::build_canonical_huffman_tree(
+    entities,
+    counts,
+    lengths,
+    hm::canonical_order(lengths, numbers)
+  );
+}
+
+
 /// Recursively build a huffman table from a huffman tree.
 ///
 /// A huffman code for an entity is the path taken from the top of the tree
@@ -171,26 +566,31 @@ build_huffman_tree(in_iter in_begin, in_iter in_end)
 /// Parameters:
 ///   node:
 ///     A non-owning handle to a huffman tree.
-///
-/// Returns a table mapping entities to their encoded representation.
+///   table:
+///     Receives the code of every entity of the tree, e.g. a
+///     hm::code_table.
+///   prefix:
+///     The code of node, empty for the root. Has the same value again on
+///     return.
 template<
-  typename entity_type
+  typename entity_type,
+  typename table_type
 >
 void
 build_huffman_table(
   const hm::enc_node<entity_type> * node,
-  std::unordered_map<entity_type, hm::code_type>& table,
+  table_type& table,
   hm::code_type& prefix
 )
 {
   if( auto tree = dynamic_cast<const hm::enc_tree<entity_type> *>(node) )
   {
-    hm::code_type left_prefix = prefix;
-    left_prefix.push_back(0);
-    hm::build_huffman_table(tree->get_left(), table, left_prefix);
-
-    prefix.push_back(1);
+    // one prefix for the whole walk: only the codes in the table allocate
+    prefix.push_back(0);
+    hm::build_huffman_table(tree->get_left(), table, prefix);
+    prefix.back() = 1;
     hm::build_huffman_table(tree->get_right(), table, prefix);
+    prefix.pop_back();
   }
   else if( auto leaf = dynamic_cast<const hm::enc_leaf<entity_type> *>(node) )
   {
@@ -200,70 +600,88 @@ build_huffman_table(
 }
 
 
-/// Encode the corpus.
+/// Append a bit to the data section.
+/// Not meant to be called directly, see encode_data.
+///
+/// Parameters:
+///   byte:
+///     The byte that is currently being filled. Written to out once full.
+template<
+  typename out_iter
+>
+inline void append_data_bit(bool bit, uint8_t& byte, out_iter& out, hm::meta& md)
+{
+  if( bit )
+  {
+    byte = hm::set_bit(byte, md.data_last_bits);
+  }
+
+  // if byte is full
+  if( md.data_last_bits >= hm::max_shifts_in_byte )
+  {
+    *out++ = byte;
+    md.data_byte_count++;
+    byte = 0;
+    md.data_last_bits = 0;
+  }
+  else
+  {
+    md.data_last_bits++;
+  }
+}
+
+
+/// Encode the corpus with a prebuilt huffman table.
 ///
 /// Parameters:
 ///   in_begin, in_end:
 ///     A range of input iterators pointing to bytes.
-///   tree:
-///     A non-owning handle to a huffman tree.
+///   table:
+///     A table as returned by build_huffman_table, containing every entity
+///     of the input.
 ///   out:
 ///     An output iterator expecting bytes.
 ///   md:
 ///     The description of the binary layout.
+///   index:
+///     If not null, receives the bit offset of every md.index_interval-th
+///     entity's code (see hm::flag_index).
 template<
-  typename entity_type,
   typename in_iter,
-  typename out_iter
+  typename table_type,
+  typename out_iter,
+  typename = typename std::enable_if<
+    hm::is_code_table<table_type>::value
+  >::type
 >
 void encode_data(
   in_iter in_begin,
   in_iter in_end,
-  const hm::enc_node<entity_type> * tree,
+  const table_type& table,
   out_iter out,
-  hm::meta& md
+  hm::meta& md,
+  std::vector<hm::index_entry_type> * index = nullptr
 )
 {
-  assert(tree != nullptr);
-
-  // my stdlib (gnu) uses an identity hash function for trivial types
-  // which will just cast entity_type to size_t.
-  // (See _Cxx_hashtable_define_trivial_hash in functional_hash.h)
-  std::unordered_map<entity_type, hm::code_type> table;
-  hm::code_type prefix;
-  hm::build_huffman_table<entity_type>(tree, table, prefix);
+  assert(index == nullptr || md.index_interval > 0);
 
   uint8_t byte = 0;
+  uint64_t entity_number = 0;
 
   while( in_begin != in_end )
   {
     // passing in_begin by reference
-    auto entity = hm::decode_type<entity_type>(in_begin, in_end);
+    auto entity = hm::decode_type<typename table_type::key_type>(in_begin, in_end);
+
+    if( index && entity_number++ % md.index_interval == 0 )
+      index->push_back(md.data_byte_count * 8U + md.data_last_bits);
 
     // get the huffman code
     const auto& code = table.at(entity);
 
     // fill byte with bits from left to right
     for(const auto& bit : code)
-    {
-      if( bit )
-      {
-        byte = hm::set_bit(byte, md.data_last_bits);
-      }
-
-      // if byte is full
-      if( md.data_last_bits >= hm::max_shifts_in_byte )
-      {
-        *out++ = byte;
-        md.data_byte_count++;
-        byte = 0;
-        md.data_last_bits = 0;
-      }
-      else
-      {
-        md.data_last_bits++;
-      }
-    }
+      hm::append_data_bit(bit, byte, out, md);
   }
 
   // if we didn't fill the last byte fully
@@ -275,28 +693,136 @@ void encode_data(
 }
 
 
-/// Encode the tree recursively. This function is not meant to be called
-/// directly, see encode_tree.
-///
-/// Due to the recursion we have no means of detecting the last written bit,
-/// so we return the last byte and let the caller handle the last part.
+/// Encode the corpus with a huffman table that may lack entities of the
+/// input (see hm::flag_escape): those are coded with the code of escape,
+/// followed by the entity as a literal.
 ///
 /// Parameters:
-///   node:
-///     A non-owning handle to a huffman tree.
-///   out:
-///     An output iterator expecting bytes.
-///   md:
-///     The description of the binary layout.
+///   table:
+///     A hm::code_table containing escape, e.g. of a tree built from a
+///     sample of the input.
+///   escape:
+///     The placeholder entity of the escape leaf. Occurrences of escape in
+///     the input are escaped as well.
 ///
-/// Returns the byte that is currently being filled.
+/// See the overload without escape for the other parameters.
 template<
   typename entity_type,
+  typename in_iter,
   typename out_iter
 >
-uint8_t encode_tree_recursive(
-  const hm::enc_node<entity_type> * node,
-  out_iter out,
+void encode_data_escaped(
+  in_iter in_begin,
+  in_iter in_end,
+  const hm::code_table<entity_type>& table,
+  const entity_type& escape,
+  out_iter out,
+  hm::meta& md,
+  std::vector<hm::index_entry_type> * index = nullptr
+)
+{
+  assert(index == nullptr || md.index_interval > 0);
+
+  const auto& escape_code = table.at(escape);
+  uint8_t byte = 0;
+  uint64_t entity_number = 0;
+
+  while( in_begin != in_end )
+  {
+    // passing in_begin by reference
+    auto entity = hm::decode_type<entity_type>(in_begin, in_end);
+
+    if( index && entity_number++ % md.index_interval == 0 )
+      index->push_back(md.data_byte_count * 8U + md.data_last_bits);
+
+    const auto found = table.find(entity);
+    if( found != table.end() && !(entity == escape) )
+    {
+      for(const auto& bit : found->second)
+        hm::append_data_bit(bit, byte, out, md);
+
+      continue;
+    }
+
+    for(const auto& bit : escape_code)
+      hm::append_data_bit(bit, byte, out, md);
+
+    uint8_t literal[sizeof(entity_type)];
+    hm::encode_type(entity, literal);
+    for(auto literal_byte : literal)
+      for(uint8_t pos = 0; pos <= hm::max_shifts_in_byte; ++pos)
+        hm::append_data_bit(hm::get_bit(literal_byte, pos), byte, out, md);
+  }
+
+  // if we didn't fill the last byte fully
+  if( md.data_last_bits > 0 )
+  {
+    *out++ = byte;
+    md.data_byte_count++;
+  }
+}
+
+
+/// Encode the corpus.
+///
+/// Parameters:
+///   in_begin, in_end:
+///     A range of input iterators pointing to bytes.
+///   tree:
+///     A non-owning handle to a huffman tree.
+///   out:
+///     An output iterator expecting bytes.
+///   md:
+///     The description of the binary layout.
+///   index:
+///     If not null, receives the bit offset of every md.index_interval-th
+///     entity's code (see hm::flag_index).
+template<
+  typename entity_type,
+  typename in_iter,
+  typename out_iter
+>
+void encode_data(
+  in_iter in_begin,
+  in_iter in_end,
+  const hm::enc_node<entity_type> * tree,
+  out_iter out,
+  hm::meta& md,
+  std::vector<hm::index_entry_type> * index = nullptr
+)
+{
+  assert(tree != nullptr);
+
+  hm::code_table<entity_type> table;
+  hm::code_type prefix;
+  hm::build_huffman_table<entity_type>(tree, table, prefix);
+
+  hm::encode_data(in_begin, in_end, table, out, md, index);
+}
+
+
+/// Encode the tree recursively. This function is not meant to be called
+/// directly, see encode_tree.
+///
+/// Due to the recursion we have no means of detecting the last written bit,
+/// so we return the last byte and let the caller handle the last part.
+///
+/// Parameters:
+///   node:
+///     A non-owning handle to a huffman tree.
+///   out:
+///     An output iterator expecting bytes.
+///   md:
+///     The description of the binary layout.
+///
+/// Returns the byte that is currently being filled.
+template<
+  typename entity_type,
+  typename out_iter
+>
+uint8_t encode_tree_recursive(
+  const hm::enc_node<entity_type> * node,
+  out_iter out,
   hm::meta& md,
   uint8_t byte = 0
 )
@@ -398,6 +924,203 @@ void encode_entities(
 }
 
 
+/// Encode the entities compactly recursively. This function is not meant to
+/// be called directly, see encode_entities_compact.
+///
+/// Parameters:
+///   previous:
+///     The number of the previously written leaf (see hm::entity_to_number).
+template<
+  typename entity_type,
+  typename out_iter
+>
+void encode_entities_compact_recursive(
+  const hm::enc_node<entity_type> * node,
+  out_iter out,
+  hm::meta& md,
+  uint64_t& previous
+)
+{
+  if( auto tree = dynamic_cast<const hm::enc_tree<entity_type> *>(node) )
+  {
+    hm::encode_entities_compact_recursive(tree->get_left(), out, md, previous);
+    hm::encode_entities_compact_recursive(tree->get_right(), out, md, previous);
+  }
+  else if( auto leaf = dynamic_cast<const hm::enc_leaf<entity_type> *>(node) )
+  {
+    const uint64_t number = hm::entity_to_number(leaf->get_entity());
+    md.entity_byte_count += hm::encode_varint(
+      hm::zigzag_encode<uint64_t>(number - previous),
+      out
+    );
+    md.entity_count++;
+    previous = number;
+  }
+  // else: node == null, ignore
+}
+
+
+/// Encode the entities compactly (see hm::flag_compact_entities).
+///
+/// Traverses the tree like encode_entities, but writes each leaf as the
+/// zigzag encoded difference to its predecessor in varint format. With a
+/// canonical tree (see build_canonical_huffman_tree) the differences are
+/// small for dense alphabets.
+///
+/// Parameters:
+///   node:
+///     A non-owning handle to a huffman tree.
+///   out:
+///     An output iterator expecting bytes.
+///   md:
+///     The description of the binary layout.
+template<
+  typename entity_type,
+  typename out_iter
+>
+void encode_entities_compact(
+  const hm::enc_node<entity_type> * node,
+  out_iter out,
+  hm::meta& md
+)
+{
+  assert(md.entity_size == sizeof(entity_type));
+  assert(sizeof(entity_type) <= hm::max_compact_entity_size);
+
+  uint64_t previous = 0;
+  hm::encode_entities_compact_recursive(node, out, md, previous);
+}
+
+
+/// Find the position of the leaf of entity in the entity section, i.e.
+/// among the leaves left to right.
+/// Not meant to be called directly, see encode_escaped.
+///
+/// Parameters:
+///   position:
+///     The number of leaves left of node. On return, the position of entity
+///     if found, otherwise the number of leaves left of and in node.
+///
+/// Returns true if entity is a leaf of node.
+template<
+  typename entity_type
+>
+bool find_leaf_position(
+  const hm::enc_node<entity_type> * node,
+  const entity_type& entity,
+  hm::meta::escape_leaf_type& position
+)
+{
+  if( auto tree = dynamic_cast<const hm::enc_tree<entity_type> *>(node) )
+  {
+    return hm::find_leaf_position(tree->get_left(), entity, position)
+      || hm::find_leaf_position(tree->get_right(), entity, position);
+  }
+  else if( auto leaf = dynamic_cast<const hm::enc_leaf<entity_type> *>(node) )
+  {
+    if( leaf->get_entity() == entity )
+      return true;
+
+    position++;
+  }
+  // else: node == null, ignore
+
+  return false;
+}
+
+
+/// Write the entity and tree sections of tree and describe them.
+/// Not meant to be called directly, see encode and encode_escaped.
+template<
+  typename entity_type,
+  typename out_iter
+>
+hm::meta encode_sections(
+  const hm::enc_node<entity_type> * tree,
+  out_iter out,
+  hm::meta::index_interval_type index_interval,
+  bool compact_entities
+)
+{
+  hm::meta md;
+  md.version = hm::current_version;
+  md.entity_size = sizeof(entity_type);
+
+  if( index_interval )
+  {
+    md.flags = hm::flag_index;
+    md.index_interval = index_interval;
+  }
+
+  compact_entities =
+    compact_entities && hm::is_compact_entity_size(sizeof(entity_type));
+  if( compact_entities )
+    md.flags = static_cast<hm::meta::flags_type>(md.flags | hm::flag_compact_entities);
+
+  if( tree == nullptr )
+    return md;
+
+  if( compact_entities )
+    hm::encode_entities_compact(tree, out, md);
+  else
+    hm::encode_entities(tree, out, md);
+  hm::encode_tree(tree, out, md);
+
+  return md;
+}
+
+
+/// Transform an input sequence into huffman codes with a prebuilt huffman
+/// table.
+///
+/// Parameters:
+///   table:
+///     The huffman table of tree, as returned by build_huffman_table.
+///
+/// See the overload without table for the other parameters.
+///
+/// Returns a description of written binary data.
+template<
+  typename entity_type,
+  typename in_iter,
+  typename table_type,
+  typename out_iter,
+  typename = typename std::enable_if<
+    hm::is_code_table<table_type>::value
+  >::type
+>
+hm::meta encode(
+  in_iter in_begin,
+  in_iter in_end,
+  const hm::enc_node<entity_type> * tree,
+  const table_type& table,
+  out_iter out,
+  hm::meta::index_interval_type index_interval = 0,
+  bool compact_entities = false
+)
+{
+  hm::meta md = hm::encode_sections(tree, out, index_interval, compact_entities);
+  if( tree == nullptr )
+    return md;
+
+  if( index_interval )
+  {
+    std::vector<hm::index_entry_type> index;
+    hm::encode_data(in_begin, in_end, table, out, md, &index);
+
+    for(auto entry : index)
+      hm::encode_type(entry, out);
+    md.index_entry_count = index.size();
+  }
+  else
+  {
+    hm::encode_data(in_begin, in_end, table, out, md);
+  }
+
+  return md;
+}
+
+
 /// Transform an input sequence into huffman codes.
 ///
 /// Parameters:
@@ -407,6 +1130,15 @@ void encode_entities(
 ///     A non-owning handle to a huffman tree.
 ///   out:
 ///     An output iterator expecting bytes.
+///   index_interval:
+///     If not 0, write a seek index with an entry for every index_interval-th
+///     entity after the data section (see hm::flag_index and
+///     hm::decode_range).
+///   compact_entities:
+///     If true, write a compact entity section (see
+///     hm::flag_compact_entities). Ignored unless
+///     hm::is_compact_entity_size(sizeof(entity_type)). Best used with a tree
+///     from build_canonical_huffman_tree.
 ///
 /// Returns a description of written binary data.
 template<
@@ -418,19 +1150,193 @@ hm::meta encode(
   in_iter in_begin,
   in_iter in_end,
   const hm::enc_node<entity_type> * tree,
-  out_iter out
+  out_iter out,
+  hm::meta::index_interval_type index_interval = 0,
+  bool compact_entities = false
+)
+{
+  hm::code_table<entity_type> table;
+  hm::code_type prefix;
+  hm::build_huffman_table<entity_type>(tree, table, prefix);
+
+  return hm::encode(
+    in_begin,
+    in_end,
+    tree,
+    table,
+    out,
+    index_interval,
+    compact_entities
+  );
+}
+
+
+/// Transform an input sequence into huffman codes with a tree that has an
+/// escape leaf (see hm::flag_escape), e.g. built from a sample of the input
+/// with an entity for the entities the sample lacks. Needs a single pass
+/// over the input.
+///
+/// Parameters:
+///   table:
+///     The huffman table of tree, a hm::code_table.
+///   escape:
+///     The placeholder entity of the escape leaf, a leaf of tree. See
+///     encode_data_escaped.
+///
+/// See the overload without table for the other parameters.
+///
+/// Throws std::invalid_argument if escape is not a leaf of tree.
+/// Returns a description of written binary data.
+template<
+  typename entity_type,
+  typename in_iter,
+  typename out_iter
+>
+hm::meta encode_escaped(
+  in_iter in_begin,
+  in_iter in_end,
+  const hm::enc_node<entity_type> * tree,
+  const hm::code_table<entity_type>& table,
+  const entity_type& escape,
+  out_iter out,
+  hm::meta::index_interval_type index_interval = 0,
+  bool compact_entities = false
+)
+{
+  hm::meta::escape_leaf_type escape_leaf = 0;
+  if( !hm::find_leaf_position(tree, escape, escape_leaf) )
+    throw std::invalid_argument("escape is not a leaf of tree");
+
+  hm::meta md = hm::encode_sections(tree, out, index_interval, compact_entities);
+  md.flags = static_cast<hm::meta::flags_type>(md.flags | hm::flag_escape);
+  md.escape_leaf = escape_leaf;
+
+  if( index_interval )
+  {
+    std::vector<hm::index_entry_type> index;
+    hm::encode_data_escaped(in_begin, in_end, table, escape, out, md, &index);
+
+    for(auto entry : index)
+      hm::encode_type(entry, out);
+    md.index_entry_count = index.size();
+  }
+  else
+  {
+    hm::encode_data_escaped(in_begin, in_end, table, escape, out, md);
+  }
+
+  return md;
+}
+
+
+/// Pick the placeholder entity of an escape leaf (see hm::flag_escape): the
+/// entity with the smallest number, in the byte order of hm::encode_type,
+/// that does not occur in frequencies.
+///
+/// Parameters:
+///   frequencies:
+///     A table as returned by build_frequency_table.
+///   escape:
+///     Receives the entity.
+///
+/// Returns false if frequencies holds all entities of entity_type, e.g. all
+/// 256 bytes. Then there is nothing to escape.
+template<
+  typename entity_type,
+  typename table_type
+>
+bool find_escape_entity(const table_type& frequencies, entity_type& escape)
+{
+  // one of the first size() + 1 numbers is free
+  for(uint64_t number = 0; number <= frequencies.size(); ++number)
+  {
+    // all numbers of entity_type are taken
+    if( sizeof(entity_type) < 8 && (number >> (8U * (sizeof(entity_type) % 8U))) )
+      return false;
+
+    uint8_t bytes[sizeof(entity_type)] = {0};
+    for(size_t i = 0; i < std::min<size_t>(sizeof(bytes), 8); ++i)
+      bytes[i] = static_cast<uint8_t>(number >> (8U * i));
+
+    uint8_t * bytes_begin = bytes;
+    const entity_type entity =
+      hm::decode_type<entity_type>(bytes_begin, bytes + sizeof(bytes));
+    if( frequencies.find(entity) == frequencies.end() )
+    {
+      escape = entity;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+/// Describe a stored binary layout of byte_count bytes.
+///
+/// Parameters:
+///   byte_count:
+///     The size of the input in bytes.
+///   entity_size:
+///     The entity size the input was meant to be coded with. Stored layouts
+///     do not depend on it.
+inline hm::meta make_stored_meta(
+  hm::meta::data_count_type byte_count,
+  hm::meta::entity_size_type entity_size
 )
 {
   hm::meta md;
-  md.version = 10;
-  md.entity_size = sizeof(entity_type);
+  md.version = hm::current_version;
+  md.entity_size = entity_size;
+  md.data_byte_count = byte_count;
+  md.flags = hm::flag_stored;
 
-  if( tree == nullptr )
-    return md;
+  return md;
+}
 
-  hm::encode_entities(tree, out, md);
-  hm::encode_tree(tree, out, md);
-  hm::encode_data(in_begin, in_end, tree, out, md);
+
+/// Check whether storing the input as is would be smaller than the huffman
+/// coded binary layout md, e.g. because the input is random or already
+/// compressed.
+///
+/// Parameters:
+///   md:
+///     The description of the coded binary layout, e.g. as predicted by
+///     hm::estimate_layout.
+///   byte_count:
+///     The size of the input in bytes.
+inline bool is_stored_smaller(
+  const hm::meta& md,
+  hm::meta::data_count_type byte_count
+)
+{
+  return hm::layout_byte_count(hm::make_stored_meta(byte_count, md.entity_size))
+    < hm::layout_byte_count(md);
+}
+
+
+/// Copy the input into a stored binary layout.
+///
+/// Parameters:
+///   in_begin, in_end:
+///     A range of input iterators pointing to bytes.
+///   out:
+///     An output iterator expecting bytes.
+///
+/// Returns a description of written binary data.
+template<
+  typename in_iter,
+  typename out_iter
+>
+hm::meta encode_stored(in_iter in_begin, in_iter in_end, out_iter out)
+{
+  hm::meta md = hm::make_stored_meta(0, 1);
+
+  for(; in_begin != in_end; ++in_begin)
+  {
+    *out++ = *in_begin;
+    md.data_byte_count++;
+  }
 
   return md;
 }
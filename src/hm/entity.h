@@ -0,0 +1,114 @@
+#ifndef HM_ENTITY_H
+#define HM_ENTITY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+
+
+namespace hm
+{
+
+/// An entity of a fixed number of bytes.
+///
+/// Used for entity sizes without a matching integral type (e.g. 3 byte RGB
+/// triples or 16 byte UUIDs), and by the decoder, which only needs to copy
+/// entities to the output.
+template<size_t size>
+struct byte_entity
+{
+  static_assert(size > 0, "entities must not be empty");
+
+  uint8_t bytes[size];
+
+  uint8_t * begin()
+  {
+    return this->bytes;
+  }
+
+  uint8_t * end()
+  {
+    return this->bytes + size;
+  }
+
+  const uint8_t * begin() const
+  {
+    return this->bytes;
+  }
+
+  const uint8_t * end() const
+  {
+    return this->bytes + size;
+  }
+};
+
+
+template<size_t size>
+inline bool operator==(
+  const hm::byte_entity<size>& left,
+  const hm::byte_entity<size>& right
+)
+{
+  return std::memcmp(left.bytes, right.bytes, size) == 0;
+}
+
+
+template<size_t size>
+inline bool operator!=(
+  const hm::byte_entity<size>& left,
+  const hm::byte_entity<size>& right
+)
+{
+  return !(left == right);
+}
+
+
+/// Trait to check if a type is a hm::byte_entity.
+template<typename type>
+struct is_byte_entity : std::false_type {};
+
+template<size_t size>
+struct is_byte_entity<hm::byte_entity<size>> : std::true_type {};
+
+
+/// Trait to check if a type can be used as an entity: either an integral type
+/// or a hm::byte_entity.
+template<typename type>
+using is_entity =
+  std::integral_constant<
+    bool,
+    std::is_integral<type>::value || hm::is_byte_entity<type>::value
+  >
+;
+
+
+} // end namespace hm
+
+
+namespace std
+{
+
+/// Hash a hm::byte_entity (FNV-1a), which allows using byte entities as keys
+/// of std::unordered_map.
+template<size_t size>
+struct hash<hm::byte_entity<size>>
+{
+  size_t operator()(const hm::byte_entity<size>& entity) const
+  {
+    uint64_t digest = 14695981039346656037ULL;
+    for(size_t i = 0; i < size; ++i)
+    {
+      digest ^= entity.bytes[i];
+      digest *= 1099511628211ULL;
+    }
+
+    return static_cast<size_t>(digest);
+  }
+};
+
+
+} // end namespace std
+
+#endif // HM_ENTITY_H
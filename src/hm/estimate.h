@@ -0,0 +1,473 @@
+#ifndef HM_ESTIMATE_H
+#define HM_ESTIMATE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <queue>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <future>
+#include <numeric>
+
+#include "hm/common.h"
+#include "hm/encode.h"
+#include "hm/symbols.h"
+#include "hm/filter.h"
+#include "hm/rle.h"
+#include "hm/shuffle.h"
+#include "hm/dispatch.h"
+#include "hm/varint.h"
+
+
+namespace hm
+{
+
+/// The entity sizes tried by select_entity_size.
+const hm::meta::entity_size_type candidate_entity_sizes[] = {1, 2, 4, 8};
+
+
+/// Compute the binary layout of a huffman code with the given code lengths.
+/// Not meant to be called directly, see estimate_layout and report_code.
+///
+/// Parameters:
+///   frequencies:
+///     The number of occurrences of each entity.
+///   lengths:
+///     The code length of each entity, see code_lengths.
+///   entity_size:
+///     The size of an entity in bytes.
+///   numbers:
+///     If not null, the value of each entity (see hm::entity_to_number) for
+///     a compact entity section (see hm::flag_compact_entities).
+inline hm::meta layout_from_code_lengths(
+  const std::vector<uint64_t>& frequencies,
+  const std::vector<size_t>& lengths,
+  hm::meta::entity_size_type entity_size,
+  const std::vector<uint64_t> * numbers = nullptr
+)
+{
+  hm::meta md;
+  md.version = hm::current_version;
+  md.entity_size = entity_size;
+  if( numbers )
+    md.flags = hm::flag_compact_entities;
+
+  if( frequencies.empty() )
+    return md;
+
+  if( numbers )
+  {
+    // the leaf order of build_canonical_huffman_tree
+    uint64_t previous = 0;
+    for(auto i : hm::canonical_order(lengths, *numbers))
+    {
+      md.entity_byte_count += hm::varint_byte_count(
+        hm::zigzag_encode<uint64_t>((*numbers)[i] - previous)
+      );
+      previous = (*numbers)[i];
+    }
+  }
+
+  // each inner node is one bit, each leaf is one bit. A single leaf still
+  // gets its own tree node.
+  const uint64_t tree_bits =
+    frequencies.size() == 1 ? 2 : 2 * frequencies.size() - 1;
+
+  uint64_t data_bits = 0;
+  for(size_t i = 0; i < frequencies.size(); ++i)
+    data_bits += frequencies[i] * lengths[i];
+
+  md.entity_count = static_cast<hm::meta::entity_count_type>(frequencies.size());
+
+  md.tree_byte_count = static_cast<hm::meta::tree_count_type>((tree_bits + 7) / 8);
+  // encode_tree flushes full bytes lazily, the last byte is never empty
+  md.tree_last_bits = static_cast<hm::meta::last_bits_type>(
+    tree_bits % 8 == 0 ? 8 : tree_bits % 8
+  );
+
+  md.data_byte_count = (data_bits + 7) / 8;
+  md.data_last_bits = static_cast<hm::meta::last_bits_type>(data_bits % 8);
+
+  return md;
+}
+
+
+/// Split a frequency table into the counts and, for a compact entity
+/// section, the values of its entities.
+/// Not meant to be called directly, see estimate_layout and report_code.
+template<
+  typename table_type,
+  typename entity_type = typename table_type::key_type
+>
+void collect_counts(
+  const table_type& frequencies,
+  bool compact_entities,
+  std::vector<uint64_t>& counts,
+  std::vector<uint64_t>& numbers
+)
+{
+  compact_entities =
+    compact_entities && hm::is_compact_entity_size(sizeof(entity_type));
+
+  counts.reserve(frequencies.size());
+  if( compact_entities )
+    numbers.reserve(frequencies.size());
+
+  for(const auto& f : frequencies)
+  {
+    counts.push_back(f.second);
+    if( compact_entities )
+      numbers.push_back(hm::entity_to_number(f.first));
+  }
+}
+
+
+/// Compute the binary layout that hm::encode would produce for a sequence
+/// with the given entity frequencies, without building the huffman tree.
+///
+/// Parameters:
+///   frequencies:
+///     A table as returned by build_frequency_table.
+///   compact_entities:
+///     Predict a compact entity section written from the tree of
+///     build_canonical_huffman_tree (see hm::encode). Ignored unless
+///     hm::is_compact_entity_size(sizeof(entity_type)).
+///
+/// Returns the description of the binary layout.
+template<
+  typename table_type,
+  typename entity_type = typename table_type::key_type
+>
+hm::meta estimate_layout(
+  const table_type& frequencies,
+  bool compact_entities = false
+)
+{
+  std::vector<uint64_t> counts;
+  std::vector<uint64_t> numbers;
+  hm::collect_counts(frequencies, compact_entities, counts, numbers);
+
+  return hm::layout_from_code_lengths(
+    counts,
+    hm::code_lengths(counts),
+    sizeof(entity_type),
+    hm::is_compact_entity_size(sizeof(entity_type)) && compact_entities
+      ? &numbers
+      : nullptr
+  );
+}
+
+
+/// Compute the binary layout that hm::encode would produce for the entities
+/// of a hm::symbol_index with the given code lengths.
+///
+/// Parameters:
+///   symbols:
+///     The distinct entities and their frequencies, see count_symbols.
+///   lengths:
+///     The code length of each symbol, see code_lengths.
+///   compact_entities:
+///     See the overload for a frequency table.
+///
+/// Returns the description of the binary layout.
+template<
+  typename entity_type
+>
+hm::meta estimate_layout(
+  const hm::symbol_index<entity_type>& symbols,
+  const std::vector<size_t>& lengths,
+  bool compact_entities = false
+)
+{
+  compact_entities =
+    compact_entities && hm::is_compact_entity_size(sizeof(entity_type));
+  const std::vector<uint64_t> numbers =
+    compact_entities ? symbols.numbers() : std::vector<uint64_t>();
+
+  return hm::layout_from_code_lengths(
+    symbols.counts(),
+    lengths,
+    sizeof(entity_type),
+    compact_entities ? &numbers : nullptr
+  );
+}
+
+
+/// Statistics of the huffman code of an input sequence, see report_code.
+struct code_report
+{
+  code_report()
+  : md(),
+    entity_count(0),
+    entropy(0),
+    average_code_length(0),
+    max_code_length(0),
+    code_length_histogram()
+  {
+  }
+
+  // The predicted binary layout
+  hm::meta md;
+
+  // The number of entities in the input sequence
+  uint64_t entity_count;
+
+  // The Shannon entropy in bits per entity, the lower bound for the
+  // average code length
+  double entropy;
+
+  // The average code length in bits per entity
+  double average_code_length;
+
+  // The longest code in bits
+  size_t max_code_length;
+
+  // The number of distinct entities per code length
+  // (index: code length in bits)
+  std::vector<uint64_t> code_length_histogram;
+};
+
+
+/// Report the huffman code of an input sequence from its frequency table,
+/// without building the huffman tree or encoding the input.
+///
+/// Parameters:
+///   frequencies:
+///     A table as returned by build_frequency_table.
+///   compact_entities:
+///     Predict a compact entity section, see estimate_layout.
+///
+/// Returns the predicted binary layout and statistics of the code.
+template<
+  typename table_type,
+  typename entity_type = typename table_type::key_type
+>
+hm::code_report report_code(
+  const table_type& frequencies,
+  bool compact_entities = false
+)
+{
+  std::vector<uint64_t> counts;
+  std::vector<uint64_t> numbers;
+  hm::collect_counts(frequencies, compact_entities, counts, numbers);
+
+  const auto lengths = hm::code_lengths(counts);
+
+  hm::code_report report;
+  report.md = hm::layout_from_code_lengths(
+    counts,
+    lengths,
+    sizeof(entity_type),
+    hm::is_compact_entity_size(sizeof(entity_type)) && compact_entities
+      ? &numbers
+      : nullptr
+  );
+
+  for(auto count : counts)
+    report.entity_count += count;
+
+  if( report.entity_count == 0 )
+    return report;
+
+  uint64_t data_bits = 0;
+  for(size_t i = 0; i < counts.size(); ++i)
+  {
+    const double p = static_cast<double>(counts[i]) / static_cast<double>(report.entity_count);
+    report.entropy -= p * std::log2(p);
+
+    data_bits += counts[i] * lengths[i];
+    report.max_code_length = std::max(report.max_code_length, lengths[i]);
+
+    if( report.code_length_histogram.size() <= lengths[i] )
+      report.code_length_histogram.resize(lengths[i] + 1, 0);
+    report.code_length_histogram[lengths[i]]++;
+  }
+
+  report.average_code_length =
+    static_cast<double>(data_bits) / static_cast<double>(report.entity_count);
+
+  return report;
+}
+
+
+/// Compute the number of bytes that encoding the input would produce,
+/// including all pre-transforms selected by md and the fallback to storing
+/// the input as is.
+///
+/// Parameters:
+///   entity_type:
+///     The byte-wise input will be interpreted as this type.
+///   in, size:
+///     The input. size must be a multiple of sizeof(entity_type).
+///   md:
+///     md.flags and md.filter select the pre-transforms, see hm::flag_*.
+///     hm::flag_compact_entities selects a compact entity section where
+///     entity_type supports it.
+///
+/// Throws hm::invalid_layout if the filter is not supported by entity_type.
+/// Returns the size of the binary layout in bytes, including the meta data.
+template<
+  typename entity_type
+>
+uint64_t estimate_byte_count(const uint8_t * in, size_t size, const hm::meta& md)
+{
+  std::vector<uint8_t> filtered;
+  if( md.flags & hm::flag_filter )
+  {
+    hm::apply_filter<entity_type>(md.filter, in, in + size, std::back_inserter(filtered));
+    in = filtered.data();
+  }
+
+  std::vector<uint8_t> tokens;
+
+  if( md.flags & hm::flag_shuffle )
+  {
+    const size_t count = size / sizeof(entity_type);
+    std::vector<uint8_t> lanes(size);
+    hm::shuffle(in, count, sizeof(entity_type), lanes.data());
+
+    hm::meta md_top;
+    md_top.version = hm::current_version;
+    md_top.flags = static_cast<hm::meta::flags_type>(
+      md.flags & ~(hm::flag_rle | hm::flag_compact_entities)
+    );
+    uint64_t byte_count = hm::meta_byte_count(md_top);
+
+    for(size_t lane = 0; lane < sizeof(entity_type); ++lane)
+    {
+      const uint8_t * lane_begin = lanes.data() + lane * count;
+      const uint8_t * lane_end = lane_begin + count;
+
+      if( md.flags & hm::flag_rle )
+      {
+        tokens.clear();
+        hm::rle_encode<uint8_t>(lane_begin, lane_end, std::back_inserter(tokens));
+        lane_begin = tokens.data();
+        lane_end = tokens.data() + tokens.size();
+      }
+
+      hm::meta md_lane = hm::estimate_layout(
+        hm::build_frequency_table<uint8_t>(lane_begin, lane_end)
+      );
+      md_lane.flags = static_cast<hm::meta::flags_type>(md.flags & hm::flag_rle);
+      if( hm::is_stored_smaller(md_lane, count) )
+        md_lane = hm::make_stored_meta(count, 1);
+      byte_count += hm::layout_byte_count(md_lane);
+    }
+
+    return byte_count;
+  }
+
+  const uint8_t * begin = in;
+  const uint8_t * end = in + size;
+  if( md.flags & hm::flag_rle )
+  {
+    hm::rle_encode<entity_type>(begin, end, std::back_inserter(tokens));
+    begin = tokens.data();
+    end = tokens.data() + tokens.size();
+  }
+
+  hm::meta md_estimate = hm::estimate_layout(
+    hm::build_frequency_table<entity_type>(begin, end),
+    md.flags & hm::flag_compact_entities
+  );
+  md_estimate.flags = static_cast<hm::meta::flags_type>(
+    (md.flags & ~hm::flag_compact_entities) |
+    (md_estimate.flags & hm::flag_compact_entities)
+  );
+  md_estimate.filter = md.filter;
+  if( hm::is_stored_smaller(md_estimate, size) )
+    md_estimate = hm::make_stored_meta(size, sizeof(entity_type));
+
+  return hm::layout_byte_count(md_estimate);
+}
+
+
+/// Call estimate_byte_count with an entity type picked at runtime.
+/// Not meant to be used directly, see select_entity_size.
+struct estimate_action
+{
+  template<typename entity_type>
+  static void run(
+    const uint8_t * in,
+    size_t size,
+    const hm::meta& md,
+    uint64_t& byte_count
+  )
+  {
+    byte_count = hm::estimate_byte_count<entity_type>(in, size, md);
+  }
+};
+
+
+/// Select the entity size that encodes a sample of the input into the fewest
+/// bytes.
+///
+/// Every entity size from candidate_entity_sizes that divides input_size is
+/// tried on the sample, each in its own thread. Ties go to the smaller entity
+/// size.
+///
+/// Parameters:
+///   sample, sample_size:
+///     A sample of the input, e.g. the whole input or evenly spaced chunks of
+///     it. Chunks should be aligned to the largest candidate entity size.
+///   input_size:
+///     The size of the whole input in bytes.
+///   md:
+///     md.flags and md.filter select the pre-transforms, see hm::flag_*.
+///
+/// Returns an entity size.
+inline hm::meta::entity_size_type select_entity_size(
+  const uint8_t * sample,
+  size_t sample_size,
+  uint64_t input_size,
+  const hm::meta& md
+)
+{
+  std::vector<hm::meta::entity_size_type> sizes;
+  std::vector<uint64_t> byte_counts;
+  std::vector<std::future<void>> trials;
+
+  for(auto entity_size : hm::candidate_entity_sizes)
+  {
+    if( input_size % entity_size == 0 )
+      sizes.push_back(entity_size);
+  }
+
+  byte_counts.resize(sizes.size(), 0);
+
+  for(size_t i = 0; i < sizes.size(); ++i)
+  {
+    trials.push_back(std::async(std::launch::async, [&, i]() {
+      hm::dispatch_entity_size<hm::estimate_action>(
+        sizes[i],
+        sample,
+        sample_size - sample_size % sizes[i],
+        md,
+        byte_counts[i]
+      );
+    }));
+  }
+
+  // rethrows exceptions of the trials
+  for(auto& trial : trials)
+    trial.get();
+
+  size_t best = 0;
+  for(size_t i = 1; i < sizes.size(); ++i)
+  {
+    if( byte_counts[i] < byte_counts[best] )
+      best = i;
+  }
+
+  return sizes.at(best);
+}
+
+
+} // end namespace hm
+
+#endif // HM_ESTIMATE_H
@@ -0,0 +1,328 @@
+#ifndef HM_FILTER_H
+#define HM_FILTER_H
+
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+
+#include "hm/common.h"
+#include "hm/exception.h"
+
+
+namespace hm
+{
+
+/// Map a two's complement difference to an unsigned value, so that values
+/// with a small magnitude stay small:
+///   0 -> 0, -1 -> 1, 1 -> 2, -2 -> 3, ...
+template<
+  typename value_type,
+  typename = typename std::enable_if<
+    std::is_unsigned<value_type>::value
+  >::type
+>
+inline value_type zigzag_encode(value_type value)
+{
+  // all ones if the sign bit is set, zero otherwise
+  const value_type sign = static_cast<value_type>(
+    0U - static_cast<value_type>(
+      value >> (std::numeric_limits<value_type>::digits - 1)
+    )
+  );
+
+  return static_cast<value_type>(static_cast<value_type>(value << 1U) ^ sign);
+}
+
+
+/// Reverse zigzag_encode.
+template<
+  typename value_type,
+  typename = typename std::enable_if<
+    std::is_unsigned<value_type>::value
+  >::type
+>
+inline value_type zigzag_decode(value_type value)
+{
+  const value_type sign = static_cast<value_type>(
+    0U - static_cast<value_type>(value & 1U)
+  );
+
+  return static_cast<value_type>(static_cast<value_type>(value >> 1U) ^ sign);
+}
+
+
+/// Replaces each value by the zigzag encoded difference to its predecessor.
+/// Slowly changing series (e.g. timestamps) collapse to few small values.
+template<typename value_type>
+class delta_filter
+{
+public:
+  delta_filter()
+  : previous(0)
+  {
+  }
+
+  value_type apply(value_type value)
+  {
+    const value_type delta = static_cast<value_type>(value - this->previous);
+    this->previous = value;
+    return hm::zigzag_encode(delta);
+  }
+
+  value_type reverse(value_type filtered)
+  {
+    this->previous = static_cast<value_type>(
+      this->previous + hm::zigzag_decode(filtered)
+    );
+    return this->previous;
+  }
+
+private:
+  value_type previous;
+};
+
+
+/// Replaces each value by the zigzag encoded difference between its delta and
+/// the previous delta. Series with a constant stride (e.g. counters) collapse
+/// to zero.
+template<typename value_type>
+class delta_delta_filter
+{
+public:
+  delta_delta_filter()
+  : previous(0),
+    previous_delta(0)
+  {
+  }
+
+  value_type apply(value_type value)
+  {
+    const value_type delta = static_cast<value_type>(value - this->previous);
+    const value_type delta_delta =
+      static_cast<value_type>(delta - this->previous_delta);
+    this->previous = value;
+    this->previous_delta = delta;
+    return hm::zigzag_encode(delta_delta);
+  }
+
+  value_type reverse(value_type filtered)
+  {
+    this->previous_delta = static_cast<value_type>(
+      this->previous_delta + hm::zigzag_decode(filtered)
+    );
+    this->previous = static_cast<value_type>(
+      this->previous + this->previous_delta
+    );
+    return this->previous;
+  }
+
+private:
+  value_type previous;
+  value_type previous_delta;
+};
+
+
+/// Replaces each value by its xor with the predecessor. Values that only
+/// differ in a few bits (e.g. floating point series) collapse to values with
+/// few bits set.
+template<typename value_type>
+class xor_filter
+{
+public:
+  xor_filter()
+  : previous(0)
+  {
+  }
+
+  value_type apply(value_type value)
+  {
+    const value_type filtered = static_cast<value_type>(value ^ this->previous);
+    this->previous = value;
+    return filtered;
+  }
+
+  value_type reverse(value_type filtered)
+  {
+    this->previous = static_cast<value_type>(filtered ^ this->previous);
+    return this->previous;
+  }
+
+private:
+  value_type previous;
+};
+
+
+/// Run each entity from the input sequence through a filter.
+/// Not meant to be called directly, see apply_filter and reverse_filter.
+///
+/// Parameters:
+///   in_begin, in_end:
+///     A range of input iterators pointing to bytes. The amount of bytes
+///     must be a multiple of sizeof(value_type).
+///   out:
+///     An output iterator expecting bytes.
+///   filter:
+///     One of delta_filter, delta_delta_filter or xor_filter.
+///   reverse:
+///     Whether to apply or reverse the filter.
+template<
+  typename value_type,
+  typename in_iter,
+  typename out_iter,
+  typename filter_impl
+>
+void run_filter(
+  in_iter in_begin,
+  in_iter in_end,
+  out_iter out,
+  filter_impl filter,
+  bool reverse
+)
+{
+  while( in_begin != in_end )
+  {
+    // passing in_begin by reference
+    const value_type value = hm::decode_type<value_type>(in_begin, in_end);
+    hm::encode_type(reverse ? filter.reverse(value) : filter.apply(value), out);
+  }
+}
+
+
+/// Select the filter implementation at runtime and run it.
+/// Not meant to be called directly, see apply_filter and reverse_filter.
+///
+/// Throws hm::invalid_layout if filter is unknown.
+template<
+  typename entity_type,
+  typename in_iter,
+  typename out_iter
+>
+void dispatch_filter(
+  hm::meta::filter_type filter,
+  in_iter in_begin,
+  in_iter in_end,
+  out_iter out,
+  bool reverse,
+  std::true_type /* integral entity */
+)
+{
+  typedef typename std::make_unsigned<entity_type>::type value_type;
+
+  switch( filter )
+  {
+    case hm::filter_none:
+      std::copy(in_begin, in_end, out);
+      break;
+    case hm::filter_delta:
+      hm::run_filter<value_type>(
+        in_begin, in_end, out, hm::delta_filter<value_type>(), reverse
+      );
+      break;
+    case hm::filter_delta_delta:
+      hm::run_filter<value_type>(
+        in_begin, in_end, out, hm::delta_delta_filter<value_type>(), reverse
+      );
+      break;
+    case hm::filter_xor:
+      hm::run_filter<value_type>(
+        in_begin, in_end, out, hm::xor_filter<value_type>(), reverse
+      );
+      break;
+    default:
+      throw hm::invalid_layout("unsupported filter");
+  }
+}
+
+
+/// Filters are only defined for integral entities.
+/// Not meant to be called directly, see apply_filter and reverse_filter.
+///
+/// Throws hm::invalid_layout if filter is not hm::filter_none.
+template<
+  typename entity_type,
+  typename in_iter,
+  typename out_iter
+>
+void dispatch_filter(
+  hm::meta::filter_type filter,
+  in_iter in_begin,
+  in_iter in_end,
+  out_iter out,
+  bool /* reverse */,
+  std::false_type /* integral entity */
+)
+{
+  if( filter != hm::filter_none )
+    throw hm::invalid_layout("unsupported filter for entity size");
+
+  std::copy(in_begin, in_end, out);
+}
+
+
+/// Apply a numeric pre-filter to the input sequence.
+///
+/// Filters make each entity relative to its predecessors. Numeric series
+/// whose entities are almost all distinct are turned into series with few
+/// distinct entities, which shrinks the frequency table, the tree and the
+/// entity section.
+///
+/// Parameters:
+///   entity_type:
+///     The byte-wise input will be interpreted as this type. Filters other
+///     than hm::filter_none require an integral type.
+///   filter:
+///     One of hm::filter_*.
+///   in_begin, in_end:
+///     A range of input iterators pointing to bytes. The amount of bytes
+///     must be a multiple of sizeof(entity_type).
+///   out:
+///     An output iterator expecting bytes.
+///
+/// Throws hm::invalid_layout if filter is unknown or not supported by
+/// entity_type.
+template<
+  typename entity_type,
+  typename in_iter,
+  typename out_iter
+>
+void apply_filter(
+  hm::meta::filter_type filter,
+  in_iter in_begin,
+  in_iter in_end,
+  out_iter out
+)
+{
+  hm::dispatch_filter<entity_type>(
+    filter, in_begin, in_end, out, false, std::is_integral<entity_type>()
+  );
+}
+
+
+/// Reverse apply_filter.
+///
+/// Parameters: see apply_filter.
+///
+/// Throws hm::invalid_layout if filter is unknown or not supported by
+/// entity_type.
+template<
+  typename entity_type,
+  typename in_iter,
+  typename out_iter
+>
+void reverse_filter(
+  hm::meta::filter_type filter,
+  in_iter in_begin,
+  in_iter in_end,
+  out_iter out
+)
+{
+  hm::dispatch_filter<entity_type>(
+    filter, in_begin, in_end, out, true, std::is_integral<entity_type>()
+  );
+}
+
+
+} // end namespace hm
+
+#endif // HM_FILTER_H
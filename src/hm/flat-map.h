@@ -0,0 +1,362 @@
+#ifndef HM_FLAT_MAP_H
+#define HM_FLAT_MAP_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+
+namespace hm
+{
+
+/// Hash an integral key of up to 8 bytes with the finalizer of MurmurHash3
+/// (fmix64).
+///
+/// Every bit of the key affects every bit of the hash, so that the low bits
+/// of the hash, which select a slot of hm::flat_map, spread evenly even if
+/// the keys differ only in their high bits (e.g. little endian entities of
+/// text). The identity hash of std::hash does not.
+template<
+  typename key_type
+>
+struct mix_hash
+{
+  static_assert(
+    std::is_integral<key_type>::value && sizeof(key_type) <= sizeof(uint64_t),
+    "mix_hash expects an integral key of up to 8 bytes"
+  );
+
+  size_t operator()(key_type key) const
+  {
+    uint64_t h = static_cast<uint64_t>(key);
+    h ^= h >> 33U;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33U;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33U;
+
+    return static_cast<size_t>(h);
+  }
+};
+
+
+/// A hash map with open addressing and linear probing.
+///
+/// All entries live in one array, a lookup touches one or a few neighbouring
+/// slots instead of following a bucket's list of nodes as std::unordered_map
+/// does, and inserting does not allocate unless the map grows. The capacity
+/// is a power of two and the map grows before it is more than
+/// hm::flat_map::max_load_numerator / max_load_denominator full.
+///
+/// Provides the subset of the interface of std::unordered_map used for the
+/// tables of the encoder. Entries cannot be erased. Growing invalidates
+/// iterators and references.
+///
+/// Parameters:
+///   key:
+///     Must be default constructible and equality comparable.
+///   value:
+///     Must be default constructible.
+///   hash:
+///     Must spread keys over the low bits, see hm::mix_hash.
+template<
+  typename key,
+  typename value,
+  typename hash = hm::mix_hash<key>
+>
+class flat_map
+{
+public:
+  typedef key key_type;
+  typedef value mapped_type;
+  typedef std::pair<key, value> value_type;
+  typedef size_t size_type;
+
+  /// Grow beyond this share of used slots.
+  static const size_t max_load_numerator = 3;
+  static const size_t max_load_denominator = 4;
+
+  /// The capacity of the first allocation.
+  static const size_t min_capacity = 16;
+
+private:
+  /// Iterates over the used slots. Not meant to be used directly, see
+  /// iterator and const_iterator.
+  template<
+    typename map_type,
+    typename entry_type
+  >
+  class basic_iterator
+  {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef typename std::remove_const<entry_type>::type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef entry_type * pointer;
+    typedef entry_type& reference;
+
+    basic_iterator()
+    : map(nullptr),
+      slot(0)
+    {
+    }
+
+    basic_iterator(map_type * owner, size_t position)
+    : map(owner),
+      slot(position)
+    {
+      this->skip_unused();
+    }
+
+    /// Convert an iterator to a const_iterator.
+    template<
+      typename other_map_type,
+      typename other_entry_type
+    >
+    basic_iterator(const basic_iterator<other_map_type, other_entry_type>& other)
+    : map(other.map),
+      slot(other.slot)
+    {
+    }
+
+    reference operator*() const
+    {
+      return this->map->slots[this->slot];
+    }
+
+    pointer operator->() const
+    {
+      return &this->map->slots[this->slot];
+    }
+
+    basic_iterator& operator++()
+    {
+      ++this->slot;
+      this->skip_unused();
+      return *this;
+    }
+
+    basic_iterator operator++(int)
+    {
+      basic_iterator previous(*this);
+      ++*this;
+      return previous;
+    }
+
+    bool operator==(const basic_iterator& other) const
+    {
+      return this->slot == other.slot;
+    }
+
+    bool operator!=(const basic_iterator& other) const
+    {
+      return this->slot != other.slot;
+    }
+
+  private:
+    template<typename, typename> friend class basic_iterator;
+
+    void skip_unused()
+    {
+      while( this->slot < this->map->used.size() && !this->map->used[this->slot] )
+        ++this->slot;
+    }
+
+    map_type * map;
+    size_t slot;
+  };
+
+public:
+  typedef basic_iterator<flat_map, value_type> iterator;
+  typedef basic_iterator<const flat_map, const value_type> const_iterator;
+
+  flat_map()
+  : slots(),
+    used(),
+    entry_count(0),
+    hasher()
+  {
+  }
+
+  size_t size() const
+  {
+    return this->entry_count;
+  }
+
+  bool empty() const
+  {
+    return this->entry_count == 0;
+  }
+
+  iterator begin()
+  {
+    return iterator(this, 0);
+  }
+
+  iterator end()
+  {
+    return iterator(this, this->slots.size());
+  }
+
+  const_iterator begin() const
+  {
+    return const_iterator(this, 0);
+  }
+
+  const_iterator end() const
+  {
+    return const_iterator(this, this->slots.size());
+  }
+
+  iterator find(const key_type& k)
+  {
+    return iterator(this, this->find_slot(k));
+  }
+
+  const_iterator find(const key_type& k) const
+  {
+    return const_iterator(this, this->find_slot(k));
+  }
+
+  size_t count(const key_type& k) const
+  {
+    return this->find_slot(k) == this->slots.size() ? 0 : 1;
+  }
+
+  /// Throws std::out_of_range if there is no entry for k.
+  const mapped_type& at(const key_type& k) const
+  {
+    const size_t slot = this->find_slot(k);
+    if( slot == this->slots.size() )
+      throw std::out_of_range("flat_map::at");
+
+    return this->slots[slot].second;
+  }
+
+  /// Throws std::out_of_range if there is no entry for k.
+  mapped_type& at(const key_type& k)
+  {
+    const size_t slot = this->find_slot(k);
+    if( slot == this->slots.size() )
+      throw std::out_of_range("flat_map::at");
+
+    return this->slots[slot].second;
+  }
+
+  /// Returns the value of k, inserting a default constructed value first if
+  /// there is none.
+  mapped_type& operator[](const key_type& k)
+  {
+    bool inserted = false;
+    return this->slots[this->insert_slot(k, inserted)].second;
+  }
+
+  /// Insert v for k unless there is an entry for k already.
+  /// Returns the entry for k and whether it was inserted.
+  std::pair<iterator, bool> emplace(const key_type& k, const mapped_type& v)
+  {
+    bool inserted = false;
+    const size_t slot = this->insert_slot(k, inserted);
+    if( inserted )
+      this->slots[slot].second = v;
+
+    return std::make_pair(iterator(this, slot), inserted);
+  }
+
+  /// Make room for n entries without growing.
+  void reserve(size_t n)
+  {
+    size_t capacity = min_capacity;
+    while( capacity * max_load_numerator < n * max_load_denominator )
+      capacity *= 2;
+
+    if( capacity > this->slots.size() )
+      this->rehash(capacity);
+  }
+
+  void clear()
+  {
+    this->slots.clear();
+    this->used.clear();
+    this->entry_count = 0;
+  }
+
+private:
+  /// The slot holding k, after taking a free slot for k if there is none.
+  size_t insert_slot(const key_type& k, bool& inserted)
+  {
+    if( (this->entry_count + 1) * max_load_denominator
+          > this->slots.size() * max_load_numerator )
+      this->rehash(this->slots.empty() ? min_capacity : 2 * this->slots.size());
+
+    const size_t slot = this->probe(k);
+    inserted = !this->used[slot];
+    if( inserted )
+    {
+      this->slots[slot].first = k;
+      this->used[slot] = 1;
+      ++this->entry_count;
+    }
+
+    return slot;
+  }
+
+  /// The slot holding k or the free slot where k belongs. Requires at least
+  /// one free slot.
+  size_t probe(const key_type& k) const
+  {
+    const size_t mask = this->slots.size() - 1;
+    size_t slot = this->hasher(k) & mask;
+    while( this->used[slot] && !(this->slots[slot].first == k) )
+      slot = (slot + 1) & mask;
+
+    return slot;
+  }
+
+  /// The slot holding k, slots.size() if there is none.
+  size_t find_slot(const key_type& k) const
+  {
+    if( this->entry_count == 0 )
+      return this->slots.size();
+
+    const size_t slot = this->probe(k);
+    return this->used[slot] ? slot : this->slots.size();
+  }
+
+  /// Move all entries into capacity slots, a power of two.
+  void rehash(size_t capacity)
+  {
+    std::vector<value_type> old_slots(capacity);
+    std::vector<uint8_t> old_used(capacity, 0);
+    old_slots.swap(this->slots);
+    old_used.swap(this->used);
+
+    for(size_t i = 0; i < old_slots.size(); ++i)
+    {
+      if( !old_used[i] )
+        continue;
+
+      const size_t slot = this->probe(old_slots[i].first);
+      this->slots[slot] = std::move(old_slots[i]);
+      this->used[slot] = 1;
+    }
+  }
+
+  std::vector<value_type> slots;
+
+  // 1 if the slot at the same position holds an entry. Kept apart from the
+  // slots, which would otherwise grow by the padding of a flag.
+  std::vector<uint8_t> used;
+
+  size_t entry_count;
+  hash hasher;
+};
+
+
+} // end namespace hm
+
+#endif // HM_FLAT_MAP_H
@@ -0,0 +1,273 @@
+#ifndef HM_RADIX_COUNT_H
+#define HM_RADIX_COUNT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <future>
+#include <type_traits>
+#include <algorithm>
+
+#include "hm/common.h"
+
+namespace hm
+{
+
+/// Whether the entities of entity_type can be counted by sorting them, see
+/// hm::radix_counter: integral entities of 4 or 8 bytes.
+template<typename entity_type>
+using uses_radix_count =
+  std::integral_constant<
+    bool,
+    std::is_integral<entity_type>::value
+      && (sizeof(entity_type) == 4 || sizeof(entity_type) == 8)
+  >
+;
+
+
+/// The distinct entities of an input sequence and their number of
+/// occurrences, ordered by the bit pattern of the entities.
+template<
+  typename entity_type
+>
+struct sorted_histogram
+{
+  sorted_histogram()
+  : entities(),
+    counts()
+  {
+  }
+
+  std::vector<entity_type> entities;
+  std::vector<uint64_t> counts;
+};
+
+
+/// Sort unsigned keys with a least significant digit radix sort, 8 bits per
+/// pass.
+///
+/// The digit histograms of all passes are counted in a single read of the
+/// keys. Passes in which all keys have the same digit are skipped, e.g. the
+/// high bytes of small numbers.
+///
+/// Parameters:
+///   keys:
+///     The keys to sort in place.
+///   scratch:
+///     A buffer, resized to the number of keys.
+template<
+  typename key_type
+>
+void radix_sort(std::vector<key_type>& keys, std::vector<key_type>& scratch)
+{
+  static_assert(std::is_unsigned<key_type>::value, "radix_sort expects unsigned keys");
+
+  const size_t pass_count = sizeof(key_type);
+  std::vector<size_t> histograms(pass_count * 256, 0);
+  for(auto key : keys)
+  {
+    for(size_t pass = 0; pass < pass_count; ++pass)
+      histograms[pass * 256 + ((key >> (pass * 8U)) & 0xffU)]++;
+  }
+
+  scratch.resize(keys.size());
+  for(size_t pass = 0; pass < pass_count; ++pass)
+  {
+    size_t * histogram = histograms.data() + pass * 256;
+    const unsigned int shift = static_cast<unsigned int>(pass * 8U);
+
+    if( keys.empty() || histogram[(keys.front() >> shift) & 0xffU] == keys.size() )
+      continue;
+
+    // turn the counts into the offset of each digit's first key
+    size_t offset = 0;
+    for(size_t digit = 0; digit < 256; ++digit)
+    {
+      const size_t count = histogram[digit];
+      histogram[digit] = offset;
+      offset += count;
+    }
+
+    for(auto key : keys)
+      scratch[histogram[(key >> shift) & 0xffU]++] = key;
+
+    keys.swap(scratch);
+  }
+}
+
+
+/// Merge two sorted histograms, adding up the counts of entities in both.
+/// Not meant to be called directly, see hm::radix_counter.
+template<
+  typename entity_type
+>
+hm::sorted_histogram<entity_type> merge_histograms(
+  const hm::sorted_histogram<entity_type>& left,
+  const hm::sorted_histogram<entity_type>& right
+)
+{
+  typedef typename std::make_unsigned<entity_type>::type key_type;
+
+  hm::sorted_histogram<entity_type> merged;
+  merged.entities.reserve(left.entities.size() + right.entities.size());
+  merged.counts.reserve(left.entities.size() + right.entities.size());
+
+  size_t l = 0;
+  size_t r = 0;
+  while( l < left.entities.size() || r < right.entities.size() )
+  {
+    const bool take_left = r == right.entities.size()
+      || (l < left.entities.size()
+          && static_cast<key_type>(left.entities[l]) <= static_cast<key_type>(right.entities[r]));
+    const bool take_right = l == left.entities.size()
+      || (r < right.entities.size()
+          && static_cast<key_type>(right.entities[r]) <= static_cast<key_type>(left.entities[l]));
+
+    merged.entities.push_back(take_left ? left.entities[l] : right.entities[r]);
+    merged.counts.push_back(
+      (take_left ? left.counts[l++] : 0) + (take_right ? right.counts[r++] : 0)
+    );
+  }
+
+  return merged;
+}
+
+
+/// Counts integral entities of 4 or 8 bytes by sorting instead of hashing.
+///
+/// Each block of input is split into one chunk per thread. Every thread
+/// radix sorts the entities of its chunk and counts the runs of equal
+/// entities, then the sorted histograms are merged. All steps read and write
+/// memory sequentially: unlike a hash table with millions of distinct
+/// entities, where every entity is a cache miss, the time depends on the
+/// size of the input, not on the number of distinct entities.
+///
+/// Memory: 2 times the size of a block for sorting, plus the histogram.
+template<
+  typename entity_type
+>
+class radix_counter
+{
+public:
+  static_assert(
+    hm::uses_radix_count<entity_type>::value,
+    "radix_counter expects integral entities of 4 or 8 bytes"
+  );
+
+  typedef typename std::make_unsigned<entity_type>::type key_type;
+
+  /// Parameters:
+  ///   threads:
+  ///     The number of threads sorting a block, at least 1.
+  explicit radix_counter(size_t threads)
+  : thread_count(std::max<size_t>(threads, 1)),
+    total()
+  {
+  }
+
+  /// Count the entities of a block of input.
+  ///
+  /// Parameters:
+  ///   bytes, byte_count:
+  ///     The block, as written by hm::encode_type.
+  ///
+  /// Throws hm::invalid_layout if byte_count is not a multiple of
+  /// sizeof(entity_type), like hm::decode_type.
+  void add(const uint8_t * bytes, size_t byte_count)
+  {
+    if( byte_count % sizeof(entity_type) )
+      throw hm::invalid_layout("unexpected end");
+
+    const size_t entity_count = byte_count / sizeof(entity_type);
+    if( entity_count == 0 )
+      return;
+
+    // small chunks are not worth a thread
+    const size_t chunk_count = std::min(
+      this->thread_count,
+      std::max<size_t>(entity_count / (64 * 1024), 1)
+    );
+    const size_t chunk_size = (entity_count + chunk_count - 1) / chunk_count;
+
+    std::vector<hm::sorted_histogram<entity_type>> chunks(chunk_count);
+    std::vector<std::future<void>> sorters;
+    for(size_t i = 0; i < chunk_count; ++i)
+    {
+      const size_t begin = std::min(i * chunk_size, entity_count);
+      const size_t end = std::min(begin + chunk_size, entity_count);
+      const uint8_t * chunk = bytes + begin * sizeof(entity_type);
+
+      // the last chunk is sorted by the calling thread
+      auto sort = [&chunks, i, chunk, begin, end]() {
+        chunks[i] = hm::radix_counter<entity_type>::count_chunk(chunk, end - begin);
+      };
+      if( i + 1 < chunk_count )
+        sorters.push_back(std::async(std::launch::async, sort));
+      else
+        sort();
+    }
+
+    // rethrows exceptions of the sorters, e.g. std::bad_alloc
+    for(auto& sorter : sorters)
+      sorter.get();
+
+    // merge neighbours pairwise, each round halves the number of histograms
+    chunks.push_back(std::move(this->total));
+    while( chunks.size() > 1 )
+    {
+      std::vector<hm::sorted_histogram<entity_type>> merged;
+      merged.reserve((chunks.size() + 1) / 2);
+      for(size_t i = 0; i + 1 < chunks.size(); i += 2)
+        merged.push_back(hm::merge_histograms(chunks[i], chunks[i + 1]));
+      if( chunks.size() % 2 )
+        merged.push_back(std::move(chunks.back()));
+      chunks.swap(merged);
+    }
+
+    this->total = std::move(chunks.front());
+  }
+
+  /// The histogram of all blocks added so far.
+  const hm::sorted_histogram<entity_type>& histogram() const
+  {
+    return this->total;
+  }
+
+private:
+  /// Sort the entity_count entities at bytes and count their runs.
+  static hm::sorted_histogram<entity_type> count_chunk(
+    const uint8_t * bytes,
+    size_t entity_count
+  )
+  {
+    std::vector<key_type> keys(entity_count);
+    std::memcpy(keys.data(), bytes, entity_count * sizeof(key_type));
+
+    std::vector<key_type> scratch;
+    hm::radix_sort(keys, scratch);
+    std::vector<key_type>().swap(scratch);
+
+    hm::sorted_histogram<entity_type> chunk;
+    for(size_t i = 0; i < keys.size(); )
+    {
+      size_t run = i + 1;
+      while( run < keys.size() && keys[run] == keys[i] )
+        ++run;
+
+      chunk.entities.push_back(static_cast<entity_type>(keys[i]));
+      chunk.counts.push_back(run - i);
+      i = run;
+    }
+
+    return chunk;
+  }
+
+  size_t thread_count;
+  hm::sorted_histogram<entity_type> total;
+};
+
+
+} // end namespace hm
+
+#endif // HM_RADIX_COUNT_H
@@ -0,0 +1,210 @@
+#ifndef HM_RLE_H
+#define HM_RLE_H
+
+#include <cstdint>
+#include <limits>
+#include <cstddef>
+
+#include "hm/common.h"
+#include "hm/exception.h"
+
+
+namespace hm
+{
+
+/// The largest run length a count token of entity_type can hold.
+template<typename entity_type>
+constexpr uint64_t rle_max_count()
+{
+  return sizeof(entity_type) >= sizeof(uint64_t)
+    ? std::numeric_limits<uint64_t>::max()
+    : (uint64_t(1) << (sizeof(entity_type) * 8U % 64U)) - 1U;
+}
+
+
+/// Write a run length as a count token with the width of entity_type
+/// (little endian).
+/// Not meant to be called directly, see rle_encode.
+template<
+  typename entity_type,
+  typename out_iter
+>
+void rle_encode_count(uint64_t count, out_iter out)
+{
+  for(size_t i = 0; i < sizeof(entity_type); ++i)
+  {
+    *out++ = static_cast<uint8_t>(i < sizeof(uint64_t) ? count >> (i * 8U) : 0U);
+  }
+}
+
+
+/// Read a count token with the width of entity_type.
+/// Not meant to be called directly, see rle_decode.
+///
+/// Throws hm::invalid_layout if in_end is reached before the token is read
+/// fully.
+template<
+  typename entity_type,
+  typename in_iter
+>
+uint64_t rle_decode_count(in_iter& in_begin, in_iter in_end)
+{
+  uint64_t count = 0;
+  for(size_t i = 0; i < sizeof(entity_type); ++i)
+  {
+    if( in_begin == in_end )
+      throw hm::invalid_layout("missing run length");
+
+    const uint8_t byte = static_cast<uint8_t>(*in_begin++);
+    if( i < sizeof(uint64_t) )
+      count |= static_cast<uint64_t>(byte) << (i * 8U);
+  }
+
+  return count;
+}
+
+
+/// Run-length encode a sequence of entities.
+///
+/// Two consecutive equal entities start a run. They are followed by a count
+/// token holding the number of further repetitions of the same entity. Count
+/// tokens have the same width as entities, therefore the resulting sequence
+/// can be encoded with the usual huffman machinery.
+///
+/// Example (entity_type uint8_t):
+///   A B B B B C C  ->  A B B 2 C C 0
+///
+/// Runs longer than a count token can express are split.
+///
+/// Parameters:
+///   entity_type:
+///     The byte-wise input will be interpreted as this type. Must be integral
+///     or a hm::byte_entity.
+///   in_begin, in_end:
+///     A range of input iterators pointing to bytes. The amount of bytes
+///     must be a multiple of sizeof(entity_type).
+///   out:
+///     An output iterator expecting bytes.
+template<
+  typename entity_type,
+  typename in_iter,
+  typename out_iter
+>
+void rle_encode(in_iter in_begin, in_iter in_end, out_iter out)
+{
+  const uint64_t max_count = hm::rle_max_count<entity_type>();
+
+  entity_type entity = entity_type();
+  entity_type previous = entity_type();
+  bool has_previous = false;
+
+  // set if we have read an entity that terminated the last run
+  bool has_pending = false;
+
+  while( has_pending || in_begin != in_end )
+  {
+    if( !has_pending )
+      // passing in_begin by reference
+      entity = hm::decode_type<entity_type>(in_begin, in_end);
+    has_pending = false;
+
+    hm::encode_type(entity, out);
+
+    if( has_previous && entity == previous )
+    {
+      uint64_t count = 0;
+      while( in_begin != in_end )
+      {
+        const entity_type next = hm::decode_type<entity_type>(in_begin, in_end);
+        if( next != entity || count == max_count )
+        {
+          entity = next;
+          has_pending = true;
+          break;
+        }
+
+        ++count;
+      }
+
+      hm::rle_encode_count<entity_type>(count, out);
+
+      // the count token must never start a new run
+      has_previous = false;
+    }
+    else
+    {
+      previous = entity;
+      has_previous = true;
+    }
+  }
+}
+
+
+/// Reverse rle_encode.
+///
+/// Parameters:
+///   entity_type:
+///     The type that was used when encoding.
+///   in_begin, in_end:
+///     A range of input iterators pointing to bytes containing run-length
+///     tokens.
+///   out:
+///     An output iterator expecting bytes.
+///   max_byte_count:
+///     The most bytes to write, e.g. the original size of the input (see
+///     hm::get_original_byte_count). Count tokens are read from the input,
+///     a corrupt one may claim a run of up to 2^64 entities.
+///
+/// Throws hm::invalid_layout if a run is missing its count token, or if the
+/// output would exceed max_byte_count.
+template<
+  typename entity_type,
+  typename in_iter,
+  typename out_iter
+>
+void rle_decode(
+  in_iter in_begin,
+  in_iter in_end,
+  out_iter out,
+  uint64_t max_byte_count = std::numeric_limits<uint64_t>::max()
+)
+{
+  entity_type previous = entity_type();
+  bool has_previous = false;
+
+  // the number of entities that may still be written
+  uint64_t remaining = max_byte_count / sizeof(entity_type);
+
+  while( in_begin != in_end )
+  {
+    // passing in_begin by reference
+    const entity_type entity = hm::decode_type<entity_type>(in_begin, in_end);
+    if( remaining == 0 )
+      throw hm::invalid_layout("output exceeds the original size");
+    --remaining;
+    hm::encode_type(entity, out);
+
+    if( has_previous && entity == previous )
+    {
+      uint64_t count = hm::rle_decode_count<entity_type>(in_begin, in_end);
+      if( count > remaining )
+        throw hm::invalid_layout("output exceeds the original size");
+      remaining -= count;
+
+      for(; count > 0; --count)
+        hm::encode_type(entity, out);
+
+      has_previous = false;
+    }
+    else
+    {
+      previous = entity;
+      has_previous = true;
+    }
+  }
+}
+
+
+} // end namespace hm
+
+#endif // HM_RLE_H
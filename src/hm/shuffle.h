@@ -0,0 +1,435 @@
+#ifndef HM_SHUFFLE_H
+#define HM_SHUFFLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <iterator>
+#include <limits>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "hm/common.h"
+#include "hm/exception.h"
+#include "hm/encode.h"
+#include "hm/decode.h"
+#include "hm/rle.h"
+
+
+namespace hm
+{
+
+#ifdef __SSE2__
+
+/// Transpose blocks of 16 entities of 4 bytes with SSE2.
+/// Not meant to be called directly, see shuffle.
+///
+/// Returns the number of entities processed.
+inline size_t shuffle4_sse2(const uint8_t * in, size_t count, uint8_t * out)
+{
+  const size_t blocks = count - count % 16;
+
+  for(size_t i = 0; i < blocks; i += 16)
+  {
+    __m128i v[4];
+    for(size_t k = 0; k < 4; ++k)
+      v[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 4 + k * 16));
+
+    // Every round interleaves the bytes of two registers. After four rounds
+    // each register holds a single byte of 16 consecutive entities.
+    const __m128i t0 = _mm_unpacklo_epi8(v[0], v[1]);
+    const __m128i t1 = _mm_unpackhi_epi8(v[0], v[1]);
+    const __m128i t2 = _mm_unpacklo_epi8(v[2], v[3]);
+    const __m128i t3 = _mm_unpackhi_epi8(v[2], v[3]);
+
+    const __m128i u0 = _mm_unpacklo_epi8(t0, t1);
+    const __m128i u1 = _mm_unpackhi_epi8(t0, t1);
+    const __m128i u2 = _mm_unpacklo_epi8(t2, t3);
+    const __m128i u3 = _mm_unpackhi_epi8(t2, t3);
+
+    const __m128i w0 = _mm_unpacklo_epi8(u0, u1);
+    const __m128i w1 = _mm_unpackhi_epi8(u0, u1);
+    const __m128i w2 = _mm_unpacklo_epi8(u2, u3);
+    const __m128i w3 = _mm_unpackhi_epi8(u2, u3);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 0 * count + i), _mm_unpacklo_epi64(w0, w2));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 1 * count + i), _mm_unpackhi_epi64(w0, w2));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * count + i), _mm_unpacklo_epi64(w1, w3));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 3 * count + i), _mm_unpackhi_epi64(w1, w3));
+  }
+
+  return blocks;
+}
+
+
+/// Transpose blocks of 16 entities of 8 bytes with SSE2.
+/// Not meant to be called directly, see shuffle.
+///
+/// Returns the number of entities processed.
+inline size_t shuffle8_sse2(const uint8_t * in, size_t count, uint8_t * out)
+{
+  const size_t blocks = count - count % 16;
+
+  for(size_t i = 0; i < blocks; i += 16)
+  {
+    __m128i v[8];
+    for(size_t k = 0; k < 8; ++k)
+      v[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 8 + k * 16));
+
+    // p[x]: interleaved bytes of entity x and x + 8
+    __m128i p[8];
+    for(size_t k = 0; k < 4; ++k)
+    {
+      p[2 * k]     = _mm_unpacklo_epi8(v[k], v[k + 4]);
+      p[2 * k + 1] = _mm_unpackhi_epi8(v[k], v[k + 4]);
+    }
+
+    // q[2x]: bytes 0-3 of entities x, x + 4, x + 8, x + 12
+    // q[2x + 1]: bytes 4-7 of the same entities
+    __m128i q[8];
+    for(size_t k = 0; k < 4; ++k)
+    {
+      q[2 * k]     = _mm_unpacklo_epi8(p[k], p[k + 4]);
+      q[2 * k + 1] = _mm_unpackhi_epi8(p[k], p[k + 4]);
+    }
+
+    // r[4b + x]: bytes 2b and 2b + 1 of the 8 entities with parity x
+    __m128i r[8];
+    for(size_t x = 0; x < 2; ++x)
+    {
+      r[0 + x] = _mm_unpacklo_epi8(q[2 * x],     q[2 * x + 4]);
+      r[2 + x] = _mm_unpackhi_epi8(q[2 * x],     q[2 * x + 4]);
+      r[4 + x] = _mm_unpacklo_epi8(q[2 * x + 1], q[2 * x + 5]);
+      r[6 + x] = _mm_unpackhi_epi8(q[2 * x + 1], q[2 * x + 5]);
+    }
+
+    for(size_t b = 0; b < 4; ++b)
+    {
+      _mm_storeu_si128(
+        reinterpret_cast<__m128i *>(out + (2 * b) * count + i),
+        _mm_unpacklo_epi8(r[2 * b], r[2 * b + 1])
+      );
+      _mm_storeu_si128(
+        reinterpret_cast<__m128i *>(out + (2 * b + 1) * count + i),
+        _mm_unpackhi_epi8(r[2 * b], r[2 * b + 1])
+      );
+    }
+  }
+
+  return blocks;
+}
+
+
+/// Reverse shuffle4_sse2.
+/// Not meant to be called directly, see unshuffle.
+///
+/// Returns the number of entities processed.
+inline size_t unshuffle4_sse2(const uint8_t * in, size_t count, uint8_t * out)
+{
+  const size_t blocks = count - count % 16;
+
+  for(size_t i = 0; i < blocks; i += 16)
+  {
+    __m128i l[4];
+    for(size_t k = 0; k < 4; ++k)
+      l[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + k * count + i));
+
+    // byte pairs 0-1 and 2-3 of entities 0-7 and 8-15
+    const __m128i a0 = _mm_unpacklo_epi8(l[0], l[1]);
+    const __m128i a1 = _mm_unpacklo_epi8(l[2], l[3]);
+    const __m128i b0 = _mm_unpackhi_epi8(l[0], l[1]);
+    const __m128i b1 = _mm_unpackhi_epi8(l[2], l[3]);
+
+    __m128i * dest = reinterpret_cast<__m128i *>(out + i * 4);
+    _mm_storeu_si128(dest + 0, _mm_unpacklo_epi16(a0, a1));
+    _mm_storeu_si128(dest + 1, _mm_unpackhi_epi16(a0, a1));
+    _mm_storeu_si128(dest + 2, _mm_unpacklo_epi16(b0, b1));
+    _mm_storeu_si128(dest + 3, _mm_unpackhi_epi16(b0, b1));
+  }
+
+  return blocks;
+}
+
+
+/// Reverse shuffle8_sse2.
+/// Not meant to be called directly, see unshuffle.
+///
+/// Returns the number of entities processed.
+inline size_t unshuffle8_sse2(const uint8_t * in, size_t count, uint8_t * out)
+{
+  const size_t blocks = count - count % 16;
+
+  for(size_t i = 0; i < blocks; i += 16)
+  {
+    __m128i l[8];
+    for(size_t k = 0; k < 8; ++k)
+      l[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + k * count + i));
+
+    __m128i * dest = reinterpret_cast<__m128i *>(out + i * 8);
+
+    // first entities 0-7, then entities 8-15
+    for(size_t half = 0; half < 2; ++half)
+    {
+      // a[k]: byte pairs 2k and 2k + 1
+      __m128i a[4];
+      for(size_t k = 0; k < 4; ++k)
+      {
+        a[k] = half
+          ? _mm_unpackhi_epi8(l[2 * k], l[2 * k + 1])
+          : _mm_unpacklo_epi8(l[2 * k], l[2 * k + 1]);
+      }
+
+      // c: bytes 0-3, d: bytes 4-7
+      const __m128i c0 = _mm_unpacklo_epi16(a[0], a[1]);
+      const __m128i c1 = _mm_unpackhi_epi16(a[0], a[1]);
+      const __m128i d0 = _mm_unpacklo_epi16(a[2], a[3]);
+      const __m128i d1 = _mm_unpackhi_epi16(a[2], a[3]);
+
+      _mm_storeu_si128(dest + half * 4 + 0, _mm_unpacklo_epi32(c0, d0));
+      _mm_storeu_si128(dest + half * 4 + 1, _mm_unpackhi_epi32(c0, d0));
+      _mm_storeu_si128(dest + half * 4 + 2, _mm_unpacklo_epi32(c1, d1));
+      _mm_storeu_si128(dest + half * 4 + 3, _mm_unpackhi_epi32(c1, d1));
+    }
+  }
+
+  return blocks;
+}
+
+#endif // __SSE2__
+
+
+/// Transpose entities into byte lanes.
+///
+/// Lane k holds byte k of every entity. Multi-byte numeric entities usually
+/// differ mostly in their low bytes, so each lane on its own has a small and
+/// skewed alphabet.
+///
+/// Example (entity_size 2):
+///   A1 B2 C3  ->  A B C 1 2 3
+///
+/// Parameters:
+///   in:
+///     count * entity_size bytes.
+///   count:
+///     The number of entities.
+///   entity_size:
+///     The size of an entity in bytes.
+///   out:
+///     Receives count * entity_size bytes. Must not overlap with in.
+inline void shuffle(
+  const uint8_t * in,
+  size_t count,
+  size_t entity_size,
+  uint8_t * out
+)
+{
+  size_t done = 0;
+
+#ifdef __SSE2__
+  if( entity_size == 4 )
+    done = hm::shuffle4_sse2(in, count, out);
+  else if( entity_size == 8 )
+    done = hm::shuffle8_sse2(in, count, out);
+#endif
+
+  for(size_t i = done; i < count; ++i)
+    for(size_t k = 0; k < entity_size; ++k)
+      out[k * count + i] = in[i * entity_size + k];
+}
+
+
+/// Reverse shuffle.
+///
+/// Parameters: see shuffle.
+inline void unshuffle(
+  const uint8_t * in,
+  size_t count,
+  size_t entity_size,
+  uint8_t * out
+)
+{
+  size_t done = 0;
+
+#ifdef __SSE2__
+  if( entity_size == 4 )
+    done = hm::unshuffle4_sse2(in, count, out);
+  else if( entity_size == 8 )
+    done = hm::unshuffle8_sse2(in, count, out);
+#endif
+
+  for(size_t i = done; i < count; ++i)
+    for(size_t k = 0; k < entity_size; ++k)
+      out[i * entity_size + k] = in[k * count + i];
+}
+
+
+/// Encode entities as byte lanes.
+///
+/// The input is shuffled into entity_size lanes. Each lane is huffman coded
+/// with 1 byte entities and written as a complete binary layout (meta data,
+/// entities, tree, data). This keeps the alphabet of each lane at no more
+/// than 256 entities, regardless of entity_size. Lanes that huffman coding
+/// would expand are stored as is (see hm::flag_stored).
+///
+/// Parameters:
+///   in, size:
+///     The input. size must be a multiple of entity_size.
+///   entity_size:
+///     The size of an entity in bytes.
+///   rle:
+///     Whether to run-length encode each lane before huffman coding.
+///   out:
+///     An output iterator expecting bytes.
+///
+/// Throws hm::invalid_layout if size is not a multiple of entity_size.
+/// Returns a description of the lanes. The data section consists of the
+/// lanes.
+template<
+  typename out_iter
+>
+hm::meta encode_lanes(
+  const uint8_t * in,
+  size_t size,
+  hm::meta::entity_size_type entity_size,
+  bool rle,
+  out_iter out
+)
+{
+  assert(entity_size > 0);
+  if( size % entity_size != 0 )
+    throw hm::invalid_layout("unexpected end");
+
+  hm::meta md;
+  md.version = hm::current_version;
+  md.entity_size = entity_size;
+  md.flags = hm::flag_shuffle;
+
+  const size_t count = size / entity_size;
+  std::vector<uint8_t> lanes(size);
+  hm::shuffle(in, count, entity_size, lanes.data());
+
+  std::vector<uint8_t> tokens;
+  std::vector<uint8_t> encoded;
+  for(size_t lane = 0; lane < entity_size; ++lane)
+  {
+    const uint8_t * const lane_data = lanes.data() + lane * count;
+    const uint8_t * lane_begin = lane_data;
+    const uint8_t * lane_end = lane_begin + count;
+
+    if( rle )
+    {
+      tokens.clear();
+      hm::rle_encode<uint8_t>(lane_begin, lane_end, std::back_inserter(tokens));
+      lane_begin = tokens.data();
+      lane_end = tokens.data() + tokens.size();
+    }
+
+    // the lane's meta data precedes its data, therefore we need to buffer
+    encoded.clear();
+    auto tree = hm::build_huffman_tree<uint8_t>(lane_begin, lane_end);
+    hm::meta md_lane = hm::encode(
+      lane_begin,
+      lane_end,
+      tree.get(),
+      std::back_inserter(encoded)
+    );
+    md_lane.flags = rle ? hm::flag_rle : 0;
+
+    // e.g. the low order bytes of floating point numbers are close to random
+    if( hm::is_stored_smaller(md_lane, count) )
+    {
+      md_lane = hm::make_stored_meta(count, 1);
+      encoded.assign(lane_data, lane_data + count);
+    }
+
+    hm::encode_meta_data(md_lane, out);
+    std::copy(encoded.begin(), encoded.end(), out);
+
+    md.data_byte_count += hm::layout_byte_count(md_lane);
+  }
+
+  return md;
+}
+
+
+/// Decode entities that were encoded as byte lanes.
+///
+/// Parameters:
+///   md:
+///     The description of the lanes, as returned by encode_lanes.
+///   in_begin, in_end:
+///     A range of input iterators pointing to bytes containing the lanes.
+///   out:
+///     An output iterator accepting decoded bytes.
+///
+/// Throws hm::invalid_layout on unexpected or missing input.
+template<
+  typename in_iter,
+  typename out_iter
+>
+void decode_lanes(const hm::meta& md, in_iter in_begin, in_iter in_end, out_iter out)
+{
+  assert(md.flags & hm::flag_shuffle);
+
+  std::vector<uint8_t> lanes;
+  std::vector<uint8_t> tokens;
+  size_t count = 0;
+
+  // every lane holds one byte of each entity
+  uint64_t original_byte_count = std::numeric_limits<uint64_t>::max();
+  hm::get_original_byte_count(md, original_byte_count);
+  const uint64_t max_lane_byte_count = original_byte_count / md.entity_size;
+
+  for(size_t lane = 0; lane < md.entity_size; ++lane)
+  {
+    const hm::meta md_lane = hm::decode_meta_data(in_begin, in_end);
+    if( md_lane.entity_size != 1
+        || (md_lane.flags & ~(hm::flag_rle | hm::flag_stored)) )
+      throw hm::invalid_layout("invalid lane");
+
+    if( hm::is_forward_iterator<in_iter>::value )
+      std::advance(in_begin, hm::meta_byte_count(md_lane));
+
+    tokens.clear();
+    hm::decode<hm::byte_entity<1>>(md_lane, in_begin, in_end, std::back_inserter(tokens));
+
+    if( hm::is_forward_iterator<in_iter>::value )
+    {
+      std::advance(
+        in_begin,
+        hm::layout_byte_count(md_lane) - hm::meta_byte_count(md_lane)
+      );
+    }
+
+    const size_t lane_begin = lanes.size();
+    if( md_lane.flags & hm::flag_rle )
+    {
+      hm::rle_decode<uint8_t>(
+        tokens.begin(),
+        tokens.end(),
+        std::back_inserter(lanes),
+        max_lane_byte_count
+      );
+    }
+    else
+      lanes.insert(lanes.end(), tokens.begin(), tokens.end());
+
+    const size_t lane_size = lanes.size() - lane_begin;
+    if( lane == 0 )
+      count = lane_size;
+    else if( lane_size != count )
+      throw hm::invalid_layout("lanes differ in size");
+  }
+
+  std::vector<uint8_t> entities(lanes.size());
+  hm::unshuffle(lanes.data(), count, md.entity_size, entities.data());
+  std::copy(entities.begin(), entities.end(), out);
+}
+
+
+} // end namespace hm
+
+#endif // HM_SHUFFLE_H
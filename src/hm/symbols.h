@@ -0,0 +1,242 @@
+#ifndef HM_SYMBOLS_H
+#define HM_SYMBOLS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+
+#include "hm/common.h"
+#include "hm/encode.h"
+
+
+namespace hm
+{
+
+/// The dense number of a distinct entity, see hm::symbol_index.
+/// hm::meta::entity_count_type limits the number of distinct entities to
+/// the same range.
+typedef uint32_t symbol_type;
+
+
+/// Whether the encoder numbers the entities of entity_type densely (see
+/// hm::symbol_index) instead of keying every stage on the entity: wide
+/// entities, whose tables are hash maps.
+template<typename entity_type>
+using uses_symbol_index =
+  std::integral_constant<bool, (sizeof(entity_type) > 2)>;
+
+
+/// Numbers the distinct entities of an input sequence densely, 0, 1, 2, ...
+/// in the order of their first occurrence, and counts them.
+///
+/// Only counting looks entities up in a hash map. Everything else about an
+/// entity is kept in arrays indexed by its symbol: its value, its frequency,
+/// and later its code length and code (see hm::symbol_codes).
+template<
+  typename entity_type
+>
+class symbol_index
+{
+public:
+  symbol_index()
+  : by_entity(),
+    entity_values(),
+    entity_counts()
+  {
+  }
+
+  /// Count count occurrences of entity.
+  /// Returns its symbol, which is new if entity was not seen before.
+  hm::symbol_type add(const entity_type& entity, uint64_t count = 1)
+  {
+    const auto entry = this->by_entity.emplace(
+      entity,
+      static_cast<hm::symbol_type>(this->entity_values.size())
+    );
+    const hm::symbol_type symbol = entry.first->second;
+
+    if( entry.second )
+    {
+      this->entity_values.push_back(entity);
+      this->entity_counts.push_back(count);
+    }
+    else
+    {
+      this->entity_counts[symbol] += count;
+    }
+
+    return symbol;
+  }
+
+  /// Make room for n distinct entities, e.g. before adding the entities of a
+  /// histogram.
+  void reserve(size_t n)
+  {
+    this->by_entity.reserve(n);
+    this->entity_values.reserve(n);
+    this->entity_counts.reserve(n);
+  }
+
+  /// Returns the symbol of entity.
+  /// Throws std::out_of_range if entity was not counted.
+  hm::symbol_type at(const entity_type& entity) const
+  {
+    return this->by_entity.at(entity);
+  }
+
+  /// The number of distinct entities.
+  size_t size() const
+  {
+    return this->entity_values.size();
+  }
+
+  /// The entity of each symbol.
+  const std::vector<entity_type>& entities() const
+  {
+    return this->entity_values;
+  }
+
+  /// The number of occurrences of each symbol.
+  const std::vector<uint64_t>& counts() const
+  {
+    return this->entity_counts;
+  }
+
+  /// The value of each symbol's entity (see hm::entity_to_number), e.g. for
+  /// hm::canonical_order. Entities must not be larger than
+  /// hm::max_compact_entity_size.
+  std::vector<uint64_t> numbers() const
+  {
+    std::vector<uint64_t> values;
+    values.reserve(this->entity_values.size());
+    for(const auto& entity : this->entity_values)
+      values.push_back(hm::entity_to_number(entity));
+
+    return values;
+  }
+
+private:
+  hm::entity_map<entity_type, hm::symbol_type> by_entity;
+  std::vector<entity_type> entity_values;
+  std::vector<uint64_t> entity_counts;
+};
+
+
+/// Count the entities of the input sequence in a hm::symbol_index.
+///
+/// Parameters:
+///   in_begin, in_end:
+///     A range of input iterators pointing to bytes.
+///   symbols:
+///     Receives the distinct entities and their frequencies.
+///   symbol_stream:
+///     If not null, receives the symbol of each entity of the input as a
+///     hm::symbol_type (see hm::encode_type). Coding the stream with
+///     hm::symbol_codes is the same as coding the input with the codes of
+///     the entities, and does not need the hash map.
+template<
+  typename entity_type,
+  typename in_iter
+>
+void count_symbols(
+  in_iter in_begin,
+  in_iter in_end,
+  hm::symbol_index<entity_type>& symbols,
+  std::vector<uint8_t> * symbol_stream = nullptr
+)
+{
+  while( in_begin != in_end )
+  {
+    // passing in_begin by reference
+    const auto symbol = symbols.add(hm::decode_type<entity_type>(in_begin, in_end));
+
+    if( symbol_stream )
+      hm::encode_type(symbol, std::back_inserter(*symbol_stream));
+  }
+}
+
+
+/// The huffman code of each symbol of a hm::symbol_index in an array.
+///
+/// A code table keyed by symbol, see hm::is_code_table: encode_data codes a
+/// symbol stream (see count_symbols) with an array lookup per entity.
+class symbol_codes
+{
+public:
+  typedef hm::symbol_type key_type;
+  typedef hm::code_type mapped_type;
+
+  symbol_codes()
+  : codes()
+  {
+  }
+
+  /// Parameters:
+  ///   symbol_code_list:
+  ///     The code of each symbol, e.g. from hm::canonical_codes.
+  explicit symbol_codes(std::vector<hm::code_type> symbol_code_list)
+  : codes(std::move(symbol_code_list))
+  {
+  }
+
+  size_t size() const
+  {
+    return this->codes.size();
+  }
+
+  /// Throws std::out_of_range if there is no such symbol.
+  const hm::code_type& at(hm::symbol_type symbol) const
+  {
+    return this->codes.at(symbol);
+  }
+
+private:
+  std::vector<hm::code_type> codes;
+};
+
+
+/// The huffman code of each entity of a hm::symbol_index, a code table keyed
+/// by entity (see hm::is_code_table) to code an input sequence that was not
+/// kept as a symbol stream.
+template<
+  typename entity_type
+>
+class entity_codes
+{
+public:
+  typedef entity_type key_type;
+  typedef hm::code_type mapped_type;
+
+  /// Both index and table must outlive the entity_codes.
+  entity_codes(
+    const hm::symbol_index<entity_type>& index,
+    const hm::symbol_codes& table
+  )
+  : symbols(index),
+    codes(table)
+  {
+  }
+
+  size_t size() const
+  {
+    return this->codes.size();
+  }
+
+  /// Throws std::out_of_range if entity was not counted.
+  const hm::code_type& at(const entity_type& entity) const
+  {
+    return this->codes.at(this->symbols.at(entity));
+  }
+
+private:
+  const hm::symbol_index<entity_type>& symbols;
+  const hm::symbol_codes& codes;
+};
+
+
+} // end namespace hm
+
+#endif // HM_SYMBOLS_H
@@ -0,0 +1,101 @@
+#ifndef HM_VARINT_H
+#define HM_VARINT_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "hm/exception.h"
+
+
+namespace hm
+{
+
+/// The maximum number of bytes of a varint encoded uint64_t.
+const size_t max_varint_byte_count = 10;
+
+
+/// The number of bytes encode_varint writes for value.
+inline size_t varint_byte_count(uint64_t value)
+{
+  size_t count = 1;
+  while( value >= 0x80U )
+  {
+    value >>= 7U;
+    ++count;
+  }
+
+  return count;
+}
+
+
+/// Encode value as a varint: seven bits per byte, least significant group
+/// first. The most significant bit of a byte is set if another byte follows.
+///
+/// Parameters:
+///   value:
+///     The value to encode. Small values take fewer bytes.
+///   out:
+///     An output iterator expecting bytes.
+///
+/// Returns the number of bytes written.
+template<
+  typename out_iter
+>
+size_t encode_varint(uint64_t value, out_iter out)
+{
+  size_t count = 1;
+  while( value >= 0x80U )
+  {
+    *out++ = static_cast<uint8_t>((value & 0x7fU) | 0x80U);
+    value >>= 7U;
+    ++count;
+  }
+  *out++ = static_cast<uint8_t>(value);
+
+  return count;
+}
+
+
+/// Decode a varint written by encode_varint.
+///
+/// in_begin is passed as a reference, see hm::decode_type.
+///
+/// Parameters:
+///   in_begin, in_end:
+///     A range of input iterators pointing to bytes.
+///   byte_count:
+///     Incremented by the number of bytes read.
+///
+/// Throws hm::invalid_layout if in_end is reached before the varint ends or
+/// if the varint does not fit into uint64_t.
+template<
+  typename in_iter
+>
+uint64_t decode_varint(in_iter& in_begin, in_iter in_end, uint64_t& byte_count)
+{
+  uint64_t value = 0;
+
+  for(size_t i = 0; i < hm::max_varint_byte_count; ++i)
+  {
+    if( in_begin == in_end )
+      throw hm::invalid_layout("unexpected end");
+
+    const uint8_t byte = static_cast<uint8_t>(*in_begin++);
+    ++byte_count;
+
+    // the tenth byte holds the most significant bit only
+    if( i == hm::max_varint_byte_count - 1 && byte > 1U )
+      break;
+
+    value |= static_cast<uint64_t>(byte & 0x7fU) << (7U * i);
+    if( !(byte & 0x80U) )
+      return value;
+  }
+
+  throw hm::invalid_layout("invalid varint");
+}
+
+
+} // end namespace hm
+
+#endif // HM_VARINT_H
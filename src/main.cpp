@@ -1,93 +1,878 @@
 #include <cstdint>
 #include <cstdlib>
+#include <algorithm>
 #include <iterator>
 #include <ios>
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <limits>
+#include <cstdio>
 
 #include "hm/common.h"
 #include "hm/encode.h"
 #include "hm/decode.h"
+#include "hm/dispatch.h"
+#include "hm/estimate.h"
+#include "hm/archive.h"
 
 // support
 #include "sp/program-options.h"
 #include "sp/file-exists.h"
+#include "sp/crc32c-streambuf.h"
+#include "sp/run-stats.h"
+#include "sp/pipeline-streambuf.h"
+#include "sp/uring-streambuf.h"
+#include "sp/batch.h"
+#include "sp/list-files.h"
+#include "sp/slice-streambuf.h"
+#include "sp/mapped-file.h"
+#include "sp/archive-file.h"
+#include "sp/stream-io.h"
+#include "sp/stream-encoder.h"
+#include "sp/stream-decoder.h"
 
-int main(int argc, const char * argv[])
+
+namespace {
+
+/// Build the meta data that selects the pre-transforms from the program
+/// options.
+hm::meta encode_meta_from_options(const sp::program_options& po)
 {
-  std::ios_base::sync_with_stdio(false);
+  hm::meta md;
+  md.version = hm::current_version;
+  if( po.contains("rle") )
+    md.flags = static_cast<hm::meta::flags_type>(md.flags | hm::flag_rle);
+  if( po.contains("shuffle") )
+    md.flags = static_cast<hm::meta::flags_type>(md.flags | hm::flag_shuffle);
+  if( po.get_filter() != hm::filter_none )
+  {
+    md.flags = static_cast<hm::meta::flags_type>(md.flags | hm::flag_filter);
+    md.filter = po.get_filter();
+  }
+  if( po.contains("checksum") )
+    md.flags = static_cast<hm::meta::flags_type>(md.flags | hm::flag_checksum);
+  if( po.contains("index") )
+  {
+    md.flags = static_cast<hm::meta::flags_type>(md.flags | hm::flag_index);
+    md.index_interval = po.get<uint32_t>("index");
+  }
 
-  try
+  // cleared for entity sizes and transforms that do not support it
+  md.flags = static_cast<hm::meta::flags_type>(md.flags | hm::flag_compact_entities);
+
+  // lets the decoder allocate its output up front
+  md.flags = static_cast<hm::meta::flags_type>(md.flags | hm::flag_original_size);
+
+  return md;
+}
+
+
+/// Return the entity size given on the command line, or select one by trial
+/// encoding a sample of the input if it is sp::pov_entity_size::automatic.
+/// Leaves input positioned at the beginning.
+unsigned int resolve_entity_size(
+  std::istream& input,
+  unsigned int entity_size,
+  const hm::meta& md
+)
+{
+  if( entity_size != sp::pov_entity_size::automatic )
+    return entity_size;
+
+  const uint64_t input_size = sp::stream_size(input);
+  const auto sample = sp::read_sample(input, input_size);
+
+  return hm::select_entity_size(sample.data(), sample.size(), input_size, md);
+}
+
+
+/// Print a code report in human readable form.
+///
+/// Parameters:
+///   input_size:
+///     The size of the input in bytes.
+void print_report(
+  const hm::code_report& report,
+  uint64_t input_size,
+  std::ostream& out
+)
+{
+  const uint64_t output_size = hm::layout_byte_count(report.md);
+
+  out << "entity size:         " << static_cast<unsigned int>(report.md.entity_size) << " bytes\n"
+      << "input size:          " << input_size << " bytes\n"
+      << "predicted size:      " << output_size << " bytes";
+  if( input_size > 0 )
+    out << " (" << 100.0 * static_cast<double>(output_size) / static_cast<double>(input_size) << " %)";
+  if( hm::is_stored_smaller(report.md, input_size) )
   {
-    sp::program_options po(argc, argv);
+    out << ", will be stored as is: "
+        << hm::layout_byte_count(hm::make_stored_meta(input_size, report.md.entity_size))
+        << " bytes";
+  }
+  out << "\n"
+      << "  meta data:         " << hm::meta_byte_count(report.md) << " bytes\n"
+      << "  entities:          " << hm::entity_section_byte_count(report.md) << " bytes\n"
+      << "  tree:              " << report.md.tree_byte_count << " bytes\n"
+      << "  data:              " << report.md.data_byte_count << " bytes\n"
+      << "coded entities:      " << report.entity_count << "\n"
+      << "distinct entities:   " << report.md.entity_count << "\n"
+      << "entropy:             " << report.entropy << " bits per entity\n"
+      << "average code length: " << report.average_code_length << " bits\n"
+      << "max code length:     " << report.max_code_length << " bits\n"
+      << "code lengths (bits: distinct entities):\n";
 
-    if( po.contains("help") )
+  for(size_t length = 0; length < report.code_length_histogram.size(); ++length)
+  {
+    if( report.code_length_histogram[length] )
+      out << "  " << length << ": " << report.code_length_histogram[length] << "\n";
+  }
+}
+
+
+/// Decode a layout read from input to output.
+///
+/// If the layout records the original size (see hm::get_original_byte_count)
+/// and map_output is set, the output file is preallocated and decoded into
+/// through a memory mapping instead of output (see sp::mapped_output_file).
+///
+/// Parameters:
+///   input:
+///     A seekable stream, positioned anywhere.
+///   output_name:
+///     The file output writes to, which must be empty.
+///   stats:
+///     Receives the statistics of the run.
+///   err:
+///     Receives error messages.
+///   map_output:
+///     Whether the output file may be mapped. Nothing must be written to
+///     output_name but through output.
+///
+/// Throws hm::invalid_layout if the input is invalid.
+/// Returns EXIT_SUCCESS or EXIT_FAILURE.
+int decode_stream(
+  const sp::program_options& po,
+  std::istream& input,
+  std::ostream& output,
+  const std::string& output_name,
+  sp::run_stats& stats,
+  std::ostream& err,
+  bool map_output
+)
+{
+  stats.operation = "decode";
+  stats.bytes_in = sp::stream_size(input);
+
+  auto dec_iter = std::istreambuf_iterator<char>(input);
+  auto dec_iter_end = std::istreambuf_iterator<char>();
+
+  stats.start("meta");
+  hm::meta md_decoded = hm::decode_meta_data(dec_iter, dec_iter_end);
+  stats.entity_size = md_decoded.entity_size;
+  stats.distinct_entity_count = md_decoded.entity_count;
+
+  uint64_t original_byte_count = 0;
+  std::unique_ptr<sp::mapped_output_file> mapped;
+  if( map_output
+      && !po.contains("range")
+      && hm::get_original_byte_count(md_decoded, original_byte_count) )
+  {
+    mapped.reset(new sp::mapped_output_file(output_name, original_byte_count));
+    if( !mapped->is_open() )
+      mapped.reset();
+  }
+
+  uint32_t checksum = 0;
+  if( mapped )
+  {
+    hm::dispatch_entity_size<sp::mapped_decoder>(
+      md_decoded.entity_size,
+      md_decoded,
+      input,
+      *mapped,
+      stats
+    );
+
+    if( md_decoded.flags & hm::flag_checksum )
     {
-      po.print(argv[0], std::cout);
-      return EXIT_SUCCESS;
+      stats.start("checksum");
+      checksum = hm::crc32c(mapped->data(), mapped->written_byte_count());
+      stats.stop();
     }
 
-    if( !po.validate_or_print_error(std::cerr) )
+    stats.bytes_out = mapped->written_byte_count();
+    if( !mapped->close() )
     {
+      err << "Error: failed writing output-file " << output_name << "\n";
       return EXIT_FAILURE;
     }
+  }
+  else
+  {
+    // checksum the output while writing it, if the input has a checksum
+    // (the checksum covers the whole input only)
+    std::unique_ptr<sp::crc32c_ostreambuf> checked_buf(
+      (md_decoded.flags & hm::flag_checksum) && !po.contains("range")
+        ? new sp::crc32c_ostreambuf(output.rdbuf())
+        : nullptr
+    );
+    std::ostream checked_output(
+      checked_buf ? static_cast<std::streambuf *>(checked_buf.get()) : output.rdbuf()
+    );
 
-    std::string output_file_name = po.get<std::string>("output-file");
-    if( sp::file_exists(output_file_name) )
+    if( po.contains("range") )
     {
-      std::cerr << "Error: output-file " << output_file_name
-                << " already exists; refusing to overwrite.\n";
+      stats.start("range");
+      const auto range = po.get<sp::pov_range>("range");
+      hm::dispatch_entity_size<sp::range_decoder>(
+        md_decoded.entity_size,
+        md_decoded,
+        input,
+        output,
+        range.start,
+        range.count
+      );
+    }
+    else
+    {
+      hm::dispatch_entity_size<sp::stream_decoder>(
+        md_decoded.entity_size,
+        md_decoded,
+        input,
+        checked_output,
+        stats
+      );
+    }
+
+    // flushes the output
+    if( checked_buf )
+    {
+      stats.start("checksum");
+      checksum = checked_buf->checksum();
+      stats.stop();
+    }
+
+    output.flush();
+    stats.bytes_out = static_cast<uint64_t>(output.tellp());
+  }
+
+  // the checksum covers the whole input only
+  if( !po.contains("range")
+      && (md_decoded.flags & hm::flag_checksum)
+      && checksum != md_decoded.checksum )
+  {
+    err << "Error: checksum mismatch, output-file "
+        << output_name << " is corrupt\n";
+    return EXIT_FAILURE;
+  }
+
+  if( md_decoded.entity_size )
+    stats.entity_count = stats.bytes_out / md_decoded.entity_size;
+
+  return EXIT_SUCCESS;
+}
+
+
+/// Encode or decode a single file, as selected by the program options.
+///
+/// Parameters:
+///   input_name:
+///     The file to encode or decode.
+///   output_name:
+///     The file to create. Must not exist.
+///   stats:
+///     Receives the statistics of the run.
+///   err:
+///     Receives error messages.
+///   buffers:
+///     If not null, the stream buffers of the files.
+///
+/// Throws hm::invalid_layout if the input is invalid.
+/// Returns EXIT_SUCCESS or EXIT_FAILURE.
+int code_file(
+  const sp::program_options& po,
+  const std::string& input_name,
+  const std::string& output_name,
+  sp::run_stats& stats,
+  std::ostream& err,
+  sp::file_buffers * buffers = nullptr
+)
+{
+  const bool decode = po.contains("decode-file");
+  if( sp::file_exists(output_name) )
+  {
+    err << "Error: output-file " << output_name
+        << " already exists; refusing to overwrite.\n";
+    return EXIT_FAILURE;
+  }
+
+  std::ofstream output_file;
+  if( buffers )
+    output_file.rdbuf()->pubsetbuf(buffers->output.data(), buffers->output.size());
+  output_file.open(output_name, std::ios::binary);
+
+  if( !output_file.good() )
+  {
+    err << "Error: failed creating output-file " << output_name
+        << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // --io uring: write the file created by output_file through io_uring
+  const bool uring = po.get_io() == sp::pov_io::uring;
+  std::unique_ptr<sp::uring_ostreambuf> uring_output(
+    uring ? new sp::uring_ostreambuf(output_name) : nullptr
+  );
+  if( uring_output && !uring_output->is_open() )
+  {
+    err << "Error: failed opening output-file " << output_name
+        << "\n";
+    return EXIT_FAILURE;
+  }
+  std::streambuf * output_buf = uring
+    ? static_cast<std::streambuf *>(uring_output.get())
+    : output_file.rdbuf();
+
+  // --pipeline: a reader thread ahead of the input, a writer thread behind
+  // the output, the main thread codes in between
+  const bool pipeline = po.contains("pipeline");
+  std::unique_ptr<sp::write_behind_ostreambuf> write_behind(
+    pipeline ? new sp::write_behind_ostreambuf(output_buf) : nullptr
+  );
+  std::ostream output(
+    pipeline
+      ? static_cast<std::streambuf *>(write_behind.get())
+      : output_buf
+  );
+
+  //
+  // DECODE FILE
+  //
+  if( decode )
+  {
+    std::ifstream decode_file;
+    if( buffers )
+      decode_file.rdbuf()->pubsetbuf(buffers->input.data(), buffers->input.size());
+    decode_file.open(input_name, std::ios::binary);
+
+    if( !decode_file.good() )
+    {
+      err << "Error: failed opening decode-file "
+          << input_name << "\n";
+      return EXIT_FAILURE;
+    }
+
+    std::unique_ptr<sp::uring_istreambuf> uring_input(
+      uring ? new sp::uring_istreambuf(input_name) : nullptr
+    );
+    if( uring_input && !uring_input->is_open() )
+    {
+      err << "Error: failed opening decode-file "
+          << input_name << "\n";
+      return EXIT_FAILURE;
+    }
+    std::streambuf * input_buf = uring
+      ? static_cast<std::streambuf *>(uring_input.get())
+      : decode_file.rdbuf();
+
+    std::unique_ptr<sp::read_ahead_istreambuf> read_ahead(
+      pipeline ? new sp::read_ahead_istreambuf(input_buf) : nullptr
+    );
+    std::istream decode_input(
+      pipeline
+        ? static_cast<std::streambuf *>(read_ahead.get())
+        : input_buf
+    );
+
+    const int status =
+      decode_stream(po, decode_input, output, output_name, stats, err, !pipeline && !uring);
+    if( status != EXIT_SUCCESS )
+      return status;
+
+    // joins the reader thread
+    read_ahead.reset();
+    uring_input.reset();
+    decode_file.close();
+  }
+  //
+  // ENCODE FILE
+  //
+  else
+  {
+    std::ifstream encode_file;
+    if( buffers )
+      encode_file.rdbuf()->pubsetbuf(buffers->input.data(), buffers->input.size());
+    encode_file.open(input_name, std::ios::binary);
+
+    if( !encode_file.good() )
+    {
+      err << "Error: failed opening encode-file "
+          << input_name << "\n";
+      return EXIT_FAILURE;
+    }
+
+    std::unique_ptr<sp::uring_istreambuf> uring_input(
+      uring ? new sp::uring_istreambuf(input_name) : nullptr
+    );
+    if( uring_input && !uring_input->is_open() )
+    {
+      err << "Error: failed opening encode-file "
+          << input_name << "\n";
       return EXIT_FAILURE;
     }
+    std::streambuf * input_buf = uring
+      ? static_cast<std::streambuf *>(uring_input.get())
+      : encode_file.rdbuf();
 
-    std::ofstream output_file(
-      output_file_name,
-      std::ios::binary
+    std::unique_ptr<sp::read_ahead_istreambuf> read_ahead(
+      pipeline ? new sp::read_ahead_istreambuf(input_buf) : nullptr
     );
 
-    if( !output_file.good() )
+    if( pipeline )
+      input_buf = read_ahead.get();
+
+    // checksum the input while reading it
+    std::unique_ptr<sp::crc32c_istreambuf> checked_buf(
+      po.contains("checksum") ? new sp::crc32c_istreambuf(input_buf) : nullptr
+    );
+    std::istream checked_input(
+      checked_buf ? static_cast<std::streambuf *>(checked_buf.get()) : input_buf
+    );
+
+    stats.operation = "encode";
+    stats.bytes_in = sp::stream_size(checked_input);
+
+    hm::meta md = encode_meta_from_options(po);
+    stats.start("sample");
+    const unsigned int entity_size =
+      resolve_entity_size(checked_input, po.get_entity_size(), md);
+    stats.stop();
+    stats.entity_size = entity_size;
+
+    // select the entity type based on runtime input
+    // (writes dummy meta data, since the final flags determine which
+    // fields are written)
+    sp::count_options counting;
+    counting.radix = po.get_histogram() == sp::pov_histogram::radix;
+    if( po.contains("sample") )
+    {
+      counting.sample_byte_count =
+        static_cast<uint64_t>(po.get<uint32_t>("sample")) * 1024 * 1024;
+    }
+
+    hm::dispatch_entity_size<sp::stream_encoder>(
+      entity_size,
+      checked_input,
+      output,
+      md,
+      stats,
+      counting
+    );
+
+    // the encoder's last pass read the whole input from the beginning
+    if( checked_buf )
+      md.checksum = checked_buf->checksum();
+
+    // overwrite dummy with actual meta data
+    stats.start("meta");
+    stats.bytes_out = static_cast<uint64_t>(output.tellp());
+    output.seekp(0);
+    hm::encode_meta_data(md, std::ostreambuf_iterator<char>(output));
+    output.flush();
+    stats.stop();
+
+    // joins the reader thread
+    read_ahead.reset();
+    uring_input.reset();
+    encode_file.close();
+  }
+
+  // joins the writer thread, waits for io_uring, then closes the file
+  write_behind.reset();
+  uring_output.reset();
+  output_file.close();
+
+  return EXIT_SUCCESS;
+}
+
+
+/// The number of workers of --batch and --archive: --jobs, or the number of
+/// hardware threads.
+size_t job_count(const sp::program_options& po)
+{
+  const unsigned int hardware_threads = std::thread::hardware_concurrency();
+  return po.contains("jobs")
+    ? po.get<uint32_t>("jobs")
+    : std::max(hardware_threads, 1U);
+}
+
+
+/// Encode or decode the files of a directory or of a list file (--batch).
+/// Each output is written alongside its input.
+///
+/// Returns EXIT_SUCCESS if all files were coded.
+int code_batch(const sp::program_options& po)
+{
+  const bool decode = po.contains("decode-file");
+  std::vector<std::string> paths;
+  if( !sp::list_inputs(
+        po.get<std::string>(decode ? "decode-file" : "encode-file"),
+        decode,
+        paths,
+        std::cerr
+      ) )
+    return EXIT_FAILURE;
+
+  const size_t failed_count = sp::run_jobs(
+    job_count(po),
+    paths,
+    [&](size_t i, std::ostream& err, sp::file_buffers& buffers) {
+      const std::string& path = paths[i];
+      if( decode && !sp::has_batch_suffix(path) )
+      {
+        err << "Error: decode-file " << path << " does not end in "
+            << sp::batch_suffix << "\n";
+        return EXIT_FAILURE;
+      }
+
+      const std::string output_name = decode
+        ? path.substr(0, path.size() - sp::batch_suffix.size())
+        : path + sp::batch_suffix;
+
+      // a failed job must not leave a partly written output behind, a later
+      // run of -d --batch would pick it up (an existing file is not touched)
+      const bool output_existed = sp::file_exists(output_name);
+      const auto remove_output = [&output_name, output_existed]() {
+        if( !output_existed )
+          std::remove(output_name.c_str());
+      };
+
+      sp::run_stats stats;
+      int status = EXIT_FAILURE;
+      try
+      {
+        status = code_file(po, path, output_name, stats, err, &buffers);
+      }
+      catch(...)
+      {
+        remove_output();
+        throw;
+      }
+
+      if( status != EXIT_SUCCESS )
+        remove_output();
+
+      return status;
+    },
+    std::cerr
+  );
+
+  return failed_count == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/// Pack the files of a directory or of a list file into the archive
+/// output-file (--archive with encode-file, see hm/archive.h).
+///
+/// The members are encoded concurrently into temporary files next to the
+/// archive, which are then appended to it in order and removed.
+///
+/// Returns EXIT_SUCCESS if all files were archived.
+int create_archive(const sp::program_options& po)
+{
+  const std::string archive_name = po.get<std::string>("output-file");
+
+  std::vector<std::string> paths;
+  if( !sp::list_inputs(po.get<std::string>("encode-file"), false, paths, std::cerr) )
+    return EXIT_FAILURE;
+
+  std::vector<hm::archive_member> members(paths.size());
+  std::vector<std::string> temp_names(paths.size());
+  std::unordered_map<std::string, std::string> paths_by_name;
+  for(size_t i = 0; i < paths.size(); ++i)
+  {
+    members[i].name = sp::base_name(paths[i]);
+    temp_names[i] = archive_name + ".member-" + std::to_string(i);
+
+    if( !hm::is_valid_member_name(members[i].name) )
     {
-      std::cerr << "Error: failed creating output-file " << output_file_name
+      std::cerr << "Error: cannot archive " << paths[i]
+                << ", expecting the path of a file\n";
+      return EXIT_FAILURE;
+    }
+
+    const auto inserted = paths_by_name.emplace(members[i].name, paths[i]);
+    if( !inserted.second )
+    {
+      std::cerr << "Error: both " << inserted.first->second << " and "
+                << paths[i] << " would be archived as " << members[i].name
                 << "\n";
       return EXIT_FAILURE;
     }
 
-    //
-    // DECODE FILE
-    //
-    if( po.contains("decode-file") )
+    if( sp::file_exists(temp_names[i]) )
     {
-      std::ifstream decode_file(
-        po.get<std::string>("decode-file"),
-        std::ios::binary
-      );
+      std::cerr << "Error: temporary file " << temp_names[i]
+                << " already exists; refusing to overwrite.\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  if( sp::file_exists(archive_name) )
+  {
+    std::cerr << "Error: output-file " << archive_name
+              << " already exists; refusing to overwrite.\n";
+    return EXIT_FAILURE;
+  }
 
-      if( !decode_file.good() )
+  std::ofstream archive(archive_name, std::ios::binary);
+  if( !archive.good() )
+  {
+    std::cerr << "Error: failed creating output-file " << archive_name << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto remove_temp_files = [&temp_names]() {
+    for(const auto& name : temp_names)
+      std::remove(name.c_str());
+  };
+
+  const size_t failed_count = sp::run_jobs(
+    job_count(po),
+    paths,
+    [&](size_t i, std::ostream& err, sp::file_buffers& buffers) {
+      sp::run_stats stats;
+      const int status =
+        code_file(po, paths[i], temp_names[i], stats, err, &buffers);
+      members[i].original_byte_count = stats.bytes_in;
+      return status;
+    },
+    std::cerr
+  );
+
+  if( failed_count > 0 )
+  {
+    remove_temp_files();
+    archive.close();
+    std::remove(archive_name.c_str());
+    return EXIT_FAILURE;
+  }
+
+  // append the members, checksumming each
+  uint64_t offset = 0;
+  for(size_t i = 0; i < members.size(); ++i)
+  {
+    std::ifstream member_file(temp_names[i], std::ios::binary);
+    sp::append_archive_member(member_file, archive, offset, members[i]);
+    offset += members[i].byte_count;
+
+    member_file.close();
+    std::remove(temp_names[i].c_str());
+  }
+
+  sp::write_archive_directory(members, offset, archive);
+
+  archive.close();
+  if( !archive.good() )
+  {
+    remove_temp_files();
+    std::cerr << "Error: failed writing output-file " << archive_name << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+/// List or extract the members of the archive decode-file (--archive with
+/// decode-file): all of them or those named by --member, concurrently, into
+/// the directory output-file.
+///
+/// Each member is decoded in place from the archive. Its checksum in the
+/// directory is verified while decoding.
+///
+/// Returns EXIT_SUCCESS if all members were extracted.
+int extract_archive(const sp::program_options& po)
+{
+  const std::string archive_name = po.get<std::string>("decode-file");
+
+  std::ifstream archive(archive_name, std::ios::binary);
+  if( !archive.good() )
+  {
+    std::cerr << "Error: failed opening decode-file " << archive_name << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const hm::archive_index index = sp::read_archive_index(archive);
+  archive.close();
+
+  if( po.contains("list") )
+  {
+    std::cout << "original-bytes\tencoded-bytes\tname\n";
+    for(const auto& member : index.members())
+    {
+      std::cout << member.original_byte_count << "\t"
+                << member.byte_count << "\t"
+                << member.name << "\n";
+    }
+
+    return EXIT_SUCCESS;
+  }
+
+  std::vector<const hm::archive_member *> selected;
+  if( po.contains("member") )
+  {
+    for(const auto& name : po.get<std::vector<std::string>>("member"))
+    {
+      const hm::archive_member * member = index.find(name);
+      if( !member )
       {
-        std::cerr << "Error: failed opening decode-file "
-                  << po.get<std::string>("decode-file") << "\n";
+        std::cerr << "Error: " << archive_name << " has no member " << name
+                  << "\n";
         return EXIT_FAILURE;
       }
+      selected.push_back(member);
+    }
+  }
+  else
+  {
+    for(const auto& member : index.members())
+      selected.push_back(&member);
+  }
 
-      auto dec_iter = std::istreambuf_iterator<char>(decode_file);
-      auto dec_iter_end = std::istreambuf_iterator<char>();
+  const std::string directory = po.get<std::string>("output-file");
+  if( !sp::is_directory(directory) )
+  {
+    std::cerr << "Error: output-file " << directory
+              << " must be an existing directory\n";
+    return EXIT_FAILURE;
+  }
 
-      hm::meta md_decoded = hm::decode_meta_data(dec_iter, dec_iter_end);
+  std::vector<std::string> names;
+  for(const auto * member : selected)
+    names.push_back(member->name);
 
-      hm::decode(
-        md_decoded,
-        dec_iter,
-        dec_iter_end,
-        std::ostreambuf_iterator<char>(output_file)
+  const bool uring = po.get_io() == sp::pov_io::uring;
+  const size_t failed_count = sp::run_jobs(
+    job_count(po),
+    names,
+    [&](size_t i, std::ostream& err, sp::file_buffers& buffers) {
+      const hm::archive_member& member = *selected[i];
+      const std::string output_name =
+        directory + (directory.back() == '/' ? "" : "/") + member.name;
+
+      if( sp::file_exists(output_name) )
+      {
+        err << "Error: " << output_name
+            << " already exists; refusing to overwrite.\n";
+        return EXIT_FAILURE;
+      }
+
+      std::ifstream archive_file;
+      std::unique_ptr<sp::uring_istreambuf> uring_input;
+      if( uring )
+      {
+        uring_input.reset(new sp::uring_istreambuf(archive_name));
+      }
+      else
+      {
+        archive_file.rdbuf()->pubsetbuf(buffers.input.data(), buffers.input.size());
+        archive_file.open(archive_name, std::ios::binary);
+      }
+
+      if( uring ? !uring_input->is_open() : !archive_file.good() )
+      {
+        err << "Error: failed opening decode-file " << archive_name << "\n";
+        return EXIT_FAILURE;
+      }
+
+      // the member's bytes of the archive, checksummed
+      sp::slice_istreambuf slice(
+        uring
+          ? static_cast<std::streambuf *>(uring_input.get())
+          : archive_file.rdbuf(),
+        member.offset,
+        member.byte_count
+      );
+      sp::crc32c_istreambuf checked_buf(&slice);
+      std::istream input(&checked_buf);
+
+      std::ofstream output_file;
+      output_file.rdbuf()->pubsetbuf(buffers.output.data(), buffers.output.size());
+      output_file.open(output_name, std::ios::binary);
+      if( !output_file.good() )
+      {
+        err << "Error: failed creating " << output_name << "\n";
+        return EXIT_FAILURE;
+      }
+
+      std::unique_ptr<sp::uring_ostreambuf> uring_output(
+        uring ? new sp::uring_ostreambuf(output_name) : nullptr
       );
+      std::ostream output(
+        uring
+          ? static_cast<std::streambuf *>(uring_output.get())
+          : output_file.rdbuf()
+      );
+
+      sp::run_stats stats;
+      const int status =
+        decode_stream(po, input, output, output_name, stats, err, !uring);
+      if( status != EXIT_SUCCESS )
+        return status;
+
+      // the decoder stops after the data, checksum the rest of the member
+      input.clear();
+      input.ignore(std::numeric_limits<std::streamsize>::max());
+
+      if( checked_buf.checksum() != member.checksum
+          || stats.bytes_out != member.original_byte_count )
+      {
+        err << "Error: member " << member.name << " of " << archive_name
+            << " is corrupt\n";
+        return EXIT_FAILURE;
+      }
+
+      return EXIT_SUCCESS;
+    },
+    std::cerr
+  );
+
+  return failed_count == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
+
+
+int main(int argc, const char * argv[])
+{
+  std::ios_base::sync_with_stdio(false);
+
+  try
+  {
+    sp::program_options po(argc, argv);
+
+    if( po.contains("help") )
+    {
+      po.print(argv[0], std::cout);
+      return EXIT_SUCCESS;
+    }
 
-      decode_file.close();
+    if( !po.validate_or_print_error(std::cerr) )
+    {
+      return EXIT_FAILURE;
     }
+
     //
-    // ENCODE FILE
+    // ESTIMATE
     //
-    else if( po.contains("encode-file") )
+    if( po.contains("estimate") )
     {
       std::ifstream encode_file(
         po.get<std::string>("encode-file"),
@@ -101,81 +886,54 @@ int main(int argc, const char * argv[])
         return EXIT_FAILURE;
       }
 
-      unsigned int entity_size = po.get_entity_size();
+      const hm::meta md = encode_meta_from_options(po);
+      const unsigned int entity_size =
+        resolve_entity_size(encode_file, po.get_entity_size(), md);
+      const uint64_t input_size = sp::stream_size(encode_file);
+
+      hm::code_report report;
+      hm::dispatch_entity_size<sp::stream_estimator>(
+        entity_size,
+        encode_file,
+        md,
+        report
+      );
 
-      auto enc_iter = std::istreambuf_iterator<char>(encode_file);
-      auto enc_iter_end = std::istreambuf_iterator<char>();
-      auto out_iter = std::ostreambuf_iterator<char>(output_file);
+      print_report(report, input_size, std::cout);
+      return EXIT_SUCCESS;
+    }
 
-      // write dummy data
-      hm::meta md;
-      hm::encode_meta_data(md, out_iter);
+    //
+    // BATCH
+    //
+    if( po.contains("batch") )
+      return code_batch(po);
 
-      // Because we cannot select a type based on runtime input, we either have
-      // to use a macro or duplicate code.
-      switch( entity_size )
-      {
-        default:
-        case 1:
-        {
-          auto tree = hm::build_huffman_tree<uint8_t>(
-            enc_iter,
-            enc_iter_end
-          );
-
-          encode_file.seekg(0);
-          md = hm::encode(enc_iter, enc_iter_end, tree.get(), out_iter);
-          break;
-        }
-        case 2:
-        {
-          auto tree = hm::build_huffman_tree<uint16_t>(
-            enc_iter,
-            enc_iter_end
-          );
-
-          encode_file.seekg(0);
-          md = hm::encode(enc_iter, enc_iter_end, tree.get(), out_iter);
-          break;
-        }
-        case 4:
-        {
-          auto tree = hm::build_huffman_tree<uint32_t>(
-            enc_iter,
-            enc_iter_end
-          );
-
-          encode_file.seekg(0);
-          md = hm::encode(enc_iter, enc_iter_end, tree.get(), out_iter);
-          break;
-        }
-        case 8:
-        {
-          auto tree = hm::build_huffman_tree<uint64_t>(
-            enc_iter,
-            enc_iter_end
-          );
-
-          encode_file.seekg(0);
-          md = hm::encode(enc_iter, enc_iter_end, tree.get(), out_iter);
-          break;
-        }
-      }
+    //
+    // ARCHIVE
+    //
+    if( po.contains("archive") )
+      return po.contains("decode-file") ? extract_archive(po) : create_archive(po);
 
-      // overwrite dummy with actual meta data
-      output_file.seekp(0);
-      hm::encode_meta_data(md, out_iter);
+    // collected for --stats and --stats-json
+    sp::run_stats stats;
 
-      encode_file.close();
-    }
-    else
-    {
-      // program option validation failed
-      // "should never happen"
-      assert(false);
-    }
+    const bool decode = po.contains("decode-file");
+    const int status = code_file(
+      po,
+      po.get<std::string>(decode ? "decode-file" : "encode-file"),
+      po.get<std::string>("output-file"),
+      stats,
+      std::cerr
+    );
+    if( status != EXIT_SUCCESS )
+      return status;
+
+    if( po.contains("stats") )
+      stats.print(std::cout);
+    if( po.contains("stats-json") )
+      stats.print_json(std::cout);
 
-    output_file.close();
     return EXIT_SUCCESS;
   }
   catch(const boost::program_options::validation_error& e)
@@ -183,6 +941,11 @@ int main(int argc, const char * argv[])
     std::cerr << "Error " << e.what() << "\n";
     return EXIT_FAILURE;
   }
+  catch(const hm::invalid_layout& e)
+  {
+    std::cerr << "Error: invalid input: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
 
   // "should never happen"
   assert(false);
@@ -0,0 +1,125 @@
+#ifndef SP_ARCHIVE_FILE_H
+#define SP_ARCHIVE_FILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <iterator>
+#include <vector>
+
+#include "hm/archive.h"
+#include "hm/crc32c.h"
+#include "hm/exception.h"
+#include "sp/stream-io.h"
+
+
+namespace sp {
+
+/// The size of the blocks append_archive_member copies at once.
+const size_t archive_block_size = 64 * 1024;
+
+
+/// Append an encoded file to an archive as a member (see hm/archive.h),
+/// checksumming it on the way.
+///
+/// Parameters:
+///   input:
+///     The encoded file, read to its end.
+///   archive:
+///     The archive, positioned at offset.
+///   offset:
+///     The offset of the member from the beginning of the archive.
+///   member:
+///     Receives the offset, size and checksum of the member.
+inline void append_archive_member(
+  std::istream& input,
+  std::ostream& archive,
+  uint64_t offset,
+  hm::archive_member& member
+)
+{
+  member.offset = offset;
+  member.byte_count = 0;
+  member.checksum = 0;
+
+  std::vector<char> block(sp::archive_block_size);
+  while( input.read(block.data(), static_cast<std::streamsize>(block.size()))
+         || input.gcount() > 0 )
+  {
+    const std::streamsize count = input.gcount();
+    member.checksum = hm::crc32c(
+      reinterpret_cast<const uint8_t *>(block.data()),
+      static_cast<size_t>(count),
+      member.checksum
+    );
+    archive.write(block.data(), count);
+    member.byte_count += static_cast<uint64_t>(count);
+  }
+}
+
+
+/// Write the directory and trailer of an archive after its members.
+///
+/// Parameters:
+///   members:
+///     The members, in archive order.
+///   directory_offset:
+///     The offset of the directory, the size of all members.
+///   archive:
+///     The archive, positioned after the last member.
+inline void write_archive_directory(
+  const std::vector<hm::archive_member>& members,
+  uint64_t directory_offset,
+  std::ostream& archive
+)
+{
+  const std::vector<uint8_t> directory = hm::encode_archive_directory(members);
+
+  hm::archive_trailer trailer;
+  trailer.directory_offset = directory_offset;
+  trailer.directory_byte_count = directory.size();
+  trailer.directory_checksum = hm::crc32c(directory.data(), directory.size());
+
+  std::ostreambuf_iterator<char> out(archive);
+  std::copy(directory.begin(), directory.end(), out);
+  hm::encode_archive_trailer(trailer, out);
+}
+
+
+/// Read the directory of an archive.
+///
+/// Parameters:
+///   input:
+///     A seekable stream of the whole archive, positioned anywhere.
+///
+/// Throws hm::invalid_layout if input is not an archive.
+inline hm::archive_index read_archive_index(std::istream& input)
+{
+  const uint64_t size = sp::stream_size(input);
+  if( size < hm::archive_trailer_byte_count )
+    throw hm::invalid_layout("not an archive");
+
+  const uint64_t trailer_offset = size - hm::archive_trailer_byte_count;
+  input.seekg(static_cast<std::streamoff>(trailer_offset));
+  auto in_begin = std::istreambuf_iterator<char>(input);
+  const hm::archive_trailer trailer =
+    hm::decode_archive_trailer(in_begin, std::istreambuf_iterator<char>());
+
+  // the directory is between the members and the trailer
+  if( trailer.directory_offset > trailer_offset
+      || trailer.directory_byte_count != trailer_offset - trailer.directory_offset )
+    throw hm::invalid_layout("invalid directory offset");
+
+  input.seekg(static_cast<std::streamoff>(trailer.directory_offset));
+  in_begin = std::istreambuf_iterator<char>(input);
+  return hm::archive_index(
+    hm::decode_archive_directory(in_begin, std::istreambuf_iterator<char>(), trailer)
+  );
+}
+
+
+}
+
+#endif // SP_ARCHIVE_FILE_H
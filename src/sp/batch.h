@@ -0,0 +1,196 @@
+#ifndef SP_BATCH_H
+#define SP_BATCH_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <sstream>
+#include <ostream>
+#include <mutex>
+#include <atomic>
+#include <exception>
+
+#include "hm/exception.h"
+#include "sp/list-files.h"
+#include "sp/work-stealing-pool.h"
+
+
+namespace sp {
+
+/// The suffix --batch appends to encoded files.
+const std::string batch_suffix = ".hm";
+
+
+inline bool has_batch_suffix(const std::string& path)
+{
+  return path.size() > sp::batch_suffix.size()
+    && path.compare(
+         path.size() - sp::batch_suffix.size(),
+         sp::batch_suffix.size(),
+         sp::batch_suffix
+       ) == 0;
+}
+
+
+/// Collect the input files of --batch and --archive.
+///
+/// Parameters:
+///   source:
+///     A directory (its encoded files when decoding, the others when
+///     encoding) or a list file with one path per line.
+///   decode:
+///     Whether the files are to be decoded.
+///   paths:
+///     Receives the paths of the files.
+///
+/// Returns false after printing an error to err if source cannot be read.
+inline bool list_inputs(
+  const std::string& source,
+  bool decode,
+  std::vector<std::string>& paths,
+  std::ostream& err
+)
+{
+  if( sp::is_directory(source) )
+  {
+    if( !sp::list_directory(source, paths) )
+    {
+      err << "Error: failed reading directory " << source << "\n";
+      return false;
+    }
+
+    // encode everything but encoded files, decode only those
+    paths.erase(
+      std::remove_if(
+        paths.begin(),
+        paths.end(),
+        [decode](const std::string& path) {
+          return sp::has_batch_suffix(path) != decode;
+        }
+      ),
+      paths.end()
+    );
+  }
+  else if( !sp::read_list_file(source, paths) )
+  {
+    err << "Error: failed reading list file " << source << "\n";
+    return false;
+  }
+
+  return true;
+}
+
+
+/// The size of the stream buffers of a batch worker's files.
+const size_t file_buffer_size = 256 * 1024;
+
+
+/// Stream buffers of a batch worker, reused for all of its files.
+struct file_buffers
+{
+  file_buffers()
+  : input(sp::file_buffer_size),
+    output(sp::file_buffer_size)
+  {
+  }
+
+  std::vector<char> input;
+  std::vector<char> output;
+};
+
+
+/// Codes a single file of a batch or member of an archive.
+///
+/// Parameters:
+///   index:
+///     The index of the task.
+///   err:
+///     Receives error messages.
+///   buffers:
+///     The stream buffers of the worker.
+///
+/// Returns EXIT_SUCCESS or EXIT_FAILURE.
+typedef std::function<
+  int(size_t index, std::ostream& err, sp::file_buffers& buffers)
+> job_type;
+
+
+/// Run job for every name, concurrently on a work-stealing pool. A job that
+/// fails or throws is reported and does not stop the others.
+///
+/// Parameters:
+///   worker_count:
+///     The maximum number of workers, at least 1. No more workers than
+///     names are started.
+///   names:
+///     The files or members, for error messages.
+///   err:
+///     Receives the error messages of failed jobs, one job at a time.
+///
+/// Returns the number of failed jobs.
+inline size_t run_jobs(
+  size_t worker_count,
+  const std::vector<std::string>& names,
+  const sp::job_type& job,
+  std::ostream& err
+)
+{
+  sp::work_stealing_pool pool(
+    std::min(std::max<size_t>(worker_count, 1), std::max<size_t>(names.size(), 1))
+  );
+
+  // the coding tables depend on each file, only the stream buffers are
+  // reused across the files of a worker
+  std::vector<sp::file_buffers> buffers(pool.size());
+
+  std::mutex error_mutex;
+  std::atomic<size_t> failed_count(0);
+
+  std::vector<sp::work_stealing_pool::task_type> tasks;
+  tasks.reserve(names.size());
+  for(size_t i = 0; i < names.size(); ++i)
+  {
+    tasks.push_back([&, i](size_t worker) {
+      std::ostringstream job_err;
+      int status = EXIT_FAILURE;
+
+      try
+      {
+        status = job(i, job_err, buffers[worker]);
+      }
+      catch(const hm::invalid_layout& e)
+      {
+        job_err << "Error: invalid input " << names[i] << ": " << e.what() << "\n";
+      }
+      catch(const std::exception& e)
+      {
+        job_err << "Error: " << names[i] << ": " << e.what() << "\n";
+      }
+
+      if( status != EXIT_SUCCESS )
+      {
+        failed_count++;
+        std::lock_guard<std::mutex> lock(error_mutex);
+        err << job_err.str();
+      }
+    });
+  }
+
+  pool.run(std::move(tasks));
+
+  if( failed_count > 0 )
+  {
+    err << "Error: " << failed_count << " of " << names.size()
+        << " files failed\n";
+  }
+
+  return failed_count;
+}
+
+
+}
+
+#endif // SP_BATCH_H
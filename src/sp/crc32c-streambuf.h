@@ -0,0 +1,184 @@
+#ifndef SP_CRC32C_STREAMBUF_H
+#define SP_CRC32C_STREAMBUF_H
+
+#include <cstdint>
+#include <cstddef>
+#include <streambuf>
+#include <vector>
+
+#include "hm/crc32c.h"
+
+
+namespace sp {
+
+/// The size of the blocks that are checksummed at once.
+const size_t crc32c_block_size = 64 * 1024;
+
+
+/// A streambuf that reads from another streambuf and computes the CRC32C of
+/// all bytes read, a block at a time.
+///
+/// Seeking to the beginning restarts the checksum, therefore the checksum is
+/// that of the whole input after the last pass from the beginning to the end.
+class crc32c_istreambuf : public std::streambuf
+{
+public:
+  explicit crc32c_istreambuf(std::streambuf * input)
+  : source(input),
+    buffer(sp::crc32c_block_size),
+    crc(0)
+  {
+    this->setg(this->buffer.data(), this->buffer.data(), this->buffer.data());
+  }
+
+  crc32c_istreambuf(const crc32c_istreambuf&) = delete;
+  crc32c_istreambuf& operator=(const crc32c_istreambuf&) = delete;
+
+  /// Returns the CRC32C of all bytes read since the last seek to the
+  /// beginning.
+  uint32_t checksum() const
+  {
+    return this->crc;
+  }
+
+protected:
+  int_type underflow() override
+  {
+    const std::streamsize count = this->source->sgetn(
+      this->buffer.data(),
+      static_cast<std::streamsize>(this->buffer.size())
+    );
+
+    if( count <= 0 )
+      return traits_type::eof();
+
+    this->crc = hm::crc32c(
+      reinterpret_cast<const uint8_t *>(this->buffer.data()),
+      static_cast<size_t>(count),
+      this->crc
+    );
+
+    this->setg(this->buffer.data(), this->buffer.data(), this->buffer.data() + count);
+    return traits_type::to_int_type(*this->gptr());
+  }
+
+  pos_type seekoff(
+    off_type off,
+    std::ios_base::seekdir dir,
+    std::ios_base::openmode which
+  ) override
+  {
+    // the source is ahead by the bytes that have not been consumed yet
+    if( dir == std::ios_base::cur )
+      off -= this->egptr() - this->gptr();
+
+    return this->restart(this->source->pubseekoff(off, dir, which));
+  }
+
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+  {
+    return this->restart(this->source->pubseekpos(pos, which));
+  }
+
+private:
+  /// Discard buffered bytes after seeking the source. Restart the checksum
+  /// if the source is at the beginning.
+  pos_type restart(pos_type pos)
+  {
+    this->setg(this->buffer.data(), this->buffer.data(), this->buffer.data());
+
+    if( pos == pos_type(0) )
+      this->crc = 0;
+
+    return pos;
+  }
+
+  std::streambuf * source;
+  std::vector<char> buffer;
+  uint32_t crc;
+};
+
+
+/// A streambuf that writes to another streambuf and computes the CRC32C of
+/// all bytes written, a block at a time.
+class crc32c_ostreambuf : public std::streambuf
+{
+public:
+  explicit crc32c_ostreambuf(std::streambuf * output)
+  : target(output),
+    buffer(sp::crc32c_block_size),
+    crc(0)
+  {
+    this->setp(this->buffer.data(), this->buffer.data() + this->buffer.size());
+  }
+
+  crc32c_ostreambuf(const crc32c_ostreambuf&) = delete;
+  crc32c_ostreambuf& operator=(const crc32c_ostreambuf&) = delete;
+
+  ~crc32c_ostreambuf()
+  {
+    this->sync();
+  }
+
+  /// Returns the CRC32C of all bytes written.
+  /// Flushes buffered bytes to the target.
+  uint32_t checksum()
+  {
+    this->sync();
+    return this->crc;
+  }
+
+protected:
+  int_type overflow(int_type c) override
+  {
+    if( !this->flush_buffer() )
+      return traits_type::eof();
+
+    if( !traits_type::eq_int_type(c, traits_type::eof()) )
+    {
+      *this->pptr() = traits_type::to_char_type(c);
+      this->pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+  }
+
+  int sync() override
+  {
+    if( !this->flush_buffer() )
+      return -1;
+
+    return this->target->pubsync();
+  }
+
+private:
+  /// Checksum and write the buffered bytes.
+  /// Returns false if the target failed to accept all bytes.
+  bool flush_buffer()
+  {
+    const std::streamsize count = this->pptr() - this->pbase();
+    if( count == 0 )
+      return true;
+
+    this->crc = hm::crc32c(
+      reinterpret_cast<const uint8_t *>(this->pbase()),
+      static_cast<size_t>(count),
+      this->crc
+    );
+
+    const bool written = this->target->sputn(this->pbase(), count) == count;
+    this->setp(this->buffer.data(), this->buffer.data() + this->buffer.size());
+
+    return written;
+  }
+
+  std::streambuf * target;
+  std::vector<char> buffer;
+  uint32_t crc;
+};
+
+
+}
+
+
+#endif // SP_CRC32C_STREAMBUF_H
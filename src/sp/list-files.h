@@ -0,0 +1,85 @@
+#ifndef SP_LIST_FILES_H
+#define SP_LIST_FILES_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+#include <sys/stat.h>
+#include <dirent.h>
+
+
+namespace sp {
+
+inline bool is_directory(const std::string& path)
+{
+  struct stat st;
+  return ::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+
+/// Return the paths of the regular files in directory (not in its
+/// subdirectories), sorted.
+///
+/// Returns false if directory cannot be read.
+inline bool list_directory(const std::string& directory, std::vector<std::string>& paths)
+{
+  DIR * dir = ::opendir(directory.c_str());
+  if( !dir )
+    return false;
+
+  const std::string prefix = directory.empty() || directory.back() == '/'
+    ? directory
+    : directory + "/";
+
+  while( const dirent * entry = ::readdir(dir) )
+  {
+    const std::string path = prefix + entry->d_name;
+
+    struct stat st;
+    if( ::stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) )
+      paths.push_back(path);
+  }
+
+  ::closedir(dir);
+  std::sort(paths.begin(), paths.end());
+
+  return true;
+}
+
+
+/// Return the last component of path.
+inline std::string base_name(const std::string& path)
+{
+  const size_t slash = path.find_last_of('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+
+/// Return the non-empty lines of a list file.
+///
+/// Returns false if the file cannot be read.
+inline bool read_list_file(const std::string& list_file, std::vector<std::string>& paths)
+{
+  std::ifstream in(list_file);
+  if( !in.good() )
+    return false;
+
+  std::string line;
+  while( std::getline(in, line) )
+  {
+    if( !line.empty() && line.back() == '\r' )
+      line.pop_back();
+
+    if( !line.empty() )
+      paths.push_back(line);
+  }
+
+  return true;
+}
+
+
+}
+
+#endif // SP_LIST_FILES_H
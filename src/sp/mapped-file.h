@@ -0,0 +1,150 @@
+#ifndef SP_MAPPED_FILE_H
+#define SP_MAPPED_FILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "hm/exception.h"
+
+
+namespace sp {
+
+/// An output file of known size, preallocated and written through a shared
+/// memory mapping instead of a stream.
+///
+/// Preallocating (posix_fallocate) reserves the file's blocks in one piece
+/// up front, so the file does not fragment and writing to the mapping cannot
+/// fail for lack of space (which would raise SIGBUS).
+///
+/// Bytes are appended with push_back, e.g. through std::back_inserter, but
+/// never beyond the size given on construction.
+class mapped_output_file
+{
+public:
+  typedef uint8_t value_type;
+
+  /// Parameters:
+  ///   path:
+  ///     The file to write, which must exist (e.g. created by an ofstream).
+  ///   file_byte_count:
+  ///     The size of the file once written.
+  mapped_output_file(const std::string& path, uint64_t file_byte_count)
+  : fd(::open(path.c_str(), O_RDWR)),
+    mapping(nullptr),
+    byte_count(file_byte_count),
+    written(0)
+  {
+    if( this->fd < 0 || file_byte_count == 0 )
+      return;
+
+    void * p = MAP_FAILED;
+    if( ::posix_fallocate(this->fd, 0, static_cast<off_t>(file_byte_count)) == 0 )
+    {
+      p = ::mmap(
+        nullptr,
+        static_cast<size_t>(file_byte_count),
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        this->fd,
+        0
+      );
+    }
+
+    if( p == MAP_FAILED )
+    {
+      // undo the preallocation, the caller falls back to a stream
+      this->close();
+      return;
+    }
+
+    this->mapping = static_cast<uint8_t *>(p);
+    ::madvise(this->mapping, static_cast<size_t>(file_byte_count), MADV_SEQUENTIAL);
+  }
+
+  mapped_output_file(const mapped_output_file&) = delete;
+  mapped_output_file& operator=(const mapped_output_file&) = delete;
+
+  ~mapped_output_file()
+  {
+    this->close();
+  }
+
+  /// Whether the file is mapped, or empty.
+  bool is_open() const
+  {
+    return this->fd >= 0;
+  }
+
+  /// Append byte.
+  ///
+  /// Throws hm::invalid_layout if the file is full: its size is taken from
+  /// the input, which may be corrupt.
+  void push_back(uint8_t byte)
+  {
+    if( this->written == this->byte_count )
+      throw hm::invalid_layout("output exceeds the original size");
+
+    this->mapping[this->written++] = byte;
+  }
+
+  /// The mapped file, of size() bytes.
+  uint8_t * data()
+  {
+    return this->mapping;
+  }
+
+  uint64_t size() const
+  {
+    return this->byte_count;
+  }
+
+  /// The number of bytes appended with push_back or written to data() and
+  /// recorded with set_written_byte_count.
+  uint64_t written_byte_count() const
+  {
+    return this->written;
+  }
+
+  void set_written_byte_count(uint64_t count)
+  {
+    this->written = count < this->byte_count ? count : this->byte_count;
+  }
+
+  /// Unmap and close the file, cutting it to the bytes written.
+  /// Returns false on error.
+  bool close()
+  {
+    if( this->fd < 0 )
+      return true;
+
+    bool ok = true;
+    if( this->mapping )
+      ok = ::munmap(this->mapping, static_cast<size_t>(this->byte_count)) == 0;
+
+    if( this->written != this->byte_count )
+      ok = ::ftruncate(this->fd, static_cast<off_t>(this->written)) == 0 && ok;
+
+    ok = ::close(this->fd) == 0 && ok;
+
+    this->mapping = nullptr;
+    this->fd = -1;
+
+    return ok;
+  }
+
+private:
+  int fd;
+  uint8_t * mapping;
+  uint64_t byte_count;
+  uint64_t written;
+};
+
+
+}
+
+#endif // SP_MAPPED_FILE_H
@@ -0,0 +1,428 @@
+#ifndef SP_PIPELINE_STREAMBUF_H
+#define SP_PIPELINE_STREAMBUF_H
+
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <streambuf>
+#include <ios>
+
+#include "sp/spsc-queue.h"
+
+
+namespace sp {
+
+/// The size of the blocks handed between the threads of a pipeline.
+const size_t pipeline_block_size = 1024 * 1024;
+
+/// The number of blocks of a pipeline stage. While the coder works on one
+/// block, the others are being read or written.
+const size_t pipeline_block_count = 4;
+
+/// The size of the first read after a seek. Smaller than a block: a read
+/// right after a seek is often a short random access (e.g. the chunks of
+/// read_sample), reading ahead only pays off for sequential reads.
+const size_t pipeline_first_read_size = 64 * 1024;
+
+
+/// A block of bytes handed between threads.
+/// Blocks are moved through the queues, never copied.
+struct pipeline_block
+{
+  pipeline_block()
+  : data(),
+    size(0)
+  {
+  }
+
+  pipeline_block(const pipeline_block&) = delete;
+  pipeline_block& operator=(const pipeline_block&) = delete;
+
+  pipeline_block(pipeline_block&&) = default;
+  pipeline_block& operator=(pipeline_block&&) = default;
+
+  std::vector<char> data;
+  size_t size;
+};
+
+
+/// A streambuf that reads from another streambuf in a separate thread,
+/// ahead of the consumer.
+///
+/// The reader thread fills free blocks and hands them to the consumer
+/// through a bounded queue; the consumer hands them back once it is done.
+/// The reader thread starts with the second read after construction or a
+/// seek, so random access is served synchronously and never reads ahead.
+///
+/// Seeking stops the reader thread and seeks the source.
+class read_ahead_istreambuf : public std::streambuf
+{
+public:
+  explicit read_ahead_istreambuf(std::streambuf * input)
+  : source(input),
+    first(),
+    current(),
+    current_is_first(false),
+    full(sp::pipeline_block_count),
+    free(sp::pipeline_block_count),
+    stop(false),
+    reader(),
+    at_end(false),
+    read_since_seek(false),
+    block_position(input->pubseekoff(0, std::ios_base::cur, std::ios_base::in))
+  {
+    this->first.data.resize(sp::pipeline_first_read_size);
+    this->setg(nullptr, nullptr, nullptr);
+  }
+
+  read_ahead_istreambuf(const read_ahead_istreambuf&) = delete;
+  read_ahead_istreambuf& operator=(const read_ahead_istreambuf&) = delete;
+
+  ~read_ahead_istreambuf()
+  {
+    this->stop_reader();
+  }
+
+protected:
+  int_type underflow() override
+  {
+    if( this->gptr() < this->egptr() )
+      return traits_type::to_int_type(*this->gptr());
+
+    this->block_position += static_cast<off_type>(this->egptr() - this->eback());
+    this->setg(nullptr, nullptr, nullptr);
+    this->release_current();
+
+    if( this->at_end )
+      return traits_type::eof();
+
+    pipeline_block * block = nullptr;
+    if( !this->read_since_seek )
+    {
+      this->read_since_seek = true;
+
+      // synchronously, see pipeline_first_read_size
+      this->first.size = read_block(this->source, this->first.data);
+      this->at_end = this->first.size < this->first.data.size();
+      this->current_is_first = true;
+      block = &this->first;
+    }
+    else
+    {
+      if( !this->reader.joinable() )
+        this->start_reader();
+
+      if( !this->full.pop(this->current, this->stop) )
+        return traits_type::eof();
+
+      // the reader stops after the first short block
+      this->at_end = this->current.size < this->current.data.size();
+      block = &this->current;
+    }
+
+    if( block->size == 0 )
+      return traits_type::eof();
+
+    this->setg(block->data.data(), block->data.data(), block->data.data() + block->size);
+    return traits_type::to_int_type(*this->gptr());
+  }
+
+  pos_type seekoff(
+    off_type off,
+    std::ios_base::seekdir dir,
+    std::ios_base::openmode which
+  ) override
+  {
+    const off_type position =
+      this->block_position + static_cast<off_type>(this->gptr() - this->eback());
+
+    // tellg
+    if( dir == std::ios_base::cur && off == 0 )
+      return pos_type(position);
+
+    if( dir == std::ios_base::cur )
+      return this->seekpos(pos_type(position + off), which);
+
+    this->restart();
+    return this->moved(this->source->pubseekoff(off, dir, which));
+  }
+
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+  {
+    this->restart();
+    return this->moved(this->source->pubseekpos(pos, which));
+  }
+
+private:
+  /// Fill data from source. Returns the number of bytes read, less than
+  /// data.size() only at the end of source.
+  static size_t read_block(std::streambuf * source, std::vector<char>& data)
+  {
+    const std::streamsize count = source->sgetn(
+      data.data(),
+      static_cast<std::streamsize>(data.size())
+    );
+
+    return count > 0 ? static_cast<size_t>(count) : 0;
+  }
+
+  void start_reader()
+  {
+    this->stop.store(false, std::memory_order_release);
+
+    for(size_t i = 0; i < sp::pipeline_block_count; ++i)
+    {
+      pipeline_block block;
+      block.data.resize(sp::pipeline_block_size);
+      this->free.try_push(block);
+    }
+
+    this->reader = std::thread(&read_ahead_istreambuf::read_loop, this);
+  }
+
+  void read_loop()
+  {
+    pipeline_block block;
+    while( this->free.pop(block, this->stop) )
+    {
+      block.size = read_block(this->source, block.data);
+      const bool last = block.size < block.data.size();
+
+      if( !this->full.push(block, this->stop) || last )
+        return;
+    }
+  }
+
+  /// Stop and join the reader thread and drop all blocks.
+  void stop_reader()
+  {
+    if( !this->reader.joinable() )
+      return;
+
+    this->stop.store(true, std::memory_order_release);
+    this->reader.join();
+
+    pipeline_block block;
+    while( this->full.try_pop(block) )
+      ;
+    while( this->free.try_pop(block) )
+      ;
+    this->current = pipeline_block();
+  }
+
+  /// Hand the current block back to the reader thread.
+  void release_current()
+  {
+    if( this->current_is_first )
+      this->current_is_first = false;
+    else if( !this->current.data.empty() )
+      this->free.try_push(this->current);
+  }
+
+  /// Prepare for a seek of the source.
+  void restart()
+  {
+    this->stop_reader();
+    this->setg(nullptr, nullptr, nullptr);
+    this->current_is_first = false;
+    this->at_end = false;
+    this->read_since_seek = false;
+  }
+
+  pos_type moved(pos_type pos)
+  {
+    if( pos != pos_type(off_type(-1)) )
+      this->block_position = off_type(pos);
+
+    return pos;
+  }
+
+  std::streambuf * source;
+
+  // the block of the synchronous first read
+  pipeline_block first;
+
+  // the block of the reader thread the consumer is reading
+  pipeline_block current;
+  bool current_is_first;
+
+  // reader thread to consumer
+  sp::spsc_queue<pipeline_block> full;
+
+  // consumer to reader thread
+  sp::spsc_queue<pipeline_block> free;
+
+  std::atomic<bool> stop;
+  std::thread reader;
+
+  bool at_end;
+  bool read_since_seek;
+
+  // the position of eback() in source
+  off_type block_position;
+};
+
+
+/// A streambuf that writes to another streambuf in a separate thread,
+/// behind the producer.
+///
+/// Full blocks go to the writer thread through a bounded queue, which hands
+/// them back once written. Flushing (sync) waits until all blocks are
+/// written. Seeking flushes and seeks the target.
+class write_behind_ostreambuf : public std::streambuf
+{
+public:
+  explicit write_behind_ostreambuf(std::streambuf * output)
+  : target(output),
+    current(),
+    full(sp::pipeline_block_count),
+    free(sp::pipeline_block_count),
+    pending(0),
+    failed(false),
+    stop(false),
+    writer()
+  {
+    for(size_t i = 1; i < sp::pipeline_block_count; ++i)
+    {
+      pipeline_block block;
+      block.data.resize(sp::pipeline_block_size);
+      this->free.try_push(block);
+    }
+
+    this->current.data.resize(sp::pipeline_block_size);
+    this->reset_put_area();
+
+    this->writer = std::thread(&write_behind_ostreambuf::write_loop, this);
+  }
+
+  write_behind_ostreambuf(const write_behind_ostreambuf&) = delete;
+  write_behind_ostreambuf& operator=(const write_behind_ostreambuf&) = delete;
+
+  ~write_behind_ostreambuf()
+  {
+    this->sync();
+    this->stop.store(true, std::memory_order_release);
+    this->writer.join();
+  }
+
+protected:
+  int_type overflow(int_type c) override
+  {
+    if( !this->hand_off() )
+      return traits_type::eof();
+
+    if( !traits_type::eq_int_type(c, traits_type::eof()) )
+    {
+      *this->pptr() = traits_type::to_char_type(c);
+      this->pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+  }
+
+  int sync() override
+  {
+    if( this->pptr() > this->pbase() && !this->hand_off() )
+      return -1;
+
+    sp::backoff b;
+    while( this->pending.load(std::memory_order_acquire) > 0 )
+      b.wait();
+
+    if( this->failed.load(std::memory_order_acquire) )
+      return -1;
+
+    return this->target->pubsync();
+  }
+
+  pos_type seekoff(
+    off_type off,
+    std::ios_base::seekdir dir,
+    std::ios_base::openmode which
+  ) override
+  {
+    if( this->sync() != 0 )
+      return pos_type(off_type(-1));
+
+    return this->target->pubseekoff(off, dir, which);
+  }
+
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+  {
+    if( this->sync() != 0 )
+      return pos_type(off_type(-1));
+
+    return this->target->pubseekpos(pos, which);
+  }
+
+private:
+  void reset_put_area()
+  {
+    this->setp(this->current.data.data(), this->current.data.data() + this->current.data.size());
+  }
+
+  /// Hand the current block to the writer thread and continue with a free
+  /// one. Returns false if writing failed.
+  bool hand_off()
+  {
+    if( this->failed.load(std::memory_order_acquire) )
+      return false;
+
+    this->current.size = static_cast<size_t>(this->pptr() - this->pbase());
+    this->pending.fetch_add(1, std::memory_order_acq_rel);
+
+    // the writer thread runs until destruction, the queues never cancel
+    this->full.push(this->current, this->stop);
+    this->free.pop(this->current, this->stop);
+    this->reset_put_area();
+
+    return true;
+  }
+
+  void write_loop()
+  {
+    pipeline_block block;
+    for(;;)
+    {
+      sp::backoff b;
+      while( !this->full.try_pop(block) )
+      {
+        // the destructor flushes before it stops the thread
+        if( this->stop.load(std::memory_order_acquire) )
+          return;
+        b.wait();
+      }
+
+      const std::streamsize size = static_cast<std::streamsize>(block.size);
+      if( this->target->sputn(block.data.data(), size) != size )
+        this->failed.store(true, std::memory_order_release);
+
+      this->free.try_push(block);
+      this->pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+  }
+
+  std::streambuf * target;
+
+  // the block the producer is filling
+  pipeline_block current;
+
+  // producer to writer thread
+  sp::spsc_queue<pipeline_block> full;
+
+  // writer thread to producer
+  sp::spsc_queue<pipeline_block> free;
+
+  // blocks handed off but not yet written
+  std::atomic<size_t> pending;
+  std::atomic<bool> failed;
+
+  std::atomic<bool> stop;
+  std::thread writer;
+};
+
+
+}
+
+#endif // SP_PIPELINE_STREAMBUF_H
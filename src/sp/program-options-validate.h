@@ -3,11 +3,15 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
 
 #include <boost/program_options.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/any.hpp>
 
+#include "hm/common.h"
+#include "hm/dispatch.h"
+
 namespace sp {
 
 /// Dummy struct for parameter entity-size.
@@ -15,6 +19,9 @@ namespace sp {
 /// function.
 struct pov_entity_size
 {
+  /// The entity size for "auto": select the entity size by trial encoding.
+  static const unsigned int automatic = 0;
+
   explicit pov_entity_size(unsigned int size)
   : entity_size(size)
   {
@@ -37,6 +44,12 @@ void validate(
   po::validators::check_first_occurrence(v);
   const std::string& s = po::validators::get_single_string(values);
 
+  if( s == "auto" )
+  {
+    v = boost::any(sp::pov_entity_size(sp::pov_entity_size::automatic));
+    return;
+  }
+
   unsigned int size = 0;
   try
   {
@@ -47,21 +60,186 @@ void validate(
     size = 0;
   }
 
-  switch( size )
+  if( size < 1 || size > hm::max_entity_size )
+    throw po::validation_error(po::validation_error::invalid_option_value);
+
+  v = boost::any(sp::pov_entity_size(size));
+}
+
+
+/// Dummy struct for parameter filter.
+struct pov_filter
+{
+  explicit pov_filter(hm::meta::filter_type f)
+  : filter(f)
   {
-    case 1:
-    case 2:
-    case 4:
-    case 8:
-      break;
-    default:
-      throw po::validation_error(po::validation_error::invalid_option_value);
   }
 
-  v = boost::any(sp::pov_entity_size(size));
+  hm::meta::filter_type filter;
+};
+
+
+/// Validate pov_filter or throw validation_error.
+void validate(
+  boost::any& v,
+  const std::vector<std::string>& values,
+  sp::pov_filter *,
+  int
+)
+{
+  namespace po = boost::program_options;
+
+  po::validators::check_first_occurrence(v);
+  const std::string& s = po::validators::get_single_string(values);
+
+  if( s == "none" )
+    v = boost::any(sp::pov_filter(hm::filter_none));
+  else if( s == "delta" )
+    v = boost::any(sp::pov_filter(hm::filter_delta));
+  else if( s == "delta-delta" )
+    v = boost::any(sp::pov_filter(hm::filter_delta_delta));
+  else if( s == "xor" )
+    v = boost::any(sp::pov_filter(hm::filter_xor));
+  else
+    throw po::validation_error(po::validation_error::invalid_option_value);
 }
 
 
+
+/// Dummy struct for parameter io.
+struct pov_io
+{
+  enum backend
+  {
+    // std::ifstream and std::ofstream
+    stream,
+
+    // io_uring, or pread and pwrite where io_uring is unavailable
+    uring
+  };
+
+  explicit pov_io(backend b)
+  : io(b)
+  {
+  }
+
+  backend io;
+};
+
+
+/// Validate pov_io or throw validation_error.
+void validate(
+  boost::any& v,
+  const std::vector<std::string>& values,
+  sp::pov_io *,
+  int
+)
+{
+  namespace po = boost::program_options;
+
+  po::validators::check_first_occurrence(v);
+  const std::string& s = po::validators::get_single_string(values);
+
+  if( s == "stream" )
+    v = boost::any(sp::pov_io(sp::pov_io::stream));
+  else if( s == "uring" )
+    v = boost::any(sp::pov_io(sp::pov_io::uring));
+  else
+    throw po::validation_error(po::validation_error::invalid_option_value);
+}
+
+
+/// Dummy struct for parameter histogram.
+struct pov_histogram
+{
+  enum engine
+  {
+    // hm::symbol_index, a hash table lookup per entity
+    hash,
+
+    // hm::radix_counter, sorting blocks of entities on all hardware threads
+    radix
+  };
+
+  explicit pov_histogram(engine e)
+  : histogram(e)
+  {
+  }
+
+  engine histogram;
+};
+
+
+/// Validate pov_histogram or throw validation_error.
+void validate(
+  boost::any& v,
+  const std::vector<std::string>& values,
+  sp::pov_histogram *,
+  int
+)
+{
+  namespace po = boost::program_options;
+
+  po::validators::check_first_occurrence(v);
+  const std::string& s = po::validators::get_single_string(values);
+
+  if( s == "hash" )
+    v = boost::any(sp::pov_histogram(sp::pov_histogram::hash));
+  else if( s == "radix" )
+    v = boost::any(sp::pov_histogram(sp::pov_histogram::radix));
+  else
+    throw po::validation_error(po::validation_error::invalid_option_value);
+}
+
+
+/// Dummy struct for parameter range.
+struct pov_range
+{
+  pov_range(uint64_t first, uint64_t entity_count)
+  : start(first),
+    count(entity_count)
+  {
+  }
+
+  uint64_t start;
+  uint64_t count;
+};
+
+
+/// Validate pov_range ("start:count") or throw validation_error.
+void validate(
+  boost::any& v,
+  const std::vector<std::string>& values,
+  sp::pov_range *,
+  int
+)
+{
+  namespace po = boost::program_options;
+
+  po::validators::check_first_occurrence(v);
+  const std::string& s = po::validators::get_single_string(values);
+
+  const auto colon = s.find(':');
+  if( colon == std::string::npos )
+    throw po::validation_error(po::validation_error::invalid_option_value);
+
+  try
+  {
+    // lexical_cast accepts a leading minus for unsigned types
+    if( s.find('-') != std::string::npos )
+      throw po::validation_error(po::validation_error::invalid_option_value);
+
+    v = boost::any(sp::pov_range(
+      boost::lexical_cast<uint64_t>(s.substr(0, colon)),
+      boost::lexical_cast<uint64_t>(s.substr(colon + 1))
+    ));
+  }
+  catch(const boost::bad_lexical_cast&)
+  {
+    throw po::validation_error(po::validation_error::invalid_option_value);
+  }
+}
+
 }
 
 #endif // SP_PROGRAM_OPTIONS_VALIDATE_H
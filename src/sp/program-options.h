@@ -2,6 +2,7 @@
 #define SP_PROGRAM_OPTIONS_H
 
 #include <string>
+#include <vector>
 #include <boost/program_options.hpp>
 
 #include "sp/program-options-validate.h"
@@ -28,7 +29,94 @@ public:
         po::value<sp::pov_entity_size>()->default_value(sp::pov_entity_size(1), "1"),
           "When encoding, interpret input in blocks of this size in bytes. "
           "Input file size must be a multiple of this size. Possible values: "
-          "1, 2, 4, 8")
+          "1 to 16, or auto to pick the best of 1, 2, 4 and 8 by trial "
+          "encoding a sample of the input")
+      ("filter,f",
+        po::value<sp::pov_filter>()->default_value(sp::pov_filter(hm::filter_none), "none"),
+          "When encoding, transform each entity relative to its predecessors "
+          "before huffman coding. Useful for numeric series. Possible values: "
+          "none, delta, delta-delta, xor. delta and delta-delta store zigzag "
+          "encoded differences. Requires an entity-size of 1, 2, 4 or 8.")
+      ("shuffle",
+          "When encoding, split the input into one lane per byte of an entity "
+          "and huffman code each lane separately with 1 byte entities. "
+          "Useful for numeric entities of 4 or 8 bytes. The input is buffered "
+          "in memory.")
+      ("rle",
+          "When encoding, run-length encode the input before huffman coding "
+          "(each lane separately with --shuffle). The input is buffered in "
+          "memory.")
+      ("index",
+        po::value<uint32_t>(),
+          "When encoding, write a seek index with an entry for every n-th "
+          "entity, which allows decoding ranges with --range. Cannot be "
+          "combined with --filter, --shuffle or --rle.")
+      ("range",
+        po::value<sp::pov_range>(),
+          "When decoding, only decode count entities starting at entity "
+          "start (start:count). Requires an input encoded with --index, or "
+          "stored as is.")
+      ("checksum",
+          "When encoding, store the CRC32C of the input, which is verified "
+          "when decoding.")
+      ("histogram",
+        po::value<sp::pov_histogram>()->default_value(sp::pov_histogram(sp::pov_histogram::hash), "hash"),
+          "When encoding, how to count entities of 4 or 8 bytes. Possible "
+          "values: hash (a hash table lookup per entity), radix (radix sort "
+          "blocks of the input on all hardware threads and count the runs of "
+          "equal entities; faster with millions of distinct entities). Other "
+          "entity sizes and --shuffle are unaffected.")
+      ("sample",
+        po::value<uint32_t>(),
+          "When encoding, build the huffman tree from n MiB of the input, "
+          "read as blocks of 1 MiB at random offsets, instead of from all of "
+          "it. The input is then coded in a single pass, entities missing "
+          "from the sample as an escape code followed by the entity. Useful "
+          "for very large files, at a small loss of ratio. Cannot be combined "
+          "with --filter, --shuffle, --rle or --histogram radix.")
+      ("estimate",
+          "When encoding, only build the frequency table and report the "
+          "predicted output size, the entropy and the code lengths instead of "
+          "writing output-file. Cannot be combined with --shuffle.")
+      ("pipeline",
+          "Read ahead and write behind in separate threads, overlapping the "
+          "file I/O with huffman coding. Useful for large files.")
+      ("io",
+        po::value<sp::pov_io>()->default_value(sp::pov_io(sp::pov_io::stream), "stream"),
+          "How to read and write files. Possible values: stream (iostreams; "
+          "without --pipeline, decoding preallocates the output file and "
+          "writes it through a memory mapping), uring (io_uring with several "
+          "large reads and writes in flight, falls back to pread and pwrite "
+          "where io_uring is unavailable).")
+      ("batch",
+          "Encode or decode many files: encode-file or decode-file is a "
+          "directory (all of its files when encoding, its .hm files when "
+          "decoding) or a file listing one path per line. Each output is "
+          "written alongside its input, with .hm appended when encoding and "
+          "removed when decoding. Cannot be combined with output-file, "
+          "--range, --pipeline or --stats.")
+      ("archive",
+          "When encoding, pack the files of a directory or list file (see "
+          "--batch) into the single archive output-file. When decoding, "
+          "extract the members of the archive decode-file into the existing "
+          "directory output-file. Cannot be combined with --batch, --range, "
+          "--pipeline or --stats.")
+      ("member",
+        po::value<std::vector<std::string>>(),
+          "With --archive, only extract the member of this name. May be "
+          "repeated.")
+      ("list",
+          "With --archive, list the members of decode-file instead of "
+          "extracting them.")
+      ("jobs,j",
+        po::value<uint32_t>(),
+          "With --batch or --archive, the number of files coded "
+          "concurrently. Defaults to the number of hardware threads.")
+      ("stats",
+          "Print the wall and CPU time of each phase, the sizes, the "
+          "throughput and the peak memory usage after encoding or decoding.")
+      ("stats-json",
+          "Like --stats, but print a single JSON object.")
       ("output-file,o", po::value<std::string>(), "Output file. Must not exist.")
     ;
 
@@ -41,12 +129,31 @@ public:
     return this->vm.count(key);
   }
 
+  /// Returns sp::pov_entity_size::automatic if entity-size is auto.
   unsigned int get_entity_size() const
   {
     // vm[entity-size] will always be filled, since it has a default value
     return this->vm["entity-size"].as<sp::pov_entity_size>().entity_size;
   }
 
+  hm::meta::filter_type get_filter() const
+  {
+    // vm[filter] will always be filled, since it has a default value
+    return this->vm["filter"].as<sp::pov_filter>().filter;
+  }
+
+  sp::pov_io::backend get_io() const
+  {
+    // vm[io] will always be filled, since it has a default value
+    return this->vm["io"].as<sp::pov_io>().io;
+  }
+
+  sp::pov_histogram::engine get_histogram() const
+  {
+    // vm[histogram] will always be filled, since it has a default value
+    return this->vm["histogram"].as<sp::pov_histogram>().histogram;
+  }
+
   template<typename value_type>
   value_type get(const char * key) const
   {
@@ -56,8 +163,12 @@ public:
   void print(const char * program_name, std::ostream& out = std::cout) const
   {
     out << "Usage:\n"
-        << "  Encode: " << program_name << " -e input-file -o output-file [-s 1|2|4|8]\n"
-        << "  Decode: " << program_name << " -d input-file -o output-file\n\n";
+        << "  Encode: " << program_name << " -e input-file -o output-file [-s 1..16|auto] [-f filter] [--shuffle] [--rle] [--checksum] [--index n] [--histogram engine] [--sample n] [--pipeline] [--io backend] [--stats|--stats-json]\n"
+        << "  Decode: " << program_name << " -d input-file -o output-file [--range start:count] [--pipeline] [--io backend] [--stats|--stats-json]\n"
+        << "  Batch:  " << program_name << " -e|-d directory-or-list-file --batch [-j jobs] [encode or decode options]\n"
+        << "  Pack:   " << program_name << " -e directory-or-list-file --archive -o archive-file [-j jobs] [encode options]\n"
+        << "  Unpack: " << program_name << " -d archive-file --archive -o directory [--member name]... [-j jobs] | --list\n"
+        << "  Report: " << program_name << " -e input-file --estimate [-s 1..16|auto] [-f filter] [--rle]\n\n";
     out << this->desc;
   }
 
@@ -75,6 +186,40 @@ public:
       return false;
     }
 
+    if( !this->contains("output-file")
+        && !this->contains("estimate")
+        && !this->contains("batch")
+        && !this->contains("list") )
+    {
+      out << "Error: Expecting output-file\n";
+      return false;
+    }
+
+    if( this->contains("decode-file") && this->contains("estimate") )
+    {
+      out << "Error: estimate may only be supplied when encoding\n";
+      return false;
+    }
+
+    if( this->contains("estimate")
+        && (this->contains("stats") || this->contains("stats-json")) )
+    {
+      out << "Error: estimate cannot be combined with stats\n";
+      return false;
+    }
+
+    if( this->contains("estimate") && this->contains("pipeline") )
+    {
+      out << "Error: estimate cannot be combined with pipeline\n";
+      return false;
+    }
+
+    if( this->contains("estimate") && this->contains("shuffle") )
+    {
+      out << "Error: estimate cannot be combined with shuffle\n";
+      return false;
+    }
+
     if( this->contains("decode-file")
         && this->contains("entity-size")
         && !this->vm["entity-size"].defaulted() )
@@ -83,6 +228,177 @@ public:
       return false;
     }
 
+    if( this->contains("decode-file")
+        && this->contains("filter")
+        && !this->vm["filter"].defaulted() )
+    {
+      out << "Error: filter may only be supplied when encoding\n";
+      return false;
+    }
+
+    if( this->contains("encode-file")
+        && this->get_filter() != hm::filter_none )
+    {
+      switch( this->get_entity_size() )
+      {
+        case sp::pov_entity_size::automatic:
+        case 1:
+        case 2:
+        case 4:
+        case 8:
+          break;
+        default:
+          out << "Error: filter requires an entity-size of 1, 2, 4 or 8\n";
+          return false;
+      }
+    }
+
+    if( this->contains("decode-file")
+        && this->contains("histogram")
+        && !this->vm["histogram"].defaulted() )
+    {
+      out << "Error: histogram may only be supplied when encoding\n";
+      return false;
+    }
+
+    if( this->contains("sample") )
+    {
+      if( this->contains("decode-file") )
+      {
+        out << "Error: sample may only be supplied when encoding\n";
+        return false;
+      }
+
+      if( this->get<uint32_t>("sample") == 0 )
+      {
+        out << "Error: sample must be greater than 0\n";
+        return false;
+      }
+
+      if( this->contains("rle")
+          || this->contains("shuffle")
+          || this->get_filter() != hm::filter_none
+          || this->get_histogram() == sp::pov_histogram::radix )
+      {
+        out << "Error: sample cannot be combined with filter, shuffle, rle or histogram radix\n";
+        return false;
+      }
+    }
+
+    if( this->contains("decode-file") && this->contains("rle") )
+    {
+      out << "Error: rle may only be supplied when encoding\n";
+      return false;
+    }
+
+    if( this->contains("decode-file") && this->contains("index") )
+    {
+      out << "Error: index may only be supplied when encoding\n";
+      return false;
+    }
+
+    if( this->contains("encode-file") && this->contains("range") )
+    {
+      out << "Error: range may only be supplied when decoding\n";
+      return false;
+    }
+
+    if( this->contains("index") )
+    {
+      if( this->get<uint32_t>("index") == 0 )
+      {
+        out << "Error: index must be greater than 0\n";
+        return false;
+      }
+
+      if( this->contains("rle")
+          || this->contains("shuffle")
+          || this->get_filter() != hm::filter_none )
+      {
+        out << "Error: index cannot be combined with filter, shuffle or rle\n";
+        return false;
+      }
+    }
+
+    if( this->contains("batch") )
+    {
+      if( this->contains("output-file") )
+      {
+        out << "Error: batch writes the outputs alongside the inputs, output-file cannot be supplied\n";
+        return false;
+      }
+
+      if( this->contains("estimate")
+          || this->contains("range")
+          || this->contains("pipeline")
+          || this->contains("stats")
+          || this->contains("stats-json") )
+      {
+        out << "Error: batch cannot be combined with estimate, range, pipeline or stats\n";
+        return false;
+      }
+    }
+
+    if( this->contains("archive") )
+    {
+      if( this->contains("batch") )
+      {
+        out << "Error: archive cannot be combined with batch\n";
+        return false;
+      }
+
+      if( this->contains("estimate")
+          || this->contains("range")
+          || this->contains("pipeline")
+          || this->contains("stats")
+          || this->contains("stats-json") )
+      {
+        out << "Error: archive cannot be combined with estimate, range, pipeline or stats\n";
+        return false;
+      }
+    }
+
+    if( (this->contains("member") || this->contains("list"))
+        && !(this->contains("archive") && this->contains("decode-file")) )
+    {
+      out << "Error: member and list require archive and decode-file\n";
+      return false;
+    }
+
+    if( this->contains("list")
+        && (this->contains("member") || this->contains("output-file")) )
+    {
+      out << "Error: list cannot be combined with member or output-file\n";
+      return false;
+    }
+
+    if( this->contains("jobs") )
+    {
+      if( !this->contains("batch") && !this->contains("archive") )
+      {
+        out << "Error: jobs requires batch or archive\n";
+        return false;
+      }
+
+      if( this->get<uint32_t>("jobs") == 0 )
+      {
+        out << "Error: jobs must be greater than 0\n";
+        return false;
+      }
+    }
+
+    if( this->contains("decode-file") && this->contains("checksum") )
+    {
+      out << "Error: checksum may only be supplied when encoding\n";
+      return false;
+    }
+
+    if( this->contains("decode-file") && this->contains("shuffle") )
+    {
+      out << "Error: shuffle may only be supplied when encoding\n";
+      return false;
+    }
+
     return true;
   }
 
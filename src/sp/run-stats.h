@@ -0,0 +1,208 @@
+#ifndef SP_RUN_STATS_H
+#define SP_RUN_STATS_H
+
+#include <cstdint>
+#include <ctime>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <iomanip>
+
+#include <sys/resource.h>
+
+
+namespace sp {
+
+/// Return the peak resident set size of the process in bytes, or 0 if it is
+/// unknown.
+inline uint64_t peak_rss_bytes()
+{
+  struct rusage usage;
+  if( getrusage(RUSAGE_SELF, &usage) != 0 || usage.ru_maxrss < 0 )
+    return 0;
+
+#ifdef __APPLE__
+  // bytes on macOS
+  return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+  // kilobytes on linux and the BSDs
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024U;
+#endif
+}
+
+
+/// Collects the wall and CPU time of the phases of an encode or decode run,
+/// and its totals, for --stats and --stats-json.
+///
+/// Phases are measured back to back: starting a phase ends the running one.
+class run_stats
+{
+public:
+  /// The time spent in a phase.
+  struct phase
+  {
+    std::string name;
+    double wall_seconds;
+    double cpu_seconds;
+  };
+
+  run_stats()
+  : operation(),
+    entity_size(0),
+    bytes_in(0),
+    bytes_out(0),
+    entity_count(0),
+    distinct_entity_count(0),
+    phases(),
+    running_name(),
+    running(false),
+    run_wall_begin(clock_type::now()),
+    run_cpu_begin(std::clock()),
+    phase_wall_begin(run_wall_begin),
+    phase_cpu_begin(run_cpu_begin)
+  {
+  }
+
+  /// Start the phase name. Ends the running phase, if any.
+  /// Starting a phase that was measured before adds to its time.
+  void start(const char * name)
+  {
+    this->stop();
+
+    this->running = true;
+    this->running_name = name;
+    this->phase_wall_begin = clock_type::now();
+    this->phase_cpu_begin = std::clock();
+  }
+
+  /// End the running phase, if any.
+  void stop()
+  {
+    if( !this->running )
+      return;
+
+    this->running = false;
+
+    const double wall = seconds_since(this->phase_wall_begin);
+    const double cpu = cpu_seconds_since(this->phase_cpu_begin);
+
+    for(auto& p : this->phases)
+    {
+      if( p.name == this->running_name )
+      {
+        p.wall_seconds += wall;
+        p.cpu_seconds += cpu;
+        return;
+      }
+    }
+
+    this->phases.push_back(phase{this->running_name, wall, cpu});
+  }
+
+  /// Print the statistics in human readable form. Ends the running phase.
+  void print(std::ostream& out)
+  {
+    this->stop();
+    const double wall = seconds_since(this->run_wall_begin);
+    const double cpu = cpu_seconds_since(this->run_cpu_begin);
+
+    out << this->operation << " statistics:\n"
+        << "  entity size:       " << static_cast<unsigned int>(this->entity_size) << " bytes\n"
+        << "  bytes in:          " << this->bytes_in << "\n"
+        << "  bytes out:         " << this->bytes_out << "\n"
+        << "  entities:          " << this->entity_count << "\n"
+        << "  distinct entities: " << this->distinct_entity_count << "\n"
+        << "  wall time:         " << wall << " s\n"
+        << "  cpu time:          " << cpu << " s\n"
+        << "  throughput:        " << this->megabytes_per_second(wall) << " MB/s\n"
+        << "  peak rss:          " << sp::peak_rss_bytes() << " bytes\n"
+        << "  phases (wall s, cpu s):\n";
+
+    for(const auto& p : this->phases)
+    {
+      out << "    " << std::left << std::setw(12) << (p.name + ":") << std::right
+          << " " << p.wall_seconds << ", " << p.cpu_seconds << "\n";
+    }
+  }
+
+  /// Print the statistics as a single JSON object. Ends the running phase.
+  void print_json(std::ostream& out)
+  {
+    this->stop();
+    const double wall = seconds_since(this->run_wall_begin);
+    const double cpu = cpu_seconds_since(this->run_cpu_begin);
+
+    // names are fixed identifiers, they need no escaping
+    out << "{\"operation\":\"" << this->operation << "\""
+        << ",\"entity_size\":" << static_cast<unsigned int>(this->entity_size)
+        << ",\"bytes_in\":" << this->bytes_in
+        << ",\"bytes_out\":" << this->bytes_out
+        << ",\"entities\":" << this->entity_count
+        << ",\"distinct_entities\":" << this->distinct_entity_count
+        << ",\"wall_seconds\":" << wall
+        << ",\"cpu_seconds\":" << cpu
+        << ",\"megabytes_per_second\":" << this->megabytes_per_second(wall)
+        << ",\"peak_rss_bytes\":" << sp::peak_rss_bytes()
+        << ",\"phases\":[";
+
+    for(size_t i = 0; i < this->phases.size(); ++i)
+    {
+      const auto& p = this->phases[i];
+      out << (i ? "," : "")
+          << "{\"name\":\"" << p.name << "\""
+          << ",\"wall_seconds\":" << p.wall_seconds
+          << ",\"cpu_seconds\":" << p.cpu_seconds << "}";
+    }
+
+    out << "]}\n";
+  }
+
+  // "encode" or "decode"
+  std::string operation;
+
+  unsigned int entity_size;
+
+  // The size of the input file and of the output file
+  uint64_t bytes_in;
+  uint64_t bytes_out;
+
+  // The number of coded entities and the number of distinct entities (the
+  // leaves of the huffman tree)
+  uint64_t entity_count;
+  uint64_t distinct_entity_count;
+
+private:
+  typedef std::chrono::steady_clock clock_type;
+
+  static double seconds_since(clock_type::time_point begin)
+  {
+    return std::chrono::duration<double>(clock_type::now() - begin).count();
+  }
+
+  static double cpu_seconds_since(std::clock_t begin)
+  {
+    return static_cast<double>(std::clock() - begin) / CLOCKS_PER_SEC;
+  }
+
+  /// The throughput of the uncompressed side in 10^6 bytes per second.
+  double megabytes_per_second(double wall) const
+  {
+    const uint64_t bytes = this->operation == "decode" ? this->bytes_out : this->bytes_in;
+    return wall > 0 ? static_cast<double>(bytes) / wall / 1e6 : 0;
+  }
+
+  std::vector<phase> phases;
+  std::string running_name;
+  bool running;
+
+  clock_type::time_point run_wall_begin;
+  std::clock_t run_cpu_begin;
+  clock_type::time_point phase_wall_begin;
+  std::clock_t phase_cpu_begin;
+};
+
+
+}
+
+#endif // SP_RUN_STATS_H
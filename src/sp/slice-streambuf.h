@@ -0,0 +1,118 @@
+#ifndef SP_SLICE_STREAMBUF_H
+#define SP_SLICE_STREAMBUF_H
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <streambuf>
+#include <vector>
+#include <ios>
+
+
+namespace sp {
+
+/// The size of the blocks a slice_istreambuf reads from its source.
+const size_t slice_block_size = 64 * 1024;
+
+
+/// A streambuf that reads byte_count bytes at offset of a seekable streambuf
+/// as if they were a whole file: positions are relative to offset and the
+/// end is at byte_count, e.g. to decode a member of an archive in place.
+class slice_istreambuf : public std::streambuf
+{
+public:
+  /// Parameters:
+  ///   input:
+  ///     A seekable streambuf, which must outlive the slice.
+  ///   first, slice_byte_count:
+  ///     The bytes of input to read.
+  slice_istreambuf(std::streambuf * input, uint64_t first, uint64_t slice_byte_count)
+  : source(input),
+    offset(first),
+    byte_count(slice_byte_count),
+    buffer(sp::slice_block_size),
+    buffer_end(0),
+    source_positioned(false)
+  {
+    this->setg(this->buffer.data(), this->buffer.data(), this->buffer.data());
+  }
+
+  slice_istreambuf(const slice_istreambuf&) = delete;
+  slice_istreambuf& operator=(const slice_istreambuf&) = delete;
+
+protected:
+  int_type underflow() override
+  {
+    if( this->buffer_end >= this->byte_count )
+      return traits_type::eof();
+
+    // reads continue where the previous one stopped, seek the source only
+    // after the slice was seeked
+    if( !this->source_positioned )
+    {
+      const auto target = static_cast<off_type>(this->offset + this->buffer_end);
+      if( this->source->pubseekpos(pos_type(target), std::ios_base::in) != pos_type(target) )
+        return traits_type::eof();
+      this->source_positioned = true;
+    }
+
+    const std::streamsize count = this->source->sgetn(
+      this->buffer.data(),
+      static_cast<std::streamsize>(
+        std::min<uint64_t>(this->buffer.size(), this->byte_count - this->buffer_end)
+      )
+    );
+
+    if( count <= 0 )
+      return traits_type::eof();
+
+    this->buffer_end += static_cast<uint64_t>(count);
+    this->setg(this->buffer.data(), this->buffer.data(), this->buffer.data() + count);
+    return traits_type::to_int_type(*this->gptr());
+  }
+
+  pos_type seekoff(
+    off_type off,
+    std::ios_base::seekdir dir,
+    std::ios_base::openmode which
+  ) override
+  {
+    off_type target = off;
+    if( dir == std::ios_base::cur )
+      target += static_cast<off_type>(this->buffer_end) - (this->egptr() - this->gptr());
+    else if( dir == std::ios_base::end )
+      target += static_cast<off_type>(this->byte_count);
+
+    return this->seekpos(pos_type(target), which);
+  }
+
+  pos_type seekpos(pos_type pos, std::ios_base::openmode /* which */) override
+  {
+    if( off_type(pos) < 0 || static_cast<uint64_t>(off_type(pos)) > this->byte_count )
+      return pos_type(off_type(-1));
+
+    this->buffer_end = static_cast<uint64_t>(off_type(pos));
+    this->source_positioned = false;
+    this->setg(this->buffer.data(), this->buffer.data(), this->buffer.data());
+
+    return pos;
+  }
+
+private:
+  std::streambuf * source;
+  uint64_t offset;
+  uint64_t byte_count;
+
+  std::vector<char> buffer;
+
+  // the position in the slice of egptr()
+  uint64_t buffer_end;
+
+  // whether the source is at offset + buffer_end
+  bool source_positioned;
+};
+
+
+}
+
+#endif // SP_SLICE_STREAMBUF_H
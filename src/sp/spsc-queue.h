@@ -0,0 +1,130 @@
+#ifndef SP_SPSC_QUEUE_H
+#define SP_SPSC_QUEUE_H
+
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <utility>
+
+
+namespace sp {
+
+/// Waits for another thread: spins briefly, then yields, then sleeps, so a
+/// thread that waits long (e.g. the reader while the coder is busy) does not
+/// burn a core.
+class backoff
+{
+public:
+  backoff()
+  : rounds(0)
+  {
+  }
+
+  void wait()
+  {
+    if( this->rounds >= 128 )
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    else if( this->rounds >= 64 )
+      std::this_thread::yield();
+
+    if( this->rounds < 128 )
+      ++this->rounds;
+  }
+
+private:
+  unsigned int rounds;
+};
+
+
+/// A bounded, lock-free queue for exactly one producer thread and one
+/// consumer thread.
+///
+/// A ring buffer with one unused slot to tell full from empty. The producer
+/// only writes tail, the consumer only writes head.
+template<typename value_type>
+class spsc_queue
+{
+public:
+  explicit spsc_queue(size_t capacity)
+  : slots(capacity + 1),
+    head(0),
+    tail(0)
+  {
+  }
+
+  spsc_queue(const spsc_queue&) = delete;
+  spsc_queue& operator=(const spsc_queue&) = delete;
+
+  /// Producer: append value unless the queue is full.
+  /// Returns false if the queue is full, value is left untouched.
+  bool try_push(value_type& value)
+  {
+    const size_t t = this->tail.load(std::memory_order_relaxed);
+    const size_t next = (t + 1) % this->slots.size();
+    if( next == this->head.load(std::memory_order_acquire) )
+      return false;
+
+    this->slots[t] = std::move(value);
+    this->tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /// Consumer: remove the oldest value unless the queue is empty.
+  /// Returns false if the queue is empty.
+  bool try_pop(value_type& value)
+  {
+    const size_t h = this->head.load(std::memory_order_relaxed);
+    if( h == this->tail.load(std::memory_order_acquire) )
+      return false;
+
+    value = std::move(this->slots[h]);
+    this->head.store((h + 1) % this->slots.size(), std::memory_order_release);
+    return true;
+  }
+
+  /// Producer: append value, waiting while the queue is full.
+  /// Gives up and returns false once cancel is set.
+  bool push(value_type& value, const std::atomic<bool>& cancel)
+  {
+    sp::backoff b;
+    while( !this->try_push(value) )
+    {
+      if( cancel.load(std::memory_order_acquire) )
+        return false;
+      b.wait();
+    }
+
+    return true;
+  }
+
+  /// Consumer: remove the oldest value, waiting while the queue is empty.
+  /// Gives up and returns false once cancel is set.
+  bool pop(value_type& value, const std::atomic<bool>& cancel)
+  {
+    sp::backoff b;
+    while( !this->try_pop(value) )
+    {
+      if( cancel.load(std::memory_order_acquire) )
+        return false;
+      b.wait();
+    }
+
+    return true;
+  }
+
+private:
+  std::vector<value_type> slots;
+
+  // next slot to pop, written by the consumer
+  std::atomic<size_t> head;
+
+  // next slot to push, written by the producer
+  std::atomic<size_t> tail;
+};
+
+
+}
+
+#endif // SP_SPSC_QUEUE_H
@@ -0,0 +1,259 @@
+#ifndef SP_STREAM_DECODER_H
+#define SP_STREAM_DECODER_H
+
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <ios>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "hm/common.h"
+#include "hm/decode.h"
+#include "hm/dispatch.h"
+#include "hm/entity.h"
+#include "hm/exception.h"
+#include "hm/rle.h"
+#include "hm/filter.h"
+#include "hm/shuffle.h"
+#include "sp/run-stats.h"
+#include "sp/mapped-file.h"
+#include "sp/stream-io.h"
+
+
+namespace sp {
+
+/// Decode a range of entities of a seekable input stream, positioned right
+/// after the meta data md, using the seek index.
+/// Called through hm::dispatch_entity_size with md.entity_size.
+///
+/// Only the entities, the tree, a single index entry and the data of the
+/// range are read.
+struct range_decoder
+{
+  template<typename entity_type>
+  static void run(
+    const hm::meta& md,
+    std::istream& input,
+    std::ostream& output,
+    uint64_t start,
+    uint64_t count
+  )
+  {
+    typedef hm::byte_entity<sizeof(entity_type)> decode_type;
+
+    const uint64_t layout_begin = static_cast<uint64_t>(input.tellg());
+
+    if( md.flags & hm::flag_stored )
+    {
+      const uint64_t entity_count = md.data_byte_count / md.entity_size;
+      start = std::min(start, entity_count);
+      count = std::min(count, entity_count - start);
+
+      input.seekg(static_cast<std::streamoff>(layout_begin + start * md.entity_size));
+      sp::copy_stream(input, output, count * md.entity_size);
+      return;
+    }
+
+    if( !(md.flags & hm::flag_index)
+        || (md.flags & (hm::flag_rle | hm::flag_filter | hm::flag_shuffle)) )
+      throw hm::invalid_layout("missing seek index");
+
+    const uint64_t entry = start / md.index_interval;
+    if( entry >= md.index_entry_count || count == 0 )
+      return;
+
+    auto in_begin = std::istreambuf_iterator<char>(input);
+    auto in_end = std::istreambuf_iterator<char>();
+
+    auto entities = hm::decode_entities<decode_type>(in_begin, in_end, md);
+    auto tree = hm::decode_tree(in_begin, in_end, entities, md);
+
+    const uint64_t data_begin =
+      layout_begin +
+      hm::entity_section_byte_count(md) +
+      md.tree_byte_count;
+
+    input.seekg(static_cast<std::streamoff>(
+      data_begin + md.data_byte_count + entry * sizeof(hm::index_entry_type)
+    ));
+    in_begin = std::istreambuf_iterator<char>(input);
+    const auto bit_offset = hm::decode_type<hm::index_entry_type>(in_begin, in_end);
+    if( bit_offset >= md.data_byte_count * 8U )
+      throw hm::invalid_layout("invalid index");
+
+    input.seekg(static_cast<std::streamoff>(data_begin + bit_offset / 8U));
+    hm::decode_data_range(
+      std::istreambuf_iterator<char>(input),
+      in_end,
+      tree.get(),
+      md,
+      bit_offset,
+      start % md.index_interval,
+      count,
+      std::ostreambuf_iterator<char>(output)
+    );
+  }
+};
+
+
+/// Decode a whole input stream, positioned right after the meta data md.
+/// Called through hm::dispatch_entity_size with md.entity_size.
+struct stream_decoder
+{
+  /// Parameters:
+  ///   stats:
+  ///     Receives the time of each phase.
+  template<typename entity_type>
+  static void run(
+    const hm::meta& md,
+    std::istream& input,
+    std::ostream& output,
+    sp::run_stats& stats
+  )
+  {
+    if( md.flags & hm::flag_stored )
+    {
+      stats.start("copy");
+      sp::copy_stream(input, output, md.data_byte_count);
+      stats.stop();
+      return;
+    }
+
+    decode_to<entity_type>(md, input, std::ostreambuf_iterator<char>(output), stats);
+  }
+
+  /// Without pre-transforms, entities are decoded straight to out_iter.
+  /// Otherwise the huffman decoded entities are buffered in memory before the
+  /// pre-transforms are reversed.
+  template<typename entity_type, typename out_type>
+  static void decode_to(
+    const hm::meta& md,
+    std::istream& input,
+    out_type out_iter,
+    sp::run_stats& stats
+  )
+  {
+    // the decoder only copies entities, it never needs their value
+    typedef hm::byte_entity<sizeof(entity_type)> decode_type;
+
+    auto in_begin = std::istreambuf_iterator<char>(input);
+    auto in_end = std::istreambuf_iterator<char>();
+
+    if( !(md.flags & (hm::flag_filter | hm::flag_rle | hm::flag_shuffle)) )
+    {
+      decode<decode_type>(md, in_begin, in_end, out_iter, stats);
+      stats.stop();
+      return;
+    }
+
+    std::vector<uint8_t> buffer;
+    if( md.flags & hm::flag_shuffle )
+    {
+      stats.start("lanes");
+      hm::decode_lanes(md, in_begin, in_end, std::back_inserter(buffer));
+    }
+    else
+    {
+      decode<decode_type>(md, in_begin, in_end, std::back_inserter(buffer), stats);
+    }
+
+    stats.start("transform");
+    if( md.flags & hm::flag_rle )
+    {
+      // the runs are expanded in memory, a corrupt count token must not
+      // expand them beyond the original size
+      uint64_t original_byte_count = std::numeric_limits<uint64_t>::max();
+      hm::get_original_byte_count(md, original_byte_count);
+
+      std::vector<uint8_t> entities;
+      hm::rle_decode<entity_type>(
+        buffer.begin(),
+        buffer.end(),
+        std::back_inserter(entities),
+        original_byte_count
+      );
+      buffer.swap(entities);
+    }
+
+    if( md.flags & hm::flag_filter )
+      hm::reverse_filter<entity_type>(md.filter, buffer.begin(), buffer.end(), out_iter);
+    else
+      std::copy(buffer.begin(), buffer.end(), out_iter);
+
+    stats.stop();
+  }
+
+  /// Decode a huffman coded layout like hm::decode, but phase by phase.
+  /// The input iterators are single pass, each phase continues where the
+  /// previous one stopped.
+  template<typename entity_type, typename out_iter>
+  static void decode(
+    const hm::meta& md,
+    std::istreambuf_iterator<char> in_begin,
+    std::istreambuf_iterator<char> in_end,
+    out_iter out,
+    sp::run_stats& stats
+  )
+  {
+    // empty input
+    if( md.entity_count == 0 && md.data_byte_count == 0 )
+      return;
+
+    stats.start("tree");
+    auto entities = hm::decode_entities<entity_type>(in_begin, in_end, md);
+    auto tree = hm::decode_tree(in_begin, in_end, entities, md);
+
+    stats.start("data");
+    hm::decode_data(in_begin, in_end, tree.get(), md, out);
+  }
+};
+
+
+/// Decode a whole input stream, positioned right after the meta data md,
+/// into a mapped output file of the original size (see
+/// hm::get_original_byte_count), like stream_decoder.
+/// Called through hm::dispatch_entity_size with md.entity_size.
+struct mapped_decoder
+{
+  /// Throws hm::invalid_layout if the output does not match the original
+  /// size.
+  template<typename entity_type>
+  static void run(
+    const hm::meta& md,
+    std::istream& input,
+    sp::mapped_output_file& output,
+    sp::run_stats& stats
+  )
+  {
+    if( md.flags & hm::flag_stored )
+    {
+      stats.start("copy");
+      input.read(
+        reinterpret_cast<char *>(output.data()),
+        static_cast<std::streamsize>(md.data_byte_count)
+      );
+      if( static_cast<uint64_t>(input.gcount()) != md.data_byte_count )
+        throw hm::invalid_layout("unexpected end");
+      output.set_written_byte_count(md.data_byte_count);
+      stats.stop();
+      return;
+    }
+
+    sp::stream_decoder::decode_to<entity_type>(
+      md,
+      input,
+      std::back_inserter(output),
+      stats
+    );
+    if( output.written_byte_count() != output.size() )
+      throw hm::invalid_layout("output is smaller than the original size");
+  }
+};
+
+
+}
+
+#endif // SP_STREAM_DECODER_H
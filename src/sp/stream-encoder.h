@@ -0,0 +1,830 @@
+#ifndef SP_STREAM_ENCODER_H
+#define SP_STREAM_ENCODER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <iterator>
+#include <ios>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <random>
+#include <thread>
+#include <type_traits>
+
+#include "hm/common.h"
+#include "hm/encode.h"
+#include "hm/dispatch.h"
+#include "hm/estimate.h"
+#include "hm/symbols.h"
+#include "hm/radix-count.h"
+#include "hm/rle.h"
+#include "hm/filter.h"
+#include "hm/shuffle.h"
+#include "sp/run-stats.h"
+#include "sp/stream-io.h"
+
+
+namespace sp {
+
+/// How stream_encoder builds the frequency table, from the program options.
+struct count_options
+{
+  count_options()
+  : radix(false),
+    sample_byte_count(0)
+  {
+  }
+
+  // Count entities of 4 and 8 bytes with hm::radix_counter instead of a hash
+  // table (--histogram radix).
+  bool radix;
+
+  // If not 0, build the tree from a random sample of this many bytes of the
+  // input, which is then coded in a single pass (--sample).
+  uint64_t sample_byte_count;
+};
+
+
+/// The size of a block read by read_random_blocks for --sample.
+const size_t sample_block_size = 1024 * 1024;
+
+
+/// Read a random sample of the input for stream_encoder::code_sampled:
+/// distinct blocks at random offsets, in the order of the input. The blocks
+/// are chosen the same way on every run.
+/// Leaves input positioned at the beginning.
+///
+/// Parameters:
+///   input_size:
+///     The size of the input in bytes.
+///   sample_byte_count:
+///     The size of the sample, rounded up to whole blocks and capped at the
+///     input.
+///   block_size:
+///     The size of a block, a multiple of the entity size. Blocks start at
+///     multiples of block_size, which keeps entities aligned.
+inline std::vector<uint8_t> read_random_blocks(
+  std::istream& input,
+  uint64_t input_size,
+  uint64_t sample_byte_count,
+  size_t block_size
+)
+{
+  // a partial last block counts as a block
+  const uint64_t block_count = (input_size + block_size - 1) / block_size;
+  const uint64_t sample_block_count = std::min(
+    block_count,
+    (sample_byte_count + block_size - 1) / block_size
+  );
+
+  // the first sample_block_count of a partial Fisher-Yates shuffle
+  std::vector<uint64_t> blocks(static_cast<size_t>(block_count));
+  for(size_t i = 0; i < blocks.size(); ++i)
+    blocks[i] = i;
+
+  std::mt19937_64 engine(block_count);
+  for(size_t i = 0; i < sample_block_count; ++i)
+  {
+    std::uniform_int_distribution<size_t> pick(i, blocks.size() - 1);
+    std::swap(blocks[i], blocks[pick(engine)]);
+  }
+  blocks.resize(static_cast<size_t>(sample_block_count));
+  std::sort(blocks.begin(), blocks.end());
+
+  std::vector<uint8_t> sample;
+  sample.reserve(static_cast<size_t>(
+    std::min<uint64_t>(input_size, sample_block_count * block_size)
+  ));
+  for(auto block : blocks)
+  {
+    const uint64_t offset = block * block_size;
+    const size_t size =
+      static_cast<size_t>(std::min<uint64_t>(block_size, input_size - offset));
+
+    const size_t sample_end = sample.size();
+    sample.resize(sample_end + size);
+    input.seekg(static_cast<std::streamoff>(offset));
+    input.read(
+      reinterpret_cast<char *>(sample.data() + sample_end),
+      static_cast<std::streamsize>(size)
+    );
+  }
+
+  input.clear();
+  input.seekg(0);
+
+  return sample;
+}
+
+
+/// Encode a whole input stream.
+/// Called through hm::dispatch_entity_size, which picks entity_type based on
+/// the entity size given on the command line.
+struct stream_encoder
+{
+  /// Without pre-transforms, the input is read twice: once to build the
+  /// huffman tree and once to encode it. With counting.sample_byte_count,
+  /// the tree is built from a sample instead (see code_sampled). With pre-transforms (md.flags
+  /// contains hm::flag_filter, hm::flag_rle or hm::flag_shuffle), the input is
+  /// buffered in memory instead.
+  ///
+  /// If huffman coding would expand the input, the input is stored as is
+  /// (see hm::flag_stored). Byte lanes fall back to storing individually.
+  ///
+  /// The meta data is written with zeroed counts before the data, once the
+  /// flags are final. The caller overwrites it with md afterwards.
+  ///
+  /// Parameters:
+  ///   md:
+  ///     On input, md.flags and md.filter select the pre-transforms.
+  ///     On output, the description of the written binary layout.
+  ///   stats:
+  ///     Receives the time of each phase and the entity counts.
+  ///   counting:
+  ///     How to build the frequency table.
+  template<typename entity_type>
+  static void run(
+    std::istream& input,
+    std::ostream& output,
+    hm::meta& md,
+    sp::run_stats& stats,
+    const sp::count_options& counting
+  )
+  {
+    const uint64_t input_size = sp::stream_size(input);
+    stats.entity_count = input_size / sizeof(entity_type);
+    md.original_byte_count = input_size;
+
+    // byte lanes always have raw entity sections
+    if( !hm::is_compact_entity_size(sizeof(entity_type))
+        || (md.flags & hm::flag_shuffle) )
+      md.flags = static_cast<hm::meta::flags_type>(md.flags & ~hm::flag_compact_entities);
+
+    auto enc_iter = std::istreambuf_iterator<char>(input);
+    auto enc_iter_end = std::istreambuf_iterator<char>();
+    auto out_iter = std::ostreambuf_iterator<char>(output);
+
+    hm::meta md_written;
+
+    if( md.flags & (hm::flag_filter | hm::flag_rle | hm::flag_shuffle) )
+    {
+      stats.start("transform");
+
+      std::vector<uint8_t> buffer;
+      if( md.flags & hm::flag_filter )
+      {
+        hm::apply_filter<entity_type>(
+          md.filter,
+          enc_iter,
+          enc_iter_end,
+          std::back_inserter(buffer)
+        );
+      }
+      else
+      {
+        buffer.assign(enc_iter, enc_iter_end);
+      }
+
+      if( md.flags & hm::flag_shuffle )
+      {
+        const bool rle = md.flags & hm::flag_rle;
+
+        // each lane records whether it was run-length encoded
+        md.flags = static_cast<hm::meta::flags_type>(md.flags & ~hm::flag_rle);
+        hm::encode_meta_data(md, out_iter);
+
+        stats.start("lanes");
+        md_written = hm::encode_lanes(
+          buffer.data(),
+          buffer.size(),
+          sizeof(entity_type),
+          rle,
+          out_iter
+        );
+      }
+      else
+      {
+        if( md.flags & hm::flag_rle )
+        {
+          std::vector<uint8_t> tokens;
+          hm::rle_encode<entity_type>(
+            buffer.begin(),
+            buffer.end(),
+            std::back_inserter(tokens)
+          );
+          buffer.swap(tokens);
+        }
+
+        if( !code<entity_type>(&buffer, input, output, input_size, md, md_written, stats, counting.radix) )
+          return;
+      }
+    }
+    else if( counting.sample_byte_count
+             && counting.sample_byte_count < input_size )
+    {
+      if( !code_sampled<entity_type>(input, output, input_size, counting.sample_byte_count, md, md_written, stats) )
+        return;
+    }
+    else
+    {
+      if( !code<entity_type>(nullptr, input, output, input_size, md, md_written, stats, counting.radix) )
+        return;
+    }
+
+    stats.stop();
+
+    md_written.flags = md.flags;
+    md_written.filter = md.filter;
+    md_written.original_byte_count = md.original_byte_count;
+    md = md_written;
+  }
+
+  /// Huffman code the entities after the meta data md, or store the input
+  /// instead if that is smaller.
+  ///
+  /// Parameters:
+  ///   buffer:
+  ///     The entities to code if they are held in memory, e.g. after
+  ///     pre-transforms. Cleared once no longer needed. If null, the
+  ///     entities are read from input, twice.
+  ///   md_written:
+  ///     Receives the description of the coded binary layout.
+  ///   radix:
+  ///     See count_options.
+  ///
+  /// Returns false if the input was stored.
+  template<typename entity_type>
+  static bool code(
+    std::vector<uint8_t> * buffer,
+    std::istream& input,
+    std::ostream& output,
+    uint64_t input_size,
+    hm::meta& md,
+    hm::meta& md_written,
+    sp::run_stats& stats,
+    bool radix
+  )
+  {
+    if( hm::uses_symbol_index<entity_type>::value )
+    {
+      return code_symbols<entity_type>(
+        buffer,
+        input,
+        output,
+        input_size,
+        md,
+        md_written,
+        stats,
+        radix && hm::uses_radix_count<entity_type>::value
+      );
+    }
+
+    return code_entities<entity_type>(buffer, input, output, input_size, md, md_written, stats);
+  }
+
+  /// Code narrow entities, keying the frequency and code tables on the
+  /// entities. See code for the parameters.
+  template<typename entity_type>
+  static bool code_entities(
+    std::vector<uint8_t> * buffer,
+    std::istream& input,
+    std::ostream& output,
+    uint64_t input_size,
+    hm::meta& md,
+    hm::meta& md_written,
+    sp::run_stats& stats
+  )
+  {
+    const bool compact = md.flags & hm::flag_compact_entities;
+    auto enc_iter = std::istreambuf_iterator<char>(input);
+    auto enc_iter_end = std::istreambuf_iterator<char>();
+    auto out_iter = std::ostreambuf_iterator<char>(output);
+
+    stats.start("frequencies");
+    const auto frequencies = buffer
+      ? hm::build_frequency_table<entity_type>(buffer->begin(), buffer->end())
+      : hm::build_frequency_table<entity_type>(enc_iter, enc_iter_end);
+    stats.distinct_entity_count = frequencies.size();
+
+    stats.start("estimate");
+    if( is_stored_smaller<entity_type>(hm::estimate_layout(frequencies, compact), md, input_size) )
+    {
+      store<entity_type>(input, output, input_size, md, stats);
+      return false;
+    }
+
+    hm::encode_meta_data(md, out_iter);
+
+    stats.start("tree");
+    auto tree = compact
+      ? hm::build_canonical_huffman_tree(frequencies)
+      : hm::build_huffman_tree(frequencies);
+
+    stats.start("table");
+    hm::code_table<entity_type> table;
+    hm::code_type prefix;
+    hm::build_huffman_table(tree.get(), table, prefix);
+
+    stats.start("data");
+    if( buffer )
+    {
+      md_written = hm::encode(
+        buffer->begin(),
+        buffer->end(),
+        tree.get(),
+        table,
+        out_iter,
+        md.index_interval,
+        compact
+      );
+    }
+    else
+    {
+      input.clear();
+      input.seekg(0);
+      md_written = hm::encode(
+        enc_iter,
+        enc_iter_end,
+        tree.get(),
+        table,
+        out_iter,
+        md.index_interval,
+        compact
+      );
+    }
+
+    return true;
+  }
+
+  /// Code wide entities through dense symbols (see hm::symbol_index): only
+  /// counting looks entities up in a hash map, the code lengths, the tree and
+  /// the codes are computed from arrays indexed by symbol. The tree is
+  /// always canonical, its codes follow from the code lengths alone.
+  ///
+  /// A buffered input is replaced by its symbol stream while counting, which
+  /// is then coded with an array lookup per entity. Otherwise the input is
+  /// not kept and the second pass maps each entity to its symbol again.
+  ///
+  /// If sorted, the entities are counted with hm::radix_counter and numbered
+  /// in the order of their values, one hash table insert per distinct
+  /// entity. A buffered input is then kept and coded like a streamed one.
+  ///
+  /// See code for the other parameters.
+  template<typename entity_type>
+  static bool code_symbols(
+    std::vector<uint8_t> * buffer,
+    std::istream& input,
+    std::ostream& output,
+    uint64_t input_size,
+    hm::meta& md,
+    hm::meta& md_written,
+    sp::run_stats& stats,
+    bool sorted
+  )
+  {
+    const bool compact = md.flags & hm::flag_compact_entities;
+    auto enc_iter = std::istreambuf_iterator<char>(input);
+    auto enc_iter_end = std::istreambuf_iterator<char>();
+    auto out_iter = std::ostreambuf_iterator<char>(output);
+
+    stats.start("frequencies");
+    hm::symbol_index<entity_type> symbols;
+    std::vector<uint8_t> symbol_stream;
+    if( sorted )
+    {
+      count_sorted<entity_type>(
+        buffer,
+        input,
+        symbols,
+        hm::uses_radix_count<entity_type>()
+      );
+    }
+    else if( buffer )
+    {
+      symbol_stream.reserve(
+        buffer->size() / sizeof(entity_type) * sizeof(hm::symbol_type)
+      );
+      hm::count_symbols<entity_type>(
+        buffer->begin(),
+        buffer->end(),
+        symbols,
+        &symbol_stream
+      );
+      std::vector<uint8_t>().swap(*buffer);
+    }
+    else
+    {
+      hm::count_symbols<entity_type>(enc_iter, enc_iter_end, symbols);
+    }
+    stats.distinct_entity_count = symbols.size();
+
+    stats.start("estimate");
+    const auto lengths = hm::code_lengths(symbols.counts());
+    if( is_stored_smaller<entity_type>(hm::estimate_layout(symbols, lengths, compact), md, input_size) )
+    {
+      store<entity_type>(input, output, input_size, md, stats);
+      return false;
+    }
+
+    hm::encode_meta_data(md, out_iter);
+
+    stats.start("tree");
+    const auto order = hm::canonical_order(
+      lengths,
+      compact ? symbols.numbers() : std::vector<uint64_t>()
+    );
+    auto tree = hm::build_canonical_huffman_tree(
+      symbols.entities(),
+      symbols.counts(),
+      lengths,
+      order
+    );
+
+    stats.start("table");
+    const hm::symbol_codes codes(hm::canonical_codes(lengths, order));
+
+    stats.start("data");
+    if( buffer && sorted )
+    {
+      md_written = hm::encode(
+        buffer->cbegin(),
+        buffer->cend(),
+        tree.get(),
+        hm::entity_codes<entity_type>(symbols, codes),
+        out_iter,
+        md.index_interval,
+        compact
+      );
+    }
+    else if( buffer )
+    {
+      md_written = hm::encode(
+        symbol_stream.cbegin(),
+        symbol_stream.cend(),
+        tree.get(),
+        codes,
+        out_iter,
+        md.index_interval,
+        compact
+      );
+    }
+    else
+    {
+      input.clear();
+      input.seekg(0);
+      md_written = hm::encode(
+        enc_iter,
+        enc_iter_end,
+        tree.get(),
+        hm::entity_codes<entity_type>(symbols, codes),
+        out_iter,
+        md.index_interval,
+        compact
+      );
+    }
+
+    return true;
+  }
+
+  /// Code the entities of input in a single pass, with a tree built from a
+  /// random sample of sample_byte_count bytes (see read_random_blocks).
+  ///
+  /// Entities the sample lacks are escaped (see hm::flag_escape). The escape
+  /// leaf counts as often as the sample's entities that occur once (the
+  /// Good-Turing estimate of the share of unseen entities). Whether to store
+  /// the input is decided from the sample alone.
+  ///
+  /// See code for the other parameters.
+  template<typename entity_type>
+  static bool code_sampled(
+    std::istream& input,
+    std::ostream& output,
+    uint64_t input_size,
+    uint64_t sample_byte_count,
+    hm::meta& md,
+    hm::meta& md_written,
+    sp::run_stats& stats
+  )
+  {
+    const bool compact = md.flags & hm::flag_compact_entities;
+    auto enc_iter = std::istreambuf_iterator<char>(input);
+    auto enc_iter_end = std::istreambuf_iterator<char>();
+    auto out_iter = std::ostreambuf_iterator<char>(output);
+
+    stats.start("sample");
+    const auto sample = sp::read_random_blocks(
+      input,
+      input_size,
+      sample_byte_count,
+      sp::sample_block_size / sizeof(entity_type) * sizeof(entity_type)
+    );
+
+    stats.start("frequencies");
+    auto frequencies =
+      hm::build_frequency_table<entity_type>(sample.begin(), sample.end());
+
+    size_t escape_count = 1;
+    for(const auto& entry : frequencies)
+      escape_count += entry.second == 1;
+
+    // without a free entity, the sample holds the whole alphabet
+    entity_type escape = entity_type();
+    const bool escaped = hm::find_escape_entity(frequencies, escape);
+    if( escaped )
+    {
+      frequencies[escape] = escape_count;
+      md.flags = static_cast<hm::meta::flags_type>(md.flags | hm::flag_escape);
+    }
+    stats.distinct_entity_count = frequencies.size();
+
+    stats.start("estimate");
+    hm::meta md_estimate = hm::estimate_layout(frequencies, compact);
+    if( escaped )
+      md_estimate.data_byte_count += escape_count * sizeof(entity_type);
+
+    // extrapolate the data section of the sample to the whole input
+    md_estimate.data_byte_count = static_cast<hm::meta::data_count_type>(
+      static_cast<double>(md_estimate.data_byte_count)
+        * static_cast<double>(input_size) / static_cast<double>(sample.size())
+    );
+    if( is_stored_smaller<entity_type>(md_estimate, md, input_size) )
+    {
+      store<entity_type>(input, output, input_size, md, stats);
+      return false;
+    }
+
+    hm::encode_meta_data(md, out_iter);
+
+    stats.start("tree");
+    auto tree = compact
+      ? hm::build_canonical_huffman_tree(frequencies)
+      : hm::build_huffman_tree(frequencies);
+
+    stats.start("table");
+    hm::code_table<entity_type> table;
+    hm::code_type prefix;
+    hm::build_huffman_table(tree.get(), table, prefix);
+
+    stats.start("data");
+    input.clear();
+    input.seekg(0);
+    if( escaped )
+    {
+      md_written = hm::encode_escaped(
+        enc_iter,
+        enc_iter_end,
+        tree.get(),
+        table,
+        escape,
+        out_iter,
+        md.index_interval,
+        compact
+      );
+    }
+    else
+    {
+      md_written = hm::encode(
+        enc_iter,
+        enc_iter_end,
+        tree.get(),
+        table,
+        out_iter,
+        md.index_interval,
+        compact
+      );
+    }
+
+    return true;
+  }
+
+  /// Count the entities of buffer, or of input if buffer is null, with
+  /// hm::radix_counter on all hardware threads, in blocks of
+  /// radix_block_size bytes, and add them to symbols.
+  template<typename entity_type>
+  static void count_sorted(
+    const std::vector<uint8_t> * buffer,
+    std::istream& input,
+    hm::symbol_index<entity_type>& symbols,
+    std::true_type
+  )
+  {
+    // a block of 8 byte entities, sorting takes twice as much
+    const size_t radix_block_size = 64 * 1024 * 1024;
+
+    hm::radix_counter<entity_type> counter(
+      std::max(std::thread::hardware_concurrency(), 1U)
+    );
+
+    if( buffer )
+    {
+      for(size_t offset = 0; offset < buffer->size(); offset += radix_block_size)
+      {
+        counter.add(
+          buffer->data() + offset,
+          std::min(radix_block_size, buffer->size() - offset)
+        );
+      }
+    }
+    else
+    {
+      std::vector<uint8_t> block(radix_block_size);
+      input.clear();
+      input.seekg(0);
+      while( input )
+      {
+        input.read(reinterpret_cast<char *>(block.data()), block.size());
+        counter.add(block.data(), static_cast<size_t>(input.gcount()));
+      }
+    }
+
+    const auto& histogram = counter.histogram();
+    symbols.reserve(histogram.entities.size());
+    for(size_t i = 0; i < histogram.entities.size(); ++i)
+      symbols.add(histogram.entities[i], histogram.counts[i]);
+  }
+
+  /// Never called, code only sorts entities of hm::uses_radix_count.
+  template<typename entity_type>
+  static void count_sorted(
+    const std::vector<uint8_t> *,
+    std::istream&,
+    hm::symbol_index<entity_type>&,
+    std::false_type
+  )
+  {
+  }
+
+  /// Check whether storing the input is smaller than the coded layout
+  /// md_estimate, completed with the flags of md.
+  template<typename entity_type>
+  static bool is_stored_smaller(
+    hm::meta md_estimate,
+    const hm::meta& md,
+    uint64_t input_size
+  )
+  {
+    md_estimate.flags = md.flags;
+    md_estimate.filter = md.filter;
+    if( md.flags & hm::flag_index )
+    {
+      // one entry for every index_interval-th entity
+      const uint64_t entity_count = input_size / sizeof(entity_type);
+      md_estimate.index_interval = md.index_interval;
+      md_estimate.index_entry_count =
+        (entity_count + md.index_interval - 1) / md.index_interval;
+    }
+
+    return hm::is_stored_smaller(md_estimate, input_size);
+  }
+
+  /// Store the input as is, without pre-transforms or seek index.
+  template<typename entity_type>
+  static void store(
+    std::istream& input,
+    std::ostream& output,
+    uint64_t input_size,
+    hm::meta& md,
+    sp::run_stats& stats
+  )
+  {
+    stats.start("store");
+
+    const hm::meta::flags_type checksum = md.flags & hm::flag_checksum;
+    md = hm::make_stored_meta(input_size, sizeof(entity_type));
+    md.flags = static_cast<hm::meta::flags_type>(md.flags | checksum);
+    hm::encode_meta_data(md, std::ostreambuf_iterator<char>(output));
+
+    input.clear();
+    input.seekg(0);
+    sp::copy_stream(input, output, input_size);
+
+    stats.stop();
+  }
+};
+
+
+/// The number of evenly spaced chunks read by read_sample.
+const size_t sample_chunk_count = 16;
+
+/// The size of a chunk read by read_sample. A multiple of all candidate
+/// entity sizes.
+const size_t sample_chunk_size = 64 * 1024;
+
+
+/// Read a sample of the input for hm::select_entity_size: the whole input if
+/// it is small, otherwise sample_chunk_count evenly spaced chunks.
+/// Leaves input positioned at the beginning.
+///
+/// Parameters:
+///   input_size:
+///     The size of the input in bytes.
+inline std::vector<uint8_t> read_sample(std::istream& input, uint64_t input_size)
+{
+  std::vector<uint8_t> sample;
+
+  if( input_size <= sp::sample_chunk_count * sp::sample_chunk_size )
+  {
+    sample.resize(static_cast<size_t>(input_size));
+    input.read(
+      reinterpret_cast<char *>(sample.data()),
+      static_cast<std::streamsize>(sample.size())
+    );
+  }
+  else
+  {
+    sample.resize(sp::sample_chunk_count * sp::sample_chunk_size);
+
+    // chunks start at multiples of sample_chunk_size, which keeps entities
+    // of all candidate sizes aligned
+    const uint64_t stride =
+      (input_size / sp::sample_chunk_count) / sp::sample_chunk_size * sp::sample_chunk_size;
+
+    for(size_t i = 0; i < sp::sample_chunk_count; ++i)
+    {
+      input.seekg(static_cast<std::streamoff>(i * stride));
+      input.read(
+        reinterpret_cast<char *>(sample.data() + i * sp::sample_chunk_size),
+        static_cast<std::streamsize>(sp::sample_chunk_size)
+      );
+    }
+  }
+
+  input.clear();
+  input.seekg(0);
+
+  return sample;
+}
+
+
+/// Report the huffman code of a whole input stream without encoding it.
+/// Called through hm::dispatch_entity_size.
+struct stream_estimator
+{
+  /// Without pre-transforms, the input is read once to build the frequency
+  /// table. With pre-transforms (md.flags contains hm::flag_filter or
+  /// hm::flag_rle), the input is buffered in memory.
+  template<typename entity_type>
+  static void run(std::istream& input, const hm::meta& md, hm::code_report& report)
+  {
+    const bool compact = md.flags & hm::flag_compact_entities;
+
+    auto in_begin = std::istreambuf_iterator<char>(input);
+    auto in_end = std::istreambuf_iterator<char>();
+
+    if( md.flags & (hm::flag_filter | hm::flag_rle) )
+    {
+      std::vector<uint8_t> buffer;
+      if( md.flags & hm::flag_filter )
+      {
+        hm::apply_filter<entity_type>(
+          md.filter,
+          in_begin,
+          in_end,
+          std::back_inserter(buffer)
+        );
+      }
+      else
+      {
+        buffer.assign(in_begin, in_end);
+      }
+
+      if( md.flags & hm::flag_rle )
+      {
+        std::vector<uint8_t> tokens;
+        hm::rle_encode<entity_type>(
+          buffer.begin(),
+          buffer.end(),
+          std::back_inserter(tokens)
+        );
+        buffer.swap(tokens);
+      }
+
+      report = hm::report_code(
+        hm::build_frequency_table<entity_type>(buffer.begin(), buffer.end()),
+        compact
+      );
+    }
+    else
+    {
+      report = hm::report_code(
+        hm::build_frequency_table<entity_type>(in_begin, in_end),
+        compact
+      );
+    }
+
+    // report_code decides whether entity_type supports a compact entity
+    // section
+    report.md.flags = static_cast<hm::meta::flags_type>(
+      (md.flags & ~hm::flag_compact_entities) |
+      (report.md.flags & hm::flag_compact_entities)
+    );
+    report.md.filter = md.filter;
+  }
+};
+
+
+}
+
+#endif // SP_STREAM_ENCODER_H
@@ -0,0 +1,54 @@
+#ifndef SP_STREAM_IO_H
+#define SP_STREAM_IO_H
+
+#include <cstdint>
+#include <algorithm>
+#include <ios>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "hm/exception.h"
+
+
+namespace sp {
+
+/// Return the size of a seekable input stream in bytes.
+/// Leaves input positioned at the beginning.
+inline uint64_t stream_size(std::istream& input)
+{
+  input.clear();
+  input.seekg(0, std::ios::end);
+  const uint64_t size = static_cast<uint64_t>(input.tellg());
+  input.seekg(0);
+
+  return size;
+}
+
+
+/// Copy byte_count bytes from input to output in large blocks.
+///
+/// Throws hm::invalid_layout if input ends before byte_count bytes are read.
+inline void copy_stream(std::istream& input, std::ostream& output, uint64_t byte_count)
+{
+  std::vector<char> block(64 * 1024);
+
+  while( byte_count > 0 )
+  {
+    const std::streamsize size = static_cast<std::streamsize>(
+      std::min<uint64_t>(byte_count, block.size())
+    );
+
+    input.read(block.data(), size);
+    if( input.gcount() != size )
+      throw hm::invalid_layout("unexpected end");
+
+    output.write(block.data(), size);
+    byte_count -= static_cast<uint64_t>(size);
+  }
+}
+
+
+}
+
+#endif // SP_STREAM_IO_H
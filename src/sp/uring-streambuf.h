@@ -0,0 +1,474 @@
+#ifndef SP_URING_STREAMBUF_H
+#define SP_URING_STREAMBUF_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cerrno>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <streambuf>
+#include <ios>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "sp/uring.h"
+
+
+namespace sp {
+
+/// The size of a single read or write of the io_uring streambufs.
+const size_t uring_block_size = 1024 * 1024;
+
+/// The number of reads or writes the io_uring streambufs keep in flight.
+const unsigned int uring_queue_depth = 4;
+
+
+/// A block of a file, read or written at an explicit offset.
+struct uring_slot
+{
+  uring_slot()
+  : data(),
+    offset(0),
+    size(0),
+    result(0),
+    done(false)
+  {
+  }
+
+  std::vector<char> data;
+  uint64_t offset;
+  uint32_t size;
+  int32_t result;
+  bool done;
+};
+
+
+/// Transfer the part of slot that io_uring left over after a short read or
+/// write, synchronously with pread or pwrite. Returns false on error.
+/// Reading stops early at the end of the file.
+inline bool complete_slot(int fd, sp::uring_slot& slot, bool write)
+{
+  uint32_t transferred = slot.result > 0 ? static_cast<uint32_t>(slot.result) : 0;
+  if( slot.result < 0 )
+    return false;
+
+  while( transferred < slot.size )
+  {
+    const ssize_t n = write
+      ? ::pwrite(fd, slot.data.data() + transferred, slot.size - transferred,
+                 static_cast<off_t>(slot.offset + transferred))
+      : ::pread(fd, slot.data.data() + transferred, slot.size - transferred,
+                static_cast<off_t>(slot.offset + transferred));
+
+    if( n < 0 && errno == EINTR )
+      continue;
+    if( n < 0 || (n == 0 && write) )
+      return false;
+    if( n == 0 )
+      break;
+
+    transferred += static_cast<uint32_t>(n);
+  }
+
+  slot.result = static_cast<int32_t>(transferred);
+  return true;
+}
+
+
+/// A streambuf that reads a file with io_uring, keeping uring_queue_depth
+/// reads of uring_block_size bytes in flight ahead of the consumer.
+///
+/// After opening and after a seek only one read is in flight, doubling with
+/// every block consumed: a read right after a seek is often a short random
+/// access (e.g. the chunks of read_sample).
+///
+/// Falls back to one synchronous pread per block if io_uring is unavailable
+/// (see sp::uring).
+class uring_istreambuf : public std::streambuf
+{
+public:
+  /// Parameters:
+  ///   path:
+  ///     The file to read.
+  ///   async:
+  ///     Whether to use io_uring. If false, reads use pread as if io_uring
+  ///     was unavailable.
+  explicit uring_istreambuf(const std::string& path, bool async = true)
+  : fd(::open(path.c_str(), O_RDONLY)),
+    file_size(0),
+    ring(async ? sp::uring_queue_depth : 0),
+    slots(ring.valid() ? sp::uring_queue_depth : 1),
+    head(0),
+    queued(0),
+    window(1),
+    next_offset(0),
+    block_position(0)
+  {
+    struct stat st;
+    if( this->fd >= 0 && ::fstat(this->fd, &st) == 0 )
+      this->file_size = static_cast<uint64_t>(st.st_size);
+
+    for(auto& slot : this->slots)
+      slot.data.resize(sp::uring_block_size);
+
+    this->setg(nullptr, nullptr, nullptr);
+  }
+
+  uring_istreambuf(const uring_istreambuf&) = delete;
+  uring_istreambuf& operator=(const uring_istreambuf&) = delete;
+
+  ~uring_istreambuf()
+  {
+    this->drain();
+    if( this->fd >= 0 )
+      ::close(this->fd);
+  }
+
+  bool is_open() const
+  {
+    return this->fd >= 0;
+  }
+
+  /// Whether reads go through io_uring rather than pread.
+  bool is_async() const
+  {
+    return this->ring.valid();
+  }
+
+protected:
+  int_type underflow() override
+  {
+    if( this->gptr() < this->egptr() )
+      return traits_type::to_int_type(*this->gptr());
+
+    // done with the head slot
+    if( this->eback() != nullptr )
+    {
+      this->block_position += static_cast<off_type>(this->egptr() - this->eback());
+      this->setg(nullptr, nullptr, nullptr);
+      this->head = (this->head + 1) % this->slots.size();
+      this->queued--;
+      this->window = std::min(this->window * 2, this->slots.size());
+    }
+
+    this->fill();
+    if( this->queued == 0 )
+      return traits_type::eof();
+
+    sp::uring_slot& slot = this->slots[this->head];
+    while( !slot.done )
+    {
+      uint64_t user_data = 0;
+      int32_t result = 0;
+      if( !this->ring.wait(user_data, result) )
+        return traits_type::eof();
+
+      this->slots[user_data].result = result;
+      this->slots[user_data].done = true;
+    }
+
+    if( !sp::complete_slot(this->fd, slot, false) || slot.result == 0 )
+    {
+      // the file shrank or a read failed; end here
+      this->restart(this->block_position);
+      return traits_type::eof();
+    }
+
+    this->setg(slot.data.data(), slot.data.data(), slot.data.data() + slot.result);
+    return traits_type::to_int_type(*this->gptr());
+  }
+
+  pos_type seekoff(
+    off_type off,
+    std::ios_base::seekdir dir,
+    std::ios_base::openmode which
+  ) override
+  {
+    const off_type position =
+      this->block_position + static_cast<off_type>(this->gptr() - this->eback());
+
+    // tellg
+    if( dir == std::ios_base::cur && off == 0 )
+      return pos_type(position);
+
+    off_type target = off;
+    if( dir == std::ios_base::cur )
+      target += position;
+    else if( dir == std::ios_base::end )
+      target += static_cast<off_type>(this->file_size);
+
+    return this->seekpos(pos_type(target), which);
+  }
+
+  pos_type seekpos(pos_type pos, std::ios_base::openmode /* which */) override
+  {
+    if( off_type(pos) < 0 )
+      return pos_type(off_type(-1));
+
+    this->restart(off_type(pos));
+    return pos;
+  }
+
+private:
+  /// Submit reads until window reads are queued or the end of the file is
+  /// reached. Without io_uring the single read is synchronous.
+  void fill()
+  {
+    while( this->queued < this->window && this->next_offset < this->file_size )
+    {
+      const size_t index = (this->head + this->queued) % this->slots.size();
+      sp::uring_slot& slot = this->slots[index];
+      slot.offset = this->next_offset;
+      slot.size = static_cast<uint32_t>(
+        std::min<uint64_t>(slot.data.size(), this->file_size - this->next_offset)
+      );
+      slot.result = 0;
+      slot.done = false;
+
+      if( !this->ring.valid()
+          || !this->ring.read(this->fd, slot.data.data(), slot.size, slot.offset, index) )
+        slot.done = true;  // complete_slot reads synchronously
+
+      this->next_offset += slot.size;
+      this->queued++;
+    }
+  }
+
+  /// Wait for all reads in flight.
+  void drain()
+  {
+    uint64_t user_data = 0;
+    int32_t result = 0;
+    while( this->ring.pending() > 0 && this->ring.wait(user_data, result) )
+      ;
+  }
+
+  void restart(off_type position)
+  {
+    this->drain();
+    this->setg(nullptr, nullptr, nullptr);
+    this->head = 0;
+    this->queued = 0;
+    this->window = 1;
+    this->next_offset = static_cast<uint64_t>(position);
+    this->block_position = position;
+  }
+
+  int fd;
+  uint64_t file_size;
+  sp::uring ring;
+
+  std::vector<sp::uring_slot> slots;
+
+  // the slot the consumer reads, and the number of slots submitted from it on
+  size_t head;
+  size_t queued;
+
+  // the number of reads to keep queued
+  size_t window;
+
+  // the offset of the next read to submit
+  uint64_t next_offset;
+
+  // the position of eback() in the file
+  off_type block_position;
+};
+
+
+/// A streambuf that writes a file with io_uring, keeping up to
+/// uring_queue_depth writes of uring_block_size bytes in flight behind the
+/// producer.
+///
+/// Falls back to synchronous pwrite if io_uring is unavailable (see
+/// sp::uring). Flushing (sync) waits for all writes.
+class uring_ostreambuf : public std::streambuf
+{
+public:
+  /// Parameters:
+  ///   path:
+  ///     The file to write, which must exist (e.g. created by an ofstream).
+  ///   async:
+  ///     Whether to use io_uring. If false, writes use pwrite as if io_uring
+  ///     was unavailable.
+  explicit uring_ostreambuf(const std::string& path, bool async = true)
+  : fd(::open(path.c_str(), O_WRONLY)),
+    ring(async ? sp::uring_queue_depth : 0),
+    slots(sp::uring_queue_depth),
+    current(0),
+    write_offset(0),
+    failed(false)
+  {
+    for(auto& slot : this->slots)
+    {
+      slot.data.resize(sp::uring_block_size);
+      slot.done = true;
+    }
+
+    this->reset_put_area();
+  }
+
+  uring_ostreambuf(const uring_ostreambuf&) = delete;
+  uring_ostreambuf& operator=(const uring_ostreambuf&) = delete;
+
+  ~uring_ostreambuf()
+  {
+    this->sync();
+    if( this->fd >= 0 )
+      ::close(this->fd);
+  }
+
+  bool is_open() const
+  {
+    return this->fd >= 0;
+  }
+
+  /// Whether writes go through io_uring rather than pwrite.
+  bool is_async() const
+  {
+    return this->ring.valid();
+  }
+
+protected:
+  int_type overflow(int_type c) override
+  {
+    if( !this->submit_current() )
+      return traits_type::eof();
+
+    if( !traits_type::eq_int_type(c, traits_type::eof()) )
+    {
+      *this->pptr() = traits_type::to_char_type(c);
+      this->pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+  }
+
+  int sync() override
+  {
+    if( this->pptr() > this->pbase() && !this->submit_current() )
+      return -1;
+
+    for(auto& slot : this->slots)
+      if( !this->wait_for(slot) )
+        return -1;
+
+    return this->failed ? -1 : 0;
+  }
+
+  pos_type seekoff(
+    off_type off,
+    std::ios_base::seekdir dir,
+    std::ios_base::openmode which
+  ) override
+  {
+    const off_type position =
+      static_cast<off_type>(this->write_offset) + (this->pptr() - this->pbase());
+
+    // tellp
+    if( dir == std::ios_base::cur && off == 0 )
+      return pos_type(position);
+
+    if( dir == std::ios_base::cur )
+      return this->seekpos(pos_type(position + off), which);
+
+    if( this->sync() != 0 )
+      return pos_type(off_type(-1));
+
+    struct stat st;
+    if( ::fstat(this->fd, &st) != 0 )
+      return pos_type(off_type(-1));
+
+    return this->seekpos(pos_type(static_cast<off_type>(st.st_size) + off), which);
+  }
+
+  pos_type seekpos(pos_type pos, std::ios_base::openmode /* which */) override
+  {
+    if( this->sync() != 0 || off_type(pos) < 0 )
+      return pos_type(off_type(-1));
+
+    this->write_offset = static_cast<uint64_t>(off_type(pos));
+    return pos;
+  }
+
+private:
+  void reset_put_area()
+  {
+    sp::uring_slot& slot = this->slots[this->current];
+    this->setp(slot.data.data(), slot.data.data() + slot.data.size());
+  }
+
+  /// Wait until the write of slot is complete.
+  /// Returns false if a write failed.
+  bool wait_for(sp::uring_slot& slot)
+  {
+    while( !slot.done )
+    {
+      uint64_t user_data = 0;
+      int32_t result = 0;
+      if( !this->ring.wait(user_data, result) )
+      {
+        this->failed = true;
+        return false;
+      }
+
+      sp::uring_slot& completed = this->slots[user_data];
+      completed.result = result;
+      completed.done = true;
+      if( !sp::complete_slot(this->fd, completed, true) )
+        this->failed = true;
+    }
+
+    return !this->failed;
+  }
+
+  /// Submit the current slot and continue with the next one, once its
+  /// previous write is complete. Returns false if a write failed.
+  bool submit_current()
+  {
+    if( this->failed )
+      return false;
+
+    sp::uring_slot& slot = this->slots[this->current];
+    slot.offset = this->write_offset;
+    slot.size = static_cast<uint32_t>(this->pptr() - this->pbase());
+    slot.result = 0;
+    slot.done = false;
+    this->write_offset += slot.size;
+
+    if( !this->ring.valid()
+        || !this->ring.write(this->fd, slot.data.data(), slot.size, slot.offset, this->current) )
+    {
+      // synchronously
+      slot.done = true;
+      if( !sp::complete_slot(this->fd, slot, true) )
+        this->failed = true;
+    }
+
+    this->current = (this->current + 1) % this->slots.size();
+    const bool ok = this->wait_for(this->slots[this->current]);
+    this->reset_put_area();
+
+    return ok;
+  }
+
+  int fd;
+  sp::uring ring;
+
+  std::vector<sp::uring_slot> slots;
+
+  // the slot being filled
+  size_t current;
+
+  // the offset of the first byte of the current slot
+  uint64_t write_offset;
+
+  bool failed;
+};
+
+
+}
+
+#endif // SP_URING_STREAMBUF_H
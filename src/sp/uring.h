@@ -0,0 +1,333 @@
+#ifndef SP_URING_H
+#define SP_URING_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+
+namespace sp {
+
+/// A minimal io_uring(7) submission and completion ring for reads and writes
+/// at explicit offsets, using the system calls directly (no liburing).
+///
+/// The ring is unavailable (valid() returns false) on other platforms, on
+/// kernels before 5.6 (no IORING_OP_READ and IORING_OP_WRITE) and where
+/// io_uring is disabled, e.g. by seccomp in containers or by
+/// kernel.io_uring_disabled. Callers fall back to pread and pwrite.
+class uring
+{
+public:
+  /// Parameters:
+  ///   entries:
+  ///     The maximum number of requests in flight. 0 creates an unavailable
+  ///     ring, callers then use pread and pwrite.
+  explicit uring(unsigned int entries)
+  : ring_fd(-1),
+    sq_ring(nullptr),
+    sq_ring_size(0),
+    cq_ring(nullptr),
+    cq_ring_size(0),
+    sqes(nullptr),
+    sqes_size(0),
+    sq_head(nullptr),
+    sq_tail(nullptr),
+    sq_mask(nullptr),
+    sq_array(nullptr),
+    cq_head(nullptr),
+    cq_tail(nullptr),
+    cq_mask(nullptr),
+    cqes(nullptr),
+    in_flight(0)
+  {
+#ifdef __linux__
+    if( entries == 0 )
+      return;
+
+    io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+
+    const long fd = ::syscall(__NR_io_uring_setup, entries, &p);
+    if( fd < 0 )
+      return;
+    this->ring_fd = static_cast<int>(fd);
+
+    // IORING_OP_READ and IORING_OP_WRITE came with 5.6, like this feature
+    if( !(p.features & IORING_FEAT_RW_CUR_POS) )
+    {
+      this->release();
+      return;
+    }
+
+    this->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    this->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    this->sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+
+    const bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if( single_mmap )
+    {
+      if( this->cq_ring_size > this->sq_ring_size )
+        this->sq_ring_size = this->cq_ring_size;
+      this->cq_ring_size = 0;
+    }
+
+    this->sq_ring = this->map(this->sq_ring_size, IORING_OFF_SQ_RING);
+    this->cq_ring = single_mmap
+      ? this->sq_ring
+      : this->map(this->cq_ring_size, IORING_OFF_CQ_RING);
+    this->sqes = static_cast<io_uring_sqe *>(this->map(this->sqes_size, IORING_OFF_SQES));
+
+    if( !this->sq_ring || !this->cq_ring || !this->sqes )
+    {
+      this->release();
+      return;
+    }
+
+    char * sq = static_cast<char *>(this->sq_ring);
+    this->sq_head = reinterpret_cast<unsigned int *>(sq + p.sq_off.head);
+    this->sq_tail = reinterpret_cast<unsigned int *>(sq + p.sq_off.tail);
+    this->sq_mask = reinterpret_cast<unsigned int *>(sq + p.sq_off.ring_mask);
+    this->sq_array = reinterpret_cast<unsigned int *>(sq + p.sq_off.array);
+
+    char * cq = static_cast<char *>(this->cq_ring);
+    this->cq_head = reinterpret_cast<unsigned int *>(cq + p.cq_off.head);
+    this->cq_tail = reinterpret_cast<unsigned int *>(cq + p.cq_off.tail);
+    this->cq_mask = reinterpret_cast<unsigned int *>(cq + p.cq_off.ring_mask);
+    this->cqes = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+#else
+    static_cast<void>(entries);
+#endif
+  }
+
+  ~uring()
+  {
+    this->release();
+  }
+
+  uring(const uring&) = delete;
+  uring& operator=(const uring&) = delete;
+
+  /// Whether the ring was set up.
+  bool valid() const
+  {
+    return this->ring_fd >= 0;
+  }
+
+  /// The number of submitted requests whose completion has not been
+  /// waited for.
+  unsigned int pending() const
+  {
+    return this->in_flight;
+  }
+
+  /// Submit a read of size bytes at offset of fd into buffer.
+  /// Returns false if the request could not be submitted.
+  bool read(int fd, void * buffer, uint32_t size, uint64_t offset, uint64_t user_data)
+  {
+#ifdef __linux__
+    return this->submit(IORING_OP_READ, fd, buffer, size, offset, user_data);
+#else
+    static_cast<void>(fd);
+    static_cast<void>(buffer);
+    static_cast<void>(size);
+    static_cast<void>(offset);
+    static_cast<void>(user_data);
+    return false;
+#endif
+  }
+
+  /// Submit a write of size bytes from buffer at offset of fd.
+  /// Returns false if the request could not be submitted.
+  bool write(int fd, const void * buffer, uint32_t size, uint64_t offset, uint64_t user_data)
+  {
+#ifdef __linux__
+    return this->submit(IORING_OP_WRITE, fd, buffer, size, offset, user_data);
+#else
+    static_cast<void>(fd);
+    static_cast<void>(buffer);
+    static_cast<void>(size);
+    static_cast<void>(offset);
+    static_cast<void>(user_data);
+    return false;
+#endif
+  }
+
+  /// Wait for the next completion, in any order.
+  ///
+  /// Parameters:
+  ///   user_data:
+  ///     Receives the user_data of the completed request.
+  ///   result:
+  ///     Receives the number of bytes transferred, or -errno.
+  ///
+  /// Returns false if nothing is in flight or waiting failed.
+  bool wait(uint64_t& user_data, int32_t& result)
+  {
+#ifdef __linux__
+    if( !this->valid() || this->in_flight == 0 )
+      return false;
+
+    const unsigned int head = *this->cq_head;
+    while( head == load_acquire(this->cq_tail) )
+    {
+      const long rc = ::syscall(
+        __NR_io_uring_enter,
+        this->ring_fd,
+        0,
+        1,
+        IORING_ENTER_GETEVENTS,
+        nullptr,
+        0
+      );
+
+      if( rc < 0 && errno != EINTR )
+        return false;
+    }
+
+    const io_uring_cqe& cqe = this->cqes[head & *this->cq_mask];
+    user_data = cqe.user_data;
+    result = cqe.res;
+    store_release(this->cq_head, head + 1);
+    this->in_flight--;
+
+    return true;
+#else
+    static_cast<void>(user_data);
+    static_cast<void>(result);
+    return false;
+#endif
+  }
+
+private:
+#ifdef __linux__
+  static unsigned int load_acquire(const unsigned int * p)
+  {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+  }
+
+  static void store_release(unsigned int * p, unsigned int value)
+  {
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+  }
+
+  void * map(size_t size, off_t offset)
+  {
+    void * p = ::mmap(
+      nullptr,
+      size,
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE,
+      this->ring_fd,
+      offset
+    );
+
+    return p == MAP_FAILED ? nullptr : p;
+  }
+
+  bool submit(
+    uint8_t opcode,
+    int fd,
+    const void * buffer,
+    uint32_t size,
+    uint64_t offset,
+    uint64_t user_data
+  )
+  {
+    if( !this->valid() )
+      return false;
+
+    const unsigned int tail = *this->sq_tail;
+    const unsigned int index = tail & *this->sq_mask;
+
+    io_uring_sqe& sqe = this->sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = opcode;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<uint64_t>(buffer);
+    sqe.len = size;
+    sqe.off = offset;
+    sqe.user_data = user_data;
+
+    this->sq_array[index] = index;
+    store_release(this->sq_tail, tail + 1);
+
+    long rc;
+    do
+    {
+      rc = ::syscall(__NR_io_uring_enter, this->ring_fd, 1, 0, 0, nullptr, 0);
+    }
+    while( rc < 0 && errno == EINTR );
+
+    if( rc != 1 )
+    {
+      // not consumed by the kernel, take it back
+      store_release(this->sq_tail, tail);
+      return false;
+    }
+
+    this->in_flight++;
+    return true;
+  }
+#endif
+
+  void release()
+  {
+#ifdef __linux__
+    if( this->sqes )
+      ::munmap(this->sqes, this->sqes_size);
+    if( this->cq_ring && this->cq_ring != this->sq_ring )
+      ::munmap(this->cq_ring, this->cq_ring_size);
+    if( this->sq_ring )
+      ::munmap(this->sq_ring, this->sq_ring_size);
+    if( this->ring_fd >= 0 )
+      ::close(this->ring_fd);
+#endif
+
+    this->sqes = nullptr;
+    this->cq_ring = nullptr;
+    this->sq_ring = nullptr;
+    this->ring_fd = -1;
+  }
+
+  int ring_fd;
+
+  void * sq_ring;
+  size_t sq_ring_size;
+  void * cq_ring;
+  size_t cq_ring_size;
+#ifdef __linux__
+  io_uring_sqe * sqes;
+#else
+  void * sqes;
+#endif
+  size_t sqes_size;
+
+  unsigned int * sq_head;
+  unsigned int * sq_tail;
+  unsigned int * sq_mask;
+  unsigned int * sq_array;
+
+  unsigned int * cq_head;
+  unsigned int * cq_tail;
+  unsigned int * cq_mask;
+#ifdef __linux__
+  io_uring_cqe * cqes;
+#else
+  void * cqes;
+#endif
+
+  unsigned int in_flight;
+};
+
+
+}
+
+#endif // SP_URING_H
@@ -0,0 +1,121 @@
+#ifndef SP_WORK_STEALING_POOL_H
+#define SP_WORK_STEALING_POOL_H
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <memory>
+
+
+namespace sp {
+
+/// Runs a fixed set of tasks on a number of worker threads.
+///
+/// Each worker owns a deque of tasks, dealt round-robin. A worker takes
+/// tasks from the back of its own deque; once it is empty, it steals from the
+/// front of the others', so long tasks (large files) do not leave the other
+/// workers idle while the owner's queue still holds work.
+class work_stealing_pool
+{
+public:
+  /// A task receives the index of the worker running it, e.g. to reuse
+  /// per-worker buffers.
+  typedef std::function<void(size_t worker)> task_type;
+
+  /// Parameters:
+  ///   worker_count:
+  ///     The number of threads, at least 1.
+  explicit work_stealing_pool(size_t worker_count)
+  : queues()
+  {
+    for(size_t i = 0; i < (worker_count ? worker_count : 1); ++i)
+      this->queues.emplace_back(new queue());
+  }
+
+  work_stealing_pool(const work_stealing_pool&) = delete;
+  work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+  size_t size() const
+  {
+    return this->queues.size();
+  }
+
+  /// Run all tasks and wait for them. Tasks must not throw.
+  void run(std::vector<task_type> tasks)
+  {
+    for(size_t i = 0; i < tasks.size(); ++i)
+      this->queues[i % this->queues.size()]->tasks.push_back(std::move(tasks[i]));
+
+    // the calling thread is worker 0
+    std::vector<std::thread> threads;
+    for(size_t w = 1; w < this->queues.size(); ++w)
+      threads.emplace_back(&work_stealing_pool::work, this, w);
+
+    this->work(0);
+
+    for(auto& t : threads)
+      t.join();
+  }
+
+private:
+  struct queue
+  {
+    queue()
+    : mutex(),
+      tasks()
+    {
+    }
+
+    std::mutex mutex;
+    std::deque<task_type> tasks;
+  };
+
+  void work(size_t worker)
+  {
+    task_type task;
+    while( this->pop(worker, task) || this->steal(worker, task) )
+      task(worker);
+  }
+
+  /// Take the newest task of the worker's own queue.
+  bool pop(size_t worker, task_type& task)
+  {
+    queue& q = *this->queues[worker];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if( q.tasks.empty() )
+      return false;
+
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+  }
+
+  /// Take the oldest task of another worker's queue. No tasks are added
+  /// while running, once every queue is empty the work is done.
+  bool steal(size_t worker, task_type& task)
+  {
+    for(size_t i = 1; i < this->queues.size(); ++i)
+    {
+      queue& q = *this->queues[(worker + i) % this->queues.size()];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if( q.tasks.empty() )
+        continue;
+
+      task = std::move(q.tasks.front());
+      q.tasks.pop_front();
+      return true;
+    }
+
+    return false;
+  }
+
+  std::vector<std::unique_ptr<queue>> queues;
+};
+
+
+}
+
+#endif // SP_WORK_STEALING_POOL_H
@@ -0,0 +1,87 @@
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "gtest/gtest.h"
+
+#include "corpus/generate.h"
+#include "hm/encode.h"
+#include "hm/decode.h"
+#include "hm/crc32c.h"
+
+namespace {
+
+TEST(Corpus, Deterministic)
+{
+  for(auto s : corpus::shapes)
+  {
+    const auto first = corpus::generate(s, 4096, 4, 256);
+    const auto second = corpus::generate(s, 4096, 4, 256);
+    const auto other_seed = corpus::generate(s, 4096, 4, 256, corpus::default_seed + 1);
+
+    EXPECT_EQ(first.size(), 4096) << corpus::shape_name(s);
+    EXPECT_EQ(first, second) << corpus::shape_name(s);
+    EXPECT_NE(first, other_seed) << corpus::shape_name(s);
+  }
+
+  // the same on every platform: benchmark numbers stay comparable
+  const auto zipf = corpus::generate(corpus::zipf, 4096, 2, 1000);
+  EXPECT_EQ(hm::crc32c(zipf.data(), zipf.size()), 0x9ea1655fU);
+}
+
+TEST(Corpus, Sizes)
+{
+  // rounded down to a multiple of the entity size
+  EXPECT_EQ(corpus::generate(corpus::uniform, 1001, 8, 16).size(), 1000);
+  EXPECT_EQ(corpus::generate(corpus::text, 7, 8, 16).size(), 0);
+
+  EXPECT_THROW(corpus::generate(corpus::uniform, 16, 0, 16), std::invalid_argument);
+  EXPECT_THROW(corpus::generate(corpus::uniform, 16, 9, 16), std::invalid_argument);
+  EXPECT_THROW(corpus::generate(corpus::uniform, 16, 1, 0), std::invalid_argument);
+}
+
+TEST(Corpus, Alphabet)
+{
+  const corpus::shape shapes[] = {
+    corpus::uniform, corpus::zipf, corpus::geometric, corpus::runs
+  };
+
+  for(auto s : shapes)
+  {
+    const auto input = corpus::generate(s, 1 << 16, 8, 100);
+    const auto table = hm::build_frequency_table<uint64_t>(input.begin(), input.end());
+    EXPECT_LE(table.size(), 100) << corpus::shape_name(s);
+
+    size_t max_frequency = 0;
+    for(const auto& f : table)
+      max_frequency = std::max(max_frequency, f.second);
+
+    // all but uniform put far more than 1/100 of the mass on one symbol
+    if( s == corpus::uniform )
+      EXPECT_LT(max_frequency, (input.size() / 8) / 50) << corpus::shape_name(s);
+    else
+      EXPECT_GT(max_frequency, (input.size() / 8) / 25) << corpus::shape_name(s);
+  }
+}
+
+TEST(Corpus, RoundTrip)
+{
+  for(auto s : corpus::shapes)
+  {
+    const auto input = corpus::generate(s, 1 << 14, 8, 4096);
+
+    auto tree = hm::build_huffman_tree<uint64_t>(input.begin(), input.end());
+    std::vector<uint8_t> encoded;
+    const auto md = hm::encode(input.begin(), input.end(), tree.get(), std::back_inserter(encoded));
+
+    std::vector<uint8_t> decoded;
+    hm::decode<hm::byte_entity<8>>(md, encoded.begin(), encoded.end(), std::back_inserter(decoded));
+    EXPECT_EQ(decoded, input) << corpus::shape_name(s);
+  }
+}
+
+
+}
@@ -0,0 +1,60 @@
+#ifndef HLP_ALLOCATION_COUNTER_H
+#define HLP_ALLOCATION_COUNTER_H
+
+#include <new>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+// Replaces the global operator new and delete to count allocations.
+// The replacement must be defined exactly once per program: the tests are
+// a single translation unit (test/src/main.cpp).
+
+namespace hlp {
+
+inline std::atomic<uint64_t>& allocation_count()
+{
+  static std::atomic<uint64_t> count(0);
+  return count;
+}
+
+
+/// Counts the allocations from construction to the call of count().
+class allocation_scope
+{
+public:
+  allocation_scope()
+  : begin(::hlp::allocation_count().load())
+  {
+  }
+
+  uint64_t count() const
+  {
+    return ::hlp::allocation_count().load() - this->begin;
+  }
+
+private:
+  const uint64_t begin;
+};
+
+
+}
+
+
+void * operator new(std::size_t size)
+{
+  ++::hlp::allocation_count();
+
+  // malloc(0) may return null
+  if( void * p = std::malloc(size ? size : 1) )
+    return p;
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void * p) noexcept
+{
+  std::free(p);
+}
+
+#endif // HLP_ALLOCATION_COUNTER_H
@@ -0,0 +1,28 @@
+#ifndef HLP_GET_TEST_BYTES_H
+#define HLP_GET_TEST_BYTES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+
+namespace hlp {
+
+/// Return byte_count pseudo random bytes, the same for the same seed.
+/// A std::string, which std::stringbuf and the streambufs under test accept
+/// directly.
+inline std::string get_test_bytes(size_t byte_count, uint32_t seed = 0)
+{
+  std::mt19937 engine(seed);
+  std::string bytes(byte_count, '\0');
+  for(auto& byte : bytes)
+    byte = static_cast<char>(engine() & 0xffU);
+
+  return bytes;
+}
+
+
+}
+
+#endif // HLP_GET_TEST_BYTES_H
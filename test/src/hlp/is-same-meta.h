@@ -15,7 +15,15 @@ bool is_same_meta(const hm::meta& left, const hm::meta& right)
     left.entity_size     == right.entity_size     &&
     left.entity_count    == right.entity_count    &&
     left.tree_byte_count == right.tree_byte_count &&
-    left.data_byte_count == right.data_byte_count
+    left.data_byte_count == right.data_byte_count &&
+    left.flags           == right.flags           &&
+    left.filter          == right.filter          &&
+    left.checksum        == right.checksum        &&
+    left.index_interval  == right.index_interval  &&
+    left.index_entry_count == right.index_entry_count &&
+    left.entity_byte_count == right.entity_byte_count &&
+    left.original_byte_count == right.original_byte_count &&
+    left.escape_leaf == right.escape_leaf
   ;
 }
 
@@ -0,0 +1,76 @@
+#ifndef HLP_TEMP_FILE_H
+#define HLP_TEMP_FILE_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+
+#include <unistd.h>
+
+
+namespace hlp {
+
+/// An empty file in the temporary directory, removed on destruction.
+class temp_file
+{
+public:
+  temp_file()
+  : name()
+  {
+    const char * dir = std::getenv("TMPDIR");
+    std::string pattern = std::string(dir ? dir : "/tmp") + "/huffman-test-XXXXXX";
+
+    std::vector<char> buffer(pattern.begin(), pattern.end());
+    buffer.push_back('\0');
+
+    const int fd = ::mkstemp(buffer.data());
+    if( fd >= 0 )
+    {
+      ::close(fd);
+      this->name = buffer.data();
+    }
+  }
+
+  temp_file(const temp_file&) = delete;
+  temp_file& operator=(const temp_file&) = delete;
+
+  ~temp_file()
+  {
+    if( !this->name.empty() )
+      std::remove(this->name.c_str());
+  }
+
+  /// The path of the file, empty if it could not be created.
+  const std::string& path() const
+  {
+    return this->name;
+  }
+
+  /// Replace the contents of the file.
+  void write(const std::string& bytes) const
+  {
+    std::ofstream out(this->name, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  }
+
+  /// The contents of the file.
+  std::string read() const
+  {
+    std::ifstream in(this->name, std::ios::binary);
+    return std::string(
+      (std::istreambuf_iterator<char>(in)),
+      std::istreambuf_iterator<char>()
+    );
+  }
+
+private:
+  std::string name;
+};
+
+
+}
+
+#endif // HLP_TEMP_FILE_H
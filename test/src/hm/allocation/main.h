@@ -0,0 +1,162 @@
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <unordered_map>
+
+#include "gtest/gtest.h"
+
+#include "hlp/allocation-counter.h"
+#include "hlp/testing-types.h"
+
+#include "corpus/generate.h"
+#include "hm/encode.h"
+#include "hm/decode.h"
+
+// Allocation budgets of the phases of encoding and decoding. The loops over
+// the input must not allocate at all; building tables may allocate per
+// entity, but not per bit of a code.
+
+namespace {
+
+namespace hlp {
+
+  // An encoded corpus with everything needed to decode it.
+  struct encoded
+  {
+    encoded()
+    : md(),
+      entities(),
+      tree(),
+      data()
+    {
+    }
+
+    hm::meta md;
+    std::vector<uint8_t> entities;
+    std::vector<uint8_t> tree;
+    std::vector<uint8_t> data;
+  };
+
+  template<typename entity_type>
+  encoded encode(const std::vector<uint8_t>& input)
+  {
+    encoded e;
+    e.md.entity_size = sizeof(entity_type);
+
+    auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+    hm::encode_entities(tree.get(), std::back_inserter(e.entities), e.md);
+    hm::encode_tree(tree.get(), std::back_inserter(e.tree), e.md);
+    hm::encode_data(input.begin(), input.end(), tree.get(), std::back_inserter(e.data), e.md);
+
+    return e;
+  }
+
+  template<typename decode_type>
+  void expect_decode_data_allocates_nothing(
+    const encoded& e,
+    const std::vector<uint8_t>& input
+  )
+  {
+    auto entities = hm::decode_entities<decode_type>(e.entities.begin(), e.entities.end(), e.md);
+    auto tree = hm::decode_tree(e.tree.begin(), e.tree.end(), entities, e.md);
+
+    std::vector<uint8_t> out(input.size());
+    ::hlp::allocation_scope allocations;
+    hm::decode_data(e.data.begin(), e.data.end(), tree.get(), e.md, out.begin());
+    EXPECT_EQ(allocations.count(), 0);
+
+    EXPECT_EQ(out, input);
+  }
+
+}
+
+template <typename T>
+class HmAllocationT : public ::testing::Test
+{
+protected:
+  static std::vector<uint8_t> input()
+  {
+    return corpus::generate(corpus::zipf, 1 << 16, sizeof(T), 1000);
+  }
+};
+TYPED_TEST_CASE(HmAllocationT, ::hlp::testing_types);
+
+TYPED_TEST(HmAllocationT, BuildHuffmanTable)
+{
+  typedef TypeParam entity_type;
+  const auto input = TestFixture::input();
+  const auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+  const auto frequencies = hm::build_frequency_table<entity_type>(input.begin(), input.end());
+
+  std::unordered_map<entity_type, hm::code_type> table;
+  table.reserve(frequencies.size());
+  hm::code_type prefix;
+  prefix.reserve(64);
+
+  // a node and a code per entity
+  ::hlp::allocation_scope allocations;
+  hm::build_huffman_table<entity_type>(tree.get(), table, prefix);
+  EXPECT_LE(allocations.count(), 2 * frequencies.size());
+
+  EXPECT_EQ(table.size(), frequencies.size());
+  EXPECT_TRUE(prefix.empty());
+}
+
+TYPED_TEST(HmAllocationT, EncodeData)
+{
+  typedef TypeParam entity_type;
+  const auto input = TestFixture::input();
+  const auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+
+  std::unordered_map<entity_type, hm::code_type> table;
+  hm::code_type prefix;
+  hm::build_huffman_table<entity_type>(tree.get(), table, prefix);
+
+  hm::meta reference;
+  std::vector<uint8_t> expected;
+  hm::encode_data(input.begin(), input.end(), table, std::back_inserter(expected), reference);
+
+  hm::meta md;
+  std::vector<uint8_t> out(expected.size());
+  ::hlp::allocation_scope allocations;
+  hm::encode_data(input.begin(), input.end(), table, out.begin(), md);
+  EXPECT_EQ(allocations.count(), 0);
+
+  EXPECT_EQ(out, expected);
+}
+
+TYPED_TEST(HmAllocationT, EncodeTree)
+{
+  typedef TypeParam entity_type;
+  const auto input = TestFixture::input();
+  const auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+
+  hm::meta reference;
+  std::vector<uint8_t> expected;
+  hm::encode_tree(tree.get(), std::back_inserter(expected), reference);
+
+  // encode_tree passes its output iterator down by value, it needs an
+  // inserter
+  hm::meta md;
+  std::vector<uint8_t> out;
+  out.reserve(expected.size());
+  ::hlp::allocation_scope allocations;
+  hm::encode_tree(tree.get(), std::back_inserter(out), md);
+  EXPECT_EQ(allocations.count(), 0);
+
+  EXPECT_EQ(out, expected);
+}
+
+TYPED_TEST(HmAllocationT, DecodeData)
+{
+  typedef TypeParam entity_type;
+  const auto input = TestFixture::input();
+  const auto e = hlp::encode<entity_type>(input);
+
+  // the default byte-vector entities as well as byte entities
+  hlp::expect_decode_data_allocates_nothing<std::vector<uint8_t>>(e, input);
+  hlp::expect_decode_data_allocates_nothing<hm::byte_entity<sizeof(entity_type)>>(e, input);
+}
+
+
+}
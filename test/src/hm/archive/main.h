@@ -0,0 +1,184 @@
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <iterator>
+
+#include "gtest/gtest.h"
+
+#include "hm/archive.h"
+#include "hm/crc32c.h"
+
+namespace {
+
+std::vector<hm::archive_member> get_test_members()
+{
+  std::vector<hm::archive_member> members(3);
+
+  members[0].name = "a.txt";
+  members[0].offset = 0;
+  members[0].byte_count = 100;
+  members[0].original_byte_count = 250;
+  members[0].checksum = 0x12345678U;
+
+  members[1].name = "empty";
+  members[1].offset = 100;
+  members[1].byte_count = 22;
+  members[1].original_byte_count = 0;
+  members[1].checksum = 0;
+
+  members[2].name = "b.bin";
+  members[2].offset = 122;
+  members[2].byte_count = 1U << 20U;
+  members[2].original_byte_count = 1ULL << 33U;
+  members[2].checksum = 0xffffffffU;
+
+  return members;
+}
+
+/// Encode a directory and trailer for members, with the directory following
+/// directory_offset bytes of members.
+std::vector<uint8_t> encode_test_directory(
+  const std::vector<hm::archive_member>& members,
+  uint64_t directory_offset,
+  hm::archive_trailer& trailer
+)
+{
+  std::vector<uint8_t> out = hm::encode_archive_directory(members);
+
+  trailer.directory_offset = directory_offset;
+  trailer.directory_byte_count = out.size();
+  trailer.directory_checksum = hm::crc32c(out.data(), out.size());
+  hm::encode_archive_trailer(trailer, std::back_inserter(out));
+
+  return out;
+}
+
+TEST(HmArchive, RoundTrip)
+{
+  const auto members = get_test_members();
+  hm::archive_trailer trailer;
+  const auto out = encode_test_directory(members, 122 + (1U << 20U), trailer);
+
+  auto trailer_begin = out.end() - hm::archive_trailer_byte_count;
+  const auto decoded_trailer = hm::decode_archive_trailer(trailer_begin, out.end());
+  EXPECT_TRUE(trailer_begin == out.end());
+  EXPECT_EQ(decoded_trailer.directory_offset, trailer.directory_offset);
+  EXPECT_EQ(decoded_trailer.directory_byte_count, trailer.directory_byte_count);
+  EXPECT_EQ(decoded_trailer.directory_checksum, trailer.directory_checksum);
+
+  auto in_begin = out.begin();
+  const auto decoded = hm::decode_archive_directory(in_begin, out.end(), decoded_trailer);
+  EXPECT_EQ(
+    static_cast<uint64_t>(in_begin - out.begin()),
+    decoded_trailer.directory_byte_count
+  );
+
+  ASSERT_EQ(decoded.size(), members.size());
+  for(size_t i = 0; i < members.size(); ++i)
+  {
+    EXPECT_EQ(decoded[i].name, members[i].name);
+    EXPECT_EQ(decoded[i].offset, members[i].offset);
+    EXPECT_EQ(decoded[i].byte_count, members[i].byte_count);
+    EXPECT_EQ(decoded[i].original_byte_count, members[i].original_byte_count);
+    EXPECT_EQ(decoded[i].checksum, members[i].checksum);
+  }
+}
+
+TEST(HmArchive, EmptyDirectory)
+{
+  hm::archive_trailer trailer;
+  const auto out = encode_test_directory({}, 0, trailer);
+  EXPECT_EQ(out.size(), 1 + hm::archive_trailer_byte_count);
+
+  auto in_begin = out.begin();
+  EXPECT_TRUE(hm::decode_archive_directory(in_begin, out.end(), trailer).empty());
+}
+
+TEST(HmArchive, ThrowsInvalid)
+{
+  const auto members = get_test_members();
+  hm::archive_trailer trailer;
+  const auto out = encode_test_directory(members, 122 + (1U << 20U), trailer);
+
+  // not an archive
+  std::vector<uint8_t> bad_magic(out);
+  bad_magic.back() ^= 0x01;
+  auto magic_begin = bad_magic.end() - hm::archive_trailer_byte_count;
+  EXPECT_THROW(
+    hm::decode_archive_trailer(magic_begin, bad_magic.end()),
+    hm::invalid_layout
+  );
+
+  // a flipped bit in the directory
+  std::vector<uint8_t> corrupt(out);
+  corrupt[3] ^= 0x10;
+  auto corrupt_begin = corrupt.begin();
+  EXPECT_THROW(
+    hm::decode_archive_directory(corrupt_begin, corrupt.end(), trailer),
+    hm::invalid_layout
+  );
+
+  // truncated
+  auto short_begin = out.begin();
+  const auto short_end = out.begin() + 5;
+  EXPECT_THROW(
+    hm::decode_archive_directory(short_begin, short_end, trailer),
+    hm::invalid_layout
+  );
+
+  // the last member overlaps the directory
+  hm::archive_trailer overlap_trailer;
+  const auto overlap = encode_test_directory(members, 1U << 20U, overlap_trailer);
+  auto overlap_begin = overlap.begin();
+  EXPECT_THROW(
+    hm::decode_archive_directory(overlap_begin, overlap.end(), overlap_trailer),
+    hm::invalid_layout
+  );
+
+  // a name with a directory
+  auto with_path = members;
+  with_path[1].name = "../empty";
+  hm::archive_trailer path_trailer;
+  const auto path = encode_test_directory(with_path, 122 + (1U << 20U), path_trailer);
+  auto path_begin = path.begin();
+  EXPECT_THROW(
+    hm::decode_archive_directory(path_begin, path.end(), path_trailer),
+    hm::invalid_layout
+  );
+}
+
+TEST(HmArchive, MemberNames)
+{
+  EXPECT_TRUE(hm::is_valid_member_name("a"));
+  EXPECT_TRUE(hm::is_valid_member_name(".hidden"));
+  EXPECT_TRUE(hm::is_valid_member_name("a..b"));
+
+  EXPECT_FALSE(hm::is_valid_member_name(""));
+  EXPECT_FALSE(hm::is_valid_member_name("."));
+  EXPECT_FALSE(hm::is_valid_member_name(".."));
+  EXPECT_FALSE(hm::is_valid_member_name("dir/a"));
+  EXPECT_FALSE(hm::is_valid_member_name("/a"));
+  EXPECT_FALSE(hm::is_valid_member_name(std::string("a\0b", 3)));
+}
+
+TEST(HmArchive, IndexFindsMembers)
+{
+  const auto members = get_test_members();
+  const hm::archive_index index(members);
+
+  ASSERT_EQ(index.members().size(), members.size());
+  for(const auto& member : members)
+  {
+    const hm::archive_member * found = index.find(member.name);
+    ASSERT_NE(found, nullptr);
+    EXPECT_EQ(found->offset, member.offset);
+  }
+
+  EXPECT_EQ(index.find("missing"), nullptr);
+
+  auto duplicate = members;
+  duplicate[2].name = duplicate[0].name;
+  EXPECT_THROW(hm::archive_index{duplicate}, hm::invalid_layout);
+}
+
+}
@@ -9,6 +9,7 @@
 #include "gtest/gtest.h"
 
 #include "hm/common.h"
+#include "hm/encode.h"
 
 namespace {
 
@@ -20,6 +21,7 @@ TEST(HmCommon, HmMetaUnchanged)
   EXPECT_TRUE((std::is_same<hm::meta::entity_count_type, uint32_t>::value));
   EXPECT_TRUE((std::is_same<hm::meta::tree_count_type, uint32_t>::value));
   EXPECT_TRUE((std::is_same<hm::meta::data_count_type, uint64_t>::value));
+  EXPECT_TRUE((std::is_same<hm::meta::flags_type, uint16_t>::value));
 
   EXPECT_EQ(hm::max_shifts_in_byte, 7U);
 }
@@ -187,6 +189,61 @@ TEST(HmCommonEncodeType, EncodesTypes)
   EXPECT_TRUE(std::equal(bytes.begin(), bytes.end(), out.begin()));
 }
 
+TEST(HmCommon, MetaByteCount)
+{
+  hm::meta md;
+
+  md.version = 10;
+  std::vector<uint8_t> bytes;
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  EXPECT_EQ(hm::meta_byte_count(md), bytes.size());
+
+  md.version = hm::current_version;
+  const hm::meta::flags_type flags[] = {
+    0, hm::flag_rle, hm::flag_filter, hm::flag_checksum, hm::flag_index,
+    hm::flag_compact_entities, hm::flag_original_size, hm::flag_escape,
+    hm::known_flags
+  };
+  for(auto f : flags)
+  {
+    md.flags = f;
+    bytes.clear();
+    hm::encode_meta_data(md, std::back_inserter(bytes));
+    EXPECT_EQ(hm::meta_byte_count(md), bytes.size());
+  }
+}
+
+TEST(HmCommon, LayoutByteCount)
+{
+  const char * input = "This is a test.";
+  std::vector<uint8_t> out;
+
+  auto tree = hm::build_huffman_tree<char>(input, input + strlen(input));
+  auto md = hm::encode(input, input + strlen(input), tree.get(), std::back_inserter(out));
+  hm::encode_meta_data(md, std::back_inserter(out));
+
+  EXPECT_EQ(hm::layout_byte_count(md), out.size());
+}
+
+TEST(HmCommon, GetOriginalByteCount)
+{
+  hm::meta md;
+  md.version = hm::current_version;
+  md.data_byte_count = 10;
+
+  uint64_t byte_count = 0;
+  EXPECT_FALSE(hm::get_original_byte_count(md, byte_count));
+
+  md.flags = hm::flag_original_size;
+  md.original_byte_count = 20;
+  EXPECT_TRUE(hm::get_original_byte_count(md, byte_count));
+  EXPECT_EQ(byte_count, 20);
+
+  const auto stored = hm::make_stored_meta(30, 4);
+  EXPECT_TRUE(hm::get_original_byte_count(stored, byte_count));
+  EXPECT_EQ(byte_count, 30);
+}
+
 TEST(HmCommonDeathTest, GetBit)
 {
   // test assert
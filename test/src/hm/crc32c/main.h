@@ -0,0 +1,68 @@
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include "gtest/gtest.h"
+
+#include "hm/crc32c.h"
+
+namespace {
+
+TEST(HmCrc32c, KnownValues)
+{
+  const char * digits = "123456789";
+  EXPECT_EQ(
+    hm::crc32c(reinterpret_cast<const uint8_t *>(digits), std::strlen(digits)),
+    0xe3069283U
+  );
+
+  // RFC 3720 (iSCSI), B.4
+  const std::vector<uint8_t> zeros(32, 0x00);
+  EXPECT_EQ(hm::crc32c(zeros.data(), zeros.size()), 0x8a9136aaU);
+
+  const std::vector<uint8_t> ones(32, 0xff);
+  EXPECT_EQ(hm::crc32c(ones.data(), ones.size()), 0x62a8ab43U);
+
+  EXPECT_EQ(hm::crc32c(nullptr, 0), 0U);
+}
+
+TEST(HmCrc32c, ContinuesBlocks)
+{
+  std::vector<uint8_t> input(1000);
+  for(size_t i = 0; i < input.size(); ++i)
+    input[i] = static_cast<uint8_t>(i * 31 + i / 7);
+
+  const uint32_t whole = hm::crc32c(input.data(), input.size());
+
+  // all split points, covering unaligned heads and short tails
+  for(size_t split = 0; split <= 67; ++split)
+  {
+    const uint32_t head = hm::crc32c(input.data(), split);
+    EXPECT_EQ(hm::crc32c(input.data() + split, input.size() - split, head), whole);
+  }
+}
+
+TEST(HmCrc32c, SlicingMatchesBitwise)
+{
+  std::vector<uint8_t> input(100);
+  for(size_t i = 0; i < input.size(); ++i)
+    input[i] = static_cast<uint8_t>(i * 131 + 7);
+
+  for(size_t size = 0; size <= input.size(); ++size)
+  {
+    uint32_t expected = ~0U;
+    for(size_t i = 0; i < size; ++i)
+    {
+      expected ^= input[i];
+      for(int bit = 0; bit < 8; ++bit)
+        expected = (expected >> 1) ^ (expected & 1U ? hm::crc32c_polynomial : 0U);
+    }
+    expected = ~expected;
+
+    EXPECT_EQ(~hm::crc32c_slicing8(~0U, input.data(), size), expected);
+    EXPECT_EQ(hm::crc32c(input.data(), size), expected);
+  }
+}
+
+
+}
@@ -40,6 +40,149 @@ TEST(HmDecodeMetaData, ThrowsInvalidLayout)
       std::end(enough)
     )
   );
+
+  // starting with version 11 the flags follow
+  uint8_t missing_flags[expected_bytes] = {0};
+  missing_flags[0] = 11;
+  EXPECT_THROW(
+    hm::decode_meta_data(
+      std::begin(missing_flags),
+      std::end(missing_flags)
+    ),
+    hm::invalid_layout
+  );
+
+  uint8_t with_flags[expected_bytes + sizeof(hm::meta::flags_type)] = {0};
+  with_flags[0] = 11;
+  EXPECT_NO_THROW(
+    hm::decode_meta_data(
+      std::begin(with_flags),
+      std::end(with_flags)
+    )
+  );
+}
+
+TEST(HmDecodeMetaData, ThrowsUnknownFlags)
+{
+  hm::meta md;
+  md.version = hm::current_version;
+  md.flags = static_cast<hm::meta::flags_type>(~hm::known_flags);
+
+  std::vector<uint8_t> bytes;
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  EXPECT_THROW(hm::decode_meta_data(bytes.begin(), bytes.end()), hm::invalid_layout);
+}
+
+TEST(HmDecodeMetaData, ThrowsUnknownFilter)
+{
+  hm::meta md;
+  md.version = hm::current_version;
+  md.flags = hm::flag_filter;
+  md.filter = hm::filter_xor + 1;
+
+  std::vector<uint8_t> bytes;
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  EXPECT_THROW(hm::decode_meta_data(bytes.begin(), bytes.end()), hm::invalid_layout);
+
+  // the filter is only present with hm::flag_filter
+  md.flags = 0;
+  bytes.clear();
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  EXPECT_EQ(hm::decode_meta_data(bytes.begin(), bytes.end()).filter, hm::filter_none);
+}
+
+TEST(HmDecodeMetaData, DecodesChecksum)
+{
+  hm::meta md;
+  md.version = hm::current_version;
+  md.flags = hm::flag_checksum | hm::flag_filter;
+  md.filter = hm::filter_delta;
+  md.checksum = 0xe3069283U;
+
+  std::vector<uint8_t> bytes;
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  EXPECT_EQ(bytes.size(), hm::meta_byte_count(md));
+  EXPECT_TRUE(::hlp::is_same_meta(md, hm::decode_meta_data(bytes.begin(), bytes.end())));
+
+  // stored layouts may carry a checksum
+  md = hm::make_stored_meta(0, 1);
+  md.flags = hm::flag_stored | hm::flag_checksum;
+  md.checksum = 42;
+  bytes.clear();
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  EXPECT_TRUE(::hlp::is_same_meta(md, hm::decode_meta_data(bytes.begin(), bytes.end())));
+
+  // the checksum is only present with hm::flag_checksum
+  md.flags = hm::flag_stored;
+  bytes.clear();
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  EXPECT_EQ(hm::decode_meta_data(bytes.begin(), bytes.end()).checksum, 0);
+}
+
+TEST(HmDecodeMetaData, DecodesOriginalSize)
+{
+  hm::meta md;
+  md.version = hm::current_version;
+  md.flags = hm::flag_original_size | hm::flag_checksum | hm::flag_compact_entities;
+  md.entity_size = 2;
+  md.checksum = 7;
+  md.entity_byte_count = 300;
+  md.original_byte_count = (1ULL << 40U) + 3;
+
+  std::vector<uint8_t> bytes;
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  EXPECT_EQ(bytes.size(), hm::meta_byte_count(md));
+  EXPECT_TRUE(::hlp::is_same_meta(md, hm::decode_meta_data(bytes.begin(), bytes.end())));
+
+  // the original size is only present with hm::flag_original_size
+  md.flags = hm::flag_checksum;
+  bytes.clear();
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  EXPECT_EQ(hm::decode_meta_data(bytes.begin(), bytes.end()).original_byte_count, 0);
+
+  // stored layouts are their original size
+  md = hm::make_stored_meta(0, 1);
+  md.flags = hm::flag_stored | hm::flag_original_size;
+  bytes.clear();
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  EXPECT_THROW(hm::decode_meta_data(bytes.begin(), bytes.end()), hm::invalid_layout);
+}
+
+TEST(HmDecodeMetaData, DecodesEscape)
+{
+  hm::meta md;
+  md.version = hm::current_version;
+  md.flags = hm::flag_escape | hm::flag_index;
+  md.entity_size = 4;
+  md.entity_count = 10;
+  md.index_interval = 3;
+  md.escape_leaf = 9;
+
+  std::vector<uint8_t> bytes;
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  EXPECT_EQ(bytes.size(), hm::meta_byte_count(md));
+  EXPECT_TRUE(::hlp::is_same_meta(md, hm::decode_meta_data(bytes.begin(), bytes.end())));
+
+  // the escape must be one of the leaves
+  md.escape_leaf = 10;
+  bytes.clear();
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  EXPECT_THROW(hm::decode_meta_data(bytes.begin(), bytes.end()), hm::invalid_layout);
+}
+
+TEST(HmDecodeMetaData, DecodesVersion10)
+{
+  hm::meta md;
+  md.version = 10;
+  md.flags = hm::flag_rle;
+
+  // version 10 has no flags
+  std::vector<uint8_t> bytes;
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  auto md_decoded = hm::decode_meta_data(bytes.begin(), bytes.end());
+
+  EXPECT_EQ(md_decoded.version, 10);
+  EXPECT_EQ(md_decoded.flags, 0);
 }
 
 TEST(HmDecodeMetaData, DecodesMeta)
@@ -52,6 +195,8 @@ TEST(HmDecodeMetaData, DecodesMeta)
   md.entity_count = 221;
   md.tree_byte_count = 212;
   md.data_byte_count = 203;
+  md.flags = hm::flag_rle | hm::flag_filter;
+  md.filter = hm::filter_delta_delta;
 
   std::vector<uint8_t> bytes;
   hm::encode_meta_data(md, std::back_inserter(bytes));
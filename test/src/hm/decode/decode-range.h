@@ -0,0 +1,141 @@
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+#include "hm/encode.h"
+#include "hm/decode.h"
+
+#include "hlp/get-test-data.h"
+#include "hlp/testing-types.h"
+#include "hlp/is-same-meta.h"
+
+namespace {
+
+template<typename T>
+class HmDecodeRangeT : public ::testing::Test {};
+TYPED_TEST_CASE(HmDecodeRangeT, ::hlp::testing_types);
+TYPED_TEST(HmDecodeRangeT, DecodesRange)
+{
+  typedef TypeParam entity_type;
+  const size_t size = sizeof(entity_type);
+
+  auto inputs = ::hlp::get_test_data<entity_type>();
+  std::vector<uint8_t> long_input(size * 1000);
+  for(size_t i = 0; i < long_input.size(); ++i)
+    long_input[i] = static_cast<uint8_t>(i % 7 + i % 13);
+  inputs.push_back(long_input);
+
+  for(const auto& input : inputs)
+  {
+    const uint64_t entity_count = input.size() / size;
+
+    for(hm::meta::index_interval_type interval : {1, 3, 64})
+    {
+      std::vector<uint8_t> enc_out;
+      auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+      auto md = hm::encode(
+        input.begin(),
+        input.end(),
+        tree.get(),
+        std::back_inserter(enc_out),
+        interval
+      );
+
+      EXPECT_EQ(md.flags, hm::flag_index);
+      EXPECT_EQ(md.index_entry_count, (entity_count + interval - 1) / interval);
+      EXPECT_EQ(hm::layout_byte_count(md), hm::meta_byte_count(md) + enc_out.size());
+
+      // the index does not disturb decoding the whole input
+      std::vector<uint8_t> dec_out;
+      hm::decode(md, enc_out.begin(), enc_out.end(), std::back_inserter(dec_out));
+      EXPECT_EQ(dec_out, input);
+
+      const std::vector<uint64_t> starts {0, 1, 2, 3, 63, 64, 65, entity_count / 2, entity_count};
+      for(auto start : starts)
+      {
+        for(uint64_t count : {0, 1, 2, 70, 2000})
+        {
+          std::vector<uint8_t> range_out;
+          hm::decode_range(
+            md,
+            enc_out.begin(),
+            enc_out.end(),
+            start,
+            count,
+            std::back_inserter(range_out)
+          );
+
+          const uint64_t first = std::min(start, entity_count);
+          const uint64_t last = std::min(first + count, entity_count);
+          const std::vector<uint8_t> expected(
+            input.begin() + static_cast<long>(first * size),
+            input.begin() + static_cast<long>(last * size)
+          );
+          EXPECT_EQ(range_out, expected);
+        }
+      }
+    }
+  }
+}
+
+TEST(HmDecodeRange, DecodesStoredRange)
+{
+  const std::vector<uint8_t> input {'A', 'B', 'C', 'D', 'E', 'F'};
+
+  std::vector<uint8_t> enc_out;
+  auto md = hm::encode_stored(input.begin(), input.end(), std::back_inserter(enc_out));
+  md.entity_size = 2;
+
+  std::vector<uint8_t> out;
+  hm::decode_range(md, enc_out.begin(), enc_out.end(), 1, 1, std::back_inserter(out));
+  EXPECT_EQ(out, std::vector<uint8_t>({'C', 'D'}));
+
+  out.clear();
+  hm::decode_range(md, enc_out.begin(), enc_out.end(), 2, 5, std::back_inserter(out));
+  EXPECT_EQ(out, std::vector<uint8_t>({'E', 'F'}));
+
+  out.clear();
+  hm::decode_range(md, enc_out.begin(), enc_out.end(), 7, 5, std::back_inserter(out));
+  EXPECT_TRUE(out.empty());
+}
+
+TEST(HmDecodeRange, ThrowsWithoutIndex)
+{
+  const std::vector<uint8_t> input {'A', 'B', 'B', 'C'};
+
+  std::vector<uint8_t> enc_out;
+  auto tree = hm::build_huffman_tree<uint8_t>(input.begin(), input.end());
+  auto md = hm::encode(input.begin(), input.end(), tree.get(), std::back_inserter(enc_out));
+
+  std::vector<uint8_t> out;
+  EXPECT_THROW(
+    hm::decode_range(md, enc_out.begin(), enc_out.end(), 0, 1, std::back_inserter(out)),
+    hm::invalid_layout
+  );
+}
+
+TEST(HmDecodeRange, DecodesIndexMeta)
+{
+  hm::meta md;
+  md.version = hm::current_version;
+  md.flags = hm::flag_index;
+  md.index_interval = 1024;
+  md.index_entry_count = 12345678901ULL;
+
+  std::vector<uint8_t> bytes;
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  EXPECT_EQ(bytes.size(), hm::meta_byte_count(md));
+  EXPECT_TRUE(::hlp::is_same_meta(md, hm::decode_meta_data(bytes.begin(), bytes.end())));
+
+  // an interval of 0 is invalid
+  md.index_interval = 0;
+  bytes.clear();
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  EXPECT_THROW(hm::decode_meta_data(bytes.begin(), bytes.end()), hm::invalid_layout);
+}
+
+
+}
@@ -0,0 +1,74 @@
+#include <vector>
+#include <cstdint>
+#include <iterator>
+
+#include "gtest/gtest.h"
+
+#include "hm/encode.h"
+#include "hm/decode.h"
+
+namespace {
+
+TEST(HmDecodeStored, Decodes)
+{
+  const std::vector<uint8_t> input {'A', 'B', 'C', 0, 255};
+
+  std::vector<uint8_t> enc_out;
+  auto md = hm::encode_stored(input.begin(), input.end(), std::back_inserter(enc_out));
+
+  std::vector<uint8_t> dec_out;
+  hm::decode_stored(md, enc_out.begin(), enc_out.end(), std::back_inserter(dec_out));
+  EXPECT_EQ(dec_out, input);
+
+  // hm::decode recognizes stored layouts
+  dec_out.clear();
+  hm::decode(md, enc_out.begin(), enc_out.end(), std::back_inserter(dec_out));
+  EXPECT_EQ(dec_out, input);
+
+  // a meta data round trip keeps the layout stored
+  std::vector<uint8_t> md_bytes;
+  hm::encode_meta_data(md, std::back_inserter(md_bytes));
+  EXPECT_EQ(hm::decode_meta_data(md_bytes.begin(), md_bytes.end()).flags, hm::flag_stored);
+}
+
+TEST(HmDecodeStored, ThrowsOnMissingData)
+{
+  const std::vector<uint8_t> input {'A', 'B', 'C'};
+  auto md = hm::make_stored_meta(input.size() + 1, 1);
+
+  std::vector<uint8_t> dec_out;
+  EXPECT_THROW(
+    hm::decode_stored(md, input.begin(), input.end(), std::back_inserter(dec_out)),
+    hm::invalid_layout
+  );
+}
+
+TEST(HmDecodeStored, CopiesBetweenPointers)
+{
+  const std::vector<uint8_t> input {'A', 'B', 'C', 0, 255};
+
+  std::vector<uint8_t> enc_out;
+  auto md = hm::encode_stored(input.begin(), input.end(), std::back_inserter(enc_out));
+
+  std::vector<uint8_t> dec_out(input.size(), 0);
+  hm::decode_stored(md, enc_out.data(), enc_out.data() + enc_out.size(), dec_out.data());
+  EXPECT_EQ(dec_out, input);
+
+  EXPECT_THROW(
+    hm::decode_stored(md, enc_out.data(), enc_out.data() + enc_out.size() - 1, dec_out.data()),
+    hm::invalid_layout
+  );
+}
+
+TEST(HmDecodeStored, ThrowsOnCombinedFlags)
+{
+  hm::meta md = hm::make_stored_meta(0, 1);
+  md.flags = hm::flag_stored | hm::flag_rle;
+
+  std::vector<uint8_t> bytes;
+  hm::encode_meta_data(md, std::back_inserter(bytes));
+  EXPECT_THROW(hm::decode_meta_data(bytes.begin(), bytes.end()), hm::invalid_layout);
+}
+
+
+}
@@ -4,3 +4,5 @@
 #include "hm/decode/decode-tree.h"
 #include "hm/decode/decode-data.h"
 #include "hm/decode/decode.h"
+#include "hm/decode/decode-stored.h"
+#include "hm/decode/decode-range.h"
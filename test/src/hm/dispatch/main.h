@@ -0,0 +1,43 @@
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "hm/dispatch.h"
+
+namespace {
+
+struct record_size
+{
+  template<typename entity_type>
+  static void run(std::vector<size_t>& sizes)
+  {
+    sizes.push_back(sizeof(entity_type));
+  }
+};
+
+TEST(HmDispatch, SelectsEntitySize)
+{
+  std::vector<size_t> sizes;
+  for(size_t size = 1; size <= hm::max_entity_size; ++size)
+    hm::dispatch_entity_size<record_size>(size, sizes);
+
+  ASSERT_EQ(sizes.size(), hm::max_entity_size);
+  for(size_t i = 0; i < sizes.size(); ++i)
+    EXPECT_EQ(sizes[i], i + 1);
+}
+
+TEST(HmDispatch, ThrowsOnUnsupportedSize)
+{
+  std::vector<size_t> sizes;
+  EXPECT_THROW(hm::dispatch_entity_size<record_size>(0, sizes), hm::invalid_layout);
+  EXPECT_THROW(
+    hm::dispatch_entity_size<record_size>(hm::max_entity_size + 1, sizes),
+    hm::invalid_layout
+  );
+  EXPECT_TRUE(sizes.empty());
+}
+
+
+}
@@ -65,9 +65,12 @@ namespace hlp {
     return -1;
   }
 
-  template<typename entity_type>
+  template<
+    typename table_type,
+    typename entity_type = typename table_type::key_type
+  >
   std::vector<std::pair<entity_type, size_t>>
-  get_entities_sorted_by_freq(const std::unordered_map<entity_type, size_t>& table)
+  get_entities_sorted_by_freq(const table_type& table)
   {
     typedef std::pair<entity_type, size_t> pair_type;
     std::vector<pair_type> entities_by_freq(
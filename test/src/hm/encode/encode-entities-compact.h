@@ -0,0 +1,151 @@
+#include <iterator>
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+#include "gtest/gtest.h"
+
+#include "hlp/get-test-data.h"
+#include "hlp/testing-types.h"
+
+#include "hm/encode.h"
+#include "hm/decode.h"
+
+
+namespace {
+
+namespace hlp {
+
+  // leaves of the tree with their depth, left to right
+  template<typename entity_type>
+  void get_leaves_with_depth(
+    const hm::enc_node<entity_type> * node,
+    size_t depth,
+    std::vector<std::pair<size_t, entity_type>>& leaves
+  )
+  {
+    if( auto tree = dynamic_cast<const hm::enc_tree<entity_type> *>(node) )
+    {
+      get_leaves_with_depth(tree->get_left(), depth + 1, leaves);
+      get_leaves_with_depth(tree->get_right(), depth + 1, leaves);
+    }
+    else if( auto leaf = dynamic_cast<const hm::enc_leaf<entity_type> *>(node) )
+    {
+      leaves.push_back(std::make_pair(depth, leaf->get_entity()));
+    }
+  }
+
+}
+
+template <typename T>
+class HmEncodeEntitiesCompactT : public ::testing::Test {};
+TYPED_TEST_CASE(HmEncodeEntitiesCompactT, ::hlp::testing_types);
+TYPED_TEST(HmEncodeEntitiesCompactT, CanonicalTree)
+{
+  typedef TypeParam entity_type;
+  const auto inputs = ::hlp::get_test_data<entity_type>();
+  for(const auto& input : inputs)
+  {
+    const auto frequencies =
+      hm::build_frequency_table<entity_type>(input.begin(), input.end());
+    if( frequencies.size() < 2 )
+      continue;
+
+    auto tree = hm::build_canonical_huffman_tree(frequencies);
+    auto reference = hm::build_huffman_tree(frequencies);
+
+    std::vector<std::pair<size_t, entity_type>> leaves;
+    hlp::get_leaves_with_depth<entity_type>(tree.get(), 0, leaves);
+    ASSERT_EQ(leaves.size(), frequencies.size());
+
+    // ordered by code length, then by value
+    for(size_t i = 1; i < leaves.size(); ++i)
+    {
+      EXPECT_TRUE(
+        leaves[i - 1].first < leaves[i].first ||
+        ( leaves[i - 1].first == leaves[i].first &&
+          hm::entity_to_number(leaves[i - 1].second)
+            < hm::entity_to_number(leaves[i].second) )
+      );
+    }
+
+    // as good as any other huffman tree
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> reference_out;
+    auto md = hm::encode(input.begin(), input.end(), tree.get(), std::back_inserter(out));
+    auto md_reference = hm::encode(
+      input.begin(),
+      input.end(),
+      reference.get(),
+      std::back_inserter(reference_out)
+    );
+    EXPECT_EQ(md.data_byte_count, md_reference.data_byte_count);
+    EXPECT_EQ(md.data_last_bits, md_reference.data_last_bits);
+  }
+}
+
+TYPED_TEST(HmEncodeEntitiesCompactT, DecodesEntities)
+{
+  typedef TypeParam entity_type;
+  const auto inputs = ::hlp::get_test_data<entity_type>();
+  for(const auto& input : inputs)
+  {
+    const auto frequencies =
+      hm::build_frequency_table<entity_type>(input.begin(), input.end());
+    auto tree = hm::build_canonical_huffman_tree(frequencies);
+
+    std::vector<uint8_t> out;
+    hm::meta md;
+    md.entity_size = sizeof(entity_type);
+    md.flags = hm::flag_compact_entities;
+    hm::encode_entities_compact<entity_type>(tree.get(), std::back_inserter(out), md);
+
+    EXPECT_EQ(md.entity_count, frequencies.size());
+    EXPECT_EQ(md.entity_byte_count, out.size());
+
+    std::vector<std::pair<size_t, entity_type>> leaves;
+    hlp::get_leaves_with_depth<entity_type>(tree.get(), 0, leaves);
+
+    auto entities = hm::decode_entities<hm::byte_entity<sizeof(entity_type)>>(
+      out.begin(),
+      out.end(),
+      md
+    );
+    ASSERT_EQ(entities.size(), leaves.size());
+    for(size_t i = 0; i < entities.size(); ++i)
+      EXPECT_EQ(hm::entity_to_number(entities[i]), hm::entity_to_number(leaves[i].second));
+
+    // a section of the wrong size
+    if( md.entity_count > 0 )
+    {
+      md.entity_byte_count++;
+      out.push_back(0);
+      EXPECT_THROW(hm::decode_entities(out.begin(), out.end(), md), hm::invalid_layout);
+    }
+  }
+}
+
+TEST(HmEncodeEntitiesCompact, LargeAlphabet)
+{
+  // a counter: every entity is distinct
+  std::vector<uint8_t> input;
+  for(uint64_t i = 0; i < 4096; ++i)
+    hm::encode_type(i * 3 + 1000000, std::back_inserter(input));
+
+  const auto frequencies = hm::build_frequency_table<uint64_t>(input.begin(), input.end());
+  auto tree = hm::build_canonical_huffman_tree(frequencies);
+
+  std::vector<uint8_t> out;
+  auto md = hm::encode(input.begin(), input.end(), tree.get(), std::back_inserter(out), 0, true);
+  EXPECT_TRUE(md.flags & hm::flag_compact_entities);
+
+  // mostly single byte differences instead of 8 bytes per entity
+  EXPECT_LT(md.entity_byte_count, md.entity_count * 2);
+
+  std::vector<uint8_t> decoded;
+  hm::decode<hm::byte_entity<8>>(md, out.begin(), out.end(), std::back_inserter(decoded));
+  EXPECT_EQ(decoded, input);
+}
+
+
+}
@@ -0,0 +1,146 @@
+#include <iterator>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+#include "hm/encode.h"
+#include "hm/decode.h"
+
+#include "hlp/get-test-data.h"
+#include "hlp/testing-types.h"
+
+namespace {
+
+TEST(HmEncodeEscaped, FindsEscapeEntity)
+{
+  hm::frequency_table<uint8_t> frequencies;
+  frequencies[0] = 3;
+  frequencies[1] = 1;
+  frequencies[3] = 2;
+
+  uint8_t escape = 0;
+  EXPECT_TRUE(hm::find_escape_entity(frequencies, escape));
+  EXPECT_EQ(escape, 2);
+
+  // all bytes occur, nothing can be missing
+  for(unsigned int i = 0; i < 256; ++i)
+    frequencies[static_cast<uint8_t>(i)] = 1;
+  EXPECT_FALSE(hm::find_escape_entity(frequencies, escape));
+}
+
+template<typename T>
+class HmEncodeEscapedT : public ::testing::Test {};
+TYPED_TEST_CASE(HmEncodeEscapedT, ::hlp::testing_types);
+TYPED_TEST(HmEncodeEscapedT, RoundTripWithSampleTree)
+{
+  typedef TypeParam entity_type;
+  const size_t size = sizeof(entity_type);
+
+  auto inputs = ::hlp::get_test_data<entity_type>();
+  std::vector<uint8_t> long_input(size * 1000);
+  for(size_t i = 0; i < long_input.size(); ++i)
+    long_input[i] = static_cast<uint8_t>(i % 7 + i / 100);
+  inputs.push_back(long_input);
+
+  for(const auto& input : inputs)
+  {
+    if( input.size() < 2 * size )
+      continue;
+
+    // the tree of the first half of the input lacks entities of the second
+    const auto sample_end = input.begin()
+      + static_cast<long>(input.size() / size / 2 * size);
+    auto frequencies = hm::build_frequency_table<entity_type>(input.begin(), sample_end);
+
+    entity_type escape;
+    if( !hm::find_escape_entity(frequencies, escape) )
+      continue;
+    frequencies[escape] = 1;
+
+    for(bool compact : {false, true})
+    {
+      auto tree = compact
+        ? hm::build_canonical_huffman_tree(frequencies)
+        : hm::build_huffman_tree(frequencies);
+      hm::code_table<entity_type> table;
+      hm::code_type prefix;
+      hm::build_huffman_table(tree.get(), table, prefix);
+
+      std::vector<uint8_t> enc_out;
+      auto md = hm::encode_escaped(
+        input.begin(),
+        input.end(),
+        tree.get(),
+        table,
+        escape,
+        std::back_inserter(enc_out),
+        7,
+        compact
+      );
+      EXPECT_TRUE(md.flags & hm::flag_escape);
+      EXPECT_LT(md.escape_leaf, md.entity_count);
+      EXPECT_EQ(hm::layout_byte_count(md), hm::meta_byte_count(md) + enc_out.size());
+
+      std::vector<uint8_t> dec_out;
+      hm::decode(md, enc_out.begin(), enc_out.end(), std::back_inserter(dec_out));
+      EXPECT_EQ(dec_out, input);
+
+      // the seek index points at escape codes as well
+      const uint64_t entity_count = input.size() / size;
+      for(uint64_t start : {uint64_t(0), uint64_t(8), entity_count / 2, entity_count - 1})
+      {
+        std::vector<uint8_t> range_out;
+        hm::decode_range(md, enc_out.begin(), enc_out.end(), start, 3, std::back_inserter(range_out));
+
+        const uint64_t first = std::min(start, entity_count);
+        const uint64_t last = std::min(first + 3, entity_count);
+        const std::vector<uint8_t> expected(
+          input.begin() + static_cast<long>(first * size),
+          input.begin() + static_cast<long>(last * size)
+        );
+        EXPECT_EQ(range_out, expected);
+      }
+    }
+  }
+}
+
+TEST(HmEncodeEscaped, EscapesPlaceholder)
+{
+  // the placeholder occurs after the sample and is escaped like any entity
+  const std::vector<uint8_t> input = {5, 5, 6, 0, 0, 5};
+  auto frequencies = hm::build_frequency_table<uint8_t>(input.begin(), input.begin() + 3);
+
+  uint8_t escape = 1;
+  ASSERT_TRUE(hm::find_escape_entity(frequencies, escape));
+  EXPECT_EQ(escape, 0);
+  frequencies[escape] = 1;
+
+  auto tree = hm::build_huffman_tree(frequencies);
+  hm::code_table<uint8_t> table;
+  hm::code_type prefix;
+  hm::build_huffman_table(tree.get(), table, prefix);
+
+  std::vector<uint8_t> enc_out;
+  auto md = hm::encode_escaped(
+    input.begin(),
+    input.end(),
+    tree.get(),
+    table,
+    escape,
+    std::back_inserter(enc_out)
+  );
+
+  std::vector<uint8_t> dec_out;
+  hm::decode(md, enc_out.begin(), enc_out.end(), std::back_inserter(dec_out));
+  EXPECT_EQ(dec_out, input);
+
+  EXPECT_THROW(
+    hm::encode_escaped(input.begin(), input.end(), tree.get(), table, uint8_t(9), std::back_inserter(enc_out)),
+    std::invalid_argument
+  );
+}
+
+
+}
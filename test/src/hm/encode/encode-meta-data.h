@@ -21,6 +21,8 @@ TEST(HmEncodeMetaData, EncodesMeta)
   md.entity_count = 100;
   md.tree_byte_count = 154;
   md.data_byte_count = 67;
+  md.flags = hm::flag_rle | hm::flag_filter;
+  md.filter = hm::filter_delta_delta;
 
   std::vector<uint8_t> bytes;
   hm::encode_meta_data(md, std::back_inserter(bytes));
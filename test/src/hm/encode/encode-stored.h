@@ -0,0 +1,47 @@
+#include <vector>
+#include <cstdint>
+#include <iterator>
+
+#include "gtest/gtest.h"
+
+#include "hm/encode.h"
+
+namespace {
+
+TEST(HmEncodeStored, CopiesInput)
+{
+  const std::vector<uint8_t> input {'A', 'B', 'C', 0, 255};
+
+  std::vector<uint8_t> out;
+  auto md = hm::encode_stored(input.begin(), input.end(), std::back_inserter(out));
+
+  EXPECT_EQ(out, input);
+  EXPECT_EQ(md.flags, hm::flag_stored);
+  EXPECT_EQ(md.data_byte_count, input.size());
+  EXPECT_EQ(md.entity_count, 0);
+  EXPECT_EQ(md.tree_byte_count, 0);
+  EXPECT_EQ(hm::layout_byte_count(md), hm::meta_byte_count(md) + input.size());
+}
+
+TEST(HmEncodeStored, IsStoredSmaller)
+{
+  // all byte values occur equally often: every code has 8 bits, while the
+  // entities and the tree are pure overhead
+  std::vector<uint8_t> input(4 * 256);
+  for(size_t i = 0; i < input.size(); ++i)
+    input[i] = static_cast<uint8_t>(i);
+
+  std::vector<uint8_t> out;
+  auto tree = hm::build_huffman_tree<uint8_t>(input.begin(), input.end());
+  auto md = hm::encode(input.begin(), input.end(), tree.get(), std::back_inserter(out));
+  EXPECT_TRUE(hm::is_stored_smaller(md, input.size()));
+
+  const std::vector<uint8_t> same(1024, 'A');
+  out.clear();
+  tree = hm::build_huffman_tree<uint8_t>(same.begin(), same.end());
+  md = hm::encode(same.begin(), same.end(), tree.get(), std::back_inserter(out));
+  EXPECT_FALSE(hm::is_stored_smaller(md, same.size()));
+}
+
+
+}
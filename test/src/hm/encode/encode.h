@@ -16,7 +16,7 @@ TEST(HmEncode, EmptySequence)
   std::vector<uint8_t> out;
 
   hm::meta md_expected;
-  md_expected.version = 10;
+  md_expected.version = hm::current_version;
   md_expected.entity_size = sizeof(entity_type);
 
   const char * empty = "";
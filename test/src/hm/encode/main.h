@@ -4,6 +4,9 @@
 #include "hm/encode/build-huffman-table.h"
 #include "hm/encode/encode-tree.h"
 #include "hm/encode/encode-entities.h"
+#include "hm/encode/encode-entities-compact.h"
 #include "hm/encode/encode-data.h"
 #include "hm/encode/encode-meta-data.h"
 #include "hm/encode/encode.h"
+#include "hm/encode/encode-escaped.h"
+#include "hm/encode/encode-stored.h"
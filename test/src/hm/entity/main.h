@@ -0,0 +1,113 @@
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <functional>
+
+#include "gtest/gtest.h"
+
+#include "hm/entity.h"
+#include "hm/common.h"
+#include "hm/encode.h"
+#include "hm/decode.h"
+#include "hm/rle.h"
+
+namespace {
+
+TEST(HmEntity, ComparesBytes)
+{
+  hm::byte_entity<3> a = {{1, 2, 3}};
+  hm::byte_entity<3> b = {{1, 2, 3}};
+  hm::byte_entity<3> c = {{1, 2, 4}};
+
+  EXPECT_TRUE(a == b);
+  EXPECT_FALSE(a != b);
+  EXPECT_TRUE(a != c);
+  EXPECT_EQ(std::hash<hm::byte_entity<3>>()(a), std::hash<hm::byte_entity<3>>()(b));
+  EXPECT_NE(std::hash<hm::byte_entity<3>>()(a), std::hash<hm::byte_entity<3>>()(c));
+}
+
+TEST(HmEntity, DecodesAndEncodesType)
+{
+  const std::vector<uint8_t> input {'A', 'B', 'C', 'D', 'E', 'F'};
+
+  auto begin = input.begin();
+  auto first = hm::decode_type<hm::byte_entity<3>>(begin, input.end());
+  auto second = hm::decode_type<hm::byte_entity<3>>(begin, input.end());
+  EXPECT_EQ(begin, input.end());
+  EXPECT_EQ(first.bytes[0], 'A');
+  EXPECT_EQ(second.bytes[2], 'F');
+
+  std::vector<uint8_t> out;
+  hm::encode_type(first, std::back_inserter(out));
+  hm::encode_type(second, std::back_inserter(out));
+  EXPECT_EQ(out, input);
+}
+
+TEST(HmEntity, ThrowsOnMismatchingSize)
+{
+  const std::vector<uint8_t> input(12, 'A');
+
+  std::vector<uint8_t> enc_out;
+  auto tree = hm::build_huffman_tree<hm::byte_entity<3>>(input.begin(), input.end());
+  auto md = hm::encode(input.begin(), input.end(), tree.get(), std::back_inserter(enc_out));
+
+  std::vector<uint8_t> dec_out;
+  EXPECT_THROW(
+    hm::decode<hm::byte_entity<4>>(md, enc_out.begin(), enc_out.end(), std::back_inserter(dec_out)),
+    hm::invalid_layout
+  );
+}
+
+
+/// Encode input with entities of size bytes and check that both decoders and
+/// run-length coding restore it.
+template<size_t size>
+void expect_round_trip()
+{
+  typedef hm::byte_entity<size> entity_type;
+
+  std::vector<std::vector<uint8_t>> inputs;
+  inputs.push_back(std::vector<uint8_t>());
+  inputs.push_back(std::vector<uint8_t>(size * 100, 0x2a));
+
+  std::vector<uint8_t> mixed(size * 1000);
+  for(size_t i = 0; i < mixed.size(); ++i)
+    mixed[i] = static_cast<uint8_t>((i / size) % 13 + (i % size) * 31);
+  inputs.push_back(mixed);
+
+  for(const auto& input : inputs)
+  {
+    std::vector<uint8_t> enc_out;
+    auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+    auto md = hm::encode(input.begin(), input.end(), tree.get(), std::back_inserter(enc_out));
+    EXPECT_EQ(md.entity_size, size);
+
+    std::vector<uint8_t> dec_out;
+    hm::decode<entity_type>(md, enc_out.begin(), enc_out.end(), std::back_inserter(dec_out));
+    EXPECT_EQ(dec_out, input);
+
+    std::vector<uint8_t> vec_out;
+    hm::decode(md, enc_out.begin(), enc_out.end(), std::back_inserter(vec_out));
+    EXPECT_EQ(vec_out, input);
+
+    std::vector<uint8_t> tokens;
+    std::vector<uint8_t> rle_out;
+    hm::rle_encode<entity_type>(input.begin(), input.end(), std::back_inserter(tokens));
+    hm::rle_decode<entity_type>(tokens.begin(), tokens.end(), std::back_inserter(rle_out));
+    EXPECT_EQ(rle_out, input);
+  }
+}
+
+TEST(HmEntity, RoundTrip)
+{
+  expect_round_trip<1>();
+  expect_round_trip<3>();
+  expect_round_trip<5>();
+  expect_round_trip<6>();
+  expect_round_trip<7>();
+  expect_round_trip<12>();
+  expect_round_trip<16>();
+}
+
+
+}
@@ -0,0 +1,179 @@
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+#include "hm/estimate.h"
+#include "hm/encode.h"
+#include "hm/shuffle.h"
+#include "hm/rle.h"
+
+#include "hlp/get-test-data.h"
+#include "hlp/testing-types.h"
+#include "hlp/is-same-meta.h"
+
+namespace {
+
+template<typename T>
+class HmEstimateT : public ::testing::Test {};
+TYPED_TEST_CASE(HmEstimateT, ::hlp::testing_types);
+TYPED_TEST(HmEstimateT, MatchesEncode)
+{
+  typedef TypeParam entity_type;
+  auto inputs = ::hlp::get_test_data<entity_type>();
+
+  for(const auto& input : inputs)
+  {
+    std::vector<uint8_t> enc_out;
+    auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+    auto md = hm::encode(input.begin(), input.end(), tree.get(), std::back_inserter(enc_out));
+
+    auto md_estimate = hm::estimate_layout(
+      hm::build_frequency_table<entity_type>(input.begin(), input.end())
+    );
+    EXPECT_TRUE(::hlp::is_same_meta(md, md_estimate));
+  }
+}
+
+TYPED_TEST(HmEstimateT, MatchesCompactEncode)
+{
+  typedef TypeParam entity_type;
+  auto inputs = ::hlp::get_test_data<entity_type>();
+
+  for(const auto& input : inputs)
+  {
+    const auto frequencies =
+      hm::build_frequency_table<entity_type>(input.begin(), input.end());
+
+    std::vector<uint8_t> enc_out;
+    auto tree = hm::build_canonical_huffman_tree(frequencies);
+    auto md = hm::encode(
+      input.begin(),
+      input.end(),
+      tree.get(),
+      std::back_inserter(enc_out),
+      0,
+      true
+    );
+
+    EXPECT_TRUE(::hlp::is_same_meta(md, hm::estimate_layout(frequencies, true)));
+  }
+}
+
+TYPED_TEST(HmEstimateT, MatchesTransforms)
+{
+  typedef TypeParam entity_type;
+  auto inputs = ::hlp::get_test_data<entity_type>();
+
+  for(const auto& input : inputs)
+  {
+    if( input.empty() )
+      continue;
+
+    hm::meta md;
+    md.flags = hm::flag_rle;
+
+    std::vector<uint8_t> tokens;
+    hm::rle_encode<entity_type>(input.begin(), input.end(), std::back_inserter(tokens));
+    std::vector<uint8_t> enc_out;
+    auto tree = hm::build_huffman_tree<entity_type>(tokens.begin(), tokens.end());
+    auto md_rle = hm::encode(tokens.begin(), tokens.end(), tree.get(), std::back_inserter(enc_out));
+    md_rle.flags = md.flags;
+    if( hm::is_stored_smaller(md_rle, input.size()) )
+      md_rle = hm::make_stored_meta(input.size(), sizeof(entity_type));
+
+    EXPECT_EQ(
+      hm::estimate_byte_count<entity_type>(input.data(), input.size(), md),
+      hm::layout_byte_count(md_rle)
+    );
+
+    md.flags = hm::flag_shuffle | hm::flag_rle;
+    std::vector<uint8_t> lanes_out;
+    auto md_lanes = hm::encode_lanes(
+      input.data(),
+      input.size(),
+      sizeof(entity_type),
+      true,
+      std::back_inserter(lanes_out)
+    );
+
+    EXPECT_EQ(
+      hm::estimate_byte_count<entity_type>(input.data(), input.size(), md),
+      hm::layout_byte_count(md_lanes)
+    );
+  }
+}
+
+TEST(HmEstimate, CodeLengths)
+{
+  const std::vector<uint64_t> frequencies {8, 1, 1, 2, 4};
+  const std::vector<size_t> expected {1, 4, 4, 3, 2};
+  EXPECT_EQ(hm::code_lengths(frequencies), expected);
+
+  EXPECT_EQ(hm::code_lengths(std::vector<uint64_t>()).size(), 0);
+  EXPECT_EQ(hm::code_lengths(std::vector<uint64_t>(1, 5)), std::vector<size_t>(1, 1));
+}
+
+TYPED_TEST(HmEstimateT, ReportsCode)
+{
+  typedef TypeParam entity_type;
+  auto inputs = ::hlp::get_test_data<entity_type>();
+
+  for(const auto& input : inputs)
+  {
+    const auto report = hm::report_code(
+      hm::build_frequency_table<entity_type>(input.begin(), input.end())
+    );
+
+    EXPECT_EQ(report.entity_count, input.size() / sizeof(entity_type));
+    if( input.empty() )
+      continue;
+
+    // a huffman code is within one bit of the entropy
+    EXPECT_LE(report.entropy, report.average_code_length + 1e-9);
+    EXPECT_LE(report.average_code_length, report.entropy + 1.0);
+
+    // the code is complete (kraft equality), unless there is a single entity
+    double kraft = 0;
+    uint64_t distinct = 0;
+    for(size_t length = 0; length < report.code_length_histogram.size(); ++length)
+    {
+      kraft += static_cast<double>(report.code_length_histogram[length])
+        / std::pow(2.0, static_cast<double>(length));
+      distinct += report.code_length_histogram[length];
+    }
+    EXPECT_EQ(distinct, report.md.entity_count);
+    EXPECT_EQ(report.code_length_histogram.size(), report.max_code_length + 1);
+    if( distinct > 1 )
+    {
+      EXPECT_DOUBLE_EQ(kraft, 1.0);
+    }
+  }
+}
+
+TEST(HmEstimate, SelectsEntitySize)
+{
+  hm::meta md;
+
+  // few distinct 8 byte entities, but all byte values
+  std::vector<uint8_t> input;
+  for(size_t i = 0; i < 4096; ++i)
+    for(size_t k = 0; k < 8; ++k)
+      input.push_back(static_cast<uint8_t>((i % 4) * 8 + k * 32));
+  EXPECT_EQ(hm::select_entity_size(input.data(), input.size(), input.size(), md), 8);
+
+  // 8 does not divide the input size
+  EXPECT_EQ(hm::select_entity_size(input.data(), input.size(), input.size() + 4, md), 4);
+
+  // a single distinct byte
+  const std::vector<uint8_t> same(4096, 'A');
+  EXPECT_EQ(hm::select_entity_size(same.data(), same.size(), same.size(), md), 8);
+
+  const std::vector<uint8_t> empty;
+  EXPECT_EQ(hm::select_entity_size(empty.data(), 0, 0, md), 1);
+}
+
+
+}
@@ -0,0 +1,121 @@
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+
+#include "gtest/gtest.h"
+
+#include "hm/filter.h"
+#include "hm/encode.h"
+
+#include "hlp/get-test-data.h"
+#include "hlp/testing-types.h"
+
+namespace {
+
+TEST(HmFilter, ZigzagEncode)
+{
+  EXPECT_EQ(hm::zigzag_encode<uint8_t>(0), 0);
+  EXPECT_EQ(hm::zigzag_encode<uint8_t>(static_cast<uint8_t>(-1)), 1);
+  EXPECT_EQ(hm::zigzag_encode<uint8_t>(1), 2);
+  EXPECT_EQ(hm::zigzag_encode<uint8_t>(static_cast<uint8_t>(-2)), 3);
+  EXPECT_EQ(hm::zigzag_encode<uint8_t>(127), 254);
+  EXPECT_EQ(hm::zigzag_encode<uint8_t>(128), 255);
+
+  EXPECT_EQ(hm::zigzag_encode<uint64_t>(static_cast<uint64_t>(-1)), 1U);
+  EXPECT_EQ(
+    hm::zigzag_encode<uint64_t>(std::numeric_limits<uint64_t>::max() / 2 + 1),
+    std::numeric_limits<uint64_t>::max()
+  );
+}
+
+TEST(HmFilter, ZigzagDecode)
+{
+  for(unsigned int i = 0; i <= std::numeric_limits<uint8_t>::max(); ++i)
+  {
+    const uint8_t value = static_cast<uint8_t>(i);
+    EXPECT_EQ(hm::zigzag_decode(hm::zigzag_encode(value)), value);
+  }
+
+  const uint64_t values[] = {
+    0, 1, 2, 1ULL << 63, std::numeric_limits<uint64_t>::max()
+  };
+  for(auto value : values)
+    EXPECT_EQ(hm::zigzag_decode(hm::zigzag_encode(value)), value);
+}
+
+TEST(HmFilter, CollapsesSeries)
+{
+  // a counter with a constant stride
+  std::vector<uint64_t> counter;
+  for(uint64_t i = 0; i < 1000; ++i)
+    counter.push_back(1400000000000ULL + i * 1000);
+
+  const uint8_t * begin = reinterpret_cast<const uint8_t *>(counter.data());
+  const uint8_t * end = begin + counter.size() * sizeof(uint64_t);
+
+  std::vector<uint8_t> delta;
+  hm::apply_filter<uint64_t>(hm::filter_delta, begin, end, std::back_inserter(delta));
+  ASSERT_EQ(delta.size(), counter.size() * sizeof(uint64_t));
+  // first value, stride
+  EXPECT_EQ(hm::build_frequency_table<uint64_t>(delta.begin(), delta.end()).size(), 2);
+
+  std::vector<uint8_t> delta_delta;
+  hm::apply_filter<uint64_t>(
+    hm::filter_delta_delta, begin, end, std::back_inserter(delta_delta)
+  );
+  // first value, first stride, zero
+  EXPECT_EQ(hm::build_frequency_table<uint64_t>(delta_delta.begin(), delta_delta.end()).size(), 3);
+}
+
+TEST(HmFilter, ThrowsUnknownFilter)
+{
+  const uint8_t input[] = {1, 2, 3};
+  std::vector<uint8_t> out;
+  EXPECT_THROW(
+    hm::apply_filter<uint8_t>(
+      hm::filter_xor + 1, std::begin(input), std::end(input), std::back_inserter(out)
+    ),
+    hm::invalid_layout
+  );
+  EXPECT_THROW(
+    hm::reverse_filter<uint8_t>(
+      hm::filter_xor + 1, std::begin(input), std::end(input), std::back_inserter(out)
+    ),
+    hm::invalid_layout
+  );
+}
+
+
+template<typename T>
+class HmFilterT : public ::testing::Test {};
+TYPED_TEST_CASE(HmFilterT, ::hlp::testing_types);
+TYPED_TEST(HmFilterT, RoundTrip)
+{
+  typedef TypeParam entity_type;
+  const auto inputs = ::hlp::get_test_data<entity_type>();
+  const hm::meta::filter_type filters[] = {
+    hm::filter_none, hm::filter_delta, hm::filter_delta_delta, hm::filter_xor
+  };
+
+  for(auto filter : filters)
+  {
+    for(const auto& input : inputs)
+    {
+      std::vector<uint8_t> filtered;
+      hm::apply_filter<entity_type>(
+        filter, input.begin(), input.end(), std::back_inserter(filtered)
+      );
+      ASSERT_EQ(filtered.size(), input.size());
+
+      std::vector<uint8_t> reversed;
+      hm::reverse_filter<entity_type>(
+        filter, filtered.begin(), filtered.end(), std::back_inserter(reversed)
+      );
+      EXPECT_EQ(reversed, input);
+    }
+  }
+}
+
+
+}
@@ -0,0 +1,158 @@
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <random>
+#include <type_traits>
+
+#include "gtest/gtest.h"
+
+#include "hm/flat-map.h"
+#include "hm/common.h"
+#include "hm/encode.h"
+
+namespace {
+
+TEST(HmFlatMap, InsertsAndFinds)
+{
+  hm::flat_map<uint64_t, size_t> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.begin() == map.end());
+  EXPECT_TRUE(map.find(0) == map.end());
+  EXPECT_EQ(map.count(0), 0);
+
+  // keys that differ in their high bits only, and zero
+  std::vector<uint64_t> keys;
+  for(uint64_t i = 0; i < 1000; ++i)
+    keys.push_back(i << 40U);
+
+  for(size_t i = 0; i < keys.size(); ++i)
+    map[keys[i]] += i + 1;
+  EXPECT_EQ(map.size(), keys.size());
+
+  for(size_t i = 0; i < keys.size(); ++i)
+  {
+    EXPECT_EQ(map.count(keys[i]), 1);
+    EXPECT_EQ(map.at(keys[i]), i + 1);
+    ASSERT_TRUE(map.find(keys[i]) != map.end());
+    EXPECT_EQ(map.find(keys[i])->first, keys[i]);
+  }
+
+  EXPECT_EQ(map.count(1), 0);
+  EXPECT_THROW(map.at(1), std::out_of_range);
+
+  // operator[] does not insert twice
+  map[keys[0]] += 1;
+  EXPECT_EQ(map.size(), keys.size());
+  EXPECT_EQ(map.at(keys[0]), 2);
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.count(keys[0]), 0);
+}
+
+TEST(HmFlatMap, MatchesUnorderedMap)
+{
+  std::mt19937 engine(47);
+  std::uniform_int_distribution<uint32_t> dist(0, 5000);
+
+  hm::flat_map<uint32_t, size_t> map;
+  std::unordered_map<uint32_t, size_t> expected;
+  for(size_t i = 0; i < 20000; ++i)
+  {
+    const uint32_t key = dist(engine);
+    map[key] += 1;
+    expected[key] += 1;
+  }
+
+  ASSERT_EQ(map.size(), expected.size());
+
+  // iteration visits every entry once
+  size_t visited = 0;
+  for(const auto& entry : map)
+  {
+    EXPECT_EQ(expected.at(entry.first), entry.second);
+    ++visited;
+  }
+  EXPECT_EQ(visited, expected.size());
+}
+
+TEST(HmFlatMap, Reserve)
+{
+  hm::flat_map<uint32_t, hm::code_type> map;
+  map.reserve(100);
+  map[7] = hm::code_type{true, false};
+
+  // entries survive growing
+  map.reserve(100000);
+  for(uint32_t i = 0; i < 1000; ++i)
+    map[i * 16U + 8U].push_back(true);
+
+  EXPECT_EQ(map.size(), 1001);
+  EXPECT_EQ(map.at(7), (hm::code_type{true, false}));
+  EXPECT_EQ(map.at(8), hm::code_type{true});
+}
+
+TEST(HmFlatMap, EntityTables)
+{
+  EXPECT_TRUE((std::is_same<
+    hm::frequency_table<uint32_t>,
+    hm::flat_map<uint32_t, size_t>
+  >::value));
+  EXPECT_TRUE((std::is_same<
+    hm::code_table<uint64_t>,
+    hm::flat_map<uint64_t, hm::code_type>
+  >::value));
+  EXPECT_TRUE((std::is_same<
+    hm::frequency_table<uint8_t>,
+    std::unordered_map<uint8_t, size_t>
+  >::value));
+  EXPECT_TRUE((std::is_same<
+    hm::frequency_table<hm::byte_entity<4>>,
+    std::unordered_map<hm::byte_entity<4>, size_t>
+  >::value));
+
+  EXPECT_TRUE(hm::is_code_table<hm::code_table<uint32_t>>::value);
+  EXPECT_TRUE(hm::is_code_table<hm::code_table<char>>::value);
+  EXPECT_FALSE(hm::is_code_table<hm::frequency_table<uint32_t>>::value);
+  EXPECT_FALSE(hm::is_code_table<uint8_t *>::value);
+}
+
+TEST(HmFlatMap, EncodesWithEitherTable)
+{
+  typedef uint32_t entity_type;
+
+  std::vector<uint8_t> input;
+  for(uint32_t i = 0; i < 4096; ++i)
+  {
+    const entity_type entity = (i * i) % 97U;
+    hm::encode_type(entity, std::back_inserter(input));
+  }
+
+  auto tree = hm::build_huffman_tree<entity_type>(input.begin(), input.end());
+
+  hm::code_table<entity_type> flat;
+  std::unordered_map<entity_type, hm::code_type> node_based;
+  hm::code_type prefix;
+  hm::build_huffman_table(tree.get(), flat, prefix);
+  hm::build_huffman_table(tree.get(), node_based, prefix);
+  ASSERT_EQ(flat.size(), node_based.size());
+
+  std::vector<uint8_t> out_flat;
+  std::vector<uint8_t> out_node_based;
+  hm::meta md_flat;
+  hm::meta md_node_based;
+  hm::encode_data(input.begin(), input.end(), flat, std::back_inserter(out_flat), md_flat);
+  hm::encode_data(
+    input.begin(),
+    input.end(),
+    node_based,
+    std::back_inserter(out_node_based),
+    md_node_based
+  );
+
+  EXPECT_EQ(out_flat, out_node_based);
+  EXPECT_EQ(md_flat.data_last_bits, md_node_based.data_last_bits);
+}
+
+}
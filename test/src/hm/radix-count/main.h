@@ -0,0 +1,112 @@
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+#include "hlp/get-test-data.h"
+
+#include "hm/radix-count.h"
+#include "hm/common.h"
+#include "hm/encode.h"
+
+namespace {
+
+TEST(HmRadixCount, SortsKeys)
+{
+  std::mt19937_64 engine(49);
+  std::vector<uint64_t> keys;
+  for(size_t i = 0; i < 10000; ++i)
+    keys.push_back(engine() >> (i % 64));
+
+  // all keys share their high bytes, those passes are skipped
+  std::vector<uint64_t> small_keys;
+  for(size_t i = 0; i < 1000; ++i)
+    small_keys.push_back(engine() % 300);
+
+  for(auto input : {keys, small_keys, std::vector<uint64_t>()})
+  {
+    auto expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    std::vector<uint64_t> scratch;
+    hm::radix_sort(input, scratch);
+    EXPECT_EQ(input, expected);
+  }
+}
+
+TEST(HmRadixCount, MergesHistograms)
+{
+  hm::sorted_histogram<int32_t> left;
+  left.entities = {0, 5, -1};
+  left.counts = {1, 2, 3};
+
+  hm::sorted_histogram<int32_t> right;
+  right.entities = {5, 7, -2};
+  right.counts = {10, 20, 30};
+
+  // ordered by bit pattern, negative entities last
+  const auto merged = hm::merge_histograms(left, right);
+  EXPECT_EQ(merged.entities, (std::vector<int32_t>{0, 5, 7, -2, -1}));
+  EXPECT_EQ(merged.counts, (std::vector<uint64_t>{1, 12, 20, 30, 3}));
+}
+
+TEST(HmRadixCount, RejectsPartialEntity)
+{
+  const std::vector<uint8_t> input(7, 0);
+  hm::radix_counter<uint32_t> counter(1);
+  EXPECT_THROW(counter.add(input.data(), input.size()), hm::invalid_layout);
+}
+
+template <typename T>
+class HmRadixCountT : public ::testing::Test {};
+typedef ::testing::Types<uint32_t, int32_t, uint64_t, int64_t> radix_count_types;
+TYPED_TEST_CASE(HmRadixCountT, radix_count_types);
+TYPED_TEST(HmRadixCountT, MatchesFrequencyTable)
+{
+  typedef TypeParam entity_type;
+
+  auto inputs = ::hlp::get_test_data<entity_type>();
+
+  // enough entities for several chunks and threads
+  std::mt19937 engine(49);
+  std::vector<uint8_t> large;
+  for(size_t i = 0; i < 300000; ++i)
+  {
+    const auto entity = static_cast<entity_type>(engine() % 70000);
+    hm::encode_type(entity, std::back_inserter(large));
+  }
+  inputs.push_back(large);
+
+  for(const auto& input : inputs)
+  {
+    const auto expected =
+      hm::build_frequency_table<entity_type>(input.begin(), input.end());
+
+    // added in two blocks
+    const size_t half = input.size() / sizeof(entity_type) / 2 * sizeof(entity_type);
+    hm::radix_counter<entity_type> counter(4);
+    counter.add(input.data(), half);
+    counter.add(input.data() + half, input.size() - half);
+
+    const auto& histogram = counter.histogram();
+    ASSERT_EQ(histogram.entities.size(), expected.size());
+    ASSERT_EQ(histogram.counts.size(), expected.size());
+    for(size_t i = 0; i < histogram.entities.size(); ++i)
+    {
+      EXPECT_EQ(histogram.counts[i], expected.at(histogram.entities[i]));
+      if( i > 0 )
+      {
+        typedef typename std::make_unsigned<entity_type>::type key_type;
+        EXPECT_LT(
+          static_cast<key_type>(histogram.entities[i - 1]),
+          static_cast<key_type>(histogram.entities[i])
+        );
+      }
+    }
+  }
+}
+
+}
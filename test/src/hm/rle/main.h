@@ -0,0 +1,143 @@
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+#include "hm/rle.h"
+#include "hm/encode.h"
+#include "hm/decode.h"
+
+#include "hlp/get-test-data.h"
+#include "hlp/testing-types.h"
+
+namespace {
+
+TEST(HmRle, EncodesRuns)
+{
+  const std::vector<uint8_t> input {'A', 'B', 'B', 'B', 'B', 'C', 'C'};
+  const std::vector<uint8_t> expected {'A', 'B', 'B', 2, 'C', 'C', 0};
+
+  std::vector<uint8_t> out;
+  hm::rle_encode<uint8_t>(input.begin(), input.end(), std::back_inserter(out));
+  EXPECT_EQ(out, expected);
+}
+
+TEST(HmRle, SplitsLongRuns)
+{
+  // 2 + 255 entities fit into a single run
+  const std::vector<uint8_t> input(2 + 255 + 1, 'A');
+
+  std::vector<uint8_t> out;
+  hm::rle_encode<uint8_t>(input.begin(), input.end(), std::back_inserter(out));
+  const std::vector<uint8_t> expected {'A', 'A', 255, 'A'};
+  EXPECT_EQ(out, expected);
+
+  std::vector<uint8_t> decoded;
+  hm::rle_decode<uint8_t>(out.begin(), out.end(), std::back_inserter(decoded));
+  EXPECT_EQ(decoded, input);
+}
+
+TEST(HmRle, EmptySequence)
+{
+  const uint8_t * empty = nullptr;
+  std::vector<uint8_t> out;
+
+  hm::rle_encode<uint8_t>(empty, empty, std::back_inserter(out));
+  EXPECT_EQ(out.size(), 0);
+
+  hm::rle_decode<uint8_t>(empty, empty, std::back_inserter(out));
+  EXPECT_EQ(out.size(), 0);
+}
+
+TEST(HmRle, ThrowsOnMissingCount)
+{
+  const std::vector<uint8_t> tokens {'A', 'B', 'B'};
+  std::vector<uint8_t> out;
+  EXPECT_THROW(
+    hm::rle_decode<uint8_t>(tokens.begin(), tokens.end(), std::back_inserter(out)),
+    hm::invalid_layout
+  );
+}
+
+TEST(HmRle, ThrowsOnRunBeyondMaxByteCount)
+{
+  // a corrupt count token claiming a run of 2^32 - 1 entities
+  const std::vector<uint8_t> tokens {
+    1, 0, 0, 0,
+    1, 0, 0, 0,
+    0xff, 0xff, 0xff, 0xff
+  };
+
+  std::vector<uint8_t> out;
+  EXPECT_THROW(
+    hm::rle_decode<uint32_t>(tokens.begin(), tokens.end(), std::back_inserter(out), 90000),
+    hm::invalid_layout
+  );
+  EXPECT_LE(out.size(), 90000);
+}
+
+TEST(HmRle, DecodesUpToMaxByteCount)
+{
+  const std::vector<uint8_t> tokens {'A', 'B', 'B', 2, 'C'};
+  const std::vector<uint8_t> expected {'A', 'B', 'B', 'B', 'B', 'C'};
+
+  std::vector<uint8_t> out;
+  hm::rle_decode<uint8_t>(tokens.begin(), tokens.end(), std::back_inserter(out), expected.size());
+  EXPECT_EQ(out, expected);
+
+  // a literal beyond the limit
+  out.clear();
+  EXPECT_THROW(
+    hm::rle_decode<uint8_t>(tokens.begin(), tokens.end(), std::back_inserter(out), expected.size() - 1),
+    hm::invalid_layout
+  );
+
+  // a run beyond the limit
+  out.clear();
+  EXPECT_THROW(
+    hm::rle_decode<uint8_t>(tokens.begin(), tokens.end(), std::back_inserter(out), 4),
+    hm::invalid_layout
+  );
+}
+
+
+template<typename T>
+class HmRleT : public ::testing::Test {};
+TYPED_TEST_CASE(HmRleT, ::hlp::testing_types);
+TYPED_TEST(HmRleT, RoundTrip)
+{
+  typedef TypeParam entity_type;
+  auto inputs = ::hlp::get_test_data<entity_type>();
+
+  // add some long runs
+  std::vector<uint8_t> runs(sizeof(entity_type) * 1000, 0);
+  runs.insert(runs.end(), sizeof(entity_type) * 300, 0xff);
+  inputs.push_back(runs);
+
+  for(const auto& input : inputs)
+  {
+    if( input.empty() )
+      continue;
+
+    std::vector<uint8_t> tokens;
+    hm::rle_encode<entity_type>(input.begin(), input.end(), std::back_inserter(tokens));
+    EXPECT_LE(tokens.size(), input.size() + input.size() / 2 + sizeof(entity_type));
+
+    // huffman code the tokens
+    std::vector<uint8_t> enc_out;
+    std::vector<uint8_t> dec_out;
+    auto tree = hm::build_huffman_tree<entity_type>(tokens.begin(), tokens.end());
+    auto md = hm::encode(tokens.begin(), tokens.end(), tree.get(), std::back_inserter(enc_out));
+    hm::decode(md, enc_out.begin(), enc_out.end(), std::back_inserter(dec_out));
+    ASSERT_EQ(dec_out, tokens);
+
+    std::vector<uint8_t> decoded;
+    hm::rle_decode<entity_type>(tokens.begin(), tokens.end(), std::back_inserter(decoded));
+    EXPECT_EQ(decoded, input);
+  }
+}
+
+
+}
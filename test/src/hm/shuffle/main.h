@@ -0,0 +1,138 @@
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+#include "hm/shuffle.h"
+
+#include "hlp/get-test-data.h"
+#include "hlp/testing-types.h"
+
+namespace {
+
+TEST(HmShuffle, TransposesLanes)
+{
+  const uint8_t input[] = {'A', '1', 'B', '2', 'C', '3'};
+  const uint8_t expected[] = {'A', 'B', 'C', '1', '2', '3'};
+
+  uint8_t out[sizeof(input)] = {0};
+  hm::shuffle(input, 3, 2, out);
+  EXPECT_TRUE(std::equal(std::begin(out), std::end(out), std::begin(expected)));
+
+  uint8_t reversed[sizeof(input)] = {0};
+  hm::unshuffle(out, 3, 2, reversed);
+  EXPECT_TRUE(std::equal(std::begin(reversed), std::end(reversed), std::begin(input)));
+}
+
+TEST(HmShuffle, MatchesTransposition)
+{
+  // counts cover full blocks of the vectorized paths as well as the tails
+  for(size_t entity_size = 1; entity_size <= 16; ++entity_size)
+  {
+    for(size_t count = 0; count <= 70; ++count)
+    {
+      std::vector<uint8_t> input(count * entity_size);
+      for(size_t i = 0; i < input.size(); ++i)
+        input[i] = static_cast<uint8_t>(i * 7 + i / 256);
+
+      std::vector<uint8_t> out(input.size());
+      hm::shuffle(input.data(), count, entity_size, out.data());
+
+      for(size_t i = 0; i < count; ++i)
+        for(size_t k = 0; k < entity_size; ++k)
+          ASSERT_EQ(out.at(k * count + i), input.at(i * entity_size + k));
+
+      std::vector<uint8_t> reversed(input.size());
+      hm::unshuffle(out.data(), count, entity_size, reversed.data());
+      EXPECT_EQ(reversed, input);
+    }
+  }
+}
+
+TEST(HmShuffle, ThrowsOnPartialEntity)
+{
+  const uint8_t input[] = {1, 2, 3};
+  std::vector<uint8_t> out;
+  EXPECT_THROW(
+    hm::encode_lanes(input, sizeof(input), 2, false, std::back_inserter(out)),
+    hm::invalid_layout
+  );
+}
+
+TEST(HmShuffle, ThrowsOnMissingLane)
+{
+  const uint8_t input[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  std::vector<uint8_t> out;
+  auto md = hm::encode_lanes(input, sizeof(input), 4, false, std::back_inserter(out));
+
+  std::vector<uint8_t> decoded;
+  EXPECT_THROW(
+    hm::decode_lanes(md, out.begin(), out.end() - 1, std::back_inserter(decoded)),
+    hm::invalid_layout
+  );
+}
+
+
+template<typename T>
+class HmShuffleT : public ::testing::Test {};
+TYPED_TEST_CASE(HmShuffleT, ::hlp::testing_types);
+TYPED_TEST(HmShuffleT, RoundTrip)
+{
+  typedef TypeParam entity_type;
+  const auto inputs = ::hlp::get_test_data<entity_type>();
+
+  for(bool rle : {false, true})
+  {
+    for(const auto& input : inputs)
+    {
+      std::vector<uint8_t> out;
+      auto md = hm::encode_lanes(
+        input.data(),
+        input.size(),
+        sizeof(entity_type),
+        rle,
+        std::back_inserter(out)
+      );
+
+      EXPECT_EQ(md.entity_size, sizeof(entity_type));
+      EXPECT_TRUE(md.flags & hm::flag_shuffle);
+      EXPECT_EQ(md.data_byte_count, out.size());
+
+      std::vector<uint8_t> decoded;
+      hm::decode_lanes(md, out.begin(), out.end(), std::back_inserter(decoded));
+      EXPECT_EQ(decoded, input);
+    }
+  }
+}
+
+TYPED_TEST(HmShuffleT, InputIterator)
+{
+  typedef TypeParam entity_type;
+  const auto inputs = ::hlp::get_test_data<entity_type>();
+
+  for(const auto& input : inputs)
+  {
+    std::basic_stringstream<uint8_t> in;
+    auto md = hm::encode_lanes(
+      input.data(),
+      input.size(),
+      sizeof(entity_type),
+      true,
+      std::ostreambuf_iterator<uint8_t>(in)
+    );
+
+    std::vector<uint8_t> decoded;
+    hm::decode_lanes(
+      md,
+      std::istreambuf_iterator<uint8_t>(in),
+      std::istreambuf_iterator<uint8_t>(),
+      std::back_inserter(decoded)
+    );
+    EXPECT_EQ(decoded, input);
+  }
+}
+
+
+}
@@ -0,0 +1,153 @@
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "gtest/gtest.h"
+
+#include "hlp/get-test-data.h"
+#include "hlp/testing-types.h"
+
+#include "hm/symbols.h"
+#include "hm/encode.h"
+#include "hm/decode.h"
+
+namespace {
+
+TEST(HmSymbols, NumbersByFirstOccurrence)
+{
+  const uint32_t entities[] = {70, 5, 70, 70, 9, 5};
+  std::vector<uint8_t> input;
+  for(auto entity : entities)
+    hm::encode_type(entity, std::back_inserter(input));
+
+  hm::symbol_index<uint32_t> symbols;
+  std::vector<uint8_t> symbol_stream;
+  hm::count_symbols<uint32_t>(input.begin(), input.end(), symbols, &symbol_stream);
+
+  EXPECT_EQ(symbols.size(), 3);
+  EXPECT_EQ(symbols.entities(), (std::vector<uint32_t>{70, 5, 9}));
+  EXPECT_EQ(symbols.counts(), (std::vector<uint64_t>{3, 2, 1}));
+  EXPECT_EQ(symbols.at(9), 2);
+  EXPECT_THROW(symbols.at(6), std::out_of_range);
+
+  ASSERT_EQ(symbol_stream.size(), 6 * sizeof(hm::symbol_type));
+  auto in_begin = symbol_stream.cbegin();
+  const hm::symbol_type expected[] = {0, 1, 0, 0, 2, 1};
+  for(auto symbol : expected)
+    EXPECT_EQ(hm::decode_type<hm::symbol_type>(in_begin, symbol_stream.cend()), symbol);
+}
+
+TEST(HmSymbols, AddsCounts)
+{
+  hm::symbol_index<uint64_t> symbols;
+  symbols.reserve(2);
+  EXPECT_EQ(symbols.add(8, 5), 0);
+  EXPECT_EQ(symbols.add(3), 1);
+  EXPECT_EQ(symbols.add(8, 2), 0);
+
+  EXPECT_EQ(symbols.entities(), (std::vector<uint64_t>{8, 3}));
+  EXPECT_EQ(symbols.counts(), (std::vector<uint64_t>{7, 1}));
+}
+
+TEST(HmSymbols, CanonicalCodesMatchTree)
+{
+  const std::vector<size_t> lengths = {3, 1, 3, 2};
+  const std::vector<size_t> order = hm::canonical_order(lengths, {});
+  EXPECT_EQ(order, (std::vector<size_t>{1, 3, 0, 2}));
+
+  const auto codes = hm::canonical_codes(lengths, order);
+  EXPECT_EQ(codes[1], (hm::code_type{0}));
+  EXPECT_EQ(codes[3], (hm::code_type{1, 0}));
+  EXPECT_EQ(codes[0], (hm::code_type{1, 1, 0}));
+  EXPECT_EQ(codes[2], (hm::code_type{1, 1, 1}));
+
+  // a single entity is coded with one bit
+  EXPECT_EQ(hm::canonical_codes({1}, {0}), std::vector<hm::code_type>{hm::code_type{0}});
+}
+
+template <typename T>
+class HmSymbolsT : public ::testing::Test {};
+TYPED_TEST_CASE(HmSymbolsT, ::hlp::testing_types);
+TYPED_TEST(HmSymbolsT, CodesMatchTree)
+{
+  typedef TypeParam entity_type;
+  const auto inputs = ::hlp::get_test_data<entity_type>();
+  for(const auto& input : inputs)
+  {
+    hm::symbol_index<entity_type> symbols;
+    hm::count_symbols<entity_type>(input.begin(), input.end(), symbols);
+    if( symbols.size() == 0 )
+      continue;
+
+    const auto lengths = hm::code_lengths(symbols.counts());
+    const auto order = hm::canonical_order(lengths, symbols.numbers());
+    const auto tree = hm::build_canonical_huffman_tree(
+      symbols.entities(),
+      symbols.counts(),
+      lengths,
+      order
+    );
+    const auto codes = hm::canonical_codes(lengths, order);
+
+    std::unordered_map<entity_type, hm::code_type> table;
+    hm::code_type prefix;
+    hm::build_huffman_table(tree.get(), table, prefix);
+
+    ASSERT_EQ(table.size(), symbols.size());
+    for(size_t i = 0; i < symbols.size(); ++i)
+      EXPECT_EQ(table.at(symbols.entities()[i]), codes[i]);
+  }
+}
+
+TYPED_TEST(HmSymbolsT, SymbolStreamRoundTrip)
+{
+  typedef TypeParam entity_type;
+  const auto inputs = ::hlp::get_test_data<entity_type>();
+  for(const auto& input : inputs)
+  {
+    hm::symbol_index<entity_type> symbols;
+    std::vector<uint8_t> symbol_stream;
+    hm::count_symbols<entity_type>(input.begin(), input.end(), symbols, &symbol_stream);
+    if( symbols.size() == 0 )
+      continue;
+
+    const auto lengths = hm::code_lengths(symbols.counts());
+    const auto order = hm::canonical_order(lengths, {});
+    const auto tree = hm::build_canonical_huffman_tree(
+      symbols.entities(),
+      symbols.counts(),
+      lengths,
+      order
+    );
+    const hm::symbol_codes codes(hm::canonical_codes(lengths, order));
+
+    // coding the symbols is the same as coding the entities
+    std::vector<uint8_t> from_symbols;
+    const auto md = hm::encode(
+      symbol_stream.cbegin(),
+      symbol_stream.cend(),
+      tree.get(),
+      codes,
+      std::back_inserter(from_symbols)
+    );
+
+    std::vector<uint8_t> from_entities;
+    const auto md_entities = hm::encode(
+      input.begin(),
+      input.end(),
+      tree.get(),
+      hm::entity_codes<entity_type>(symbols, codes),
+      std::back_inserter(from_entities)
+    );
+    EXPECT_EQ(from_symbols, from_entities);
+    EXPECT_EQ(md.data_byte_count, md_entities.data_byte_count);
+
+    std::vector<uint8_t> out;
+    hm::decode(md, from_symbols.begin(), from_symbols.end(), std::back_inserter(out));
+    EXPECT_EQ(out, input);
+  }
+}
+
+}
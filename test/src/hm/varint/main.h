@@ -0,0 +1,66 @@
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+
+#include "gtest/gtest.h"
+
+#include "hm/varint.h"
+
+namespace {
+
+TEST(HmVarint, RoundTrip)
+{
+  const uint64_t values[] = {
+    0, 1, 127, 128, 300, 16383, 16384,
+    std::numeric_limits<uint32_t>::max(),
+    std::numeric_limits<uint64_t>::max() - 1,
+    std::numeric_limits<uint64_t>::max()
+  };
+
+  for(auto value : values)
+  {
+    std::vector<uint8_t> out;
+    const size_t written = hm::encode_varint(value, std::back_inserter(out));
+    EXPECT_EQ(written, out.size());
+    EXPECT_EQ(hm::varint_byte_count(value), out.size());
+
+    auto in_begin = out.begin();
+    uint64_t byte_count = 0;
+    EXPECT_EQ(hm::decode_varint(in_begin, out.end(), byte_count), value);
+    EXPECT_EQ(byte_count, out.size());
+    EXPECT_TRUE(in_begin == out.end());
+  }
+
+  EXPECT_EQ(hm::varint_byte_count(127), 1);
+  EXPECT_EQ(hm::varint_byte_count(128), 2);
+  EXPECT_EQ(
+    hm::varint_byte_count(std::numeric_limits<uint64_t>::max()),
+    hm::max_varint_byte_count
+  );
+}
+
+TEST(HmVarint, ThrowsInvalid)
+{
+  uint64_t byte_count = 0;
+
+  // continuation bit set on the last byte
+  const std::vector<uint8_t> truncated = {0x80, 0x80};
+  auto in_begin = truncated.begin();
+  EXPECT_THROW(
+    hm::decode_varint(in_begin, truncated.end(), byte_count),
+    hm::invalid_layout
+  );
+
+  // more than 64 bits
+  std::vector<uint8_t> overlong(hm::max_varint_byte_count - 1, 0xff);
+  overlong.push_back(0x02);
+  auto overlong_begin = overlong.begin();
+  EXPECT_THROW(
+    hm::decode_varint(overlong_begin, overlong.end(), byte_count),
+    hm::invalid_layout
+  );
+}
+
+
+}
@@ -5,6 +5,29 @@
 #include "hm/common/main.h"
 #include "hm/encode/main.h"
 #include "hm/decode/main.h"
+#include "hm/rle/main.h"
+#include "hm/filter/main.h"
+#include "hm/shuffle/main.h"
+#include "hm/entity/main.h"
+#include "hm/dispatch/main.h"
+#include "hm/estimate/main.h"
+#include "hm/crc32c/main.h"
+#include "hm/varint/main.h"
+#include "hm/archive/main.h"
+#include "hm/flat-map/main.h"
+#include "hm/symbols/main.h"
+#include "hm/radix-count/main.h"
+#include "hm/allocation/main.h"
+#include "sp/spsc-queue/main.h"
+#include "sp/pipeline-streambuf/main.h"
+#include "sp/uring-streambuf/main.h"
+#include "sp/work-stealing-pool/main.h"
+#include "sp/batch/main.h"
+#include "sp/slice-streambuf/main.h"
+#include "sp/archive-file/main.h"
+#include "sp/mapped-file/main.h"
+#include "sp/crc32c-streambuf/main.h"
+#include "corpus/main.h"
 #include "hlp/main.h"
 
 int main(int argc, char **argv) {
@@ -0,0 +1,84 @@
+#include <cstdint>
+#include <string>
+#include <sstream>
+#include <istream>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "hlp/get-test-bytes.h"
+
+#include "hm/archive.h"
+#include "hm/crc32c.h"
+#include "hm/exception.h"
+#include "sp/archive-file.h"
+#include "sp/crc32c-streambuf.h"
+#include "sp/slice-streambuf.h"
+
+namespace {
+
+TEST(SpArchiveFile, RoundTrip)
+{
+  const std::vector<std::string> contents {
+    ::hlp::get_test_bytes(100000, 10),
+    std::string(),
+    ::hlp::get_test_bytes(3 * sp::archive_block_size + 1, 11)
+  };
+  const std::vector<std::string> names {"a", "empty", "b.bin"};
+
+  std::stringstream archive(std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+  std::vector<hm::archive_member> members(contents.size());
+  uint64_t offset = 0;
+  for(size_t i = 0; i < contents.size(); ++i)
+  {
+    std::istringstream member_file(contents[i]);
+    members[i].name = names[i];
+    sp::append_archive_member(member_file, archive, offset, members[i]);
+
+    EXPECT_EQ(members[i].offset, offset);
+    EXPECT_EQ(members[i].byte_count, contents[i].size());
+    EXPECT_EQ(
+      members[i].checksum,
+      hm::crc32c(
+        reinterpret_cast<const uint8_t *>(contents[i].data()),
+        contents[i].size()
+      )
+    );
+    offset += members[i].byte_count;
+  }
+  sp::write_archive_directory(members, offset, archive);
+
+  const hm::archive_index index = sp::read_archive_index(archive);
+  ASSERT_EQ(index.members().size(), contents.size());
+
+  // each member is read in place, checksummed on the way
+  for(size_t i = 0; i < contents.size(); ++i)
+  {
+    const hm::archive_member * member = index.find(names[i]);
+    ASSERT_NE(member, nullptr);
+
+    archive.clear();
+    sp::slice_istreambuf slice(archive.rdbuf(), member->offset, member->byte_count);
+    sp::crc32c_istreambuf checked_buf(&slice);
+    std::istream input(&checked_buf);
+    const std::string read(
+      (std::istreambuf_iterator<char>(input)),
+      std::istreambuf_iterator<char>()
+    );
+
+    EXPECT_EQ(read, contents[i]);
+    EXPECT_EQ(checked_buf.checksum(), member->checksum);
+  }
+}
+
+TEST(SpArchiveFile, RejectsNonArchives)
+{
+  std::istringstream empty{std::string()};
+  EXPECT_THROW(sp::read_archive_index(empty), hm::invalid_layout);
+
+  std::istringstream random(::hlp::get_test_bytes(1000, 12));
+  EXPECT_THROW(sp::read_archive_index(random), hm::invalid_layout);
+}
+
+
+}
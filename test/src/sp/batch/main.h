@@ -0,0 +1,109 @@
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <stdexcept>
+#include <atomic>
+
+#include "gtest/gtest.h"
+
+#include "hlp/temp-file.h"
+
+#include "hm/exception.h"
+#include "sp/batch.h"
+
+namespace {
+
+TEST(SpBatch, RecognizesSuffix)
+{
+  EXPECT_TRUE(sp::has_batch_suffix("file.hm"));
+  EXPECT_TRUE(sp::has_batch_suffix("dir/file.txt.hm"));
+  EXPECT_FALSE(sp::has_batch_suffix(".hm"));
+  EXPECT_FALSE(sp::has_batch_suffix("file.hmx"));
+  EXPECT_FALSE(sp::has_batch_suffix("file"));
+}
+
+TEST(SpBatch, ListsInputsOfListFile)
+{
+  ::hlp::temp_file list;
+  list.write("a.txt\r\n\nb/c.hm\n");
+
+  // a list file is taken as is, whether encoding or decoding
+  for(bool decode : {false, true})
+  {
+    std::vector<std::string> paths;
+    std::ostringstream err;
+    EXPECT_TRUE(sp::list_inputs(list.path(), decode, paths, err));
+    EXPECT_EQ(paths, (std::vector<std::string>{"a.txt", "b/c.hm"}));
+    EXPECT_TRUE(err.str().empty());
+  }
+
+  std::vector<std::string> paths;
+  std::ostringstream err;
+  EXPECT_FALSE(sp::list_inputs("/nonexistent/list", false, paths, err));
+  EXPECT_FALSE(err.str().empty());
+}
+
+TEST(SpBatch, RunsAllJobsAndCountsFailures)
+{
+  const std::vector<std::string> names {"a", "b", "c", "d", "e", "f", "g"};
+
+  for(size_t worker_count : {0, 1, 3, 16})
+  {
+    std::vector<int> runs(names.size(), 0);
+    std::atomic<size_t> missing_buffers(0);
+    std::ostringstream err;
+
+    const size_t failed_count = sp::run_jobs(
+      worker_count,
+      names,
+      [&](size_t i, std::ostream& job_err, sp::file_buffers& buffers) {
+        runs[i]++;
+        if( buffers.input.size() != sp::file_buffer_size )
+          missing_buffers++;
+
+        if( names[i] == "b" )
+        {
+          job_err << "failed b\n";
+          return EXIT_FAILURE;
+        }
+        if( names[i] == "d" )
+          throw hm::invalid_layout("broken");
+        if( names[i] == "f" )
+          throw std::runtime_error("unexpected");
+
+        return EXIT_SUCCESS;
+      },
+      err
+    );
+
+    EXPECT_EQ(failed_count, 3U);
+    EXPECT_EQ(runs, std::vector<int>(names.size(), 1));
+    EXPECT_EQ(missing_buffers.load(), 0U);
+
+    const std::string messages = err.str();
+    EXPECT_NE(messages.find("failed b"), std::string::npos);
+    EXPECT_NE(messages.find("invalid input d: broken"), std::string::npos);
+    EXPECT_NE(messages.find("f: unexpected"), std::string::npos);
+    EXPECT_NE(messages.find("3 of 7 files failed"), std::string::npos);
+  }
+}
+
+TEST(SpBatch, RunsNoJobs)
+{
+  std::ostringstream err;
+  EXPECT_EQ(
+    sp::run_jobs(
+      4,
+      std::vector<std::string>(),
+      [](size_t, std::ostream&, sp::file_buffers&) { return EXIT_FAILURE; },
+      err
+    ),
+    0U
+  );
+  EXPECT_TRUE(err.str().empty());
+}
+
+
+}
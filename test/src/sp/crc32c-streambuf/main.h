@@ -0,0 +1,100 @@
+#include <cstdint>
+#include <string>
+#include <sstream>
+#include <istream>
+#include <ostream>
+#include <iterator>
+
+#include "gtest/gtest.h"
+
+#include "hlp/get-test-bytes.h"
+
+#include "hm/crc32c.h"
+#include "sp/crc32c-streambuf.h"
+
+namespace {
+
+uint32_t crc32c_of_string(const std::string& bytes)
+{
+  return hm::crc32c(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size());
+}
+
+TEST(SpCrc32cStreambuf, ChecksumsInput)
+{
+  const std::string bytes = ::hlp::get_test_bytes(3 * sp::crc32c_block_size + 5, 16);
+  std::stringbuf source(bytes, std::ios_base::in);
+  sp::crc32c_istreambuf checked_buf(&source);
+  std::istream input(&checked_buf);
+
+  const std::string read(
+    (std::istreambuf_iterator<char>(input)),
+    std::istreambuf_iterator<char>()
+  );
+  EXPECT_EQ(read, bytes);
+  EXPECT_EQ(checked_buf.checksum(), crc32c_of_string(bytes));
+}
+
+TEST(SpCrc32cStreambuf, RestartsOnSeekToBeginning)
+{
+  const std::string bytes = ::hlp::get_test_bytes(2 * sp::crc32c_block_size, 17);
+  std::stringbuf source(bytes, std::ios_base::in);
+  sp::crc32c_istreambuf checked_buf(&source);
+  std::istream input(&checked_buf);
+
+  // e.g. the encoder reads the input to count it, then again to code it
+  std::string read(
+    (std::istreambuf_iterator<char>(input)),
+    std::istreambuf_iterator<char>()
+  );
+  input.clear();
+  input.seekg(0);
+  read.assign(
+    (std::istreambuf_iterator<char>(input)),
+    std::istreambuf_iterator<char>()
+  );
+
+  EXPECT_EQ(read, bytes);
+  EXPECT_EQ(checked_buf.checksum(), crc32c_of_string(bytes));
+}
+
+TEST(SpCrc32cStreambuf, SeeksRelativeToConsumedBytes)
+{
+  const std::string bytes = ::hlp::get_test_bytes(sp::crc32c_block_size + 100, 18);
+  std::stringbuf source(bytes, std::ios_base::in);
+  sp::crc32c_istreambuf checked_buf(&source);
+  std::istream input(&checked_buf);
+
+  char c = 0;
+  input.get(c);
+  input.seekg(9, std::ios_base::cur);
+  EXPECT_EQ(input.tellg(), std::streampos(10));
+  input.get(c);
+  EXPECT_EQ(c, bytes[10]);
+}
+
+TEST(SpCrc32cStreambuf, ChecksumsOutput)
+{
+  const std::string bytes = ::hlp::get_test_bytes(3 * sp::crc32c_block_size + 5, 19);
+  std::stringbuf target(std::ios_base::out);
+  sp::crc32c_ostreambuf checked_buf(&target);
+  std::ostream output(&checked_buf);
+
+  // a single byte and blocks, both through the buffer and around it
+  output.put(bytes[0]);
+  output.write(bytes.data() + 1, static_cast<std::streamsize>(bytes.size() - 1));
+
+  EXPECT_EQ(checked_buf.checksum(), crc32c_of_string(bytes));
+  EXPECT_EQ(target.str(), bytes);
+}
+
+TEST(SpCrc32cStreambuf, ChecksumsEmptyOutput)
+{
+  std::stringbuf target(std::ios_base::out);
+  sp::crc32c_ostreambuf checked_buf(&target);
+
+  EXPECT_EQ(checked_buf.checksum(), 0U);
+  EXPECT_EQ(target.str(), std::string());
+}
+
+
+}
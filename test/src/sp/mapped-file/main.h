@@ -0,0 +1,94 @@
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <iterator>
+
+#include "gtest/gtest.h"
+
+#include "hlp/get-test-bytes.h"
+#include "hlp/temp-file.h"
+
+#include "hm/exception.h"
+#include "sp/mapped-file.h"
+
+namespace {
+
+TEST(SpMappedFile, WritesThroughBackInserter)
+{
+  ::hlp::temp_file file;
+  ASSERT_FALSE(file.path().empty());
+
+  const std::string bytes = ::hlp::get_test_bytes(300000, 13);
+  sp::mapped_output_file output(file.path(), bytes.size());
+  ASSERT_TRUE(output.is_open());
+  EXPECT_EQ(output.size(), bytes.size());
+
+  std::copy(bytes.begin(), bytes.end(), std::back_inserter(output));
+  EXPECT_EQ(output.written_byte_count(), bytes.size());
+
+  // the file is full
+  EXPECT_THROW(output.push_back(0), hm::invalid_layout);
+
+  EXPECT_TRUE(output.close());
+  EXPECT_FALSE(output.is_open());
+  EXPECT_EQ(file.read(), bytes);
+}
+
+TEST(SpMappedFile, WritesThroughData)
+{
+  ::hlp::temp_file file;
+  ASSERT_FALSE(file.path().empty());
+
+  const std::string bytes = ::hlp::get_test_bytes(5000, 14);
+  sp::mapped_output_file output(file.path(), bytes.size());
+  ASSERT_TRUE(output.is_open());
+  ASSERT_NE(output.data(), nullptr);
+
+  std::memcpy(output.data(), bytes.data(), bytes.size());
+  output.set_written_byte_count(bytes.size());
+
+  EXPECT_TRUE(output.close());
+  EXPECT_EQ(file.read(), bytes);
+}
+
+TEST(SpMappedFile, CutsToBytesWritten)
+{
+  ::hlp::temp_file file;
+  ASSERT_FALSE(file.path().empty());
+
+  const std::string bytes = ::hlp::get_test_bytes(1000, 15);
+  {
+    sp::mapped_output_file output(file.path(), 100000);
+    ASSERT_TRUE(output.is_open());
+    std::copy(bytes.begin(), bytes.end(), std::back_inserter(output));
+
+    // closed on destruction
+  }
+
+  EXPECT_EQ(file.read(), bytes);
+}
+
+TEST(SpMappedFile, OpensEmptyFile)
+{
+  ::hlp::temp_file file;
+  ASSERT_FALSE(file.path().empty());
+
+  sp::mapped_output_file output(file.path(), 0);
+  EXPECT_TRUE(output.is_open());
+  EXPECT_EQ(output.data(), nullptr);
+  EXPECT_THROW(output.push_back(0), hm::invalid_layout);
+
+  EXPECT_TRUE(output.close());
+  EXPECT_EQ(file.read(), std::string());
+}
+
+TEST(SpMappedFile, FailsOnMissingFile)
+{
+  sp::mapped_output_file output("/nonexistent/huffman-test", 100);
+  EXPECT_FALSE(output.is_open());
+  EXPECT_TRUE(output.close());
+}
+
+
+}
@@ -0,0 +1,124 @@
+#include <cstddef>
+#include <string>
+#include <sstream>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+#include "hlp/get-test-bytes.h"
+
+#include "sp/pipeline-streambuf.h"
+
+namespace {
+
+/// Read input to its end in chunks of chunk_size bytes.
+std::string read_pipeline_chunks(std::istream& input, size_t chunk_size)
+{
+  std::string result;
+  std::vector<char> chunk(chunk_size);
+  while( input.read(chunk.data(), static_cast<std::streamsize>(chunk.size()))
+         || input.gcount() > 0 )
+    result.append(chunk.data(), static_cast<size_t>(input.gcount()));
+
+  return result;
+}
+
+TEST(SpPipelineStreambuf, ReadsAhead)
+{
+  // spans the first read and several blocks, ending in a partial block
+  const std::string bytes =
+    ::hlp::get_test_bytes(3 * sp::pipeline_block_size + 12345, 42);
+
+  for(size_t chunk_size : {size_t(1), size_t(10007), sp::pipeline_block_size * 2})
+  {
+    std::stringbuf source(bytes, std::ios_base::in);
+    sp::read_ahead_istreambuf buf(&source);
+    std::istream input(&buf);
+
+    EXPECT_EQ(read_pipeline_chunks(input, chunk_size), bytes);
+  }
+}
+
+TEST(SpPipelineStreambuf, ReadsEmptyInput)
+{
+  std::stringbuf source(std::string(), std::ios_base::in);
+  sp::read_ahead_istreambuf buf(&source);
+  std::istream input(&buf);
+
+  EXPECT_EQ(read_pipeline_chunks(input, 100), std::string());
+}
+
+TEST(SpPipelineStreambuf, SeeksWhileReadingAhead)
+{
+  const std::string bytes =
+    ::hlp::get_test_bytes(2 * sp::pipeline_block_size + 999, 7);
+
+  std::stringbuf source(bytes, std::ios_base::in);
+  sp::read_ahead_istreambuf buf(&source);
+  std::istream input(&buf);
+
+  // the reader thread is running after the second read
+  std::vector<char> chunk(300000);
+  input.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+  EXPECT_EQ(std::string(chunk.data(), chunk.size()), bytes.substr(0, chunk.size()));
+  EXPECT_EQ(static_cast<size_t>(input.tellg()), chunk.size());
+
+  const size_t middle = sp::pipeline_block_size + 17;
+  input.seekg(static_cast<std::streamoff>(middle));
+  input.read(chunk.data(), 1000);
+  EXPECT_EQ(std::string(chunk.data(), 1000), bytes.substr(middle, 1000));
+
+  input.seekg(-10, std::ios_base::end);
+  EXPECT_EQ(read_pipeline_chunks(input, 4), bytes.substr(bytes.size() - 10));
+
+  input.clear();
+  input.seekg(0);
+  EXPECT_EQ(read_pipeline_chunks(input, 65536), bytes);
+}
+
+TEST(SpPipelineStreambuf, WritesBehind)
+{
+  const std::string bytes =
+    ::hlp::get_test_bytes(3 * sp::pipeline_block_size + 4321, 13);
+
+  std::stringbuf target(std::ios_base::out);
+  {
+    sp::write_behind_ostreambuf buf(&target);
+    std::ostream output(&buf);
+
+    // single bytes through overflow, then chunks larger than a block
+    size_t written = 0;
+    for(; written < 1000; ++written)
+      output.put(bytes[written]);
+    while( written < bytes.size() )
+    {
+      const size_t size = std::min(bytes.size() - written, size_t(1500000));
+      output.write(bytes.data() + written, static_cast<std::streamsize>(size));
+      written += size;
+    }
+
+    // seeking flushes the written blocks first
+    output.seekp(0);
+    output.write("HEAD", 4);
+    EXPECT_TRUE(output.good());
+  }
+
+  EXPECT_EQ(target.str(), "HEAD" + bytes.substr(4));
+}
+
+TEST(SpPipelineStreambuf, FlushesOnSync)
+{
+  std::stringbuf target(std::ios_base::out);
+  sp::write_behind_ostreambuf buf(&target);
+  std::ostream output(&buf);
+
+  output << "abc";
+  output.flush();
+  EXPECT_EQ(target.str(), "abc");
+}
+
+
+}
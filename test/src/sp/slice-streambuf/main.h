@@ -0,0 +1,69 @@
+#include <cstddef>
+#include <string>
+#include <sstream>
+#include <istream>
+#include <iterator>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "hlp/get-test-bytes.h"
+
+#include "sp/slice-streambuf.h"
+
+namespace {
+
+TEST(SpSliceStreambuf, ReadsSlice)
+{
+  const std::string bytes = ::hlp::get_test_bytes(5 * sp::slice_block_size, 8);
+  const size_t offset = 1000;
+  const size_t byte_count = 3 * sp::slice_block_size + 17;
+
+  std::stringbuf source(bytes, std::ios_base::in);
+  sp::slice_istreambuf slice(&source, offset, byte_count);
+  std::istream input(&slice);
+
+  const std::string read(
+    (std::istreambuf_iterator<char>(input)),
+    std::istreambuf_iterator<char>()
+  );
+  EXPECT_EQ(read, bytes.substr(offset, byte_count));
+}
+
+TEST(SpSliceStreambuf, SeeksRelativeToSlice)
+{
+  const std::string bytes = ::hlp::get_test_bytes(3 * sp::slice_block_size, 9);
+  const size_t offset = 500;
+  const size_t byte_count = 2 * sp::slice_block_size;
+
+  std::stringbuf source(bytes, std::ios_base::in);
+  sp::slice_istreambuf slice(&source, offset, byte_count);
+  std::istream input(&slice);
+
+  // the size of the slice, as the encoder and decoder measure streams
+  input.seekg(0, std::ios_base::end);
+  EXPECT_EQ(static_cast<size_t>(input.tellg()), byte_count);
+
+  std::vector<char> chunk(100);
+  input.seekg(static_cast<std::streamoff>(sp::slice_block_size - 50));
+  input.read(chunk.data(), 100);
+  EXPECT_EQ(
+    std::string(chunk.data(), 100),
+    bytes.substr(offset + sp::slice_block_size - 50, 100)
+  );
+  EXPECT_EQ(static_cast<size_t>(input.tellg()), sp::slice_block_size + 50);
+
+  // reading stops at the end of the slice, not of the source
+  input.seekg(-10, std::ios_base::end);
+  input.read(chunk.data(), 100);
+  EXPECT_EQ(input.gcount(), 10);
+  EXPECT_EQ(std::string(chunk.data(), 10), bytes.substr(offset + byte_count - 10, 10));
+
+  // beyond the slice
+  input.clear();
+  input.seekg(static_cast<std::streamoff>(byte_count + 1));
+  EXPECT_TRUE(input.fail());
+}
+
+
+}
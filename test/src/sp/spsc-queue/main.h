@@ -0,0 +1,71 @@
+#include <cstddef>
+#include <atomic>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "sp/spsc-queue.h"
+
+namespace {
+
+TEST(SpSpscQueue, KeepsOrderAndCapacity)
+{
+  sp::spsc_queue<int> queue(2);
+
+  int value = 1;
+  EXPECT_TRUE(queue.try_push(value));
+  value = 2;
+  EXPECT_TRUE(queue.try_push(value));
+
+  // full, the value is left untouched
+  value = 3;
+  EXPECT_FALSE(queue.try_push(value));
+  EXPECT_EQ(value, 3);
+
+  EXPECT_TRUE(queue.try_pop(value));
+  EXPECT_EQ(value, 1);
+  EXPECT_TRUE(queue.try_pop(value));
+  EXPECT_EQ(value, 2);
+  EXPECT_FALSE(queue.try_pop(value));
+}
+
+TEST(SpSpscQueue, HandsValuesBetweenThreads)
+{
+  const size_t count = 100000;
+  sp::spsc_queue<size_t> queue(4);
+  std::atomic<bool> cancel(false);
+
+  std::thread producer([&]() {
+    for(size_t i = 0; i < count; ++i)
+    {
+      size_t value = i;
+      queue.push(value, cancel);
+    }
+  });
+
+  size_t mismatches = 0;
+  for(size_t i = 0; i < count; ++i)
+  {
+    size_t value = 0;
+    ASSERT_TRUE(queue.pop(value, cancel));
+    if( value != i )
+      mismatches++;
+  }
+  producer.join();
+
+  EXPECT_EQ(mismatches, 0U);
+}
+
+TEST(SpSpscQueue, GivesUpOnCancel)
+{
+  sp::spsc_queue<int> queue(1);
+  std::atomic<bool> cancel(true);
+
+  int value = 0;
+  EXPECT_FALSE(queue.pop(value, cancel));
+  EXPECT_TRUE(queue.push(value, cancel));
+  EXPECT_FALSE(queue.push(value, cancel));
+}
+
+
+}
@@ -0,0 +1,162 @@
+#include <cstddef>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+#include "hlp/get-test-bytes.h"
+#include "hlp/temp-file.h"
+
+#include "sp/uring-streambuf.h"
+
+namespace {
+
+TEST(SpUringStreambuf, ReadsFile)
+{
+  const std::string bytes =
+    ::hlp::get_test_bytes(sp::uring_queue_depth * sp::uring_block_size + 777, 3);
+  ::hlp::temp_file file;
+  ASSERT_FALSE(file.path().empty());
+  file.write(bytes);
+
+  // io_uring where available, and always the pread fallback
+  for(bool async : {true, false})
+  {
+    sp::uring_istreambuf buf(file.path(), async);
+    ASSERT_TRUE(buf.is_open());
+    if( !async )
+    {
+      EXPECT_FALSE(buf.is_async());
+    }
+
+    std::istream input(&buf);
+    const std::string read(
+      (std::istreambuf_iterator<char>(input)),
+      std::istreambuf_iterator<char>()
+    );
+    EXPECT_EQ(read, bytes);
+  }
+}
+
+TEST(SpUringStreambuf, SeeksWhileReading)
+{
+  const std::string bytes =
+    ::hlp::get_test_bytes(3 * sp::uring_block_size + 5, 4);
+  ::hlp::temp_file file;
+  file.write(bytes);
+
+  for(bool async : {true, false})
+  {
+    sp::uring_istreambuf buf(file.path(), async);
+    std::istream input(&buf);
+
+    std::vector<char> chunk(sp::uring_block_size + 100);
+    input.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    EXPECT_EQ(std::string(chunk.data(), chunk.size()), bytes.substr(0, chunk.size()));
+    EXPECT_EQ(static_cast<size_t>(input.tellg()), chunk.size());
+
+    const size_t middle = 2 * sp::uring_block_size - 50;
+    input.seekg(static_cast<std::streamoff>(middle));
+    input.read(chunk.data(), 100);
+    EXPECT_EQ(std::string(chunk.data(), 100), bytes.substr(middle, 100));
+
+    input.seekg(-3, std::ios_base::end);
+    input.read(chunk.data(), 10);
+    EXPECT_EQ(input.gcount(), 3);
+    EXPECT_EQ(std::string(chunk.data(), 3), bytes.substr(bytes.size() - 3));
+  }
+}
+
+TEST(SpUringStreambuf, FailsOnMissingFile)
+{
+  sp::uring_istreambuf input("/nonexistent/huffman-test");
+  EXPECT_FALSE(input.is_open());
+
+  sp::uring_ostreambuf output("/nonexistent/huffman-test");
+  EXPECT_FALSE(output.is_open());
+}
+
+TEST(SpUringStreambuf, WritesFile)
+{
+  const std::string bytes =
+    ::hlp::get_test_bytes(sp::uring_queue_depth * sp::uring_block_size + 999, 5);
+
+  for(bool async : {true, false})
+  {
+    ::hlp::temp_file file;
+    {
+      sp::uring_ostreambuf buf(file.path(), async);
+      ASSERT_TRUE(buf.is_open());
+      if( !async )
+      {
+        EXPECT_FALSE(buf.is_async());
+      }
+
+      std::ostream output(&buf);
+      output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+      EXPECT_EQ(static_cast<size_t>(output.tellp()), bytes.size());
+
+      // seeking waits for the writes in flight
+      output.seekp(0);
+      output.write("HEAD", 4);
+      output.flush();
+      EXPECT_TRUE(output.good());
+    }
+
+    EXPECT_EQ(file.read(), "HEAD" + bytes.substr(4));
+  }
+}
+
+TEST(SpUringStreambuf, CompletesShortTransfers)
+{
+  const std::string bytes = ::hlp::get_test_bytes(1000, 6);
+  ::hlp::temp_file file;
+  file.write(bytes);
+
+  const int fd = ::open(file.path().c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+
+  // io_uring read the first 100 bytes, pread reads the rest
+  sp::uring_slot slot;
+  slot.data.resize(600, '\0');
+  slot.offset = 300;
+  slot.size = 600;
+  slot.result = 100;
+  std::copy(bytes.begin() + 300, bytes.begin() + 400, slot.data.begin());
+  EXPECT_TRUE(sp::complete_slot(fd, slot, false));
+  EXPECT_EQ(slot.result, 600);
+  EXPECT_EQ(std::string(slot.data.begin(), slot.data.end()), bytes.substr(300, 600));
+
+  // reading stops early at the end of the file
+  slot.offset = 900;
+  slot.result = 0;
+  EXPECT_TRUE(sp::complete_slot(fd, slot, false));
+  EXPECT_EQ(slot.result, 100);
+
+  // pwrite writes the rest of a short write
+  slot.data.assign(600, 'x');
+  slot.offset = 0;
+  slot.result = 200;
+  EXPECT_TRUE(sp::complete_slot(fd, slot, true));
+  EXPECT_EQ(slot.result, 600);
+
+  // a failed request fails
+  slot.result = -5;
+  EXPECT_FALSE(sp::complete_slot(fd, slot, true));
+
+  ::close(fd);
+
+  const std::string written = file.read();
+  EXPECT_EQ(written.substr(0, 200), bytes.substr(0, 200));
+  EXPECT_EQ(written.substr(200, 400), std::string(400, 'x'));
+  EXPECT_EQ(written.substr(600), bytes.substr(600));
+}
+
+
+}
@@ -0,0 +1,63 @@
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <memory>
+
+#include "gtest/gtest.h"
+
+#include "sp/work-stealing-pool.h"
+
+namespace {
+
+TEST(SpWorkStealingPool, RunsEveryTaskOnce)
+{
+  for(size_t worker_count : {0, 1, 2, 3, 8})
+  {
+    for(size_t task_count : {0, 1, 5, 1000})
+    {
+      sp::work_stealing_pool pool(worker_count);
+      EXPECT_EQ(pool.size(), worker_count ? worker_count : 1);
+
+      std::unique_ptr<std::atomic<int>[]> runs(new std::atomic<int>[task_count]);
+      for(size_t i = 0; i < task_count; ++i)
+        runs[i] = 0;
+      std::atomic<size_t> invalid_workers(0);
+
+      std::vector<sp::work_stealing_pool::task_type> tasks;
+      for(size_t i = 0; i < task_count; ++i)
+      {
+        tasks.push_back([&, i](size_t worker) {
+          runs[i]++;
+          if( worker >= pool.size() )
+            invalid_workers++;
+        });
+      }
+
+      pool.run(std::move(tasks));
+
+      for(size_t i = 0; i < task_count; ++i)
+        EXPECT_EQ(runs[i].load(), 1) << worker_count << " workers, task " << i;
+      EXPECT_EQ(invalid_workers.load(), 0U);
+    }
+  }
+}
+
+TEST(SpWorkStealingPool, RunsRepeatedly)
+{
+  sp::work_stealing_pool pool(4);
+
+  std::atomic<size_t> count(0);
+  for(size_t round = 0; round < 3; ++round)
+  {
+    std::vector<sp::work_stealing_pool::task_type> tasks(
+      10,
+      [&count](size_t) { count++; }
+    );
+    pool.run(std::move(tasks));
+  }
+
+  EXPECT_EQ(count.load(), 30U);
+}
+
+
+}